@@ -46,6 +46,7 @@ ADD_SUBDIRECTORY ( src-wnd		)
 ADD_SUBDIRECTORY ( src-main		)
 ADD_SUBDIRECTORY ( src-dox		)
 ADD_SUBDIRECTORY ( src-find-dup	)
+ADD_SUBDIRECTORY ( src-verify-shards )
 
 IF (UNIX AND NOT APPLE)
 	ADD_SUBDIRECTORY ( src-ubuntu	)
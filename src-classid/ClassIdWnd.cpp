@@ -2,6 +2,306 @@
 
 #include "DarkMark.hpp"
 
+#include "json.hpp"
+using json = nlohmann::json;
+
+#if JUCE_LINUX
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#elif JUCE_MAC
+#include <sys/clonefile.h>
+#endif
+
+
+namespace
+{
+	/// Name of the journal written in the project directory while the classes are being remapped.
+	const std::string remap_journal_filename = "darkmark_class_remap.json";
+
+	/// The remapped files are first written with this suffix.
+	const std::string new_suffix = ".darkmark_new";
+
+	/// Until the remap is complete, the original files are kept with this suffix.
+	const std::string old_suffix = ".darkmark_old";
+
+
+	void write_file(const std::string & filename, const std::string & content)
+	{
+		std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+		ofs << content;
+		ofs.close();
+		if (ofs.fail())
+		{
+			throw std::runtime_error("failed to write " + filename);
+		}
+
+		return;
+	}
+
+
+	void write_journal(const File & journal, const json & root)
+	{
+		// the journal itself is also replaced atomically, so it is never seen half-written
+		const std::string tmp = journal.getFullPathName().toStdString() + new_suffix;
+		write_file(tmp, root.dump(1, '\t') + "\n");
+		std::filesystem::rename(tmp, journal.getFullPathName().toStdString());
+
+		return;
+	}
+
+
+	/** Rewrite the class of each annotation in the content of a .txt file.  Only the class at the start of each line is
+	 * changed, the coordinates are kept exactly as they were.  Lines which cannot be parsed are kept as-is.
+	 * @returns @p true if anything was modified.
+	 */
+	bool remap_txt(const std::string & content, const std::set<size_t> & to_be_deleted, const std::map<size_t, size_t> & to_be_renumbered, std::string & output, size_t & annotations_deleted, size_t & annotations_remapped)
+	{
+		bool modified = false;
+		output.clear();
+		output.reserve(content.size());
+
+		const char * p			= content.data();
+		const char * const end	= p + content.size();
+		while (p < end)
+		{
+			const char * eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+			eol = (eol == nullptr ? end : eol + 1);
+
+			const char * start = p;
+			while (start < eol and (*start == ' ' or *start == '\t'))
+			{
+				start ++;
+			}
+
+			int class_idx = -1;
+			const char * const next = dm::parse_int(start, eol, class_idx);
+			if (next == nullptr or class_idx < 0 or (next < eol and not std::isspace(static_cast<unsigned char>(*next))))
+			{
+				output.append(p, eol);
+			}
+			else if (to_be_deleted.count(class_idx))
+			{
+				modified = true;
+				annotations_deleted ++;
+			}
+			else if (to_be_renumbered.count(class_idx))
+			{
+				modified = true;
+				annotations_remapped ++;
+				output += std::to_string(to_be_renumbered.at(class_idx));
+				output.append(next, eol);
+			}
+			else
+			{
+				output.append(p, eol);
+			}
+
+			p = eol;
+		}
+
+		return modified;
+	}
+
+
+	/** Rewrite the class index and name of each mark in a .json file the same way as @ref remap_txt().  If all the marks
+	 * are deleted, the image becomes a negative sample just like the empty .txt file.
+	 * @returns @p true if anything was modified.
+	 */
+	bool remap_json(json & root, const std::set<size_t> & to_be_deleted, const std::map<size_t, size_t> & to_be_renumbered, const std::map<size_t, std::string> & names)
+	{
+		if (not root.contains("mark") or not root["mark"].is_array())
+		{
+			return false;
+		}
+
+		bool modified = false;
+		json marks = json::array();
+		for (auto mark : root["mark"])
+		{
+			size_t class_idx = mark.value("class_idx", 0);
+			if (to_be_deleted.count(class_idx))
+			{
+				modified = true;
+				continue;
+			}
+
+			if (to_be_renumbered.count(class_idx))
+			{
+				modified	= true;
+				class_idx	= to_be_renumbered.at(class_idx);
+				mark["class_idx"] = class_idx;
+			}
+			if (names.count(class_idx) and mark.value("name", "") != names.at(class_idx))
+			{
+				modified		= true;
+				mark["name"]	= names.at(class_idx);
+			}
+			marks.push_back(mark);
+		}
+
+		if (marks.empty())
+		{
+			root.erase("mark");
+			root["completely_empty"] = true;
+		}
+		else
+		{
+			root["mark"] = marks;
+		}
+
+		return modified;
+	}
+
+
+	/** Replace the file with the new version which was written next to it, or delete the file if @p "delete" is set in
+	 * the journal entry.  The original is first hardlinked (or copied if that is not possible) so it can be restored
+	 * until the journal is deleted.  This can safely be repeated if the remap was interrupted.
+	 */
+	void commit_file(const json & entry)
+	{
+		const std::string filename			= entry["file"];
+		const bool delete_file				= entry.value("delete", false);
+		const std::filesystem::path fn		= filename;
+		const std::filesystem::path new_fn	= filename + new_suffix;
+		const std::filesystem::path old_fn	= filename + old_suffix;
+
+		if ((delete_file and not std::filesystem::exists(fn)) or (not delete_file and not std::filesystem::exists(new_fn)))
+		{
+			// this file has already been committed
+			return;
+		}
+
+		std::error_code ec;
+		if (std::filesystem::exists(fn))
+		{
+			std::filesystem::remove(old_fn, ec);
+			std::filesystem::create_hard_link(fn, old_fn, ec);
+			if (ec)
+			{
+				std::filesystem::copy_file(fn, old_fn, std::filesystem::copy_options::overwrite_existing);
+			}
+		}
+
+		if (delete_file)
+		{
+			std::filesystem::remove(fn);
+		}
+		else
+		{
+			std::filesystem::rename(new_fn, fn);
+		}
+
+		return;
+	}
+
+
+	/// Undo @ref commit_file().  If the file did not exist prior to the remap, then it is deleted.
+	void rollback_file(const json & entry)
+	{
+		const std::string filename			= entry["file"];
+		const bool existed					= entry.value("existed", true);
+		const std::filesystem::path fn		= filename;
+		const std::filesystem::path new_fn	= filename + new_suffix;
+		const std::filesystem::path old_fn	= filename + old_suffix;
+
+		std::error_code ec;
+		std::filesystem::remove(new_fn, ec);
+		if (std::filesystem::exists(old_fn))
+		{
+			std::filesystem::rename(old_fn, fn);
+		}
+		else if (not existed)
+		{
+			std::filesystem::remove(fn, ec);
+		}
+
+		return;
+	}
+
+
+	/// Run the same action on every file in the journal, using all the worker threads.
+	void for_each_journal_file(const json & root, const std::function<void(const json &)> & action)
+	{
+		const size_t files_per_task = 500;
+		const json & files = root["files"];
+
+		dm::WorkPool::Tasks tasks;
+		for (size_t first = 0; first < files.size(); first += files_per_task)
+		{
+			tasks.push_back(
+				[&, first](const size_t worker_idx)
+				{
+					for (size_t idx = first; idx < std::min(files.size(), first + files_per_task); idx ++)
+					{
+						action(files[idx]);
+					}
+				});
+		}
+
+		dm::work_pool().submit("class remap journal", tasks)->wait();
+
+		return;
+	}
+
+
+	/** The new files are only added to the journal once they have all been written, so if DarkMark is stopped while the
+	 * files are being prepared, the journal does not know about them.  None of the original files have been modified at
+	 * that point, so any file with the temporary suffix in the project can safely be deleted.
+	 */
+	void remove_orphaned_new_files(const File & dir)
+	{
+		size_t count = 0;
+		for (const auto & dir_entry : RangedDirectoryIterator(dir, true, "*" + String(new_suffix), File::findFiles))
+		{
+			if (dir_entry.getFile().deleteFile())
+			{
+				count ++;
+			}
+		}
+
+		if (count > 0)
+		{
+			dm::Log("removed " + std::to_string(count) + " temporary class remap files from " + dir.getFullPathName().toStdString());
+		}
+
+		return;
+	}
+
+
+	/** Finish a remap which was interrupted.  Going forward commits the files which were not yet renamed, going back
+	 * restores all the original files.  Either way the project is consistent and the journal is deleted.
+	 */
+	void finish_remap(const File & journal, json & root, const bool go_forward)
+	{
+		if (go_forward)
+		{
+			for_each_journal_file(root, commit_file);
+			root["state"] = "done";
+			write_journal(journal, root);
+		}
+		else
+		{
+			for_each_journal_file(root, rollback_file);
+			remove_orphaned_new_files(journal.getParentDirectory());
+		}
+
+		// the original files are no longer needed
+		for_each_journal_file(root,
+			[](const json & entry)
+			{
+				const std::string fn = entry["file"];
+				std::error_code ec;
+				std::filesystem::remove(fn + new_suffix, ec);
+				std::filesystem::remove(fn + old_suffix, ec);
+			});
+		journal.deleteFile();
+
+		return;
+	}
+}
+
 
 dm::ClassIdWnd::ClassIdWnd(File project_dir, const std::string & fn) :
 	DocumentWindow("DarkMark - " + File(fn).getFileName(), Colours::darkgrey, TitleBarButtons::closeButton),
@@ -23,7 +323,9 @@ dm::ClassIdWnd::ClassIdWnd(File project_dir, const std::string & fn) :
 	number_of_annotations_deleted(0),
 	number_of_annotations_remapped(0),
 	number_of_txt_files_rewritten(0),
-	number_of_files_copied	(0)
+	number_of_files_copied	(0),
+	number_of_images_linked	(0),
+	export_with_hardlinks	(false)
 {
 	setContentNonOwned		(&canvas, true	);
 	setUsingNativeTitleBar	(true			);
@@ -66,6 +368,9 @@ dm::ClassIdWnd::ClassIdWnd(File project_dir, const std::string & fn) :
 	apply_button	.addListener(this);
 	cancel_button	.addListener(this);
 
+	// this must be done before the .names file and the annotations are read
+	recover_interrupted_class_remap(dir, true);
+
 	std::ifstream ifs(names_fn);
 	std::string line;
 	while (std::getline(ifs, line))
@@ -129,6 +434,66 @@ dm::ClassIdWnd::~ClassIdWnd()
 }
 
 
+bool dm::recover_interrupted_class_remap(const File & dir, const bool interactive)
+{
+	const File journal = dir.getChildFile(remap_journal_filename);
+	if (not journal.existsAsFile())
+	{
+		return true;
+	}
+
+	try
+	{
+		json root;
+		if (true)
+		{
+			std::ifstream ifs(journal.getFullPathName().toStdString());
+			root = json::parse(ifs);
+		}
+		const std::string state = root.value("state", "");
+		Log("found an interrupted class remap in " + journal.getFullPathName().toStdString() + " with state \"" + state + "\"");
+
+		if (state != "commit")
+		{
+			// either nothing was modified yet, or everything was already modified and only the cleanup is left
+			finish_remap(journal, root, state == "done");
+			return true;
+		}
+
+		if (not interactive)
+		{
+			// only the user can decide if the changes should be kept
+			Log("ERROR: the interrupted class remap must be finished or rolled back by opening the project in DarkMark");
+			return false;
+		}
+
+		AlertWindow w("DarkMark Class Remap",
+				"The previous changes to the classes in this project were interrupted, and only some of the " + String(root["files"].size()) + " annotation files have been modified.\n\n"
+				"Do you want to finish applying the changes, or go back to the original annotations?",
+				MessageBoxIconType::WarningIcon);
+		w.addButton("Finish"	, 1, KeyPress(KeyPress::returnKey));
+		w.addButton("Roll Back"	, 2);
+		const int result = w.runModalLoop();
+
+		Log(std::string(result == 2 ? "rolling back" : "finishing") + " the interrupted class remap");
+		finish_remap(journal, root, result != 2);
+	}
+	catch (const std::exception & e)
+	{
+		Log("failed to recover the interrupted class remap: " + std::string(e.what()));
+		if (interactive)
+		{
+			AlertWindow::showMessageBox(MessageBoxIconType::WarningIcon, "DarkMark",
+					"Failed to recover the interrupted changes to the classes:\n\n" + String(e.what()) + "\n\n"
+					"The journal is in " + journal.getFullPathName() + ".");
+		}
+		return false;
+	}
+
+	return true;
+}
+
+
 void dm::ClassIdWnd::add_row(const std::string & name)
 {
 	Info info;
@@ -167,6 +532,7 @@ void dm::ClassIdWnd::closeButtonPressed()
 					String(export_directory.c_str()) + "\n"
 					"\n"
 					"Number of files copied: "			+ String(number_of_files_copied			) + "\n"
+					"Number of images cloned or linked: "	+ String(number_of_images_linked	) + "\n"
 					"Number of annotations deleted: "	+ String(number_of_annotations_deleted	) + "\n"
 					"Number of annotations remapped: "	+ String(number_of_annotations_remapped	) + "\n"
 					"Number of .txt files modified: "	+ String(number_of_txt_files_rewritten	) + "\n");
@@ -272,6 +638,12 @@ void dm::ClassIdWnd::buttonClicked(Button * button)
 		// 1 = All
 		// 2 = Only Annotated
 		// 0 = Cancel
+		ToggleButton hardlink_toggle("Link the images instead of copying them");
+		hardlink_toggle.setTooltip("The new dataset will use hardlinks to the same image files as this dataset, which is much faster and uses almost no disk space.  Images modified in one dataset will also be modified in the other.  The annotations are always copied.");
+		hardlink_toggle.setToggleState(cfg().get_bool("ClassIdWnd_export_hardlinks", false), NotificationType::dontSendNotification);
+		hardlink_toggle.setSize(400, 24);
+		w.addCustomComponent(&hardlink_toggle);
+
 		w.addButton("All Images"			, 1, KeyPress(KeyPress::returnKey));
 		w.addButton("Only Annotated Images"	, 2);
 		w.addButton("Cancel"				, 0, KeyPress(KeyPress::escapeKey));
@@ -300,6 +672,8 @@ void dm::ClassIdWnd::buttonClicked(Button * button)
 		{
 			is_exporting = true;
 			export_all_images = (result == 1);
+			export_with_hardlinks = hardlink_toggle.getToggleState();
+			cfg().setValue("ClassIdWnd_export_hardlinks", export_with_hardlinks);
 			runThread(); // calls run() and waits for it to be done
 			dm::Log("forcing the window to close");
 			closeButtonPressed();
@@ -359,9 +733,74 @@ void dm::ClassIdWnd::buttonClicked(Button * button)
 
 namespace
 {
-	void cp_files(const std::filesystem::path & src, const std::filesystem::path & dst)
+	/** Create a copy-on-write clone of the file.  This is instant and doesn't use any extra disk space, but is only
+	 * supported by some filesystems such as Btrfs, XFS, and APFS.
+	 * @returns @p false if the file could not be cloned, in which case it needs to be copied or linked instead.
+	 */
+	bool reflink_file(const std::filesystem::path & src, const std::filesystem::path & dst)
 	{
-		// this will copy both the image and the .txt annotation file (if it exists)
+#if JUCE_LINUX
+		const int src_fd = open(src.c_str(), O_RDONLY);
+		if (src_fd < 0)
+		{
+			return false;
+		}
+		const int dst_fd = open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (dst_fd < 0)
+		{
+			close(src_fd);
+			return false;
+		}
+		const bool success = (ioctl(dst_fd, FICLONE, src_fd) == 0);
+		close(dst_fd);
+		close(src_fd);
+		if (not success)
+		{
+			std::error_code ec;
+			std::filesystem::remove(dst, ec);
+		}
+		return success;
+#elif JUCE_MAC
+		return (clonefile(src.c_str(), dst.c_str(), 0) == 0);
+#else
+		return false;
+#endif
+	}
+
+
+	/** Put a copy of the image at @p dst.  A copy-on-write clone is used if the filesystem supports it.  Otherwise, when
+	 * @p hardlink is set, the new project shares the image file with the original project instead of copying it.
+	 * @returns @p true if the image was cloned or linked instead of copied.
+	 */
+	bool link_image(const std::filesystem::path & src, const std::filesystem::path & dst, const bool hardlink)
+	{
+		if (reflink_file(src, dst))
+		{
+			return true;
+		}
+
+		std::error_code ec;
+		if (hardlink)
+		{
+			std::filesystem::create_hard_link(src, dst, ec);
+			if (not ec)
+			{
+				return true;
+			}
+			// probably on a different filesystem, so fall back to copying the file
+		}
+
+		return false;
+	}
+
+
+	/** Copy both the image and the .txt annotation file (if it exists).  See @ref link_image() for @p hardlink.  The
+	 * .txt file is always copied since it may be rewritten once the classes are remapped.
+	 * @returns @p true if the image was cloned or linked instead of copied.
+	 */
+	bool cp_files(const std::filesystem::path & src, const std::filesystem::path & dst, const bool hardlink = false)
+	{
+		bool linked = false;
 
 		if (src.empty())
 		{
@@ -395,7 +834,11 @@ namespace
 			const auto f1 = std::filesystem::path(src).replace_extension(ext);
 			const auto f2 = std::filesystem::path(dst).replace_extension(ext);
 
-			if (std::filesystem::exists(f1))
+			if (ext != ".txt" and link_image(f1, f2, hardlink))
+			{
+				linked = true;
+			}
+			else if (std::filesystem::exists(f1))
 			{
 				bool success = std::filesystem::copy_file(f1, f2, ec);
 				if (ec or not success)
@@ -407,7 +850,7 @@ namespace
 			}
 		}
 
-		return;
+		return linked;
 	}
 }
 
@@ -439,28 +882,52 @@ void dm::ClassIdWnd::run_export()
 	// remember the new .names file so it gets saved in the right location in run()
 	names_fn = (target / std::filesystem::relative(names_fn, source)).string();
 
-	VStr dst_images;
-	dst_images.reserve(all_images.size());
-	double work_completed = 0.0f;
-	const double work_to_be_done = all_images.size();
-
-	for (size_t idx = 0; idx < all_images.size() and not threadShouldExit(); idx ++)
+	// each task copies a block of images; the new filenames are stored by index so the order of the images is kept
+	const size_t images_per_task = 100;
+	VStr dst_images(all_images.size());
+	std::atomic<size_t> files_copied = 0;
+	std::atomic<size_t> images_linked = 0;
+	WorkPool::Tasks tasks;
+	for (size_t first = 0; first < all_images.size(); first += images_per_task)
 	{
-		setProgress(work_completed / work_to_be_done);
-		work_completed ++;
+		tasks.push_back(
+			[&, first](const size_t worker_idx)
+			{
+				for (size_t idx = first; idx < std::min(all_images.size(), first + images_per_task); idx ++)
+				{
+					std::filesystem::path src = all_images[idx];
+					std::filesystem::path dst = target / std::filesystem::relative(src, source);
 
-		std::filesystem::path src = all_images[idx];
-		std::filesystem::path dst = target / std::filesystem::relative(src, source);
+					if (export_all_images or std::filesystem::exists(std::filesystem::path(src).replace_extension(".txt")))
+					{
+						// this will copy both the image and the .txt annotation file (if it exists)
+						if (cp_files(src, dst, export_with_hardlinks))
+						{
+							images_linked ++;
+						}
+						files_copied ++;
+						dst_images[idx] = dst.string();
+					}
+				}
+			});
+	}
 
-		if (export_all_images or std::filesystem::exists(std::filesystem::path(src).replace_extension(".txt")))
+	auto job = work_pool().submit("export dataset", tasks);
+	job->wait(
+		[&](const double fraction)
 		{
-			// this will copy both the image and the .txt annotation file (if it exists)
-			cp_files(src, dst);
-			number_of_files_copied ++;
-			dst_images.push_back(dst.string());
-		}
-	}
+			setProgress(fraction);
+			if (threadShouldExit())
+			{
+				job->cancel();
+			}
+		});
 
+	number_of_files_copied	= files_copied;
+	number_of_images_linked	= images_linked;
+	Log("export dataset: " + std::to_string(number_of_files_copied) + " images exported, " + std::to_string(number_of_images_linked) + " of which were cloned or hardlinked");
+
+	dst_images.erase(std::remove(dst_images.begin(), dst_images.end(), std::string()), dst_images.end());
 	all_images.swap(dst_images);
 
 	return;
@@ -499,104 +966,170 @@ void dm::ClassIdWnd::run()
 		run_export();
 	}
 
-	std::ofstream ofs(names_fn);
-	if (ofs.good())
-	{
-		for (const auto & [key, val] : names)
-		{
-			dm::Log("-> class #" + std::to_string(key) + ": \"" + val + "\"");
-			ofs << val << std::endl;
-		}
-	}
-	ofs.close();
-	names_file_rewritten = true;
+	/* Everything is first written to temporary files next to the originals.  Once all the files are ready, the journal
+	 * lists them and they are renamed over the originals.  If this is interrupted, the next time the project is loaded
+	 * the journal is used to either finish the remap or restore the original files.
+	 */
+	const File journal = (is_exporting ? File(export_directory.string()) : dir).getChildFile(remap_journal_filename);
+	json root;
+	root["state"]	= "prepare";
+	root["files"]	= json::array();
 
-	if (to_be_deleted.size() > 0 or to_be_renumbered.size() > 0)
+	try
 	{
-		double work_completed = 0.0f;
-		const double work_to_be_done = all_images.size();
+		write_journal(journal, root);
 
-		setStatusMessage("Processing " + String(all_images.size()) + " images...");
+		if (true)
+		{
+			std::string content;
+			for (const auto & [key, val] : names)
+			{
+				dm::Log("-> class #" + std::to_string(key) + ": \"" + val + "\"");
+				content += val + "\n";
+			}
+			write_file(names_fn + new_suffix, content);
+			root["files"].push_back({{"file", names_fn}, {"existed", File(names_fn).existsAsFile()}});
+		}
 
-		for (size_t idx = 0; idx < all_images.size() and not threadShouldExit(); idx ++)
+		if (to_be_deleted.size() > 0 or to_be_renumbered.size() > 0)
 		{
-			dm::Log("idx=" + std::to_string(idx) + " fn=" + all_images[idx]);
+			setStatusMessage("Processing " + String(all_images.size()) + " images...");
 
-			setProgress(work_completed / work_to_be_done);
-			work_completed ++;
+			struct RemapResults
+			{
+				VStr files;
+				VStr deleted_files;
+				size_t annotations_deleted	= 0;
+				size_t annotations_remapped	= 0;
+				size_t txt_files_rewritten	= 0;
+			};
 
-			File image_filename(all_images[idx]);
-			File txt_filename = image_filename.withFileExtension(".txt");
-			if (not txt_filename.exists())
+			const size_t images_per_task = 250;
+			std::vector<RemapResults> results((all_images.size() + images_per_task - 1) / images_per_task);
+			WorkPool::Tasks tasks;
+			for (size_t task_idx = 0; task_idx < results.size(); task_idx ++)
 			{
-				// nothing we can do, this image is not annotated
-				continue;
+				tasks.push_back(
+					[&, task_idx](const size_t worker_idx)
+					{
+						auto & result = results[task_idx];
+						const size_t first	= task_idx * images_per_task;
+						const size_t last	= std::min(all_images.size(), first + images_per_task);
+						for (size_t idx = first; idx < last; idx ++)
+						{
+							File txt_filename = File(all_images[idx]).withFileExtension(".txt");
+							std::ifstream ifs(txt_filename.getFullPathName().toStdString(), std::ios::binary);
+							if (not ifs.good())
+							{
+								// nothing we can do, this image is not annotated
+								continue;
+							}
+							const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+							std::string output;
+							if (not remap_txt(content, to_be_deleted, to_be_renumbered, output, result.annotations_deleted, result.annotations_remapped))
+							{
+								continue;
+							}
+							write_file(txt_filename.getFullPathName().toStdString() + new_suffix, output);
+							result.files.push_back(txt_filename.getFullPathName().toStdString());
+							result.txt_files_rewritten ++;
+
+							// remap the .json file as well so DarkMark doesn't need to rebuild it from the .txt file
+							File json_filename = txt_filename.withFileExtension(".json");
+							if (json_filename.existsAsFile())
+							{
+								const std::string fn = json_filename.getFullPathName().toStdString();
+								json json_root;
+								try
+								{
+									std::ifstream json_ifs(fn);
+									json_root = json::parse(json_ifs);
+								}
+								catch (const std::exception & e)
+								{
+									// DarkMark will rebuild the .json file from the .txt file the next time this image is loaded
+									result.deleted_files.push_back(fn);
+									continue;
+								}
+								if (remap_json(json_root, to_be_deleted, to_be_renumbered, names))
+								{
+									write_file(fn + new_suffix, json_root.dump(1, '\t') + "\n");
+									result.files.push_back(fn);
+								}
+							}
+						}
+					});
 			}
 
-			struct annotation
+			std::string error;
+			auto job = work_pool().submit("class remap", tasks);
+			try
 			{
-				int class_idx;
-				double x;
-				double y;
-				double w;
-				double h;
-
-				annotation() :
-					class_idx(-1),
-					x(-1.0),
-					y(-1.0),
-					w(-1.0),
-					h(-1.0)
-				{
-					return;
-				}
-			};
-			std::vector<annotation> v;
-
-			bool modified = false;
-			std::ifstream ifs(txt_filename.getFullPathName().toStdString());
-			ifs.imbue(std::locale("C"));
-			while (not threadShouldExit())
+				job->wait(
+					[&](const double fraction)
+					{
+						setProgress(fraction);
+						if (threadShouldExit())
+						{
+							job->cancel();
+						}
+					});
+			}
+			catch (const std::exception & e)
 			{
-				annotation a;
-				ifs >> a.class_idx >> a.x >> a.y >> a.w >> a.h;
-				if (not ifs.good())
-				{
-					break;
-				}
+				error = e.what();
+			}
 
-				if (to_be_deleted.count(a.class_idx))
+			// remember all the new files, including those from tasks which were cancelled, so they can be removed
+			for (const auto & result : results)
+			{
+				for (const auto & fn : result.files)
 				{
-					modified = true;
-					number_of_annotations_deleted ++;
+					root["files"].push_back({{"file", fn}, {"existed", true}});
 				}
-				else
+				for (const auto & fn : result.deleted_files)
 				{
-					if (to_be_renumbered.count(a.class_idx))
-					{
-						modified = true;
-						a.class_idx = to_be_renumbered[a.class_idx];
-						number_of_annotations_remapped ++;
-					}
-
-					// remember this annotation
-					v.push_back(a);
+					root["files"].push_back({{"file", fn}, {"existed", true}, {"delete", true}});
 				}
+				number_of_annotations_deleted	+= result.annotations_deleted;
+				number_of_annotations_remapped	+= result.annotations_remapped;
+				number_of_txt_files_rewritten	+= result.txt_files_rewritten;
 			}
 
-			if (modified)
+			if (job->is_cancelled())
 			{
-				ofs.open(txt_filename.getFullPathName().toStdString());
-				ofs << std::fixed << std::setprecision(10);
-				for (const auto & a : v)
-				{
-					ofs << a.class_idx << " " << a.x << " " << a.y << " " << a.w << " " << a.h << std::endl;
-				}
-				ofs.close();
-				number_of_txt_files_rewritten ++;
+				throw std::runtime_error("the class remap was cancelled");
+			}
+			if (not error.empty())
+			{
+				throw std::runtime_error(error);
+			}
+		}
 
-				File json_filename = txt_filename.withFileExtension(".json");
-				json_filename.deleteFile();
+		// all the new files are ready, so now the originals are replaced
+		setStatusMessage("Saving " + String(root["files"].size()) + " files...");
+		root["state"] = "commit";
+		write_journal(journal, root);
+		finish_remap(journal, root, true);
+		names_file_rewritten = true;
+	}
+	catch (const std::exception & e)
+	{
+		// if the commit was not yet started, then none of the original files have been modified
+		Log("class remap failed: " + std::string(e.what()));
+		if (root["state"] == "prepare")
+		{
+			number_of_annotations_deleted	= 0;
+			number_of_annotations_remapped	= 0;
+			number_of_txt_files_rewritten	= 0;
+			try
+			{
+				finish_remap(journal, root, false);
+			}
+			catch (const std::exception & e2)
+			{
+				Log("failed to remove the temporary files: " + std::string(e2.what()));
 			}
 		}
 	}
@@ -1058,6 +1591,112 @@ void dm::ClassIdWnd::rebuild_table()
 }
 
 
+namespace
+{
+	/// Counters kept by each of the tasks which verify the annotations.
+	struct VerificationResults
+	{
+		std::map<int, size_t> count_files_per_class;
+		std::map<int, size_t> count_annotations_per_class;
+		size_t error_count;
+		dm::VStr messages;
+
+		VerificationResults() :
+			error_count(0)
+		{
+			return;
+		}
+	};
+
+
+	/** Verify all the annotations in a .txt file, and count the classes.  Since many of these run in parallel, the
+	 * messages are not logged immediately but stored in @p results.
+	 */
+	void verify_annotations(const File & file, const size_t number_of_classes, VerificationResults & results)
+	{
+		std::ifstream ifs(file.getFullPathName().toStdString(), std::ios::binary);
+		if (not ifs.good())
+		{
+			// this image is not annotated
+			return;
+		}
+		const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+		std::set<int> classes_found;
+		size_t line_number = 0;
+		const char * p			= content.data();
+		const char * const end	= p + content.size();
+		while (p < end)
+		{
+			const char * eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+			if (eol == nullptr)
+			{
+				eol = end;
+			}
+			line_number ++;
+
+			const bool is_blank = std::all_of(p, eol, [](const char c) { return std::isspace(static_cast<unsigned char>(c)); });
+
+			int class_id = -1;
+			float values[4] = {-1.0f, -1.0f, -1.0f, -1.0f};
+			const bool valid = dm::parse_annotation(p, eol, class_id, values);
+			const float & x = values[0];
+			const float & y = values[1];
+			const float & w = values[2];
+			const float & h = values[3];
+			p = eol + 1;
+
+			if (is_blank)
+			{
+				continue;
+			}
+
+			if (not valid)
+			{
+				results.error_count ++;
+				results.messages.push_back("ERROR: line #" + std::to_string(line_number) + " in " + file.getFullPathName().toStdString() + " cannot be parsed");
+			}
+			else if (class_id < 0 or class_id >= static_cast<int>(number_of_classes))
+			{
+				results.error_count ++;
+				results.messages.push_back("ERROR: class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " is invalid");
+			}
+			else if (
+				x <= 0.0f or
+				y <= 0.0f or
+				w <= 0.0f or
+				h <= 0.0f)
+			{
+				// ignore these errors...we're not changing the coordinates of anything just renumbering and merging things together
+				results.messages.push_back("WARNING: coordinates for class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " are invalid");
+			}
+			else if (
+				// take into account rounding errors, especially when converting coordinates between float and double
+				x - w / 2.0 < -0.000001 or
+				x + w / 2.0 >  1.000001 or
+				y - h / 2.0 < -0.000001 or
+				y + h / 2.0 >  1.000001)
+			{
+				// ignore these errors...we're not changing the coordinates of anything just renumbering and merging things together
+				results.messages.push_back("WARNING: width or height for class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " is invalid");
+			}
+			else
+			{
+				classes_found.insert(class_id);
+				results.count_annotations_per_class[class_id] ++;
+			}
+		}
+
+		for (const int id : classes_found)
+		{
+			results.count_files_per_class[id] ++;
+		}
+
+		return;
+	}
+}
+
+
 void dm::ClassIdWnd::count_images_and_marks()
 {
 	// this is started on a secondary thread
@@ -1078,82 +1717,67 @@ void dm::ClassIdWnd::count_images_and_marks()
 
 		dm::Log("counting thread: done=" + std::to_string(done) + ": number of images found in " + dir.getFullPathName().toStdString() + ": " + std::to_string(image_filenames.size()));
 
-		for (size_t idx = 0; idx < image_filenames.size() and not done and not threadShouldExit(); idx ++)
+		/* Each task verifies a block of images and keeps its own counters, which are added together once all the tasks
+		 * are done.  This way the threads never need to share anything while the annotations are being read.
+		 */
+		const size_t images_per_task	= 1000;
+		const size_t number_of_classes	= vinfo.size();
+		std::vector<VerificationResults> results((image_filenames.size() + images_per_task - 1) / images_per_task);
+		WorkPool::Tasks tasks;
+		for (size_t task_idx = 0; task_idx < results.size(); task_idx ++)
 		{
-			// don't bother updating the button if there is a trivial number of images
-			if (image_filenames.size() > 100)
-			{
-				const int percentage = std::round(idx * 100.0f / image_filenames.size());
-				if (percentage != previous_percentage)
-				{
-					export_button.setButtonText("Verifying " + std::to_string(percentage) + "% ...");
-					previous_percentage = percentage;
-				}
-			}
-
-			auto & fn = image_filenames[idx];
-			File file = File(fn).withFileExtension(".txt");
-			if (file.exists())
-			{
-				std::set<int> classes_found;
-
-				size_t line_number = 0;
-				std::ifstream ifs(file.getFullPathName().toStdString());
-				ifs.imbue(std::locale("C"));
-				while (not threadShouldExit())
+			tasks.push_back(
+				[&, task_idx](const size_t worker_idx)
 				{
-					int class_id = -1;
-					double x = -1.0;
-					double y = -1.0;
-					double w = -1.0;
-					double h = -1.0;
-
-					line_number ++;
-					ifs >> class_id >> x >> y >> w >> h;
-
-					if (not ifs.good())
+					const size_t first	= task_idx * images_per_task;
+					const size_t last	= std::min(image_filenames.size(), first + images_per_task);
+					for (size_t idx = first; idx < last and not done; idx ++)
 					{
-						break;
+						verify_annotations(File(image_filenames[idx]).withFileExtension(".txt"), number_of_classes, results[task_idx]);
 					}
+				});
+		}
 
-					if (class_id < 0 or class_id >= (int)vinfo.size())
-					{
-						error_count ++;
-						dm::Log("ERROR: class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " is invalid");
-					}
-					else if (
-						x <= 0.0 or
-						y <= 0.0 or
-						w <= 0.0 or
-						h <= 0.0)
-					{
-						// ignore these errors...we're not changing the coordinates of anything just renumbering and merging things together
-//						error_count ++;
-						dm::Log("WARNING: coordinates for class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " are invalid");
-					}
-					else if (
-						// take into account rounding errors, especially when converting coordinates between float and double
-						x - w / 2.0 < -0.000001 or
-						x + w / 2.0 >  1.000001 or
-						y - h / 2.0 < -0.000001 or
-						y + h / 2.0 >  1.000001)
-					{
-						// ignore these errors...we're not changing the coordinates of anything just renumbering and merging things together
-//						error_count ++;
-						dm::Log("WARNING: width or height for class #" + std::to_string(class_id) + " in " + file.getFullPathName().toStdString() + " on line #" + std::to_string(line_number) + " is invalid");
-					}
-					else
+		auto job = work_pool().submit("class id verification", tasks);
+		job->wait(
+			[&](const double fraction)
+			{
+				// don't bother updating the button if there is a trivial number of images
+				if (image_filenames.size() > 100)
+				{
+					const int percentage = std::round(fraction * 100.0);
+					if (percentage != previous_percentage)
 					{
-						classes_found.insert(class_id);
-						count_annotations_per_class[class_id] ++;
+						export_button.setButtonText("Verifying " + std::to_string(percentage) + "% ...");
+						previous_percentage = percentage;
 					}
 				}
-
-				for (const int id : classes_found)
+				if (done or threadShouldExit())
 				{
-					count_files_per_class[id] ++;
+					job->cancel();
 				}
+			});
+
+		if (job->is_cancelled())
+		{
+			throw std::runtime_error("verification of the annotations was cancelled");
+		}
+
+		for (const auto & result : results)
+		{
+			for (const auto & msg : result.messages)
+			{
+				dm::Log(msg);
+			}
+			for (const auto & [id, count] : result.count_files_per_class)
+			{
+				count_files_per_class[id] += count;
+			}
+			for (const auto & [id, count] : result.count_annotations_per_class)
+			{
+				count_annotations_per_class[id] += count;
 			}
+			error_count += result.error_count;
 		}
 
 		// display a bit of information on all the classes and annotations we found
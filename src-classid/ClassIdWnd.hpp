@@ -7,6 +7,13 @@
 
 namespace dm
 {
+	/** If the classes were being remapped when DarkMark was stopped, finish or roll back the remap using the journal
+	 * @p darkmark_class_remap.json in the project directory.  When only some of the files were modified, the user is
+	 * asked which to do.  If @p interactive is @p false, nothing is done in that case since there is nobody to ask.
+	 * @returns @p false if the project still has an interrupted remap, or @p true if the project is consistent.
+	 */
+	bool recover_interrupted_class_remap(const File & dir, const bool interactive);
+
 	class ClassIdWnd : public DocumentWindow, public Button::Listener, public ThreadWithProgressWindow, public TableListBoxModel
 	{
 		public:
@@ -114,6 +121,12 @@ namespace dm
 			size_t number_of_annotations_remapped;
 			size_t number_of_txt_files_rewritten;
 			size_t number_of_files_copied;
+			size_t number_of_images_linked;
+
+			/** When exporting, use hardlinks to the original images instead of copying them.  Copy-on-write clones are
+			 * always used when the filesystem supports them, since they are as fast as hardlinks but still separate files.
+			 */
+			bool export_with_hardlinks;
 
 			std::filesystem::path export_directory;
 	};
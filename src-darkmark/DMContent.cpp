@@ -315,6 +315,25 @@ void dm::DMContent::start_darknet()
 #endif
 	}
 
+	load_names();
+
+	annotation_colours = DarkHelp::get_default_annotation_colours();
+	if (annotation_colours.empty() == false)
+	{
+		const auto & opencv_colour = annotation_colours.at(most_recent_class_idx % annotation_colours.size());
+		crosshair_colour = Colour(opencv_colour[2], opencv_colour[1], opencv_colour[0]);
+	}
+
+	set_sort_order(sort_order);
+
+	return;
+}
+
+
+void dm::DMContent::load_names()
+{
+	const std::string darknet_names = cfg().get_str(cfg_prefix + "names");
+
 	if (names.empty() and darknet_names.empty() == false)
 	{
 		Log("manually parsing " + darknet_names);
@@ -354,15 +373,6 @@ void dm::DMContent::start_darknet()
 	empty_image_name_index = names.size();
 	names.push_back("* empty image *");
 
-	annotation_colours = DarkHelp::get_default_annotation_colours();
-	if (annotation_colours.empty() == false)
-	{
-		const auto & opencv_colour = annotation_colours.at(most_recent_class_idx % annotation_colours.size());
-		crosshair_colour = Colour(opencv_colour[2], opencv_colour[1], opencv_colour[0]);
-	}
-
-	set_sort_order(sort_order);
-
 	return;
 }
 
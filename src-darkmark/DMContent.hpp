@@ -49,6 +49,11 @@ namespace dm
 
 			void start_darknet();
 
+			/** Parse the .names file unless the names were already obtained from the neural network, and then append the
+			 * special "empty image" entry.  This does not load the neural network, so it can also be used without a display.
+			 */
+			void load_names();
+
 			virtual void paintOverChildren(Graphics & g) override;
 
 			void rebuild_image_and_repaint();
@@ -363,7 +363,7 @@ void dm::DMContentFlipImages::run()
 				break;
 			}
 
-			Log("flip: next image at idx=" + std::to_string(idx) + " is " + content.image_filenames[idx]);
+			Log(ELogLevel::kDebug, [&]{ return "flip: next image at idx=" + std::to_string(idx) + " is " + content.image_filenames[idx]; });
 
 			setProgress(work_completed / work_to_be_done);
 			work_completed ++;
@@ -392,7 +392,7 @@ void dm::DMContentFlipImages::run()
 			}
 			if (file_already_exists)
 			{
-				Log("skip flip (already exists): " + content.image_filenames[idx]);
+				Log(ELogLevel::kDebug, [&]{ return "skip flip (already exists): " + content.image_filenames[idx]; });
 				images_skipped ++;
 				continue;
 			}
@@ -403,16 +403,16 @@ void dm::DMContentFlipImages::run()
 				const auto f = original_file.withFileExtension(".txt");
 				if (not f.exists())
 				{
-					Log("skip flip (non-annotated image): " + content.image_filenames[idx]);
+					Log(ELogLevel::kDebug, [&]{ return "skip flip (non-annotated image): " + content.image_filenames[idx]; });
 					images_skipped ++;
 					continue;
 				}
 			}
 
 			// load the given image so we can get access to the cv::Mat and annotations
-			Log("flip: loading image #" + std::to_string(idx) + ": " + content.image_filenames[idx]);
+			Log(ELogLevel::kDebug, [&]{ return "flip: loading image #" + std::to_string(idx) + ": " + content.image_filenames[idx]; });
 			content.load_image(idx);
-			Log("flip: done loading image");
+			Log(ELogLevel::kDebug, [&]{ return "flip: done loading image"; });
 
 			if (content.original_image.empty() or
 				content.original_image.cols < 1 or
@@ -449,10 +449,10 @@ void dm::DMContentFlipImages::run()
 
 					// see if this rotation already exists
 					std::string new_fn = original_file.getSiblingFile(original_fn).getFullPathName().toStdString() + postfix;
-					Log("flip: looking for " + new_fn);
+					Log(ELogLevel::kDebug, [&]{ return "flip: looking for " + new_fn; });
 					if (filenames_without_extensions.count(new_fn))
 					{
-						Log("skip flip (already exists): " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "skip flip (already exists): " + new_fn; });
 						images_already_exist ++;
 						continue;
 					}
@@ -483,7 +483,7 @@ void dm::DMContentFlipImages::run()
 
 						const auto txt_fn = File(new_fn).withFileExtension(".txt").getFullPathName().toStdString();
 
-						Log("flip: creating annotations for " + txt_fn);
+						Log(ELogLevel::kDebug, [&]{ return "flip: creating annotations for " + txt_fn; });
 
 						std::ofstream ofs(txt_fn);
 						ofs.imbue(std::locale("C"));
@@ -533,7 +533,7 @@ void dm::DMContentFlipImages::run()
 
 						if (ofs.fail())
 						{
-							Log("Flip:  error saving " + txt_fn);
+							Log(ELogLevel::kError, "Flip:  error saving " + txt_fn);
 							AlertWindow::showMessageBox(
 								AlertWindow::AlertIconType::WarningIcon,
 								"DarkMark",
@@ -546,15 +546,15 @@ void dm::DMContentFlipImages::run()
 						ofs.close();
 
 						// load the new images to force DarkMark to create the .json file from the .txt file
-						Log("flip: reloading " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "flip: reloading " + new_fn; });
 						content.load_image(content.image_filenames.size() - 1);
-						Log("flip: done loading " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "flip: done loading " + new_fn; });
 					}
 				}
 			}
 			else
 			{
-				Log("flip: skipping " + content.image_filenames[idx]);
+				Log(ELogLevel::kDebug, [&]{ return "flip: skipping " + content.image_filenames[idx]; });
 				images_skipped ++;
 			}
 		}
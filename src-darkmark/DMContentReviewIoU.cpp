@@ -8,6 +8,60 @@
 using json = nlohmann::json;
 
 
+namespace
+{
+	/** Create a string which uniquely identifies the neural network and the settings used to make predictions.  This is
+	 * stored in the .json file alongside the IoU results, and is used to determine if the predictions need to be redone.
+	 */
+	std::string get_network_stamp(const std::string & cfg_prefix)
+	{
+		std::stringstream ss;
+		for (const auto & key : {"cfg", "weights"})
+		{
+			File f(dm::cfg().get_str(cfg_prefix + key));
+			ss << MD5(f).toHexString().toStdString() << "/";
+		}
+
+		const auto & config = dm::darkhelp_nn().config;
+		ss	<< std::fixed << std::setprecision(4)
+			<< config.threshold << "/"
+			<< config.hierarchy_threshold << "/"
+			<< config.non_maximal_suppression_threshold << "/"
+			<< (config.enable_tiles ? "tiles" : "notiles");
+
+		return ss.str();
+	}
+
+
+	/** Create a string which identifies the annotations.  Moving an annotation or changing the class does not change the
+	 * number of annotations, so the IoU results would otherwise be re-used even though they no longer apply.
+	 */
+	std::string get_annotation_stamp(const json & root)
+	{
+		const std::string marks = root["mark"].dump();
+
+		return MD5(marks.data(), marks.size()).toHexString().toStdString();
+	}
+
+
+	/// Returns @p true if the IoU results stored in the .json were created with this network and against this exact image.
+	bool predictions_are_current(const json & root, const std::string & network_stamp, const int64 image_timestamp)
+	{
+		if (root.contains("predictions") == false or root["predictions"].contains("stamp") == false)
+		{
+			return false;
+		}
+
+		const auto & predictions = root["predictions"];
+
+		return
+			predictions["stamp"].value("network"	, "") == network_stamp		and
+			predictions["stamp"].value("image"		, 0LL) == image_timestamp	and
+			predictions["stamp"].value("marks"		, "") == get_annotation_stamp(root);
+	}
+}
+
+
 dm::DMContentReviewIoU::DMContentReviewIoU(dm::DMContent & c) :
 	ThreadWithProgressWindow("Predicting With Darknet/YOLO...", true, true),
 	content(c)
@@ -40,6 +94,11 @@ void dm::DMContentReviewIoU::run()
 	VIoUInfo v;
 	v.reserve(content.image_filenames.size());
 
+	// images which have not changed since the last review, and which were predicted with the same network, are not re-predicted
+	const std::string network_stamp = get_network_stamp(content.cfg_prefix);
+	size_t number_of_images_reused = 0;
+	Log("IoU: network stamp is " + network_stamp);
+
 	for (const auto & fn : content.image_filenames)
 	{
 		if (threadShouldExit())
@@ -59,21 +118,49 @@ void dm::DMContentReviewIoU::run()
 
 		json root;
 		cv::Mat mat;
+		const int64 image_timestamp = File(fn).getLastModificationTime().toMilliseconds();
 		try
 		{
-			Log("IoU: loading " + fn);
 			root = json::parse(f.loadFileAsString().toStdString());
+
+			if (predictions_are_current(root, network_stamp, image_timestamp))
+			{
+				// nothing has changed, so re-use the previous results; only the thumbnail needs to be created
+				const auto & predictions = root["predictions"];
+
+				ReviewIoUInfo info;
+				info.number											= v.size() + 1;
+				info.image_filename									= fn;
+				info.minimum_iou									= predictions["IoU"]["min"];
+				info.average_iou									= predictions["IoU"]["avg"];
+				info.maximum_iou									= predictions["IoU"]["max"];
+				info.number_of_annotations							= root["mark"].size();
+				info.number_of_predictions							= predictions["count"];
+				info.number_of_matches								= predictions["matches"];
+				info.number_of_predictions_without_annotations		= predictions["predictions_without_annotations"];
+				info.number_of_annotations_without_predictions		= predictions["annotations_without_predictions"];
+				info.number_of_differences							= predictions["number_of_differences"];
+				info.predictions_without_annotations				= predictions.value("names_predictions_without_annotations", "");
+				info.annotations_without_predictions				= predictions.value("names_annotations_without_predictions", "");
+				info.thumbnail										= load_thumbnail(fn, row_height);
+
+				v.push_back(info);
+				number_of_images_reused ++;
+				continue;
+			}
+
+			Log(ELogLevel::kDebug, [&]{ return "IoU: loading " + fn; });
 			mat = cv::imread(fn);
 		}
 		catch(const std::exception & e)
 		{
-			Log("failed to read image " + fn + " or parse json " + f.getFullPathName().toStdString() + ": " + e.what());
+			Log(ELogLevel::kWarning, "failed to read image " + fn + " or parse json " + f.getFullPathName().toStdString() + ": " + e.what());
 			continue;
 		}
 
 		if (mat.empty())
 		{
-			Log("failed to load image " + fn);
+			Log(ELogLevel::kWarning, "failed to load image " + fn);
 			continue;
 		}
 
@@ -81,9 +168,7 @@ void dm::DMContentReviewIoU::run()
 		info.image_filename = fn;
 		info.number_of_annotations = root["mark"].size();
 
-		const float size_factor = static_cast<float>(mat.rows) / mat.cols;
-		const cv::Size desired_size(std::round(size_factor * row_height), row_height);
-		info.thumbnail = DarkHelp::fast_resize_ignore_aspect_ratio(mat, desired_size);
+		info.thumbnail = create_thumbnail(mat, row_height);
 
 		const auto results = dmapp().darkhelp_nn->predict(mat);
 		info.number_of_predictions = results.size();
@@ -234,7 +319,7 @@ void dm::DMContentReviewIoU::run()
 		v.push_back(info);
 
 		// update the JSON with the IoU information for this image; these values are then used when sorting
-		Log("IoU: updating " + f.getFullPathName().toStdString());
+		Log(ELogLevel::kDebug, [&]{ return "IoU: updating " + f.getFullPathName().toStdString(); });
 		root["predictions"]["IoU"]["min"]						= info.minimum_iou;
 		root["predictions"]["IoU"]["avg"]						= info.average_iou;
 		root["predictions"]["IoU"]["max"]						= info.maximum_iou;
@@ -243,12 +328,20 @@ void dm::DMContentReviewIoU::run()
 		root["predictions"]["predictions_without_annotations"]	= info.number_of_predictions_without_annotations;
 		root["predictions"]["annotations_without_predictions"]	= info.number_of_annotations_without_predictions;
 		root["predictions"]["number_of_differences"]			= info.number_of_differences;
+		root["predictions"]["names_predictions_without_annotations"]	= info.predictions_without_annotations;
+		root["predictions"]["names_annotations_without_predictions"]	= info.annotations_without_predictions;
+		root["predictions"]["annotations"]						= info.number_of_annotations;
+		root["predictions"]["stamp"]["network"]					= network_stamp;
+		root["predictions"]["stamp"]["image"]					= image_timestamp;
+		root["predictions"]["stamp"]["marks"]					= get_annotation_stamp(root);
 
 		std::ofstream fs(f.getFullPathName().toStdString());
 		fs.imbue(std::locale("C"));
 		fs << root.dump(1, '\t') << std::endl;
 	}
 
+	Log("IoU: re-used the previous results for " + std::to_string(number_of_images_reused) + " of " + std::to_string(v.size()) + " images");
+
 	if (not dmapp().review_iou_wnd)
 	{
 		dmapp().review_iou_wnd.reset(new DMReviewIoUWnd(content));
@@ -322,7 +322,7 @@ void dm::DMContentRotateImages::run()
 				break;
 			}
 
-			Log("rotation: next image at idx=" + std::to_string(idx) + " is " + content.image_filenames[idx]);
+			Log(ELogLevel::kDebug, [&]{ return "rotation: next image at idx=" + std::to_string(idx) + " is " + content.image_filenames[idx]; });
 
 			setProgress(work_completed / work_to_be_done);
 			work_completed ++;
@@ -340,9 +340,9 @@ void dm::DMContentRotateImages::run()
 			}
 
 			// load the given image so we can get access to the cv::Mat and annotations
-			Log("rotation: loading image #" + std::to_string(idx) + ": " + content.image_filenames[idx]);
+			Log(ELogLevel::kDebug, [&]{ return "rotation: loading image #" + std::to_string(idx) + ": " + content.image_filenames[idx]; });
 			content.load_image(idx);
-			Log("rotation: done loading image");
+			Log(ELogLevel::kDebug, [&]{ return "rotation: done loading image"; });
 
 			if (content.original_image.empty() or
 				content.original_image.cols < 1 or
@@ -374,10 +374,10 @@ void dm::DMContentRotateImages::run()
 
 					// see if this rotation already exists
 					std::string new_fn = original_file.getSiblingFile(original_fn).getFullPathName().toStdString() + postfix;
-					Log("rotation: looking for " + new_fn);
+					Log(ELogLevel::kDebug, [&]{ return "rotation: looking for " + new_fn; });
 					if (filenames_without_extensions.count(new_fn))
 					{
-						Log("skip rotation (already exists): " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "skip rotation (already exists): " + new_fn; });
 						images_already_exist ++;
 						continue;
 					}
@@ -408,7 +408,7 @@ void dm::DMContentRotateImages::run()
 
 						const auto txt_fn = File(new_fn).withFileExtension(".txt").getFullPathName().toStdString();
 
-						Log("rotation: creating annotations for " + txt_fn);
+						Log(ELogLevel::kDebug, [&]{ return "rotation: creating annotations for " + txt_fn; });
 
 						const double degrees	= (rotation_code == cv::ROTATE_90_CLOCKWISE ? 90.0 : rotation_code == cv::ROTATE_180 ? 180.0 : 270.0);
 						const double rads		= degrees * M_PI / 180.0;
@@ -441,7 +441,7 @@ void dm::DMContentRotateImages::run()
 
 						if (ofs.fail())
 						{
-							Log("Rotate:  error saving " + txt_fn);
+							Log(ELogLevel::kError, "Rotate:  error saving " + txt_fn);
 							AlertWindow::showMessageBox(
 								AlertWindow::AlertIconType::WarningIcon,
 								"DarkMark",
@@ -454,15 +454,15 @@ void dm::DMContentRotateImages::run()
 						ofs.close();
 
 						// load the new images to force DarkMark to create the .json file from the .txt file
-						Log("rotation: reloading " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "rotation: reloading " + new_fn; });
 						content.load_image(content.image_filenames.size() - 1);
-						Log("rotation: done loading " + new_fn);
+						Log(ELogLevel::kDebug, [&]{ return "rotation: done loading " + new_fn; });
 					}
 				}
 			}
 			else
 			{
-				Log("rotation: skipping " + content.image_filenames[idx]);
+				Log(ELogLevel::kDebug, [&]{ return "rotation: skipping " + content.image_filenames[idx]; });
 				images_skipped ++;
 			}
 		}
@@ -0,0 +1,684 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+#include "yolo_anchors.hpp"
+#include <random>
+
+
+dm::DarknetGen::DarknetGen(dm::DMContent & c) :
+	content(c),
+	info(c.project_info),
+	verbose_output(false),
+	keep_augmented_images(false),
+	show_receptive_field(false)
+{
+	return;
+}
+
+
+dm::DarknetGen::~DarknetGen()
+{
+	return;
+}
+
+
+std::string dm::DarknetGen::validate(const std::string & cfg_template, const int image_width, const int image_height, const int batch_size, const int subdivisions)
+{
+	if (cfg_template.empty() or File(cfg_template).exists() == false)
+	{
+		return "The configuration template filename is not valid.";
+	}
+
+	if (image_width % 32)
+	{
+		return "The image width must be a multiple of 32.";
+	}
+
+	if (image_height % 32)
+	{
+		return "The image height must be a multiple of 32.";
+	}
+
+	if (subdivisions > batch_size)
+	{
+		return "The subdivision must be less than or equal to the batch size.";
+	}
+
+	if (batch_size % subdivisions)
+	{
+		return "The batch size must be a multiple of subdivisions.";
+	}
+
+	return "";
+}
+
+
+std::string dm::DarknetGen::create_darknet_files(Progress & progress)
+{
+	info.rebuild();
+
+	size_t number_of_files_train			= 0;
+	size_t number_of_files_valid			= 0;
+	size_t number_of_annotated_images		= 0;
+	size_t number_of_skipped_files			= 0;
+	size_t number_of_marks					= 0;
+	size_t number_of_empty_images			= 0;
+	size_t number_of_dropped_empty_images	= 0;
+	size_t number_of_images_resized			= 0;
+	size_t number_of_images_not_resized		= 0;
+	size_t number_of_tiles_created			= 0;
+	size_t number_of_zooms_created			= 0;
+	size_t number_of_dropped_annotations	= 0;
+
+	progress.set_status(getText("Creating training and validation files..."));
+	create_Darknet_training_and_validation_files(
+		progress,
+		number_of_files_train,
+		number_of_files_valid,
+		number_of_annotated_images,
+		number_of_skipped_files,
+		number_of_marks,
+		number_of_empty_images,
+		number_of_dropped_empty_images,
+		number_of_images_resized,
+		number_of_images_not_resized,
+		number_of_tiles_created,
+		number_of_zooms_created,
+		number_of_dropped_annotations);
+
+	progress.set_status(getText("Creating configuration files and shell scripts..."));
+	progress.set_progress(0.333);
+	create_Darknet_configuration_file(progress);
+	progress.set_progress(1.0);
+	create_Darknet_shell_scripts();
+
+	progress.set_status(getText("Done!"));
+	progress.set_progress(1.0);
+
+	const bool singular = (content.names.size() == 2); // two because the "empty" class is appended to the names, but it does not get output
+
+	std::stringstream ss;
+	ss	<< "The necessary files to run darknet have been saved to " << info.project_dir << "." << std::endl
+		<< std::endl
+		<< "There " << (singular ? "is " : "are ") << (content.names.size() - 1) << " class" << (singular ? "" : "es") << " with a total of "
+		<< number_of_files_train << " training images and "
+		<< number_of_files_valid << " validation images. The average is "
+		<< std::fixed << std::setprecision(2) << double(number_of_marks) / double(number_of_annotated_images)
+		<< " marks per image across a total of " << number_of_annotated_images << " annotated images." << std::endl
+		<< std::endl;
+
+	if (number_of_empty_images)
+	{
+		ss	<< "The number of negative samples (empty images): " << number_of_empty_images << "." << std::endl;
+		if (number_of_dropped_empty_images)
+		{
+			ss << "Additional negative samples dropped/ignored: " << number_of_dropped_empty_images << "." << std::endl;
+		}
+		ss << std::endl;
+	}
+
+	if (number_of_images_resized)
+	{
+		ss	<< "The number of images resized to " << info.image_width << "x" << info.image_height << ": " << number_of_images_resized << "." << std::endl;
+		if (number_of_images_not_resized)
+		{
+			ss << "The number of images already at " << info.image_width << "x" << info.image_height << ": " << number_of_images_not_resized << "." << std::endl;
+		}
+		ss << std::endl;
+	}
+
+	if (number_of_tiles_created)
+	{
+		ss	<< "The number of new image tiles created: " << number_of_tiles_created << "." << std::endl
+			<< std::endl;
+	}
+
+	if (number_of_zooms_created)
+	{
+		ss	<< "The number of random crop & zoom images created: " << number_of_zooms_created << "." << std::endl
+			<< std::endl;
+	}
+
+	if (number_of_skipped_files)
+	{
+		ss	<< "IMPORTANT: " << number_of_skipped_files << " images were skipped because they have not yet been annotated." << std::endl
+			<< std::endl;
+	}
+
+	const double percentage = double(number_of_empty_images) / double(number_of_annotated_images + number_of_empty_images);
+	if (percentage < 0.2)
+	{
+		ss	<< "WARNING: The number of negative samples (empty images) seems unusually low: " << (int)std::round(100.0 * percentage) << "%." << std::endl
+			<< std::endl;
+	}
+	if (percentage > 0.7)
+	{
+		ss	<< "NOTE: The number of negative samples (empty images) seems unusually high: " << (int)std::round(100.0 * percentage) << "%." << std::endl
+			<< std::endl;
+	}
+
+	if (info.remove_small_annotations)
+	{
+		if (number_of_dropped_annotations == 0)
+		{
+			ss << "No annotations were dropped." << std::endl << std::endl;
+		}
+		else
+		{
+			ss << "WARNING: The number of dropped lines (annotations are too small): " << number_of_dropped_annotations << "." << std::endl << std::endl;
+		}
+	}
+
+	ss << "Run " << info.command_filename << " to start the training.";
+
+	Log(ss.str());
+
+	return ss.str();
+}
+
+
+void dm::DarknetGen::create_Darknet_configuration_file(Progress & progress)
+{
+	const size_t number_of_classes		= content.names.size() - 1;
+	const bool enable_mosaic			= info.enable_mosaic;
+	const bool enable_cutmix			= info.enable_cutmix;
+	const bool enable_mixup				= info.enable_mixup;
+	const bool enable_flip				= info.enable_flip;
+	const float learning_rate			= info.learning_rate;
+	const float max_chart_loss			= info.max_chart_loss;
+	const float saturation				= info.saturation;
+	const float exposure				= info.exposure;
+	const float hue						= info.hue;
+	const int angle						= info.angle;
+	const size_t number_of_iterations	= info.iterations;
+	const size_t batch					= info.batch_size;
+	const size_t subdivisions			= info.subdivisions;
+//	const size_t filters				= number_of_classes * 3 + 15;
+	const size_t width					= info.image_width;
+	const size_t height					= info.image_height;
+	const bool recalculate_anchors		= info.recalculate_anchors;
+	const size_t anchor_clusters		= info.anchor_clusters;
+	const bool class_imbalance			= info.class_imbalance;
+
+	MStr m =
+	{
+		{"use_cuda_graph"	, "0"													},
+		{"flip"				, enable_flip	? "1" : "0"								},
+		{"mosaic"			, enable_mosaic	? "1" : "0"								},
+		{"cutmix"			, enable_cutmix	? "1" : "0"								},
+		{"mixup"			, enable_mixup	? "1" : "0"								},
+		{"learning_rate"	, std::to_string(learning_rate)							},
+		{"max_chart_loss"	, std::to_string(max_chart_loss)						},
+		{"hue"				, std::to_string(hue)									},
+		{"saturation"		, std::to_string(saturation)							},
+		{"exposure"			, std::to_string(exposure)								},
+		{"max_batches"		, std::to_string(number_of_iterations)					},
+		{"scales"			, "0.2,0.1"												},
+		{"batch"			, std::to_string(batch)									},
+		{"subdivisions"		, std::to_string(subdivisions)							},
+		{"height"			, std::to_string(height)								},
+		{"width"			, std::to_string(width)									},
+		{"angle"			, std::to_string(angle)									}
+	};
+
+	if (show_receptive_field)
+	{
+		m["show_receptive_field"] = "1";
+	}
+
+	std::set<size_t> steps =
+	{
+		static_cast<size_t>(std::round(0.8f * number_of_iterations)),
+		static_cast<size_t>(std::round(0.9f * number_of_iterations))
+	};
+
+	if (info.restart_training)
+	{
+		steps.insert(std::round(0.5f * number_of_iterations));
+		steps.insert(std::round(0.6f * number_of_iterations));
+		steps.insert(std::round(0.7f * number_of_iterations));
+		m["scales"] = "0.5,0.4,0.3,0.2,0.1";
+		m["burn_in"] = "0";
+	}
+
+	std::string str;
+	for (const auto s : steps)
+	{
+		if (str.size())
+		{
+			str += ",";
+		}
+		str += std::to_string(s);
+	}
+	m["steps"] = str;
+
+	cfg_handler.modify_all_sections("[net]", m);
+
+	m.clear();
+	if (recalculate_anchors)
+	{
+		progress.set_status(dm::getText("Recalculating anchors..."));
+		progress.set_progress(0.0);
+
+		/* Make several attempts at figuring out the best anchors.  With purely random clusters, I've seen the best
+		 * anchors found as high as the 98th attempt!  Each attempt now starts with k-means++ clusters, so only a few
+		 * are needed.  The attempts run in parallel, and the project's random seed is used so the same annotations
+		 * always give the same anchors.
+		 */
+		std::string counters_per_class;
+		std::string anchors;
+		float avg_iou = 0.0f;
+
+		calc_anchors(info.train_filename, anchor_clusters, info.image_width, info.image_height, number_of_classes, static_cast<uint64_t>(info.random_seed), number_of_anchor_restarts, std::max(0, info.anchor_sample_size), progress, anchors, counters_per_class, avg_iou);
+		dm::Log("avg IoU ........ " + std::to_string(avg_iou));
+		dm::Log("new anchors .... " + anchors);
+		dm::Log("new counters ... " + counters_per_class);
+
+		m["anchors"] = anchors;
+		if (class_imbalance)
+		{
+			m["counters_per_class"] = counters_per_class;
+		}
+
+		/* In YOLOv3-tiny and YOLOv4-tiny, there is a typo in the masks.  It
+		 * should be 0,1,2 but instead appears as 1,2,3.  Fix this when the
+		 * user has chosen to re-calculate the anchors.
+		 *
+		 * https://github.com/AlexeyAB/darknet/issues/7856#issuecomment-874147909
+		 */
+		for (auto section_idx : cfg_handler.find_section("yolo"))
+		{
+			const auto idx = cfg_handler.find_key_in_section(section_idx, "mask");
+
+			if (idx != std::string::npos)
+			{
+				std::string & line = cfg_handler.cfg.at(idx);
+				if (line == "mask = 1,2,3")
+				{
+					Log("fixing YOLO masks at index " + std::to_string(idx) + ": " + line);
+					line = "mask = 0,1,2";
+				}
+			}
+		}
+	}
+
+	m["classes"] = std::to_string(number_of_classes);
+
+	cfg_handler.modify_all_sections("[yolo]", m);
+	cfg_handler.fix_filters_before_yolo();
+	cfg_handler.output(info);
+
+	return;
+}
+
+
+void dm::DarknetGen::create_Darknet_training_and_validation_files(
+		Progress & progress,
+		size_t & number_of_files_train			,
+		size_t & number_of_files_valid			,
+		size_t & number_of_annotated_images		,
+		size_t & number_of_skipped_files		,
+		size_t & number_of_marks				,
+		size_t & number_of_empty_images			,
+		size_t & number_of_dropped_empty_images	,
+		size_t & number_of_resized_images		,
+		size_t & number_of_images_not_resized	,
+		size_t & number_of_tiles_created		,
+		size_t & number_of_zooms_created		,
+		size_t & number_of_dropped_annotations	)
+{
+	if (true)
+	{
+		std::ofstream fs(info.data_filename);
+		fs	<< "classes = "	<< content.names.size() - 1						<< std::endl
+			<< "train = "	<< info.train_filename							<< std::endl
+			<< "valid = "	<< info.valid_filename							<< std::endl
+			<< "names = "	<< cfg().get_str(content.cfg_prefix + "names")	<< std::endl
+			<< "backup = "	<< info.project_dir								<< std::endl;
+	}
+
+	number_of_files_train			= 0;
+	number_of_files_valid			= 0;
+	number_of_annotated_images		= 0;
+	number_of_skipped_files			= 0;
+	number_of_marks					= 0;
+	number_of_empty_images			= 0;
+	number_of_dropped_empty_images	= 0;
+	number_of_resized_images		= 0;
+	number_of_images_not_resized	= 0;
+	number_of_tiles_created			= 0;
+	number_of_zooms_created			= 0;
+	number_of_dropped_annotations	= 0;
+
+	// these vectors will have the full path of the images we need to use (or which have been skipped)
+	VStr negative_samples;
+	VStr annotated_images;
+	VStr skipped_images;
+	VStr all_output_images;
+	find_all_annotated_images(progress, annotated_images, skipped_images, number_of_marks, number_of_empty_images);
+	number_of_annotated_images = annotated_images.size();
+	number_of_skipped_files = skipped_images.size();
+
+	Log("total number of skipped input images ..... " + std::to_string(number_of_skipped_files		));
+	Log("original number of annotated images ...... " + std::to_string(number_of_annotated_images	));
+	Log("original number of marks ................. " + std::to_string(number_of_marks				));
+	Log("original number of empty images .......... " + std::to_string(number_of_empty_images		));
+
+	if (info.do_not_resize_images)
+	{
+		Log("not resizing any images");
+		all_output_images = annotated_images;
+	}
+	else
+	{
+		// reset these counters and let the resize/tile/zoom+crop functions set these values
+		number_of_marks = 0;
+		number_of_empty_images = 0;
+	}
+
+	if (info.resize_images or info.tile_images or info.zoom_images)
+	{
+		Log("generating images (resize=" + std::to_string(info.resize_images) + ", tile=" + std::to_string(info.tile_images) + ", crop+zoom=" + std::to_string(info.zoom_images) + ")");
+		generate_images(progress, annotated_images, all_output_images, number_of_resized_images, number_of_images_not_resized, number_of_marks, number_of_tiles_created, number_of_zooms_created, number_of_empty_images, number_of_dropped_annotations);
+		if (info.resize_images)
+		{
+			Log("number of images resized ................. " + std::to_string(number_of_resized_images		));
+			Log("number of images not resized ............. " + std::to_string(number_of_images_not_resized	));
+		}
+		if (info.tile_images)
+		{
+			Log("number of tiles created .................. " + std::to_string(number_of_tiles_created));
+		}
+		if (info.zoom_images)
+		{
+			Log("number of crop+zoom images created ....... " + std::to_string(number_of_zooms_created));
+		}
+	}
+
+	std::shuffle(all_output_images.begin(), all_output_images.end(), get_random_engine());
+
+	if (info.limit_negative_samples)
+	{
+		// see if we need to limit the negative samples (especially useful when using tiling with large images)
+		negative_samples.clear();
+		annotated_images.clear();
+		double work_done = 0.0;
+		double work_to_do = all_output_images.size() + 1.0;
+		progress.set_progress(0.0);
+		progress.set_status(dm::getText("Limit negative samples..."));
+		for (size_t idx = 0; idx < all_output_images.size(); idx ++)
+		{
+			work_done ++;
+			progress.set_progress(work_done / work_to_do);
+
+			const auto & fn = all_output_images[idx];
+			if (File(fn).withFileExtension(".txt").getSize() == 0)
+			{
+				negative_samples.push_back(fn);
+			}
+			else
+			{
+				annotated_images.push_back(fn);
+			}
+		}
+
+		Log("negative samples: " + std::to_string(negative_samples.size()));
+		Log("annotated images: " + std::to_string(annotated_images.size()));
+
+		if (negative_samples.size() > 1.2 * annotated_images.size())
+		{
+			number_of_dropped_empty_images = negative_samples.size() - annotated_images.size();
+			Log("number of dropped negative samples ....... " + std::to_string(number_of_dropped_empty_images));
+			negative_samples.resize(annotated_images.size());
+
+			number_of_empty_images = negative_samples.size();
+			all_output_images.swap(negative_samples);
+			all_output_images.insert(all_output_images.end(), annotated_images.begin(), annotated_images.end());
+			std::shuffle(all_output_images.begin(), all_output_images.end(), get_random_engine());
+		}
+	}
+
+	// now that we know the exact set of images (including resized and tiled images)
+	// we can create the training and validation .txt files
+
+	double work_done = 0.0;
+	double work_to_do = all_output_images.size() + 1.0;
+	progress.set_progress(0.0);
+	progress.set_status(dm::getText("Writing training and validation files..."));
+	Log("total number of output images ............ " + std::to_string(all_output_images.size()));
+
+	const bool use_all_images = info.train_with_all_images;
+	number_of_files_train = std::round(info.training_images_percentage * all_output_images.size());
+	number_of_files_valid = all_output_images.size() - number_of_files_train;
+
+	if (use_all_images)
+	{
+		number_of_files_train = all_output_images.size();
+		number_of_files_valid = all_output_images.size();
+	}
+
+	const size_t maximum_number_of_validation_images = 10 * content.names.size();
+	if (info.limit_validation_images)
+	{
+		if (number_of_files_valid > maximum_number_of_validation_images)
+		{
+			number_of_files_valid = maximum_number_of_validation_images;
+
+			if (not use_all_images)
+			{
+				number_of_files_train = all_output_images.size() - number_of_files_valid;
+			}
+		}
+	}
+
+	number_of_annotated_images = all_output_images.size() - number_of_empty_images;
+	Log("total number of annotated images ............ " + std::to_string(number_of_annotated_images	));
+	Log("total number of marks ....................... " + std::to_string(number_of_marks				));
+	Log("total number of dropped marks (too small) ... " + std::to_string(number_of_dropped_annotations));
+	Log("total number of empty images ................ " + std::to_string(number_of_empty_images		));
+	Log("total number of training images ............. " + std::to_string(number_of_files_train) + " (" + info.train_filename + ")");
+	Log("total number of validation images ........... " + std::to_string(number_of_files_valid) + " (" + info.valid_filename + ")");
+	Log("cap validation images ....................... " + std::string(info.limit_validation_images ? "true" : "false"));
+
+	std::ofstream fs_train(info.train_filename);
+	std::ofstream fs_valid(info.valid_filename);
+	VStr train_images;
+	VStr valid_images;
+
+	size_t current_number_of_validation_images = 0;
+	for (size_t idx = 0; idx < all_output_images.size(); idx ++)
+	{
+		work_done ++;
+		progress.set_progress(work_done / work_to_do);
+
+		if (use_all_images or idx < number_of_files_train)
+		{
+			fs_train << all_output_images[idx] << std::endl;
+			train_images.push_back(all_output_images[idx]);
+		}
+
+		if (use_all_images or idx >= number_of_files_train)
+		{
+			if (info.limit_validation_images and current_number_of_validation_images >= maximum_number_of_validation_images)
+			{
+				continue;
+			}
+			fs_valid << all_output_images[idx] << std::endl;
+			valid_images.push_back(all_output_images[idx]);
+			current_number_of_validation_images ++;
+		}
+	}
+
+	Log("training and validation files have been saved to disk");
+
+	if (info.pack_shards)
+	{
+		create_shards(progress, train_images, valid_images);
+	}
+
+	return;
+}
+
+
+void dm::DarknetGen::create_Darknet_shell_scripts()
+{
+	if (simplified_interface)
+	{
+		return;
+	}
+
+	std::string header;
+
+	if (true)
+	{
+		std::stringstream ss;
+		ss	<< "#!/bin/bash -e"				<< std::endl
+			<< ""							<< std::endl
+			<< "cd " << info.project_dir	<< std::endl
+			<< ""							<< std::endl
+			<< "# Warning: this file is automatically created/updated by DarkMark v" << DARKMARK_VERSION << "!" << std::endl
+			<< "# Created on " << Time::getCurrentTime().formatted("%a %Y-%m-%d %H:%M:%S %Z").toStdString()
+			<< " by " << SystemStats::getLogonName().toStdString()
+			<< "@" << SystemStats::getComputerName().toStdString() << "." << std::endl;
+		header = ss.str();
+	}
+
+	if (true)
+	{
+		std::string cmd =
+				cfg().get_str("darknet_executable") +
+				" detector train " +
+				(verbose_output			? "-verbose "	: "") +
+				(keep_augmented_images	? "-show_imgs "	: "") +
+				info.extra_flags + " " +
+				info.data_filename + " " + info.cfg_filename;
+
+		if (info.save_weights > 0)
+		{
+			cmd += " --save-weights " + std::to_string(info.save_weights);
+		}
+		if (info.restart_training)
+		{
+			cmd += " " + cfg().get_str(content.cfg_prefix + "weights");
+			cmd += " -clear";
+		}
+
+		std::stringstream ss;
+		ss	<< header
+			<< ""												<< std::endl
+			<< "rm -f output.log"								<< std::endl
+			<< "#rm -f chart.png"								<< std::endl
+			<< ""												<< std::endl
+			<< "echo \"creating new log file\" > output.log"	<< std::endl
+			<< "date >> output.log"								<< std::endl
+			<< ""												<< std::endl
+			<< "ts1=$(date)"									<< std::endl
+			<< "ts2=$(date +%s)"								<< std::endl
+			<< "echo \"initial ts1: ${ts1}\" >> output.log"		<< std::endl
+			<< "echo \"initial ts2: ${ts2}\" >> output.log"		<< std::endl
+			<< "echo \"cmd: " << cmd << "\" >> output.log"		<< std::endl
+			<< ""												<< std::endl
+			<< "/usr/bin/time --verbose " << cmd << " 2>&1 | tee --append output.log" << std::endl
+			<< ""												<< std::endl
+			<< "ts3=$(date)"									<< std::endl
+			<< "ts4=$(date +%s)"								<< std::endl
+			<< "echo \"ts1: ${ts1}\" >> output.log"				<< std::endl
+			<< "echo \"ts2: ${ts2}\" >> output.log"				<< std::endl
+			<< "echo \"ts3: ${ts3}\" >> output.log"				<< std::endl
+			<< "echo \"ts4: ${ts4}\" >> output.log"				<< std::endl
+			<< ""												<< std::endl;
+
+		if (info.delete_temp_weights)
+		{
+			ss	<< "find " << info.project_dir << " -maxdepth 1 -regex \".+_[0-9]+\\.weights\" -print -delete >> output.log" << std::endl
+				<< "" << std::endl;
+		}
+
+		const std::string data = ss.str();
+		File f(info.command_filename);
+		f.replaceWithData(data.c_str(), data.size());	// do not use replaceWithText() since it converts the file to CRLF endings which confuses bash
+		f.setExecutePermission(true);
+	}
+
+	if (true)
+	{
+		std::stringstream ss;
+		ss	<< header
+			<< "#"																								<< std::endl
+			<< "# This script assumes you have 2 computers:"													<< std::endl
+			<< "#"																								<< std::endl
+			<< "# - the first is the desktop where you run DarkMark and this script,"							<< std::endl
+			<< "# - the second has a decent GPU and is where you train the neural network."						<< std::endl
+			<< "#"																								<< std::endl
+			<< "# It also assumes the directory structure for where neural networks are saved"					<< std::endl
+			<< "# on disk is identical between both computers."													<< std::endl
+			<< "#"																								<< std::endl
+			<< "# Running this script *FROM THE DESKTOP COMPUTER* will retrieve the results"					<< std::endl
+			<< "# (the .weights files) from 'gpurig' where training took place."								<< std::endl
+			<< ""																								<< std::endl
+			<< "ping -c 1 -W 1 gpurig >/dev/null 2>&1"															<< std::endl
+			<< "if [ $? -ne 0 ]; then"																			<< std::endl
+			<< "	echo \"Make sure the hostname 'gpurig' can be resolved or exists in the /etc/hosts file!\""	<< std::endl
+			<< "else"																							<< std::endl
+			<< "#	rm -f " << info.project_name << "*.weights"													<< std::endl
+			<< "#	rm -f output.log"																			<< std::endl
+			<< "	rm -f chart.png"																			<< std::endl
+			<< ""																								<< std::endl
+			<< "	rsync --update --human-readable --info=progress2,stats2 --times --no-compress gpurig:" << info.project_dir << "/\\* ." << std::endl
+			<< ""																								<< std::endl;
+
+			if (info.delete_temp_weights)
+			{
+				ss	<< "	find " << info.project_dir << " -maxdepth 1 -regex \".+_[0-9]+\\.weights\" -print -delete" << std::endl
+					<< "" << std::endl;
+			}
+
+		ss	<< "	if [ -e chart.png ]; then"																	<< std::endl
+			<< "		eog chart.png"																			<< std::endl
+			<< "	fi"																							<< std::endl
+			<< "fi"																								<< std::endl
+			<< ""																								<< std::endl;
+
+		const std::string data = ss.str();
+		File f = File(info.project_dir).getChildFile("get_results_from_gpu_rig.sh");
+		f.replaceWithData(data.c_str(), data.size());
+		f.setExecutePermission(true);
+	}
+
+	if (true)
+	{
+		std::stringstream ss;
+		ss	<< header
+			<< "#"																								<< std::endl
+			<< "# This script assumes you have 2 computers:"													<< std::endl
+			<< "#"																								<< std::endl
+			<< "# - the first is the desktop where you run DarkMark and this script,"							<< std::endl
+			<< "# - the second has a decent GPU and is where you train the neural network."						<< std::endl
+			<< "#"																								<< std::endl
+			<< "# It also assumes the directory structure for where neural networks are saved"					<< std::endl
+			<< "# on disk is identical between both computers."													<< std::endl
+			<< "#"																								<< std::endl
+			<< "# Running this script *FROM THE DESKTOP COMPUTER* will copy all of the"							<< std::endl
+			<< "# necessary files (images, .txt, .names, .cfg, etc) from the desktop computer"					<< std::endl
+			<< "# to the rig with the decent GPU so you can then start the training process."					<< std::endl
+			<< "#"																								<< std::endl
+			<< "# After this script has finished running, ssh to the GPU rig and run this to train:"			<< std::endl
+			<< "#"																								<< std::endl
+			<< "#		" << info.command_filename																<< std::endl
+			<< "#"																								<< std::endl
+			<< ""																								<< std::endl
+			<< "ping -c 1 -W 1 gpurig >/dev/null 2>&1"															<< std::endl
+			<< "if [ $? -ne 0 ]; then"																			<< std::endl
+			<< "	echo \"Make sure the hostname 'gpurig' can be resolved or exists in the /etc/hosts file!\""	<< std::endl
+			<< "else"																							<< std::endl
+			<< "	rsync --update --human-readable --recursive --no-inc-recursive --info=progress2,stats2 --times --no-compress . gpurig:" << info.project_dir << std::endl
+			<< "fi"																								<< std::endl
+			<< ""																								<< std::endl;
+		const std::string data = ss.str();
+		File f = File(info.project_dir).getChildFile("send_files_to_gpu_rig.sh");
+		f.replaceWithData(data.c_str(), data.size());
+		f.setExecutePermission(true);
+	}
+
+	return;
+}
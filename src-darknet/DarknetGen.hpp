@@ -0,0 +1,123 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+
+
+namespace dm
+{
+	// Sponsored change:  simplified interface + Japanese translation.
+	#if DARKNET_GEN_SIMPLIFIED
+	constexpr bool simplified_interface = true;
+	#else
+	constexpr bool simplified_interface = false;
+	#endif
+	constexpr bool normal_interface = not simplified_interface;
+
+	/** Create all of the Darknet/YOLO files for a project:  the resized/tiled/zoomed images, the training and validation
+	 * lists, the .cfg file with the new anchors, and the shell scripts.  None of this needs a display, so the same code is
+	 * used by @ref DarknetWnd and by the headless "gen-darknet" mode.
+	 */
+	class DarknetGen
+	{
+		public:
+
+			DarknetGen(DMContent & c);
+
+			virtual ~DarknetGen();
+
+			/** Check the values which would otherwise cause Darknet to fail when training.
+			 * @returns an empty string if everything is valid, otherwise a message describing the first problem found.
+			 */
+			static std::string validate(const std::string & cfg_template, const int image_width, const int image_height, const int batch_size, const int subdivisions);
+
+			/** Create all of the files using the settings in @ref info.
+			 * @returns a summary of the images and annotations which can be shown to the user.
+			 * @throws std::exception if anything fails or if the task has been cancelled.
+			 */
+			std::string create_darknet_files(Progress & progress);
+
+			/** Work out what @ref create_darknet_files() would create without decoding or writing any images.  The image
+			 * dimensions come from the .json files, and a few images are decoded and encoded to measure how fast this
+			 * computer is and how large the new images will be.
+			 * @returns a summary with the number of outputs, negative samples, disk space, and estimated time.
+			 * @throws std::exception if an annotation file cannot be read or if the task has been cancelled.
+			 */
+			std::string plan_export(Progress & progress);
+
+			/** Recalculate the anchors for every combination of network size and number of clusters, reading the
+			 * annotations only once.  When either vector is empty, a few sizes and cluster counts around the current
+			 * configuration are used.  The full results including the anchors are also written to @p anchor_sweep.txt.
+			 * @returns a table with the average IoU and the number of small annotations for each configuration.
+			 * @throws std::exception if there are no annotations or if the task has been cancelled.
+			 */
+			std::string sweep_anchors(Progress & progress, std::vector<cv::Size> network_sizes, std::vector<size_t> cluster_counts);
+
+			void create_Darknet_training_and_validation_files(
+					Progress & progress,
+					size_t & number_of_files_train			,
+					size_t & number_of_files_valid			,
+					size_t & number_of_annotated_images		,
+					size_t & number_of_skipped_files		,
+					size_t & number_of_marks				,
+					size_t & number_of_empty_images			,
+					size_t & number_of_dropped_empty_images	,
+					size_t & number_of_resized_images		,
+					size_t & number_of_images_not_resized	,
+					size_t & number_of_tiles_created		,
+					size_t & number_of_zooms_created		,
+					size_t & number_of_dropped_annotations	);
+
+			void find_all_annotated_images(Progress & progress, VStr & annotated_images, VStr & skipped_images, size_t & number_of_marks, size_t & number_of_empty_images);
+
+			/** Create the resized, tiled, and crop+zoom images.  Each annotated image is decoded only once, and all of the
+			 * requested outputs are created from that same copy of the image and annotations.
+			 */
+			void generate_images(Progress & progress, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_resized_images, size_t & number_of_images_not_resized, size_t & number_of_marks, size_t & number_of_tiles_created, size_t & number_of_zooms_created, size_t & number_of_empty_images, size_t & number_of_annotations_dropped);
+
+			/** Pack the images and their annotations into a few large shard files in @p darkmark_shards.  The shards are
+			 * written in parallel, and each one has an index.  Validation images which are also training images are not
+			 * packed twice.  This is an archive of the dataset in addition to the individual files, since Darknet cannot
+			 * read shards.  See @ref dm::ShardWriter for the file format.
+			 */
+			void create_shards(Progress & progress, const VStr & train_images, const VStr & valid_images);
+
+
+			void create_Darknet_configuration_file(Progress & progress);
+			void create_Darknet_shell_scripts();
+
+			/** Number of times k-means is restarted when the anchors are recalculated.  The restarts begin with k-means++
+			 * clusters which rarely differ by more than a fraction of a percent in IoU, so a few restarts are enough.  This
+			 * is also used for every configuration in @ref sweep_anchors().
+			 */
+			static constexpr size_t number_of_anchor_restarts = 8;
+
+			DMContent & content;
+			ProjectInfo & info;
+			CfgHandler cfg_handler;
+
+			/// Debug options which are not stored in the project configuration. @{
+			bool verbose_output;
+			bool keep_augmented_images;
+			bool show_receptive_field;
+			/// @}
+	};
+
+	/// What @ref gen_darknet_headless() needs to do.
+	enum class EHeadless
+	{
+		kCreate,	///< create all of the Darknet files
+		kPlan,		///< only estimate the export with @ref DarknetGen::plan_export()
+		kSweep,		///< only compare anchors and network sizes with @ref DarknetGen::sweep_anchors()
+	};
+
+	/** Load the project given with @p load=... and create the Darknet files without creating any windows.  This is used
+	 * when @p editor=gen-darknet is combined with @p headless=true, or when DarkMark is started on a system without a
+	 * display.  The progress is written to @p STDOUT, either as plain text or as one JSON object per line.  With
+	 * @ref EHeadless::kPlan or @ref EHeadless::kSweep only a summary is created, and the Darknet files are not written.
+	 *
+	 * @returns the exit code for the application:  zero on success, non-zero if the files could not be created.
+	 */
+	int gen_darknet_headless(const EHeadless task);
+}
@@ -0,0 +1,269 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+
+namespace
+{
+	/** Write the progress to @p STDOUT.  A new line is written each time the status changes, and at most once per second
+	 * while the progress is being updated.  In JSON mode each line is a complete JSON object, and the log messages are
+	 * sent to @p STDERR so @p STDOUT only contains JSON.  Each line is written with a single call so it cannot be split
+	 * by output from other threads.
+	 */
+	class ConsoleProgress : public dm::Progress
+	{
+		public:
+
+			ConsoleProgress(const bool use_json) :
+				json_output(use_json),
+				percentage(0),
+				start_time(std::chrono::high_resolution_clock::now()),
+				last_output(start_time)
+			{
+				return;
+			}
+
+			virtual void set_progress(const double progress)
+			{
+				const int new_percentage = std::clamp(static_cast<int>(std::round(100.0 * progress)), 0, 100);
+
+				std::lock_guard lock(mutex);
+				const auto now = std::chrono::high_resolution_clock::now();
+				if (new_percentage != percentage and (new_percentage == 100 or now - last_output >= std::chrono::seconds(1)))
+				{
+					percentage = new_percentage;
+					output(now);
+				}
+
+				return;
+			}
+
+			virtual void set_status(const String & msg)
+			{
+				std::lock_guard lock(mutex);
+				status = msg.toStdString();
+				percentage = 0;
+				output(std::chrono::high_resolution_clock::now());
+
+				return;
+			}
+
+			virtual bool should_stop()
+			{
+				// there is no "cancel" button when running without a display
+				return false;
+			}
+
+			/// Output the final result of the headless run.
+			void finished(const bool success, const std::string & msg)
+			{
+				std::lock_guard lock(mutex);
+				if (json_output)
+				{
+					json j;
+					j["result"]		= success ? "success" : "error";
+					j["message"]	= msg;
+					j["elapsed"]	= elapsed(std::chrono::high_resolution_clock::now());
+					write_line(j.dump());
+				}
+				else if (not success)
+				{
+					write_line("ERROR: " + msg);
+				}
+
+				return;
+			}
+
+		private:
+
+			void write_line(std::string line)
+			{
+				line += "\n";
+				std::cout.write(line.data(), line.size()).flush();
+
+				return;
+			}
+
+			double elapsed(const std::chrono::high_resolution_clock::time_point & now) const
+			{
+				return std::chrono::duration_cast<std::chrono::duration<double>>(now - start_time).count();
+			}
+
+			/// The mutex must be locked prior to calling this.
+			void output(const std::chrono::high_resolution_clock::time_point & now)
+			{
+				last_output = now;
+
+				if (json_output)
+				{
+					json j;
+					j["status"]		= status;
+					j["progress"]	= percentage / 100.0;
+					j["elapsed"]	= elapsed(now);
+					write_line(j.dump());
+				}
+				else
+				{
+					std::stringstream ss;
+					ss << "[" << std::setw(3) << percentage << "%] " << status;
+					write_line(ss.str());
+				}
+
+				return;
+			}
+
+			const bool json_output;
+			int percentage;
+			std::string status;
+			const std::chrono::high_resolution_clock::time_point start_time;
+			std::chrono::high_resolution_clock::time_point last_output;
+			std::mutex mutex;
+	};
+
+
+	/// Parse a comma-separated list of network sizes such as @p "416x416,608x352".
+	std::vector<cv::Size> parse_network_sizes(const std::string & text)
+	{
+		std::vector<cv::Size> sizes;
+		for (const auto & token : StringArray::fromTokens(String(text), ",", ""))
+		{
+			const int width		= token.upToFirstOccurrenceOf("x", false, true).trim().getIntValue();
+			const int height	= token.fromFirstOccurrenceOf("x", false, true).trim().getIntValue();
+			if (width < 32 or height < 32 or width % 32 or height % 32)
+			{
+				throw std::invalid_argument("invalid network size \"" + token.toStdString() + "\" (must be WxH, where both are multiples of 32)");
+			}
+			sizes.push_back(cv::Size(width, height));
+		}
+
+		return sizes;
+	}
+
+
+	/// Parse a comma-separated list of cluster counts such as @p "6,9,12".
+	std::vector<size_t> parse_cluster_counts(const std::string & text)
+	{
+		std::vector<size_t> counts;
+		for (const auto & token : StringArray::fromTokens(String(text), ",", ""))
+		{
+			const int count = token.trim().getIntValue();
+			if (count <= 1 or not token.trim().containsOnly("0123456789"))
+			{
+				throw std::invalid_argument("invalid number of clusters \"" + token.toStdString() + "\" (must be greater than 1)");
+			}
+			counts.push_back(count);
+		}
+
+		return counts;
+	}
+}
+
+
+int dm::gen_darknet_headless(const EHeadless task)
+{
+	const auto & options = dmapp().cli_options;
+	const bool use_json = (options.count("progress") and options.at("progress") == "json");
+
+	ConsoleProgress progress(use_json);
+	int rc = 1;
+
+	try
+	{
+		if (options.count("project_key") == 0)
+		{
+			throw std::invalid_argument("the project must be specified with \"load=...\" when running without a display");
+		}
+
+		const std::string prefix = "project_" + options.at("project_key") + "_";
+		Log("creating the darknet files without a display for " + prefix + " using " + std::to_string(number_of_worker_threads()) + " threads");
+
+		// the GUI would ask the user what to do with a class remap that was interrupted, but here it can only be reported
+		const std::string project_dir = cfg().get_str(prefix + "dir");
+		if (not recover_interrupted_class_remap(File(project_dir), false))
+		{
+			throw std::runtime_error("the classes in " + project_dir + " were being remapped when DarkMark was stopped; open the project in DarkMark to finish or roll back the changes");
+		}
+
+		// without a neural network the class names can only come from the .names file, so don't invent dummy names
+		const std::string names_filename = cfg().get_str(prefix + "names");
+		if (names_filename.empty() or File(names_filename).existsAsFile() == false)
+		{
+			throw std::runtime_error("the .names file for this project does not exist: \"" + names_filename + "\"");
+		}
+
+		DMContent content(prefix);
+		content.load_names();
+
+		if (content.image_filenames.size() == 1 and File(content.image_filenames[0]).existsAsFile() == false)
+		{
+			// this is the dummy entry which DMContent inserts when the project has no images
+			throw std::runtime_error("no images were found in " + content.project_info.project_dir);
+		}
+
+		if (content.images_without_json.empty() == false)
+		{
+			// the GUI would import these, but that requires a window; they will be treated as images without annotations
+			Log("WARNING: " + std::to_string(content.images_without_json.size()) + " images have .txt annotations which have not yet been imported");
+		}
+
+		DarknetGen gen(content);
+		ProjectInfo & info = gen.info;
+
+		if (info.batch_size <= 1)
+		{
+			info.batch_size = 64;
+		}
+
+		const std::string error_message = DarknetGen::validate(info.cfg_template, info.image_width, info.image_height, info.batch_size, info.subdivisions);
+		if (not error_message.empty())
+		{
+			throw std::invalid_argument(error_message);
+		}
+
+		// this is what DarknetWnd does when the template is selected:  anchors can only be recalculated if the template has some
+		gen.cfg_handler.parse(info.cfg_template);
+		const int number_of_clusters = gen.cfg_handler.number_of_anchors_in_yolo();
+		if (number_of_clusters <= 1)
+		{
+			info.recalculate_anchors	= false;
+			info.anchor_clusters		= 0;
+		}
+		else
+		{
+			info.anchor_clusters		= number_of_clusters;
+		}
+		if (not info.recalculate_anchors)
+		{
+			info.class_imbalance = false;
+		}
+
+		std::string summary;
+		if (task == EHeadless::kPlan)
+		{
+			summary = gen.plan_export(progress);
+		}
+		else if (task == EHeadless::kSweep)
+		{
+			const std::vector<cv::Size> network_sizes	= parse_network_sizes	(options.count("sweep_sizes"	) ? options.at("sweep_sizes"	) : "");
+			const std::vector<size_t> cluster_counts	= parse_cluster_counts	(options.count("sweep_clusters"	) ? options.at("sweep_clusters"	) : "");
+			summary = gen.sweep_anchors(progress, network_sizes, cluster_counts);
+		}
+		else
+		{
+			summary = gen.create_darknet_files(progress);
+		}
+		progress.finished(true, summary);
+		rc = 0;
+	}
+	catch (const std::exception & e)
+	{
+		Log("failed to create the darknet files: " + std::string(e.what()));
+		progress.finished(false, e.what());
+		rc = 1;
+	}
+
+	return rc;
+}
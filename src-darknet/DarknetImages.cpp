@@ -15,52 +15,8 @@ namespace
 	 */
 	static int cache_image_format = 0;
 
-	/** Split a vector of filenames (or strings) into several parts.  When pieces is set to 0 (the default) an attempt
-	 * will be made to determine the number of available cores.
-	 * @since 2025-12-08
-	 */
-	std::vector<dm::VStr> split(const dm::VStr & vstr, size_t pieces = 0)
-	{
-		if (pieces == 0)
-		{
-			pieces = std::max(2U, std::thread::hardware_concurrency());
-		}
-
-		std::vector<dm::VStr> output;
-
-		dm::Log("splitting a vector of " + std::to_string(vstr.size()) + " strings into " + std::to_string(pieces) + " new vectors...");
-
-		if (pieces < 2)
-		{
-			output.push_back(vstr);
-		}
-		else
-		{
-			output.resize(pieces);
-			for (auto & v : output)
-			{
-				v.reserve((vstr.size() + pieces) / pieces);
-			}
-
-			// round-robin distribute the filenames between all the vectors
-			for (size_t idx = 0; idx < vstr.size(); idx ++)
-			{
-				output[idx % pieces].push_back(vstr[idx]);
-			}
-		}
-
-		return output;
-	}
-
-
-	std::atomic<size_t> output_image_index = 0;
-	size_t get_next_output_image_index()
-	{
-		return output_image_index ++;
-	}
-
 
-	cv::InterpolationFlags rnd_resize_method(std::default_random_engine & rng)
+	cv::InterpolationFlags rnd_resize_method(dm::SplitMix64 & rng)
 	{
 		/* With very repetitive networks, such as those based on text using black-and-white images, or close-ups of barcodes,
 		* or close-ups of parts on a machine when looking for defects, always using the same resize method actually prevents
@@ -85,7 +41,7 @@ namespace
 	}
 
 
-	std::string rnd_image_filename(std::default_random_engine & rng, const std::string & basename)
+	std::string rnd_image_filename(dm::SplitMix64 & rng, const std::string & basename)
 	{
 		if (cache_image_format == 1)
 		{
@@ -102,7 +58,7 @@ namespace
 	}
 
 
-	int rnd_jpg_quality(std::default_random_engine & rng)
+	int rnd_jpg_quality(dm::SplitMix64 & rng)
 	{
 		// Sweet spot is ~70.  See https://www.ccoderun.ca/programming/2021-02-08_imwrite/
 
@@ -127,13 +83,13 @@ namespace
 	}
 
 
-	void save_image(const std::string & filename, cv::Mat & mat, std::default_random_engine & rng)
+	void save_image(const std::string & filename, const cv::Mat & mat, const int jpg_quality)
 	{
 		if (filename.empty() == false and mat.empty() == false)
 		{
 			if (is_jpg(filename))
 			{
-				cv::imwrite(filename, mat, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, rnd_jpg_quality(rng)});
+				cv::imwrite(filename, mat, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, jpg_quality});
 			}
 			else
 			{
@@ -143,977 +99,1922 @@ namespace
 
 		return;
 	}
-}
 
 
-void dm::DarknetWnd::find_all_annotated_images(ThreadWithProgressWindow & progress_window, VStr & annotated_images, VStr & skipped_images, size_t & number_of_marks, size_t & number_of_empty_images)
-{
-	output_image_index = 0;
-	double work_done = 0.0;
-	double work_to_do = content.image_filenames.size() + 1.0;
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(getText("Finding all images and annotations..."));
+	/// One of the ways new images are generated:  @p "resize", @p "tiles", or @p "zoom".
+	struct GenerationStage
+	{
+		std::string name;
+		std::string dir;
+		std::string key;
+		bool cached;
+		dm::ImageCache::Entry entry;
+	};
 
-	annotated_images.clear();
-	skipped_images.clear();
 
-	for (const auto & filename : content.image_filenames)
+	/** A source image as it moves through the decode, transform, and encode stages of the pipeline.  The references are
+	 * the number of outputs which have not yet been written to disk, plus one for the transform stage itself.  Whoever
+	 * releases the last reference records the outputs.
+	 */
+	struct PendingImage
 	{
-		work_done ++;
-		progress_window.setProgress(work_done / work_to_do);
-
-		File f = File(filename).withFileExtension(".json");
+		std::string original_image;
+		json root;
+		std::string txt;	///< The original .txt annotations, as written by DarkMark.
+		cv::Mat mat;
+		cv::Size size;	///< Set from the annotations when the image does not need to be decoded.
+		std::vector<GenerationStage> stages;
+		std::atomic<size_t> references;
+	};
+	using SPendingImage = std::shared_ptr<PendingImage>;
 
-		// note how count_marks_in_json() lies about negative samples and returns "1" for empty images
-		size_t count = content.count_marks_in_json(f);
-		if (count)
-		{
-			annotated_images.push_back(filename);
 
-			// cheat -- we'd like to know if this is actually a negative samples
-			if (File(f).withFileExtension(".txt").getSize() == 0)
-			{
-				number_of_empty_images ++;
-				count = 0;
-			}
-		}
-		else
-		{
-			skipped_images.push_back(filename);
-		}
-		number_of_marks += count;
-	}
+	/// An output image waiting to be encoded and written to disk.
+	struct EncodeItem
+	{
+		SPendingImage pending;
+		std::string filename;
+		cv::Mat mat;
+		int jpg_quality;
+	};
 
-	work_done = 0.0;
-	work_to_do = skipped_images.size() + 1.0;
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(getText("Listing skipped images..."));
 
-	std::shuffle(skipped_images.begin(), skipped_images.end(), get_random_engine());
-	const std::string fn = File(info.project_dir).getChildFile("skipped_images.txt").getFullPathName().toStdString();
-	std::ofstream fs_skipped(fn);
-	for (const auto & image_filename : skipped_images)
+	/// Each transform thread keeps its own log, and the logs are written to the .txt files once all the threads are done.
+	struct GenerationLogs
 	{
-		work_done ++;
-		progress_window.setProgress(work_done / work_to_do);
+		std::stringstream resized;
+		std::stringstream tiles;
+		std::stringstream zoom;
+	};
 
-		fs_skipped << image_filename << std::endl;
-	}
 
-	if (info.image_type == "JPG")
-	{
-		cache_image_format = 1;
-	}
-	else if (info.image_type == "PNG")
-	{
-		cache_image_format = 2;
-	}
-	else
+	/** Everything shared between the pipeline threads while the resized, tiled, and crop+zoom images are generated.  The
+	 * mutex protects the vector of output images, the counters, and the first error.
+	 */
+	struct ImageGeneration final
 	{
-		cache_image_format = 0; // both
-	}
+		ImageGeneration(const dm::ProjectInfo & i, dm::VStr & output, const size_t decoded_queue_size, const size_t encode_queue_size) :
+			info(i),
+			cache(i.project_dir),
+			master_seed(static_cast<uint64_t>(i.random_seed)),
+			desired_size(i.image_width, i.image_height),
+			/* Images must be larger than the final desired size for us to "zoom in".
+			 * This variable describes the minimum size we need for us to work with the image.
+			 */
+			large_size(
+				std::round(1.25f * desired_size.width),
+				std::round(1.25f * desired_size.height)),
+			decoded_queue(decoded_queue_size),
+			encode_queue(encode_queue_size),
+			all_output_images(output),
+			number_of_resized_images(0),
+			number_of_images_not_resized(0),
+			number_of_tiles_created(0),
+			number_of_zooms_created(0),
+			number_of_marks(0),
+			number_of_empty_images(0),
+			number_of_annotations_dropped(0),
+			images_done(0),
+			abort(false)
+		{
+			return;
+		}
 
-	return;
-}
+		const dm::ProjectInfo & info;
+		dm::ImageCache cache;
+		/// Every image and stage gets its own random number stream derived from this seed.  See @ref stream_seed().
+		const uint64_t master_seed;
+		const cv::Size desired_size;
+		const cv::Size large_size;
+
+		dm::BoundedQueue<SPendingImage> decoded_queue;
+		dm::BoundedQueue<EncodeItem> encode_queue;
+
+		std::mutex mutex;
+		std::condition_variable images_done_cv;
+		dm::VStr & all_output_images;
+		size_t number_of_resized_images;
+		size_t number_of_images_not_resized;
+		size_t number_of_tiles_created;
+		size_t number_of_zooms_created;
+		size_t number_of_marks;
+		size_t number_of_empty_images;
+		size_t number_of_annotations_dropped;
+		dm::ImageCache::DroppedAnnotations annotations_dropped_per_class;
+		std::atomic<size_t> images_done;
+		std::atomic<bool> abort;
+		std::string first_error;
+
+		/// Everything other than the source image and the annotations which determines the content of the outputs.
+		std::string parameters;
+
+		std::string resize_dir;
+		std::string tiles_dir;
+		std::string zoom_dir;
+		std::ofstream resized_txt;
+		std::ofstream tiles_txt;
+		std::ofstream zoom_txt;
+	};
 
 
-void dm::DarknetWnd::resize_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_resized_images, size_t & number_of_images_not_resized, size_t & number_of_marks, size_t & number_of_empty_images)
-{
-	std::atomic<size_t> work_done = 0;
-	const size_t work_to_do = annotated_images.size();
+	/// Create one of the subdirectories in @p darkmark_image_cache, and open the .txt file used to log what was created.
+	std::string create_cache_directory(ImageGeneration & gen, const std::string & name, const std::string & txt_name, std::ofstream & txt)
+	{
+		const std::string dir_name = gen.cache.stage_directory(name);
+
+		txt.open(dir_name + "/" + txt_name);
 
-	const String sizing = String(info.image_width) + "x" + String(info.image_height);
-	String text = getText("Resizing images to");
-	#if DARKNET_GEN_SIMPLIFIED
-		text = sizing + " " + text + "...";
-	#else
-		text += " " + sizing + "...";
-	#endif
+		return dir_name;
+	}
 
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(text);
 
-	File dir = File(info.project_dir).getChildFile("darkmark_image_cache").getChildFile("resize");
-	const std::string dir_name = dir.getFullPathName().toStdString();
-	dir.createDirectory();
-	if (dir.isDirectory() == false)
+	/// Add the outputs to the list of images and update the counters.  The outputs may have been created now, or re-used from the cache.
+	void record_outputs(ImageGeneration & gen, const dm::ImageCache::Entry & entry)
 	{
-		throw std::runtime_error("Failed to create directory " + dir_name + ".");
-	}
+		std::lock_guard lock(gen.mutex);
 
-	auto & rng = get_random_engine();
+		for (const auto & output : entry.outputs)
+		{
+			gen.all_output_images.push_back(output.filename);
+			gen.number_of_marks += output.annotations;
+			if (output.annotations == 0)
+			{
+				gen.number_of_empty_images ++;
+			}
+			for (const auto & [class_idx, count] : output.dropped)
+			{
+				gen.annotations_dropped_per_class[class_idx] += count;
+				gen.number_of_annotations_dropped += count;
+			}
+		}
 
-	const cv::Size desired_image_size(info.image_width, info.image_height);
+		if (entry.stage == "resize")
+		{
+			if (entry.resized)
+			{
+				gen.number_of_resized_images ++;
+			}
+			else
+			{
+				gen.number_of_images_not_resized ++;
+			}
+		}
+		else if (entry.stage == "tiles")
+		{
+			gen.number_of_tiles_created += entry.outputs.size();
+		}
+		else if (entry.stage == "zoom")
+		{
+			gen.number_of_zooms_created += entry.outputs.size();
+		}
 
-	std::ofstream resized_txt(dir_name + "/resized.txt");
-	resized_txt << "WARNING: multiple threads write to this file at the same time." << std::endl;
+		return;
+	}
 
-	// need to protect "all_output_images" and several other items from being modified across multiple threads at the same time
-	std::mutex resize_images_mutex;
-	const auto & split_image_filenames = split(annotated_images);
-	std::string error_detected;
 
-	const auto resize_worker_lambda = [&, this](const size_t thread_idx)
+	/// Record the outputs once the last one has been written to disk.
+	void release_image(ImageGeneration & gen, const SPendingImage & pending)
 	{
-		std::string last_image_filename = "?";
-
-		try
+		if (pending->references.fetch_sub(1) == 1)
 		{
-			for (const auto & original_image : split_image_filenames[thread_idx])
+			for (auto & stage : pending->stages)
 			{
-				if (not error_detected.empty())
+				if (not stage.cached)
 				{
-					break;
+					gen.cache.add(stage.key, stage.entry);
 				}
+				record_outputs(gen, stage.entry);
+			}
 
-				work_done ++;
+			gen.images_done ++;
+			gen.images_done_cv.notify_all();
+		}
 
-				last_image_filename = original_image;
+		return;
+	}
 
-				std::stringstream ss;
-				ss << dir_name << "/" << std::setfill('0') << std::setw(8) << get_next_output_image_index();
-				const std::string output_base_name = ss.str();
-				const std::string output_image = rnd_image_filename(rng, output_base_name);
-				const std::string output_label = output_base_name + ".txt";
 
-				// first we create the resized image file
-				cv::Mat mat = cv::imread(original_image);
-				if (mat.empty())
-				{
-					// something has gone *very* wrong if we cannot read the image
-					Log(original_image + " (" + std::to_string(mat.cols) + "x" + std::to_string(mat.rows) + ")");
-					throw std::runtime_error("failed to open or read the image " + original_image);
-				}
+	/** Hand the output image over to the encode stage.  The JPG quality is chosen now from the stream of the image being
+	 * transformed, so the encoder threads don't need a random number generator.
+	 */
+	void queue_image(ImageGeneration & gen, const SPendingImage & pending, const std::string & filename, const cv::Mat & mat, dm::SplitMix64 & rng)
+	{
+		const int jpg_quality = is_jpg(filename) ? rnd_jpg_quality(rng) : 0;
 
-				cv::Mat dst;
-				if (mat.cols != desired_image_size.width or mat.rows != desired_image_size.height)
-				{
-					cv::resize(mat, dst, desired_image_size, 0, 0, rnd_resize_method(rng));
-					number_of_resized_images ++;
-				}
-				else
-				{
-					dst = mat;
-					number_of_images_not_resized ++;
-				}
+		pending->references ++;
+		if (gen.encode_queue.push({pending, filename, mat, jpg_quality}) == false)
+		{
+			pending->references --;
+			throw std::runtime_error("encode queue was closed while processing " + filename);
+		}
 
-				save_image(output_image, dst, rng);
+		return;
+	}
 
-				// next we copy the annoations in the .txt file
-				File txt = File(original_image).withFileExtension(".txt");
-				const bool success = txt.copyFileTo(File(output_label));
-				if (not success)
-				{
-					throw std::runtime_error("Failed to copy " + txt.getFullPathName().toStdString() + ".");
-				}
 
-				// beyond this point we update the things that must be protected by the mutex lock
+	/** The seed for the random number stream used by one stage of one image.  This is derived from the cache key -- which
+	 * already includes the image content, annotations, filename, and settings -- so the outputs don't depend on the order
+	 * in which the images are processed, on which thread they are processed, or on which other stages were cached.
+	 */
+	uint64_t stream_seed(const ImageGeneration & gen, const std::string & key)
+	{
+		return dm::SplitMix64::split(gen.master_seed, std::stoull(key.substr(0, 16), nullptr, 16));
+	}
 
-				std::lock_guard lock(resize_images_mutex);
-				all_output_images.push_back(output_image);
-				resized_txt
-					<< "#" << thread_idx << ": "
-					<< original_image
-					<< " [" << mat.cols << "x" << mat.rows << "] -> "
-					<< output_image
-					<< " [" << dst.cols << "x" << dst.rows << "]"
-					<< std::endl;
 
-				if (txt.getSize() == 0)
-				{
-					number_of_empty_images ++;
-				}
-				else
-				{
-					json root = json::parse(txt.withFileExtension(".json").loadFileAsString().toStdString());
-					number_of_marks += root["mark"].size();
-				}
-			}
-		}
-		catch (const std::exception & e)
-		{
-			std::string msg = "error in resize thread #" + std::to_string(thread_idx) + " while processing \"" + last_image_filename + "\": " + e.what();
-			Log(msg);
-			if (error_detected.empty())
-			{
-				error_detected.swap(msg);
-			}
-		}
-	};
+	/// Everything other than the source image and the annotations which determines the content of the outputs.
+	std::string generation_parameters(const dm::ProjectInfo & info)
+	{
+		// if any of these change, then all of the images in the cache need to be re-generated
+		std::stringstream parameters;
+		parameters
+			<< info.image_width << "x" << info.image_height
+			<< " type="		<< info.image_type
+			<< " small="	<< info.remove_small_annotations << "/" << info.annotation_area_size
+			<< " seed="		<< info.random_seed
+			<< " link="		<< info.link_unmodified_images;
+
+		return parameters.str();
+	}
 
-	// start multiple threads running the resize worker lambda, then we wait for all of them to be done
 
-	VThreads vthreads;
-	for (size_t idx = 0; idx < split_image_filenames.size(); idx ++)
+	/// The key used to find the outputs of one stage of one image in the cache.
+	std::string stage_key(const ImageGeneration & gen, const std::string & stage, const std::string & original_image, const std::string & source_hash, const std::string & annotation_hash)
 	{
-		Log("creating image resize thread #" + std::to_string(idx) + " to handle " + std::to_string(split_image_filenames[idx].size()) + " images...");
-		vthreads.emplace_back(resize_worker_lambda, idx);
+		// images which fit in a single tile are skipped by the tile stage when resize is enabled, so the tile key must include that setting
+		const std::string parameters = gen.parameters + (stage == "tiles" ? " resize=" + std::to_string(gen.info.resize_images) : "");
+
+		// the filename is included so that identical copies of an image don't end up writing to the same outputs
+		return dm::ImageCache::key(stage, source_hash, annotation_hash, parameters + " " + original_image);
 	}
 
-	while (work_done < work_to_do and error_detected.empty())
+
+	/// Set the format used for the images in the cache from the image type selected in the project.
+	void set_cache_image_format(const std::string & image_type)
 	{
-		progress_window.setProgress(work_done / static_cast<double>(work_to_do));
-		std::this_thread::sleep_for(std::chrono::milliseconds(750));
+		if (image_type == "JPG")
+		{
+			cache_image_format = 1;
+		}
+		else if (image_type == "PNG")
+		{
+			cache_image_format = 2;
+		}
+		else
+		{
+			cache_image_format = 0; // both
+		}
+
+		return;
 	}
 
-	for (auto & t : vthreads)
+
+	/** Decoding and encoding are much slower than the transformations, and PNG encoding is the slowest of all, so the
+	 * encode stage of the pipeline gets the most threads.
+	 */
+	void pipeline_threads(const size_t hardware_threads, size_t & number_of_decoders, size_t & number_of_transformers, size_t & number_of_encoders)
 	{
-		t.join();
+		number_of_decoders		= std::max(size_t(1), hardware_threads / 4);
+		number_of_transformers	= std::max(size_t(1), hardware_threads / 4);
+		number_of_encoders		= std::max(size_t(1), hardware_threads / 2);
+
+		return;
 	}
 
-	if (not error_detected.empty())
+
+	/// Determine how many tiles will be created horizontally and vertically for an image of the given size.
+	cv::Size tile_counts(const ImageGeneration & gen, const cv::Size & size)
 	{
-		throw std::runtime_error(error_detected);
+		const double horizontal_factor	= static_cast<double>(size.width) / static_cast<double>(gen.desired_size.width);
+		const double vertical_factor	= static_cast<double>(size.height) / static_cast<double>(gen.desired_size.height);
+
+		return cv::Size(
+			std::round(std::max(1.0, horizontal_factor	)),
+			std::round(std::max(1.0, vertical_factor	)));
 	}
 
-	return;
-}
 
+	/** Determine the part of the image used to create one of the tiles.  When a cell is smaller than the network size, a
+	 * few more pixels are taken from the neighbouring cells.  Tiles are never larger than the image itself.
+	 */
+	cv::Rect tile_rectangle(const ImageGeneration & gen, const cv::Size & size, const cv::Size & counts, const size_t x_idx, const size_t y_idx)
+	{
+		const double cell_width		= static_cast<double>(size.width) / static_cast<double>(counts.width);
+		const double cell_height	= static_cast<double>(size.height) / static_cast<double>(counts.height);
+
+		int tile_x = std::round(cell_width	* static_cast<double>(x_idx));
+		int tile_y = std::round(cell_height	* static_cast<double>(y_idx));
+		int tile_w = std::round(cell_width);
+		int tile_h = std::round(cell_height);
+//		dm::Log("-> old tile: x=" + std::to_string(tile_x) + " y=" + std::to_string(tile_y) + " w=" + std::to_string(tile_w) + " h=" + std::to_string(tile_h));
+
+		// if a cell is smaller than our desired tile, then we can grab a few more pixels to fill out the tile and get it closer to the desired network size
+		int delta = gen.desired_size.width - tile_w;
+		tile_x -= delta / 2;
+		tile_w += delta;
+
+		// if we moved beyond the right border then move the X coordinate back
+		if (tile_x + tile_w >= size.width)
+		{
+			tile_x = size.width - tile_w;
+		}
 
-void dm::DarknetWnd::tile_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_marks, size_t & number_of_tiles_created, size_t & number_of_empty_images)
-{
-	std::atomic<size_t> work_done = 0;
-	const size_t work_to_do = annotated_images.size();
+		// if we moved beyond the *left* border, then reset to zero
+		if (tile_x < 0)
+		{
+			tile_x = 0;
+		}
 
-	const String sizing = String(info.image_width) + "x" + String(info.image_height);
-	String text = getText("Tiling images to");
-	#if DARKNET_GEN_SIMPLIFIED
-		text = sizing + " " + text + "...";
-	#else
-		text += " " + sizing + "...";
-	#endif
+		// make sure the cell width doesn't extend beyond the right border
+		if (tile_x + tile_w >= size.width)
+		{
+			tile_w = (size.width - tile_x);
+		}
 
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(text);
+		delta = gen.desired_size.height - tile_h;
+		tile_y -= delta / 2;
+		tile_h += delta;
 
-	File dir = File(info.project_dir).getChildFile("darkmark_image_cache").getChildFile("tiles");
-	const std::string dir_name = dir.getFullPathName().toStdString();
-	dir.createDirectory();
-	if (dir.isDirectory() == false)
-	{
-		throw std::runtime_error("Failed to create directory " + dir_name + ".");
-	}
+		// if we moved beyond the bottom border then move the Y coordinate back
+		if (tile_y + tile_h >= size.height)
+		{
+			tile_y = size.height - tile_h;
+		}
 
-	auto & rng = get_random_engine();
+		// if we moved beyond the *top* border, then reset to zero
+		if (tile_y < 0)
+		{
+			tile_y = 0;
+		}
 
-	const cv::Size desired_tile_size(info.image_width, info.image_height);
+		// make sure the cell width doesn't extend beyond the bottom border
+		if (tile_y + tile_h >= size.height)
+		{
+			tile_h = (size.height - tile_y);
+		}
+//		dm::Log("-> new tile: x=" + std::to_string(tile_x) + " y=" + std::to_string(tile_y) + " w=" + std::to_string(tile_w) + " h=" + std::to_string(tile_h));
 
-	std::ofstream tiles_txt(dir_name + "/tiles.txt");
-	tiles_txt << "WARNING: multiple threads write to this file at the same time." << std::endl;
+		return cv::Rect(tile_x, tile_y, tile_w, tile_h);
+	}
 
-	std::mutex tile_images_mutex;
-	const auto & split_image_filenames = split(annotated_images);
-	std::string error_detected;
 
-	const auto tile_worker_lambda = [&, this](const size_t thread_idx)
+	/** Clip the annotation to the part of the image used to create a tile or a crop+zoom image.  The coordinates are
+	 * still relative to the original image.
+	 * @returns @p false if the annotation is not in the region, or if what remains is a slice narrower than @p min_size.
+	 */
+	bool clip_annotation(const cv::Rect & region, const int min_size, int & x, int & y, int & w, int & h)
 	{
-		std::string last_image_filename = "?";
+		if ((cv::Rect(x, y, w, h) & region).area() == 0)
+		{
+			return false;
+		}
+
+		if (x < region.x)
+		{
+			// X is beyond the left border, we need to move it to the right
+			const int delta = region.x - x;
+			x += delta;
+			w -= delta;
+		}
+		if (y < region.y)
+		{
+			// Y is beyond the top border, we need to move it down
+			const int delta = region.y - y;
+			y += delta;
+			h -= delta;
+		}
+		if (x + w > region.x + region.width)
+		{
+			// width is beyond the right border
+			w = region.x + region.width - x;
+		}
+		if (y + h > region.y + region.height)
+		{
+			// height is beyond the bottom border
+			h = region.y + region.height - y;
+		}
+
+		// ignore extremely tiny slices of annotations
+		return (w >= min_size and h >= min_size);
+	}
 
-		try
+
+	/// The corners and the middle of every annotation.  The crop+zoom images keep going until all of these are covered.
+	std::vector<cv::Point> zoom_points_of_interest(const json & root, const cv::Size & image_size)
+	{
+		const cv::Rect original_rect(cv::Point(0, 0), image_size);
+		std::vector<cv::Point> points_of_interest;
+		for (const auto & j : root["mark"])
 		{
-			for (const auto & original_image : split_image_filenames[thread_idx])
+			const int x = j["rect"]["int_x"];
+			const int y = j["rect"]["int_y"];
+			const int w = j["rect"]["int_w"];
+			const int h = j["rect"]["int_h"];
+
+			for (const cv::Point & p :
+				{
+					cv::Point(x + 0, y + 0),	// TL
+					cv::Point(x + w, y + 0),	// TR
+					cv::Point(x + w, y + h),	// BR
+					cv::Point(x + 0, y + h),	// BL
+					cv::Point(x + w/2, y + h/2)	// middle
+				})
 			{
-				if (not error_detected.empty())
+				if (original_rect.contains(p))
 				{
-					break;
+					points_of_interest.push_back(p);
 				}
+			}
+		}
 
-				work_done ++;
+		return points_of_interest;
+	}
 
-				last_image_filename = original_image;
 
-				// first thing we'll do is read the annotations for this image
-				json root = json::parse(File(original_image).withFileExtension(".json").loadFileAsString().toStdString());
+	/** Randomly choose the next part of the image to crop and zoom.  This only depends on the image size, the annotations,
+	 * and the random number stream, never on the pixels, which is what allows the export to be planned without decoding.
+	 * @returns @p false once 5 consecutive attempts have failed to cover a new part of the image.
+	 */
+	bool next_zoom_roi(const ImageGeneration & gen, const cv::Size & image_size, std::vector<cv::Point> & points_of_interest, std::vector<cv::Rect> & all_previous_rectangles, dm::SplitMix64 & rng, cv::Rect & roi, float & factor, std::stringstream & messages, const std::string & prefix)
+	{
+		// keep creating cropped/zoomed images as long as we're finding new parts of the image that we didn't previously cover
+		size_t failed_consecutive_attempts = 0;
 
-				cv::Mat mat = cv::imread(original_image);
-				if (mat.empty())
+		while (failed_consecutive_attempts < 5)
+		{
+			/* The amount we're going to "zoom in" depends on exactly how big the image is compared to the final size.
+			 * This value is the "factor" by which we multiply the desired image size.  We need to make sure that both
+			 * the horizontal and vertical values can be satisfied.
+			 */
+			const float horizontal_factor	= static_cast<float>(image_size.width) / static_cast<float>(gen.desired_size.width);
+			const float vertical_factor		= static_cast<float>(image_size.height) / static_cast<float>(gen.desired_size.height);
+			const float min_factor			= std::min(horizontal_factor, vertical_factor);
+
+			std::uniform_real_distribution<float> uni_f(0.8f, min_factor);
+			factor = uni_f(rng);
+
+			// This describes the size of the RoI we're going to carve out of the original image mat.
+			const cv::Size size(
+					std::round(factor * gen.desired_size.width),
+					std::round(factor * gen.desired_size.height));
+
+			// Now that we know the size, we can create the rectangle which is used to carve out the RoI.
+			roi = cv::Rect(cv::Point(0, 0), size);
+
+			// Now figure out how much room remains outside of the RoI, and randomly choose some spacing to assign.
+			const int delta_h = image_size.width - roi.width;
+			const int delta_v = image_size.height - roi.height;
+			std::uniform_int_distribution<int> uni_h(0, delta_h);
+			std::uniform_int_distribution<int> uni_v(0, delta_v);
+			roi.x = uni_h(rng);
+			roi.y = uni_v(rng);
+
+			// See if the middle point of this RoI was already covered by a previous rectangle.
+			bool continue_crop_and_zoom = true;
+			const cv::Point middle_point(roi.x + roi.width/2, roi.y + roi.height/2);
+			for (const auto & r : all_previous_rectangles)
+			{
+				if (r.contains(middle_point))
 				{
-					// something has gone *very* wrong if we cannot read the image
-					Log(original_image + " (" + std::to_string(mat.cols) + "x" + std::to_string(mat.rows) + ")");
-					throw std::runtime_error("failed to open or read the image " + original_image);
+					// we've already covered this point
+					continue_crop_and_zoom = false;
+					break;
 				}
+			}
 
-				const double horizontal_factor		= static_cast<double>(mat.cols) / static_cast<double>(desired_tile_size.width);
-				const double vertical_factor		= static_cast<double>(mat.rows) / static_cast<double>(desired_tile_size.height);
-				const size_t horizontal_tiles_count	= std::round(std::max(1.0, horizontal_factor	));
-				const size_t vertical_tiles_count	= std::round(std::max(1.0, vertical_factor		));
-				const double cell_width				= static_cast<double>(mat.cols) / static_cast<double>(horizontal_tiles_count);
-				const double cell_height			= static_cast<double>(mat.rows) / static_cast<double>(vertical_tiles_count);
+			if (continue_crop_and_zoom == false)
+			{
+				// before we give up on this RoI, see if it covers one of the remaining points of interest
+				for (const auto & p : points_of_interest)
+				{
+					if (roi.contains(p))
+					{
+						messages << prefix << "-> adding RoI because it includes point-of-interest x=" << p.x << " y=" << p.y << std::endl;
+						continue_crop_and_zoom = true;
+						break;
+					}
+				}
+			}
 
-				std::stringstream messages;
+			if (continue_crop_and_zoom == false)
+			{
 				messages
-					<< "#" << thread_idx << ": "
-					<< original_image << " [" << mat.cols << "x" << mat.rows << "]"
-					<< " -> [" << horizontal_tiles_count << "x" << vertical_tiles_count << "]"
-					<< " -> [" << cell_width << "x" << cell_height << "]"
-					<< std::endl;
+					<< prefix
+					<< " -> skipped RoI [x=" << roi.x << " y=" << roi.y << " w=" << roi.width << " h=" << roi.height << "] due to overlap" << std::endl;
+				failed_consecutive_attempts ++;
+				continue;
+			}
 
-				if (info.resize_images and horizontal_tiles_count == 1 and vertical_tiles_count == 1)
+			// ...otherise, if we get here then we seem to be covering a new part of the image
+			all_previous_rectangles.push_back(roi);
+			messages
+				<< prefix
+				<< " -> creating RoI from [x=" << roi.x << " y=" << roi.y << " w=" << roi.width << " h=" << roi.height << "]" << std::endl;
+
+			// remove from "points-of-interest" any points located within the RoI we've just created
+			auto iter = points_of_interest.begin();
+			while (iter != points_of_interest.end())
+			{
+				const auto & p = *iter;
+				if (roi.contains(p))
 				{
-					// this image only has 1 tile, and we already have it since "resize" is enabled, so skip to the next image
-					std::lock_guard lock(tile_images_mutex);
-					tiles_txt
-						<< messages.str()
-						<< "#" << thread_idx << ": "
-						<< "skipped (single tile)" << std::endl;
-					continue;
+					iter = points_of_interest.erase(iter);
 				}
-
-//				Log(original_image + " (" + std::to_string(mat.cols) + "x" + std::to_string(mat.rows) + ") needs to be tiled as " + std::to_string(horizontal_tiles_count) + "x" + std::to_string(vertical_tiles_count) + " tiles each measuring " + std::to_string(desired_tile_size.width) + "x" + std::to_string(desired_tile_size.height));
-
-				for (size_t y_idx = 0; y_idx < vertical_tiles_count; y_idx ++)
+				else
 				{
-					for (size_t x_idx = 0; x_idx < horizontal_tiles_count; x_idx ++)
-					{
-						int tile_x = std::round(cell_width	* static_cast<double>(x_idx));
-						int tile_y = std::round(cell_height	* static_cast<double>(y_idx));
-						int tile_w = std::round(cell_width);
-						int tile_h = std::round(cell_height);
-//						Log("-> old tile: x=" + std::to_string(tile_x) + " y=" + std::to_string(tile_y) + " w=" + std::to_string(tile_w) + " h=" + std::to_string(tile_h));
-
-						// if a cell is smaller than our desired tile, then we can grab a few more pixels to fill out the tile and get it closer to the desired network size
-						int delta = desired_tile_size.width - tile_w;
-						tile_x -= delta / 2;
-						tile_w += delta;
-
-						// if we moved beyond the right border then move the X coordinate back
-						if (tile_x + tile_w >= mat.cols)
-						{
-							tile_x = mat.cols - tile_w;
-						}
-
-						// if we moved beyond the *left* border, then reset to zero
-						if (tile_x < 0)
-						{
-							tile_x = 0;
-						}
+					iter ++;
+				}
+			}
 
-						// make sure the cell width doesn't extend beyond the right border
-						if (tile_x + tile_w >= mat.cols)
-						{
-							tile_w = (mat.cols - tile_x);
-						}
+			return true;
+		}
 
-						delta = desired_tile_size.height - tile_h;
-						tile_y -= delta / 2;
-						tile_h += delta;
+		return false;
+	}
 
-						// if we moved beyond the bottom border then move the Y coordinate back
-						if (tile_y + tile_h >= mat.rows)
-						{
-							tile_y = mat.rows - tile_h;
-						}
 
-						// if we moved beyond the *top* border, then reset to zero
-						if (tile_y < 0)
-						{
-							tile_y = 0;
-						}
+	/** Get the image dimensions stored in the .json annotations.  The dimensions are only trusted if the annotations were
+	 * saved after the image was last modified.  Otherwise an image which was replaced in-place by one of a different size
+	 * could be linked into the cache at the wrong size.
+	 * @returns an empty size if the dimensions are unknown or may be out-of-date, in which case the image must be decoded.
+	 */
+	cv::Size annotated_image_size(const json & root, const std::string & original_image)
+	{
+		if (not root.contains("image")				or
+			not root["image"].is_object()			or
+			not root["image"]["width"].is_number()	or
+			not root["image"]["height"].is_number()	or
+			not root.contains("timestamp")			or
+			not root["timestamp"].is_number())
+		{
+			return cv::Size();
+		}
 
-						// make sure the cell width doesn't extend beyond the bottom border
-						if (tile_y + tile_h >= mat.rows)
-						{
-							tile_h = (mat.rows - tile_y);
-						}
-//						Log("-> new tile: x=" + std::to_string(tile_x) + " y=" + std::to_string(tile_y) + " w=" + std::to_string(tile_w) + " h=" + std::to_string(tile_h));
+		const std::time_t annotation_timestamp	= root["timestamp"].get<std::time_t>();
+		const std::time_t image_timestamp		= File(original_image).getLastModificationTime().toMilliseconds() / 1000;
+		if (image_timestamp > annotation_timestamp)
+		{
+			return cv::Size();
+		}
 
-						const cv::Rect tile_rect(tile_x, tile_y, tile_w, tile_h);
-						cv::Mat tile = mat(tile_rect);
+		return cv::Size(root["image"]["width"].get<int>(), root["image"]["height"].get<int>());
+	}
 
-						std::stringstream ss;
-						ss << dir_name << "/" << std::setfill('0') << std::setw(8) << get_next_output_image_index();
-						const std::string output_base_name = ss.str();
-						const std::string output_image = rnd_image_filename(rng, output_base_name);
-						const std::string output_label = output_base_name + ".txt";
 
-						save_image(output_image, tile, rng);
+	/** Images which already match the network dimensions and are already in one of the formats used by the image cache
+	 * don't need to be decoded and re-encoded.  The original file can be linked into the cache as-is.
+	 */
+	bool can_link_image(const ImageGeneration & gen, const std::string & original_image, const cv::Size & size)
+	{
+		if (gen.info.link_unmodified_images == false or size != gen.desired_size)
+		{
+			return false;
+		}
 
-						// now re-create the .txt file with the appropriate annotations for this new tile
-						//
-						// we know our tile is from (tile_x, tile_y, tile_w, tile_h), so include any annotations within those bounds
-						std::ofstream fs_txt(output_label);
-						fs_txt.imbue(std::locale("C"));
-						fs_txt << std::fixed << std::setprecision(10);
+		const std::string extension = File(original_image).getFileExtension().toLowerCase().toStdString();
+		const bool jpg = (extension == ".jpg" or extension == ".jpeg");
+		const bool png = (extension == ".png");
 
-						size_t number_of_annotations = 0;
-						for (auto j : root["mark"])
-						{
-							const cv::Rect annotation_rect(j["rect"]["int_x"], j["rect"]["int_y"], j["rect"]["int_w"], j["rect"]["int_h"]);
-							const cv::Rect intersection = annotation_rect & tile_rect;
-							if (intersection.area() > 0)
-							{
-								const int class_idx = j["class_idx"];
-								int x = j["rect"]["int_x"];
-								int y = j["rect"]["int_y"];
-								int w = j["rect"]["int_w"];
-								int h = j["rect"]["int_h"];
-
-								if (x < tile_rect.x)
-								{
-									// X is beyond the left border, we need to move it to the right
-									const int delta_x = tile_rect.x - x;
-									x += delta_x;
-									w -= delta_x;
-								}
-								if (y < tile_rect.y)
-								{
-									const int delta_y = tile_rect.y - y;
-									y += delta_y;
-									h -= delta_y;
-								}
-								if (x + w > tile_rect.x + tile_rect.width)
-								{
-									w = tile_rect.x + tile_rect.width - x;
-								}
-								if (y + h > tile_rect.y + tile_rect.height)
-								{
-									h = tile_rect.y + tile_rect.height - y;
-								}
-
-								// ignore extremely tiny slices
-								if (w >= 10 and h >= 10)
-								{
-									// bring all the coordinates back down to zero
-									x -= tile_rect.x;
-									y -= tile_rect.y;
-
-									const double normalized_w = static_cast<double>(w) / static_cast<double>(tile.cols);
-									const double normalized_h = static_cast<double>(h) / static_cast<double>(tile.rows);
-									const double normalized_x = static_cast<double>(x) / static_cast<double>(tile.cols) + normalized_w / 2.0;
-									const double normalized_y = static_cast<double>(y) / static_cast<double>(tile.rows) + normalized_h / 2.0;
-									fs_txt << class_idx << " " << normalized_x <<  " " << normalized_y << " " << normalized_w << " " << normalized_h << std::endl;
-									number_of_annotations ++;
-								}
-							}
-						}
+		if (cache_image_format == 1)
+		{
+			return jpg;
+		}
+		if (cache_image_format == 2)
+		{
+			return png;
+		}
+
+		return jpg or png;
+	}
+
+
+	/** Determine if the stage needs the decoded image.  This must match the decisions made by @ref resize_image(),
+	 * @ref tile_image() and @ref zoom_image() before they look at the pixels.
+	 */
+	bool stage_needs_pixels(const ImageGeneration & gen, const std::string & original_image, const std::string & stage, const cv::Size & size)
+	{
+		if (size.width <= 0 or size.height <= 0)
+		{
+			// we don't know the image size, so the image must be decoded
+			return true;
+		}
+
+		if (stage == "resize")
+		{
+			return not can_link_image(gen, original_image, size);
+		}
+
+		if (stage == "tiles")
+		{
+			const cv::Size counts = tile_counts(gen, size);
+			return not (gen.info.resize_images and counts.width == 1 and counts.height == 1);
+		}
+
+		// zoom
+		return not (size.width < gen.large_size.width or size.height < gen.large_size.height);
+	}
+
+
+	/** Hard-link the original image into the cache.  If that fails -- for example the cache is on a different filesystem
+	 * or the filesystem doesn't support hard links -- then the image is copied instead.
+	 * @returns @p "hardlink" or @p "copy" to indicate what was done.
+	 */
+	std::string link_image(const std::string & original_image, const std::string & output_image)
+	{
+		std::error_code ec;
+		std::filesystem::remove(output_image, ec);
+
+		ec.clear();
+		std::filesystem::create_hard_link(original_image, output_image, ec);
+		if (not ec)
+		{
+			return "hardlink";
+		}
+
+		if (std::filesystem::copy_file(original_image, output_image, std::filesystem::copy_options::overwrite_existing, ec) == false or ec)
+		{
+			throw std::runtime_error("Failed to link or copy " + original_image + " to " + output_image + ": " + ec.message());
+		}
+
+		return "copy";
+	}
+
+
+	/** Annotations which are too small in the output image cannot be detected, so they are dropped instead of being
+	 * written to the .txt file.  The size is measured in the output image, which is not always the network size.  For
+	 * example, tiles along the edge of the image may be smaller.
+	 * @returns @p true if the annotation must be dropped.
+	 */
+	bool drop_small_annotation(const ImageGeneration & gen, const std::string & output_image, const cv::Size & output_size, const int class_idx, const double normalized_w, const double normalized_h, dm::ImageCache::DroppedAnnotations & dropped, std::stringstream & log, const size_t thread_idx)
+	{
+		if (not gen.info.remove_small_annotations)
+		{
+			return false;
+		}
+
+		const int annotation_width	= std::round(output_size.width	* normalized_w);
+		const int annotation_height	= std::round(output_size.height	* normalized_h);
+		const int area = annotation_width * annotation_height;
+		if (area > gen.info.annotation_area_size)
+		{
+			return false;
+		}
+
+		dropped[class_idx] ++;
+		log	<< "#" << thread_idx << ": "
+			<< output_image << " -> dropping annotation (too small):"
+			<< " class #" << class_idx
+			<< " w=" << annotation_width
+			<< " h=" << annotation_height
+			<< " area=" << area
+			<< " limit=" << gen.info.annotation_area_size
+			<< std::endl;
+
+		return true;
+	}
+
+
+	/** Resize the image to match the network dimensions.  The annotations are normalized, so the lines in the .txt file
+	 * are copied as-is, other than those which are too small.
+	 */
+	void resize_image(ImageGeneration & gen, const SPendingImage & pending, const std::string & output_base_name, dm::ImageCache::Entry & entry, dm::SplitMix64 & rng, GenerationLogs & logs, const size_t thread_idx)
+	{
+		const std::string & original_image = pending->original_image;
+		const cv::Mat & mat = pending->mat;
+
+		const cv::Size & size = pending->size;
+		const bool needs_resizing = (size != gen.desired_size);
+		const bool link = can_link_image(gen, original_image, size);
+
+		// images which are linked keep their original extension, since the file content is not modified
+		const std::string output_image = link ? output_base_name + File(original_image).getFileExtension().toLowerCase().toStdString() : rnd_image_filename(rng, output_base_name);
+		const std::string output_label = output_base_name + ".txt";
+
+		// first we create the resized image file
+		std::string method;
+		if (link)
+		{
+			method = link_image(original_image, output_image);
+		}
+		else
+		{
+			cv::Mat dst;
+			if (needs_resizing)
+			{
+				cv::resize(mat, dst, gen.desired_size, 0, 0, rnd_resize_method(rng));
+				method = "resize";
+			}
+			else
+			{
+				dst = mat;
+				method = "re-encode";
+			}
+
+			queue_image(gen, pending, output_image, dst, rng);
+		}
+
+		// next we copy the annoations in the .txt file, skipping those which are too small
+		size_t number_of_annotations = 0;
+		dm::ImageCache::DroppedAnnotations dropped;
+		std::ofstream fs_txt(output_label);
+		std::istringstream lines(pending->txt);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			std::istringstream iss(line);
+			iss.imbue(std::locale("C"));
+			int class_idx		= -1;
+			double normalized_x	= -1.0;
+			double normalized_y	= -1.0;
+			double normalized_w	= -1.0;
+			double normalized_h	= -1.0;
+			iss >> class_idx >> normalized_x >> normalized_y >> normalized_w >> normalized_h;
+			if (iss.fail() or class_idx < 0)
+			{
+				// not an annotation, so copy the line as-is
+				fs_txt << line << std::endl;
+				continue;
+			}
+
+			if (drop_small_annotation(gen, output_image, gen.desired_size, class_idx, normalized_w, normalized_h, dropped, logs.resized, thread_idx))
+			{
+				continue;
+			}
+
+			fs_txt << line << std::endl;
+			number_of_annotations ++;
+		}
+		fs_txt.close();
+		if (fs_txt.fail())
+		{
+			throw std::runtime_error("Failed to write " + output_label + ".");
+		}
+
+		entry.resized = needs_resizing;
+		entry.outputs.push_back({output_image, number_of_annotations, dropped});
+
+		logs.resized
+			<< "#" << thread_idx << ": "
+			<< original_image
+			<< " [" << size.width << "x" << size.height << "] -> "
+			<< output_image
+			<< " [" << gen.desired_size.width << "x" << gen.desired_size.height << "]"
+			<< " [" << method << "]"
+			<< std::endl;
+
+		return;
+	}
+
+
+	/// Cut the image into tiles which match the network dimensions, and re-create the annotations for each tile.
+	void tile_image(ImageGeneration & gen, const SPendingImage & pending, const std::string & output_base_name, dm::ImageCache::Entry & entry, dm::SplitMix64 & rng, GenerationLogs & logs, const size_t thread_idx)
+	{
+		const std::string & original_image = pending->original_image;
+		const cv::Mat & mat = pending->mat;
+		json & root = pending->root;
+
+		// note the image may not have been decoded if it fits in a single tile, so use the size and not the mat
+		const cv::Size & size				= pending->size;
+		const cv::Size counts				= tile_counts(gen, size);
+		const size_t horizontal_tiles_count	= counts.width;
+		const size_t vertical_tiles_count	= counts.height;
+		const double cell_width				= static_cast<double>(size.width) / static_cast<double>(horizontal_tiles_count);
+		const double cell_height			= static_cast<double>(size.height) / static_cast<double>(vertical_tiles_count);
+
+		std::stringstream messages;
+		messages
+			<< "#" << thread_idx << ": "
+			<< original_image << " [" << size.width << "x" << size.height << "]"
+			<< " -> [" << horizontal_tiles_count << "x" << vertical_tiles_count << "]"
+			<< " -> [" << cell_width << "x" << cell_height << "]"
+			<< std::endl;
+
+		if (gen.info.resize_images and horizontal_tiles_count == 1 and vertical_tiles_count == 1)
+		{
+			// this image only has 1 tile, and we already have it since "resize" is enabled, so skip to the next image
+			logs.tiles
+				<< messages.str()
+				<< "#" << thread_idx << ": "
+				<< "skipped (single tile)" << std::endl;
+			return;
+		}
+
+//		dm::Log(original_image + " (" + std::to_string(mat.cols) + "x" + std::to_string(mat.rows) + ") needs to be tiled as " + std::to_string(horizontal_tiles_count) + "x" + std::to_string(vertical_tiles_count) + " tiles each measuring " + std::to_string(gen.desired_size.width) + "x" + std::to_string(gen.desired_size.height));
+
+		for (size_t y_idx = 0; y_idx < vertical_tiles_count; y_idx ++)
+		{
+			for (size_t x_idx = 0; x_idx < horizontal_tiles_count; x_idx ++)
+			{
+				const cv::Rect tile_rect = tile_rectangle(gen, mat.size(), counts, x_idx, y_idx);
+				cv::Mat tile = mat(tile_rect);
+
+				const std::string tile_base_name = output_base_name + "_" + std::to_string(entry.outputs.size());
+				const std::string output_image = rnd_image_filename(rng, tile_base_name);
+				const std::string output_label = tile_base_name + ".txt";
+
+				queue_image(gen, pending, output_image, tile, rng);
 
-						std::lock_guard lock(tile_images_mutex);
-						all_output_images.push_back(output_image);
+				// now re-create the .txt file with the appropriate annotations for this new tile
+				//
+				// we know our tile is from (tile_x, tile_y, tile_w, tile_h), so include any annotations within those bounds
+				std::ofstream fs_txt(output_label);
+				fs_txt.imbue(std::locale("C"));
+				fs_txt << std::fixed << std::setprecision(10);
 
-						if (number_of_annotations == 0)
+				size_t number_of_annotations = 0;
+				dm::ImageCache::DroppedAnnotations dropped;
+				for (auto j : root["mark"])
+				{
+					int x = j["rect"]["int_x"];
+					int y = j["rect"]["int_y"];
+					int w = j["rect"]["int_w"];
+					int h = j["rect"]["int_h"];
+					if (clip_annotation(tile_rect, 10, x, y, w, h))
+					{
+						const int class_idx = j["class_idx"];
+
+						// bring all the coordinates back down to zero
+						x -= tile_rect.x;
+						y -= tile_rect.y;
+
+						const double normalized_w = static_cast<double>(w) / static_cast<double>(tile.cols);
+						const double normalized_h = static_cast<double>(h) / static_cast<double>(tile.rows);
+						const double normalized_x = static_cast<double>(x) / static_cast<double>(tile.cols) + normalized_w / 2.0;
+						const double normalized_y = static_cast<double>(y) / static_cast<double>(tile.rows) + normalized_h / 2.0;
+						if (drop_small_annotation(gen, output_image, tile.size(), class_idx, normalized_w, normalized_h, dropped, logs.tiles, thread_idx))
 						{
-							number_of_empty_images ++;
+							continue;
 						}
-						number_of_marks += number_of_annotations;
-						number_of_tiles_created ++;
-
-						tiles_txt
-							<< messages.str()
-							<< "#" << thread_idx << ": "
-							<< output_image
-							<< " [" << tile.cols << "x" << tile.rows << "]"
-							<< " [" << number_of_annotations << "/" << root["mark"].size() << "]"
-							<< std::endl;
+						fs_txt << class_idx << " " << normalized_x <<  " " << normalized_y << " " << normalized_w << " " << normalized_h << std::endl;
+						number_of_annotations ++;
+					}
+				}
+
+				entry.outputs.push_back({output_image, number_of_annotations, dropped});
+
+				logs.tiles
+					<< messages.str()
+					<< "#" << thread_idx << ": "
+					<< output_image
+					<< " [" << tile.cols << "x" << tile.rows << "]"
+					<< " [" << number_of_annotations << "/" << root["mark"].size() << "]"
+					<< std::endl;
+			}
+		}
+
+		return;
+	}
+
+
+	/// Randomly crop parts of the image and resize them to match the network dimensions.
+	void zoom_image(ImageGeneration & gen, const SPendingImage & pending, const std::string & output_base_name, dm::ImageCache::Entry & entry, dm::SplitMix64 & rng, GenerationLogs & logs, const size_t thread_idx)
+	{
+		const std::string & original_image = pending->original_image;
+		const cv::Mat & mat = pending->mat;
+		json & root = pending->root;
+
+		// the image is not decoded when it is too small, so use the size and not the mat
+		const cv::Size & image_size = pending->size;
+		if (image_size.width < gen.large_size.width or image_size.height < gen.large_size.height)
+		{
+			logs.zoom
+				<< "#" << thread_idx << ": "
+				<< original_image
+				<< " [" << image_size.width << "x" << image_size.height << "]"
+				<< " -> skipped (image too small)" << std::endl;
+			return;
+		}
+
+		std::vector<cv::Point> points_of_interest = zoom_points_of_interest(root, mat.size());
+		std::vector<cv::Rect> all_previous_rectangles;
+		std::stringstream messages;
+		const std::string prefix = "#" + std::to_string(thread_idx) + ": " + original_image;
+
+		cv::Rect roi;
+		float factor = 0.0f;
+		while (next_zoom_roi(gen, mat.size(), points_of_interest, all_previous_rectangles, rng, roi, factor, messages, prefix))
+		{
+			// Crop the original image, and at the same time resize it to be the exact dimensions we need.
+			cv::Mat output_mat;
+			cv::resize(mat(roi), output_mat, gen.desired_size, 0.0, 0.0, rnd_resize_method(rng));
+
+			const std::string zoom_base_name = output_base_name + "_" + std::to_string(entry.outputs.size());
+			const std::string output_image = rnd_image_filename(rng, zoom_base_name);
+			const std::string output_label = zoom_base_name + ".txt";
+
+			queue_image(gen, pending, output_image, output_mat, rng);
+
+			// crop the annotations to match the image, and re-calculate the values for the .txt file.
+
+			std::ofstream fs_txt(output_label);
+			fs_txt.imbue(std::locale("C"));
+			fs_txt << std::fixed << std::setprecision(10);
+			size_t number_of_annotations = 0;
+			dm::ImageCache::DroppedAnnotations dropped;
+			for (auto j : root["mark"])
+			{
+				int x = j["rect"]["int_x"];
+				int y = j["rect"]["int_y"];
+				int w = j["rect"]["int_w"];
+				int h = j["rect"]["int_h"];
+				if (not clip_annotation(roi, 5, x, y, w, h))
+				{
+					// this annotation does not appear in our new image, or only a tiny slice of it is visible
+					continue;
+				}
+
+				const int class_idx = j["class_idx"];
+
+				// bring all the coordinates back down to zero
+				x -= roi.x;
+				y -= roi.y;
+
+				const double normalized_w = static_cast<double>(w) / static_cast<double>(roi.width	);
+				const double normalized_h = static_cast<double>(h) / static_cast<double>(roi.height	);
+				const double normalized_x = static_cast<double>(x) / static_cast<double>(roi.width	) + normalized_w / 2.0;
+				const double normalized_y = static_cast<double>(y) / static_cast<double>(roi.height	) + normalized_h / 2.0;
+
+				// the RoI is resized to the network dimensions, so that is the size used to decide if the annotation is too small
+				if (drop_small_annotation(gen, output_image, gen.desired_size, class_idx, normalized_w, normalized_h, dropped, logs.zoom, thread_idx))
+				{
+					continue;
+				}
+
+				fs_txt << class_idx << " " << normalized_x <<  " " << normalized_y << " " << normalized_w << " " << normalized_h << std::endl;
+				number_of_annotations ++;
+			}
+
+			entry.outputs.push_back({output_image, number_of_annotations, dropped});
+
+			logs.zoom
+				<< messages.str()
+				<< "#" << thread_idx << ": "
+				<< original_image
+				<< " [" << mat.cols << "x" << mat.rows << "]"
+				<< " -> " << output_image
+				<< " [f=" << factor
+				<< " x=" << roi.x
+				<< " y=" << roi.y
+				<< " w=" << roi.width
+				<< " h=" << roi.height
+				<< "]"
+				<< " -> [" << output_mat.cols << "x" << output_mat.rows << "]"
+				<< " [" << number_of_annotations << "/" << root["mark"].size() << "]"
+				<< std::endl;
+		}
+
+		if (points_of_interest.empty() == false)
+		{
+			logs.zoom << "#" << thread_idx << ": " << original_image << " -> still had " << points_of_interest.size() << " items remaining in the points-of-interest" << std::endl;
+		}
+
+		return;
+	}
+
+	/// What the export planner expects to be created from a single annotated image.
+	struct ImagePlan
+	{
+		size_t resized;			///< Outputs of the resize stage which need to be encoded.
+		size_t linked;			///< Images which already match the network dimensions and will be linked into the cache.
+		size_t tiles;
+		size_t zooms;
+		size_t cached;			///< Outputs which already exist in the image cache and will be re-used.
+		size_t jpg;				///< New outputs which will be encoded as JPG.
+		size_t png;				///< New outputs which will be encoded as PNG.
+		size_t annotated;		///< Outputs with at least one annotation.
+		size_t negative;		///< Outputs without any annotations (negative samples).
+		size_t dropped;			///< Annotations which will be dropped because they are too small.
+		double megapixels;		///< The size of the image if it has to be decoded, otherwise zero.
+		bool size_unknown;		///< The annotations don't remember the image dimensions.
+		bool skipped;			///< The image has not been annotated, so it won't be exported.
+	};
+
+
+	/// Count one of the outputs the planner expects to be created or re-used.
+	void plan_output(ImagePlan & plan, const size_t annotations, const dm::ImageCache::DroppedAnnotations & dropped)
+	{
+		if (annotations)
+		{
+			plan.annotated ++;
+		}
+		else
+		{
+			plan.negative ++;
+		}
+
+		for (const auto & [class_idx, count] : dropped)
+		{
+			plan.dropped += count;
+		}
+
+		return;
+	}
+
+
+	/** Count the new output the planner expects to be encoded.  The random numbers are drawn exactly as the pipeline
+	 * would draw them, so the following outputs of the same image get the same values.
+	 */
+	void plan_encoded_output(ImagePlan & plan, dm::SplitMix64 & rng)
+	{
+		if (is_jpg(rnd_image_filename(rng, "")))
+		{
+			rnd_jpg_quality(rng);
+			plan.jpg ++;
+		}
+		else
+		{
+			plan.png ++;
+		}
+
+		return;
+	}
+
+
+	/** Count the annotations which will remain in a tile or crop+zoom image, the same way @ref tile_image() and
+	 * @ref zoom_image() re-create the .txt files.
+	 */
+	size_t plan_annotations(const ImageGeneration & gen, const json & root, const cv::Rect & region, const int min_size, const cv::Size & output_size, dm::ImageCache::DroppedAnnotations & dropped)
+	{
+		std::stringstream ignored;
+		size_t number_of_annotations = 0;
+		for (const auto & j : root["mark"])
+		{
+			int x = j["rect"]["int_x"];
+			int y = j["rect"]["int_y"];
+			int w = j["rect"]["int_w"];
+			int h = j["rect"]["int_h"];
+			if (clip_annotation(region, min_size, x, y, w, h))
+			{
+				const int class_idx = j["class_idx"];
+				const double normalized_w = static_cast<double>(w) / static_cast<double>(region.width);
+				const double normalized_h = static_cast<double>(h) / static_cast<double>(region.height);
+				if (not drop_small_annotation(gen, "", output_size, class_idx, normalized_w, normalized_h, dropped, ignored, 0))
+				{
+					number_of_annotations ++;
+				}
+			}
+		}
+
+		return number_of_annotations;
+	}
+
+
+	/** Work out what the pipeline will do with this image without decoding it.  The image size comes from the annotations,
+	 * and the outputs which are already in the cache are taken from the manifest.  When the cache doesn't know the image,
+	 * the random numbers come from a stream derived from the filename instead of the image content, so the number of
+	 * crop+zoom images and the JPG/PNG split are statistically the same but not identical to the actual export.
+	 */
+	void plan_image(ImageGeneration & gen, const std::string & original_image, ImagePlan & plan)
+	{
+		json root = json::parse(File(original_image).withFileExtension(".json").loadFileAsString().toStdString());
+		if (root["mark"].empty() and root.value("completely_empty", false) == false)
+		{
+			// same as DMContent::count_marks_in_json() returning zero
+			plan.skipped = true;
+			return;
+		}
+
+		const std::string txt = File(original_image).withFileExtension(".txt").loadFileAsString().toStdString();
+
+		cv::Size size = annotated_image_size(root, original_image);
+		if (size.width <= 0 or size.height <= 0)
+		{
+			// we're not going to decode the image just to plan the export, so assume it already matches the network dimensions
+			plan.size_unknown = true;
+			size = gen.desired_size;
+		}
+
+		if (gen.info.do_not_resize_images)
+		{
+			// the original images are used as-is
+			plan_output(plan, txt.empty() ? 0 : 1, {});
+		}
+
+		std::string source_hash;
+		std::string annotation_hash;
+		const bool hash_known = gen.cache.known_source_hash(original_image, source_hash);
+		if (hash_known)
+		{
+			const std::string annotations = root["mark"].dump() + txt;
+			annotation_hash = MD5(annotations.c_str(), annotations.size()).toHexString().toStdString();
+		}
+
+		dm::VStr stages;
+		if (gen.info.resize_images)
+		{
+			stages.push_back("resize");
+		}
+		if (gen.info.tile_images)
+		{
+			stages.push_back("tiles");
+		}
+		if (gen.info.zoom_images)
+		{
+			stages.push_back("zoom");
+		}
+
+		bool needs_decoding = false;
+		for (const auto & stage : stages)
+		{
+			uint64_t seed = 0;
+			if (hash_known)
+			{
+				const std::string key = stage_key(gen, stage, original_image, source_hash, annotation_hash);
+				dm::ImageCache::Entry entry;
+				if (gen.cache.find(key, entry))
+				{
+					for (const auto & output : entry.outputs)
+					{
+						plan.cached ++;
+						plan_output(plan, output.annotations, output.dropped);
+					}
+					if (stage == "tiles")
+					{
+						plan.tiles += entry.outputs.size();
+					}
+					else if (stage == "zoom")
+					{
+						plan.zooms += entry.outputs.size();
+					}
+					continue;
+				}
+				seed = stream_seed(gen, key);
+			}
+			else
+			{
+				const std::string name = stage + "|" + original_image;
+				seed = dm::SplitMix64::split(gen.master_seed, std::hash<std::string>{}(name));
+			}
+
+			dm::SplitMix64 rng(seed);
+			if (plan.size_unknown or stage_needs_pixels(gen, original_image, stage, size))
+			{
+				needs_decoding = true;
+			}
+
+			if (stage == "resize")
+			{
+				// the annotations are normalized, so only those which are too small at the network size are dropped
+				dm::ImageCache::DroppedAnnotations dropped;
+				const cv::Rect region(cv::Point(0, 0), size);
+				const size_t annotations = plan_annotations(gen, root, region, 0, gen.desired_size, dropped);
+				plan_output(plan, annotations, dropped);
+
+				if (can_link_image(gen, original_image, size))
+				{
+					plan.linked ++;
+				}
+				else
+				{
+					plan.resized ++;
+					plan_encoded_output(plan, rng);
+				}
+			}
+			else if (stage == "tiles")
+			{
+				const cv::Size counts = tile_counts(gen, size);
+				if (gen.info.resize_images and counts.width == 1 and counts.height == 1)
+				{
+					continue;
+				}
+
+				for (size_t y_idx = 0; y_idx < static_cast<size_t>(counts.height); y_idx ++)
+				{
+					for (size_t x_idx = 0; x_idx < static_cast<size_t>(counts.width); x_idx ++)
+					{
+						const cv::Rect tile_rect = tile_rectangle(gen, size, counts, x_idx, y_idx);
+						plan_encoded_output(plan, rng);
+
+						dm::ImageCache::DroppedAnnotations dropped;
+						plan_output(plan, plan_annotations(gen, root, tile_rect, 10, tile_rect.size(), dropped), dropped);
+						plan.tiles ++;
 					}
 				}
 			}
+			else if (not (size.width < gen.large_size.width or size.height < gen.large_size.height))
+			{
+				std::vector<cv::Point> points_of_interest = zoom_points_of_interest(root, size);
+				std::vector<cv::Rect> all_previous_rectangles;
+				std::stringstream ignored;
+				cv::Rect roi;
+				float factor = 0.0f;
+				while (next_zoom_roi(gen, size, points_of_interest, all_previous_rectangles, rng, roi, factor, ignored, ""))
+				{
+					rnd_resize_method(rng);
+					plan_encoded_output(plan, rng);
+
+					dm::ImageCache::DroppedAnnotations dropped;
+					plan_output(plan, plan_annotations(gen, root, roi, 5, gen.desired_size, dropped), dropped);
+					plan.zooms ++;
+				}
+			}
 		}
-		catch (const std::exception & e)
+
+		if (needs_decoding)
+		{
+			plan.megapixels = static_cast<double>(size.area()) / 1000000.0;
+		}
+
+		return;
+	}
+
+
+	/// How fast this computer decodes, resizes, and encodes images, as measured on a few of the images in the project.
+	struct Throughput
+	{
+		size_t samples;
+		double decode_seconds_per_megapixel;
+		double resize_seconds;	///< Time needed to create one output at the network dimensions.
+		double jpg_seconds;		///< Time needed to encode one output as JPG.
+		double png_seconds;		///< Time needed to encode one output as PNG.
+		double jpg_bytes;		///< Average size of one output when encoded as JPG.
+		double png_bytes;		///< Average size of one output when encoded as PNG.
+	};
+
+
+	/** Decode, resize, and encode a few sample images on this thread.  This gives the time spent in each stage of the
+	 * pipeline for a single thread, and the typical file size of the outputs.
+	 */
+	Throughput measure_throughput(const ImageGeneration & gen, const dm::VStr & samples)
+	{
+		Throughput throughput = {};
+		double megapixels = 0.0;
+
+		for (const auto & filename : samples)
+		{
+			const auto t1 = std::chrono::high_resolution_clock::now();
+			cv::Mat mat = cv::imread(filename);
+			if (mat.empty())
+			{
+				continue;
+			}
+			const auto t2 = std::chrono::high_resolution_clock::now();
+			cv::Mat dst;
+			cv::resize(mat, dst, gen.desired_size, 0, 0, cv::InterpolationFlags::INTER_LINEAR);
+			const auto t3 = std::chrono::high_resolution_clock::now();
+			std::vector<uchar> jpg;
+			cv::imencode(".jpg", dst, jpg, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+			const auto t4 = std::chrono::high_resolution_clock::now();
+			std::vector<uchar> png;
+			cv::imencode(".png", dst, png, {cv::ImwriteFlags::IMWRITE_PNG_COMPRESSION, 0});
+			const auto t5 = std::chrono::high_resolution_clock::now();
+
+			const auto seconds = [](const auto & start, const auto & end)
+			{
+				return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+			};
+
+			throughput.samples ++;
+			megapixels								+= static_cast<double>(mat.total()) / 1000000.0;
+			throughput.decode_seconds_per_megapixel	+= seconds(t1, t2);
+			throughput.resize_seconds				+= seconds(t2, t3);
+			throughput.jpg_seconds					+= seconds(t3, t4);
+			throughput.png_seconds					+= seconds(t4, t5);
+			throughput.jpg_bytes					+= jpg.size();
+			throughput.png_bytes					+= png.size();
+		}
+
+		if (throughput.samples)
+		{
+			const double count = throughput.samples;
+			throughput.decode_seconds_per_megapixel	/= std::max(0.001, megapixels);
+			throughput.resize_seconds				/= count;
+			throughput.jpg_seconds					/= count;
+			throughput.png_seconds					/= count;
+			throughput.jpg_bytes					/= count;
+			throughput.png_bytes					/= count;
+		}
+
+		return throughput;
+	}
+
+
+	/// Format a number of bytes as MiB or GiB.
+	std::string format_bytes(const double bytes)
+	{
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1);
+		if (bytes >= 1024.0 * 1024.0 * 1024.0)
+		{
+			ss << bytes / 1024.0 / 1024.0 / 1024.0 << " GiB";
+		}
+		else
 		{
-			std::string msg = "error in tile thread #" + std::to_string(thread_idx) + " while processing \"" + last_image_filename + "\": " + e.what();
-			Log(msg);
-			if (error_detected.empty())
-			{
-				error_detected.swap(msg);
-			}
+			ss << bytes / 1024.0 / 1024.0 << " MiB";
 		}
-	};
-
-	// start multiple threads running the tile lambda, then we wait for all of them to be done
 
-	VThreads vthreads;
-	for (size_t idx = 0; idx < split_image_filenames.size(); idx ++)
-	{
-		Log("creating tile thread #" + std::to_string(idx) + " to handle " + std::to_string(split_image_filenames[idx].size()) + " images...");
-		vthreads.emplace_back(tile_worker_lambda, idx);
+		return ss.str();
 	}
 
-	while (work_done < work_to_do and error_detected.empty())
+
+	/// Format a number of seconds as hours, minutes, and seconds.
+	std::string format_duration(const double seconds)
 	{
-		progress_window.setProgress(work_done / static_cast<double>(work_to_do));
-		std::this_thread::sleep_for(std::chrono::milliseconds(750));
+		const size_t total = std::round(seconds);
+		const size_t hours = total / 3600;
+		const size_t minutes = (total / 60) % 60;
+
+		std::stringstream ss;
+		if (hours)
+		{
+			ss << hours << "h ";
+		}
+		if (hours or minutes)
+		{
+			ss << minutes << "m ";
+		}
+		ss << (total % 60) << "s";
+
+		return ss.str();
 	}
 
-	for (auto & t : vthreads)
+}
+
+
+void dm::DarknetGen::find_all_annotated_images(Progress & progress, VStr & annotated_images, VStr & skipped_images, size_t & number_of_marks, size_t & number_of_empty_images)
+{
+	double work_done = 0.0;
+	double work_to_do = content.image_filenames.size() + 1.0;
+	progress.set_progress(0.0);
+	progress.set_status(getText("Finding all images and annotations..."));
+
+	annotated_images.clear();
+	skipped_images.clear();
+
+	for (const auto & filename : content.image_filenames)
 	{
-		t.join();
+		work_done ++;
+		progress.set_progress(work_done / work_to_do);
+
+		File f = File(filename).withFileExtension(".json");
+
+		// note how count_marks_in_json() lies about negative samples and returns "1" for empty images
+		size_t count = content.count_marks_in_json(f);
+		if (count)
+		{
+			annotated_images.push_back(filename);
+
+			// cheat -- we'd like to know if this is actually a negative samples
+			if (File(f).withFileExtension(".txt").getSize() == 0)
+			{
+				number_of_empty_images ++;
+				count = 0;
+			}
+		}
+		else
+		{
+			skipped_images.push_back(filename);
+		}
+		number_of_marks += count;
 	}
 
-	if (not error_detected.empty())
+	work_done = 0.0;
+	work_to_do = skipped_images.size() + 1.0;
+	progress.set_progress(0.0);
+	progress.set_status(getText("Listing skipped images..."));
+
+	std::shuffle(skipped_images.begin(), skipped_images.end(), get_random_engine());
+	const std::string fn = File(info.project_dir).getChildFile("skipped_images.txt").getFullPathName().toStdString();
+	std::ofstream fs_skipped(fn);
+	for (const auto & image_filename : skipped_images)
 	{
-		throw std::runtime_error(error_detected);
+		work_done ++;
+		progress.set_progress(work_done / work_to_do);
+
+		fs_skipped << image_filename << std::endl;
 	}
 
+	set_cache_image_format(info.image_type);
+
 	return;
 }
 
 
-void dm::DarknetWnd::random_zoom_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_marks, size_t & number_of_zooms_created, size_t & number_of_empty_images)
+void dm::DarknetGen::generate_images(Progress & progress, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_resized_images, size_t & number_of_images_not_resized, size_t & number_of_marks, size_t & number_of_tiles_created, size_t & number_of_zooms_created, size_t & number_of_empty_images, size_t & number_of_annotations_dropped)
 {
-	std::atomic<size_t> work_done = 0;
-	const size_t work_to_do = annotated_images.size();
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(getText("Random image crop and zoom..."));
-
-	File dir = File(info.project_dir).getChildFile("darkmark_image_cache").getChildFile("zoom");
-	const std::string dir_name = dir.getFullPathName().toStdString();
-	dir.createDirectory();
-	if (dir.isDirectory() == false)
+	String text = getText("Random image crop and zoom...");
+	if (info.resize_images or info.tile_images)
 	{
-		throw std::runtime_error("Failed to create directory " + dir_name + ".");
+		const String sizing = String(info.image_width) + "x" + String(info.image_height);
+		text = getText(info.resize_images ? "Resizing images to" : "Tiling images to");
+		#if DARKNET_GEN_SIMPLIFIED
+			text = sizing + " " + text + "...";
+		#else
+			text += " " + sizing + "...";
+		#endif
 	}
 
-	std::ofstream zoom_txt(dir_name + "/zoom.txt");
-	zoom_txt << "WARNING: multiple threads write to this file at the same time." << std::endl;
+	progress.set_progress(0.0);
+	progress.set_status(text);
 
-	const cv::Size desired_size(info.image_width, info.image_height);
-
-	/* Images must be larger than the final desired size for us to "zoom in".
-	 * This variable describes the minimum size we need for us to work with the image.
-	 */
-	const cv::Size large_size(
-			std::round(1.25f * desired_size.width),
-			std::round(1.25f * desired_size.height));
+	const size_t hardware_threads = number_of_worker_threads();
+	ImageGeneration gen(info, all_output_images, hardware_threads, 4 * hardware_threads);
+	if (info.resize_images)
+	{
+		gen.resize_dir = create_cache_directory(gen, "resize", "resized.txt", gen.resized_txt);
+	}
+	if (info.tile_images)
+	{
+		gen.tiles_dir = create_cache_directory(gen, "tiles", "tiles.txt", gen.tiles_txt);
+	}
+	if (info.zoom_images)
+	{
+		gen.zoom_dir = create_cache_directory(gen, "zoom", "zoom.txt", gen.zoom_txt);
+	}
 
-	auto & rng = get_random_engine();
+	gen.parameters = generation_parameters(info);
+	gen.cache.set_master_seed(gen.master_seed);
+	Log("image generation master seed: " + std::to_string(gen.master_seed));
 
-	std::mutex random_zoom_mutex;
-	const auto & split_image_filenames = split(annotated_images);
-	std::string error_detected;
+	// The stages are connected by bounded queues so no stage can run too far ahead of the others and fill up the memory with images.
+	size_t number_of_decoders		= 0;
+	size_t number_of_transformers	= 0;
+	size_t number_of_encoders		= 0;
+	pipeline_threads(hardware_threads, number_of_decoders, number_of_transformers, number_of_encoders);
+	Log("image generation pipeline: " + std::to_string(number_of_decoders) + " decode, " + std::to_string(number_of_transformers) + " transform, and " + std::to_string(number_of_encoders) + " encode threads");
 
-	const auto random_zoom_worker_lambda = [&, this](const size_t thread_idx)
+	const auto pipeline_error = [&gen](const std::string & stage, const size_t thread_idx, const std::string & filename, const std::string & what)
 	{
-		std::string last_image_filename = "?";
+		const std::string msg = "error in " + stage + " thread #" + std::to_string(thread_idx) + " while processing \"" + filename + "\": " + what;
+		Log(msg);
+
+		std::lock_guard lock(gen.mutex);
+		if (gen.first_error.empty())
+		{
+			gen.first_error = msg;
+		}
+		gen.abort = true;
+		gen.images_done_cv.notify_all();
+	};
 
-		try
+	std::atomic<size_t> next_image = 0;
+	const auto decode_lambda = [&, this](const size_t thread_idx)
+	{
+		while (not gen.abort)
 		{
-			for (const auto & original_image : split_image_filenames[thread_idx])
+			const size_t idx = next_image ++;
+			if (idx >= annotated_images.size())
+			{
+				break;
+			}
+
+			const std::string & original_image = annotated_images[idx];
+			try
 			{
-				if (not error_detected.empty())
+				auto pending = std::make_shared<PendingImage>();
+				pending->original_image	= original_image;
+				pending->references		= 1;
+
+				// parse the annotations once, and use them for the cache keys and for all of the resized, tiled, and zoomed outputs
+				pending->root = json::parse(File(original_image).withFileExtension(".json").loadFileAsString().toStdString());
+				pending->txt = File(original_image).withFileExtension(".txt").loadFileAsString().toStdString();
+				const std::string annotations = pending->root["mark"].dump() + pending->txt;
+				const std::string annotation_hash = MD5(annotations.c_str(), annotations.size()).toHexString().toStdString();
+				const std::string source_hash = gen.cache.source_hash(original_image);
+
+				if (info.resize_images)
 				{
-					break;
+					pending->stages.push_back({"resize", gen.resize_dir, "", false, {}});
 				}
-
-				work_done ++;
-
-				last_image_filename = original_image;
-
-				cv::Mat original_mat = cv::imread(original_image);
-				if (original_mat.empty())
+				if (info.tile_images)
 				{
-					// something has gone *very* wrong if we cannot read the image
-					Log(original_image + " (" + std::to_string(original_mat.cols) + "x" + std::to_string(original_mat.rows) + ")");
-					throw std::runtime_error("failed to open or read the image " + original_image);
+					pending->stages.push_back({"tiles", gen.tiles_dir, "", false, {}});
 				}
-
-				if (original_mat.cols < large_size.width or original_mat.rows < large_size.height)
+				if (info.zoom_images)
 				{
-					std::lock_guard lock(random_zoom_mutex);
-					zoom_txt
-						<< "#" << thread_idx << ": "
-						<< original_image
-						<< " [" << original_mat.cols << "x" << original_mat.rows << "]"
-						<< " -> skipped (image too small)" << std::endl;
-					continue;
+					pending->stages.push_back({"zoom", gen.zoom_dir, "", false, {}});
 				}
 
-				const cv::Rect original_rect(0, 0, original_mat.cols, original_mat.rows);
-				json root = json::parse(File(original_image).withFileExtension(".json").loadFileAsString().toStdString());
-				std::vector<cv::Point> points_of_interest;
-				for (auto j : root["mark"])
-				{
-					const int x = j["rect"]["int_x"];
-					const int y = j["rect"]["int_y"];
-					const int w = j["rect"]["int_w"];
-					const int h = j["rect"]["int_h"];
+				// the annotations remember the image dimensions, which is often enough to know what needs to be done without decoding the image
+				pending->size = annotated_image_size(pending->root, original_image);
 
-					for (const cv::Point & p :
-						{
-							cv::Point(x + 0, y + 0),	// TL
-							cv::Point(x + w, y + 0),	// TR
-							cv::Point(x + w, y + h),	// BR
-							cv::Point(x + 0, y + h),	// BL
-							cv::Point(x + w/2, y + h/2)	// middle
-						})
+				bool needs_transform	= false;
+				bool needs_decoding		= false;
+				for (auto & stage : pending->stages)
+				{
+					stage.key = stage_key(gen, stage.name, original_image, source_hash, annotation_hash);
+					stage.cached = gen.cache.find(stage.key, stage.entry);
+					if (not stage.cached)
 					{
-						if (original_rect.contains(p))
+						stage.entry = {stage.name, false, stream_seed(gen, stage.key), {}};
+						needs_transform = true;
+						if (stage_needs_pixels(gen, original_image, stage.name, pending->size))
 						{
-							points_of_interest.push_back(p);
+							needs_decoding = true;
 						}
 					}
 				}
 
-				// keep creating cropped/zoomed images as long as we're finding new parts of the image that we didn't previously cover
-				std::vector<cv::Rect> all_previous_rectangles;
-				size_t failed_consecutive_attempts = 0;
-				std::stringstream messages;
+				if (not needs_transform)
+				{
+					// everything we need is already in the cache, so there is no need to decode this image
+					release_image(gen, pending);
+					continue;
+				}
 
-				while (failed_consecutive_attempts < 5)
+				if (needs_decoding)
 				{
-					/* The amount we're going to "zoom in" depends on exactly how big the image is compared to the final size.
-					 * This value is the "factor" by which we multiply the desired image size.  We need to make sure that both
-					 * the horizontal and vertical values can be satisfied.
-					 */
-					const float horizontal_factor	= static_cast<float>(original_mat.cols) / static_cast<float>(desired_size.width);
-					const float vertical_factor		= static_cast<float>(original_mat.rows) / static_cast<float>(desired_size.height);
-					const float min_factor			= std::min(horizontal_factor, vertical_factor);
-
-					std::uniform_real_distribution<float> uni_f(0.8f, min_factor);
-					const float factor = uni_f(rng);
-
-					// This describes the size of the RoI we're going to carve out of the original image mat.
-					const cv::Size size(
-							std::round(factor * desired_size.width),
-							std::round(factor * desired_size.height));
-
-					// Now that we know the size, we can create the rectangle which is used to carve out the RoI.
-					cv::Rect roi(cv::Point(0, 0), size);
-
-					// Now figure out how much room remains outside of the RoI, and randomly choose some spacing to assign.
-					const int delta_h = original_mat.cols - roi.width;
-					const int delta_v = original_mat.rows - roi.height;
-					std::uniform_int_distribution<int> uni_h(0, delta_h);
-					std::uniform_int_distribution<int> uni_v(0, delta_v);
-					roi.x = uni_h(rng);
-					roi.y = uni_v(rng);
-
-					// See if the middle point of this RoI was already covered by a previous rectangle.
-					bool continue_crop_and_zoom = true;
-					const cv::Point middle_point(roi.x + roi.width/2, roi.y + roi.height/2);
-					for (const auto & r : all_previous_rectangles)
+					// decode the image once, then create all of the missing outputs from the same copy
+					pending->mat = cv::imread(original_image);
+					if (pending->mat.empty())
 					{
-						if (r.contains(middle_point))
-						{
-							// we've already covered this point
-							continue_crop_and_zoom = false;
-							break;
-						}
+						// something has gone *very* wrong if we cannot read the image
+						throw std::runtime_error("failed to open or read the image " + original_image);
 					}
 
-					if (continue_crop_and_zoom == false)
-					{
-						// before we give up on this RoI, see if it covers one of the remaining points of interest
-						for (const auto & p : points_of_interest)
-						{
-							if (roi.contains(p))
-							{
-								messages << "#" << thread_idx << ": " << original_image << "-> adding RoI because it includes point-of-interest x=" << p.x << " y=" << p.y << std::endl;
-								continue_crop_and_zoom = true;
-								break;
-							}
-						}
-					}
+					// the decoded image is the final word on the size, in case the annotations are out-of-date
+					pending->size = pending->mat.size();
+				}
+
+				gen.decoded_queue.push(pending);
+			}
+			catch (const std::exception & e)
+			{
+				pipeline_error("decode", thread_idx, original_image, e.what());
+			}
+		}
+
+		return;
+	};
+
+	std::vector<GenerationLogs> logs(number_of_transformers);
+	const auto transform_lambda = [&](const size_t thread_idx)
+	{
+		SPendingImage pending;
+		while (gen.decoded_queue.pop(pending))
+		{
+			if (gen.abort)
+			{
+				// empty the queue so the decode threads are not blocked
+				continue;
+			}
 
-					if (continue_crop_and_zoom == false)
+			try
+			{
+				for (auto & stage : pending->stages)
+				{
+					if (stage.cached)
 					{
-						messages
-							<< "#" << thread_idx << ": "
-							<< original_image
-							<< " -> skipped RoI [x=" << roi.x << " y=" << roi.y << " w=" << roi.width << " h=" << roi.height << "] due to overlap" << std::endl;
-						failed_consecutive_attempts ++;
 						continue;
 					}
 
-					// ...otherise, if we get here then we seem to be covering a new part of the image
-					failed_consecutive_attempts = 0;
-					all_previous_rectangles.push_back(roi);
-					messages
-						<< "#" << thread_idx << ": "
-						<< original_image
-						<< " -> creating RoI from [x=" << roi.x << " y=" << roi.y << " w=" << roi.width << " h=" << roi.height << "]" << std::endl;
-
-					// remove from "points-of-interest" any points located within the RoI we've just created
-					auto iter = points_of_interest.begin();
-					while (iter != points_of_interest.end())
+					const std::string output_base_name = stage.dir + "/" + stage.key;
+					dm::SplitMix64 rng(stage.entry.seed);
+					if (stage.name == "resize")
 					{
-						const auto & p = *iter;
-						if (roi.contains(p))
-						{
-							iter = points_of_interest.erase(iter);
-						}
-						else
-						{
-							iter ++;
-						}
+						resize_image(gen, pending, output_base_name, stage.entry, rng, logs[thread_idx], thread_idx);
 					}
-
-					// Crop the original image, and at the same time resize it to be the exact dimensions we need.
-					cv::Mat output_mat;
-					cv::resize(original_mat(roi), output_mat, desired_size, 0.0, 0.0, rnd_resize_method(rng));
-
-					std::stringstream ss;
-					ss << dir_name << "/" << std::setfill('0') << std::setw(8) << get_next_output_image_index();
-					const std::string output_base_name = ss.str();
-					const std::string output_image = rnd_image_filename(rng, output_base_name);
-					const std::string output_label = output_base_name + ".txt";
-
-					save_image(output_image, output_mat, rng);
-
-					// crop the annotations to match the image, and re-calculate the values for the .txt file.
-
-					std::ofstream fs_txt(output_label);
-					fs_txt.imbue(std::locale("C"));
-					fs_txt << std::fixed << std::setprecision(10);
-					size_t number_of_annotations = 0;
-					for (auto j : root["mark"])
+					else if (stage.name == "tiles")
 					{
-						int x = j["rect"]["int_x"];
-						int y = j["rect"]["int_y"];
-						int w = j["rect"]["int_w"];
-						int h = j["rect"]["int_h"];
-						const cv::Rect annotation_rect(x, y, w, h);
-						const cv::Rect intersection = annotation_rect & roi;
-						if (intersection.area() == 0)
-						{
-							// this annotation does not appear in our new image
-							continue;
-						}
-
-						const int class_idx = j["class_idx"];
-
-						if (x < roi.x)
-						{
-							// X is beyond the left border, we need to move it to the right
-							int delta = roi.x - x;
-							x += delta;
-							w -= delta;
-						}
-						if (y < roi.y)
-						{
-							// Y is beyond the top border, we need to move it down
-							int delta = roi.y - y;
-							y += delta;
-							h -= delta;
-						}
-						if (x + w > roi.x + roi.width)
-						{
-							// width is beyond the right border
-							w = roi.x + roi.width - x;
-						}
-						if (y + h > roi.y + roi.height)
-						{
-							// height is beyond the bottom border
-							h = roi.y + roi.height - y;
-						}
-
-						if (w < 5 or h < 5)
-						{
-							// ignore extremely tiny slices of annotations
-							continue;
-						}
-
-						// bring all the coordinates back down to zero
-						x -= roi.x;
-						y -= roi.y;
-
-						const double normalized_w = static_cast<double>(w) / static_cast<double>(roi.width	);
-						const double normalized_h = static_cast<double>(h) / static_cast<double>(roi.height	);
-						const double normalized_x = static_cast<double>(x) / static_cast<double>(roi.width	) + normalized_w / 2.0;
-						const double normalized_y = static_cast<double>(y) / static_cast<double>(roi.height	) + normalized_h / 2.0;
-
-						fs_txt << class_idx << " " << normalized_x <<  " " << normalized_y << " " << normalized_w << " " << normalized_h << std::endl;
-						number_of_annotations ++;
+						tile_image(gen, pending, output_base_name, stage.entry, rng, logs[thread_idx], thread_idx);
 					}
-
-					// beyond this point we update the things that must be protected by the mutex lock
-
-					std::lock_guard lock(random_zoom_mutex);
-					all_output_images.push_back(output_image);
-
-					zoom_txt
-						<< messages.str()
-						<< "#" << thread_idx << ": "
-						<< original_image
-						<< " [" << original_mat.cols << "x" << original_mat.rows << "]"
-						<< " -> " << output_image
-						<< " [f=" << factor
-						<< " x=" << roi.x
-						<< " y=" << roi.y
-						<< " w=" << roi.width
-						<< " h=" << roi.height
-						<< "]"
-						<< " -> [" << output_mat.cols << "x" << output_mat.rows << "]"
-						<< " [" << number_of_annotations << "/" << root["mark"].size() << "]"
-						<< std::endl;
-
-					if (number_of_annotations == 0)
+					else
 					{
-						number_of_empty_images ++;
+						zoom_image(gen, pending, output_base_name, stage.entry, rng, logs[thread_idx], thread_idx);
 					}
-					number_of_marks += number_of_annotations;
-					number_of_zooms_created ++;
 				}
 
-				if (points_of_interest.empty() == false)
-				{
-					std::lock_guard lock(random_zoom_mutex);
-					zoom_txt << "#" << thread_idx << ": " << original_image << " -> still had " << points_of_interest.size() << " items remaining in the points-of-interest" << std::endl;
-				}
+				// the outputs hold on to the parts of the image they need, so the original can be released
+				pending->mat.release();
+				release_image(gen, pending);
+			}
+			catch (const std::exception & e)
+			{
+				pipeline_error("transform", thread_idx, pending->original_image, e.what());
 			}
 		}
-		catch (const std::exception & e)
+
+		return;
+	};
+
+	const auto encode_lambda = [&](const size_t thread_idx)
+	{
+		EncodeItem item;
+		while (gen.encode_queue.pop(item))
 		{
-			std::string msg = "error in crop & zoom thread #" + std::to_string(thread_idx) + " while processing \"" + last_image_filename + "\": " + e.what();
-			Log(msg);
-			if (error_detected.empty())
+			if (gen.abort)
+			{
+				continue;
+			}
+
+			try
 			{
-				error_detected.swap(msg);
+				save_image(item.filename, item.mat, item.jpg_quality);
+				item.mat.release();
+				release_image(gen, item.pending);
+			}
+			catch (const std::exception & e)
+			{
+				pipeline_error("encode", thread_idx, item.filename, e.what());
 			}
 		}
-	};
 
-	// start multiple threads running the crop and zoom worker lambda, then we wait for all of them to be done
+		return;
+	};
 
-	VThreads vthreads;
-	for (size_t idx = 0; idx < split_image_filenames.size(); idx ++)
+	VThreads decoders;
+	VThreads transformers;
+	VThreads encoders;
+	for (size_t idx = 0; idx < number_of_decoders; idx ++)
+	{
+		decoders.emplace_back(decode_lambda, idx);
+	}
+	for (size_t idx = 0; idx < number_of_transformers; idx ++)
+	{
+		transformers.emplace_back(transform_lambda, idx);
+	}
+	for (size_t idx = 0; idx < number_of_encoders; idx ++)
 	{
-		Log("creating random zoom thread #" + std::to_string(idx) + " to handle " + std::to_string(split_image_filenames[idx].size()) + " images...");
-		vthreads.emplace_back(random_zoom_worker_lambda, idx);
+		encoders.emplace_back(encode_lambda, idx);
 	}
 
-	while (work_done < work_to_do and error_detected.empty())
+	if (true)
 	{
-		progress_window.setProgress(work_done / static_cast<double>(work_to_do));
-		std::this_thread::sleep_for(std::chrono::milliseconds(750));
+		std::unique_lock lock(gen.mutex);
+		while (gen.images_done < annotated_images.size() and not gen.abort)
+		{
+			gen.images_done_cv.wait_for(lock, std::chrono::milliseconds(100));
+
+			// do not hold the lock while updating the GUI
+			lock.unlock();
+			progress.set_progress(static_cast<double>(gen.images_done) / static_cast<double>(annotated_images.size()));
+			lock.lock();
+
+			if (progress.should_stop() and gen.first_error.empty())
+			{
+				gen.first_error = "image generation was cancelled";
+				gen.abort = true;
+			}
+		}
 	}
 
-	for (auto & t : vthreads)
+	// shut down the pipeline one stage at a time, so each stage can finish with the work already queued
+	for (auto & t : decoders)
 	{
 		t.join();
 	}
-
-	if (not error_detected.empty())
+	gen.decoded_queue.close();
+	for (auto & t : transformers)
 	{
-		throw std::runtime_error(error_detected);
+		t.join();
+	}
+	gen.encode_queue.close();
+	for (auto & t : encoders)
+	{
+		t.join();
 	}
 
-	return;
-}
-
-
-void dm::DarknetWnd::drop_small_annotations(ThreadWithProgressWindow & progress_window, const VStr & all_output_images, size_t & number_of_annotations_dropped)
-{
-	std::atomic<size_t> work_done = 0;
-	const size_t work_to_do = all_output_images.size();
+	for (const auto & log : logs)
+	{
+		gen.resized_txt	<< log.resized.str();
+		gen.tiles_txt	<< log.tiles.str();
+		gen.zoom_txt	<< log.zoom.str();
+	}
 
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage("Looking for annotations too small to detect...");
+	if (not gen.first_error.empty())
+	{
+		throw std::runtime_error(gen.first_error);
+	}
 
-	const double image_width	= info.image_width;
-	const double image_height	= info.image_height;
+	gen.cache.save();
 
-	std::atomic<size_t> total_annotations_dropped = 0;
-	const auto & split_image_filenames = split(all_output_images);
-	std::string error_detected;
+	number_of_resized_images		+= gen.number_of_resized_images;
+	number_of_images_not_resized	+= gen.number_of_images_not_resized;
+	number_of_tiles_created			+= gen.number_of_tiles_created;
+	number_of_zooms_created			+= gen.number_of_zooms_created;
+	number_of_marks					+= gen.number_of_marks;
+	number_of_empty_images			+= gen.number_of_empty_images;
+	number_of_annotations_dropped	+= gen.number_of_annotations_dropped;
 
-	const auto drop_small_annotations_worker_lambda = [&, this](const size_t thread_idx)
+	for (const auto & [class_idx, count] : gen.annotations_dropped_per_class)
 	{
-		std::string last_image_filename = "?";
+		const std::string name = (class_idx >= 0 and static_cast<size_t>(class_idx) < content.names.size()) ? content.names.at(class_idx) : "unknown";
+		Log("dropped " + std::to_string(count) + " annotation" + (count == 1 ? "" : "s") + " (too small) for class #" + std::to_string(class_idx) + " \"" + name + "\"");
+	}
 
-		try
-		{
-			for (const auto & fn : split_image_filenames[thread_idx])
-			{
-				if (not error_detected.empty())
-				{
-					break;
-				}
+	return;
+}
 
-				work_done ++;
 
-				last_image_filename = fn;
 
-				const auto txt = std::filesystem::path(fn).replace_extension(".txt");
-				if (std::filesystem::file_size(txt) == 0)
-				{
-					continue;
-				}
+std::string dm::DarknetGen::plan_export(Progress & progress)
+{
+	progress.set_progress(0.0);
+	progress.set_status(getText("Planning the export..."));
 
-				std::stringstream ss;
-				ss.imbue(std::locale("C"));
-				ss << std::fixed << std::setprecision(10);
+	const auto start_time = std::chrono::high_resolution_clock::now();
 
-				std::ifstream ifs(txt.string());
-				ifs.imbue(std::locale("C"));
+	// nothing is written to disk, so the planner gets its own copy of the image cache which is never saved
+	set_cache_image_format(info.image_type);
+	VStr unused;
+	ImageGeneration gen(info, unused, 1, 1);
+	gen.parameters = generation_parameters(info);
 
-				size_t lines_dropped_in_this_file	= 0;
-				size_t lines_kept_in_this_file		= 0;
-				int class_id						= -1;
-				double cx							= -1.0;
-				double cy							= -1.0;
-				double w							= -1.0;
-				double h							= -1.0;
+	const VStr & images = content.image_filenames;
+	std::vector<ImagePlan> plans(images.size(), ImagePlan{});
 
-				while (ifs.good())
+	const size_t images_per_task = 64;
+	WorkPool::Tasks tasks;
+	for (size_t first = 0; first < images.size(); first += images_per_task)
+	{
+		tasks.push_back(
+			[&, first](const size_t worker_idx)
+			{
+				const size_t last = std::min(images.size(), first + images_per_task);
+				for (size_t idx = first; idx < last; idx ++)
 				{
-					ifs >> class_id >> cx >> cy >> w >> h;
-					if (class_id >= 0 and cx > 0.0 and cy > 0.0 and w > 0.0 and h > 0.0)
+					if (File(images[idx]).withFileExtension(".json").existsAsFile())
 					{
-						const int annotation_width	= std::round(image_width * w);
-						const int annotation_height	= std::round(image_height * h);
-						const int area = annotation_width * annotation_height;
-
-						if (area <= info.annotation_area_size)
-						{
-							// this annotation is too small, so don't bother remembering it (we'll re-write the .txt file without this line)
-							Log(txt.string() + ": dropping annotation (too small): class #" + std::to_string(class_id) + " w=" + std::to_string(annotation_width) + " h=" + std::to_string(annotation_height) + " area=" + std::to_string(area) + " limit=" + std::to_string(info.annotation_area_size));
-							total_annotations_dropped ++;
-							lines_dropped_in_this_file ++;
-							continue;
-						}
-
-						// otherwise, remember this annotation
-						lines_kept_in_this_file ++;
-						ss << class_id << " " << cx << " " << cy << " " << w << " " << h << std::endl;
+						plan_image(gen, images[idx], plans[idx]);
+					}
+					else
+					{
+						plans[idx].skipped = true;
 					}
 				}
-				ifs.close();
+			});
+	}
 
-				if (lines_dropped_in_this_file > 0)
-				{
-					// we must have decided to drop an annotation, so re-write the .txt file
-					std::ofstream ofs(txt.string());
-					ofs << ss.str();
-				}
-			}
-		}
-		catch (const std::exception & e)
+	auto job = work_pool().submit("export plan", tasks);
+	job->wait(
+		[&](const double fraction)
 		{
-			std::string msg = "error in \"too-small\" thread #" + std::to_string(thread_idx) + " while processing \"" + last_image_filename + "\": " + e.what();
-			Log(msg);
-			if (error_detected.empty())
+			progress.set_progress(fraction);
+			if (progress.should_stop())
 			{
-				error_detected.swap(msg);
+				job->cancel();
 			}
+		});
+
+	if (job->is_cancelled())
+	{
+		throw std::runtime_error("planning the export was cancelled");
+	}
+
+	ImagePlan total = {};
+	size_t number_of_annotated_images	= 0;
+	size_t number_of_skipped_images		= 0;
+	size_t number_of_uncached_images	= 0;
+	size_t number_of_unknown_sizes		= 0;
+	VStr images_to_decode;
+	for (size_t idx = 0; idx < plans.size(); idx ++)
+	{
+		const auto & plan = plans[idx];
+		if (plan.skipped)
+		{
+			number_of_skipped_images ++;
+			continue;
 		}
-	};
 
-	// start multiple threads running the "too-small" worker lambda, then we wait for all of them to be done
+		number_of_annotated_images ++;
+		total.resized		+= plan.resized;
+		total.linked		+= plan.linked;
+		total.tiles			+= plan.tiles;
+		total.zooms			+= plan.zooms;
+		total.cached		+= plan.cached;
+		total.jpg			+= plan.jpg;
+		total.png			+= plan.png;
+		total.annotated		+= plan.annotated;
+		total.negative		+= plan.negative;
+		total.dropped		+= plan.dropped;
+		total.megapixels	+= plan.megapixels;
+
+		if (plan.jpg + plan.png > 0)
+		{
+			number_of_uncached_images ++;
+		}
+		if (plan.size_unknown)
+		{
+			number_of_unknown_sizes ++;
+		}
+		if (plan.megapixels > 0.0)
+		{
+			images_to_decode.push_back(images[idx]);
+		}
+	}
+
+	progress.set_progress(0.0);
+	progress.set_status(getText("Measuring image throughput..."));
 
-	VThreads vthreads;
-	for (size_t idx = 0; idx < split_image_filenames.size(); idx ++)
+	// a handful of images spread across the project is enough to know how fast this computer decodes and encodes images
+	const size_t max_samples = 5;
+	VStr samples;
+	for (size_t idx = 0; idx < std::min(max_samples, images_to_decode.size()); idx ++)
 	{
-		Log("creating \"too-small\" thread #" + std::to_string(idx) + " to handle " + std::to_string(split_image_filenames[idx].size()) + " images...");
-		vthreads.emplace_back(drop_small_annotations_worker_lambda, idx);
+		samples.push_back(images_to_decode[idx * images_to_decode.size() / std::min(max_samples, images_to_decode.size())]);
 	}
+	const Throughput throughput = measure_throughput(gen, samples);
+	progress.set_progress(1.0);
 
-	while (work_done < work_to_do and error_detected.empty())
+	// the same rule as create_Darknet_training_and_validation_files()
+	const size_t total_outputs = total.annotated + total.negative;
+	size_t negative_after_limit = total.negative;
+	if (info.limit_negative_samples and total.negative > 1.2 * total.annotated)
 	{
-		progress_window.setProgress(work_done / static_cast<double>(work_to_do));
-		std::this_thread::sleep_for(std::chrono::milliseconds(750));
+		negative_after_limit = total.annotated;
 	}
+	const size_t final_outputs = total.annotated + negative_after_limit;
 
-	for (auto & t : vthreads)
+	size_t number_of_files_train = std::round(info.training_images_percentage * final_outputs);
+	size_t number_of_files_valid = final_outputs - number_of_files_train;
+	if (info.train_with_all_images)
 	{
-		t.join();
+		number_of_files_train = final_outputs;
+		number_of_files_valid = final_outputs;
+	}
+	const size_t maximum_number_of_validation_images = 10 * content.names.size();
+	if (info.limit_validation_images and number_of_files_valid > maximum_number_of_validation_images)
+	{
+		number_of_files_valid = maximum_number_of_validation_images;
+		if (not info.train_with_all_images)
+		{
+			number_of_files_train = final_outputs - number_of_files_valid;
+		}
 	}
 
-	number_of_annotations_dropped += total_annotations_dropped;
+	const double jpg_bytes = total.jpg * throughput.jpg_bytes;
+	const double png_bytes = total.png * throughput.png_bytes;
+
+	// each stage of the pipeline runs on its own threads, so the slowest stage determines how long the export takes
+	size_t number_of_decoders		= 0;
+	size_t number_of_transformers	= 0;
+	size_t number_of_encoders		= 0;
+	pipeline_threads(number_of_worker_threads(), number_of_decoders, number_of_transformers, number_of_encoders);
+	const double decode_seconds		= total.megapixels * throughput.decode_seconds_per_megapixel / number_of_decoders;
+	const double transform_seconds	= (total.jpg + total.png) * throughput.resize_seconds / number_of_transformers;
+	const double encode_seconds		= (total.jpg * throughput.jpg_seconds + total.png * throughput.png_seconds) / number_of_encoders;
+
+	// the export also reads all of the annotations and looks up the cache the same way the planner did
+	const auto end_time = std::chrono::high_resolution_clock::now();
+	const double planning_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time).count();
+	const double estimated_seconds = planning_seconds + std::max({decode_seconds, transform_seconds, encode_seconds});
+
+	const auto percentage = [](const size_t count, const size_t total_count)
+	{
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1) << (total_count ? 100.0 * count / total_count : 0.0) << "%";
+		return ss.str();
+	};
+
+	std::stringstream ss;
+	ss	<< "Export plan for " << number_of_annotated_images << " annotated images at " << info.image_width << "x" << info.image_height
+		<< " (" << number_of_skipped_images << " images skipped):" << std::endl
+		<< std::endl;
+
+	if (info.do_not_resize_images)
+	{
+		ss << "Original images used as-is: " << number_of_annotated_images << std::endl;
+	}
+	if (info.resize_images)
+	{
+		ss << "Resized images: " << (total.resized + total.linked) << " (" << total.linked << " linked without re-encoding)" << std::endl;
+	}
+	if (info.tile_images)
+	{
+		ss << "Tiles: " << total.tiles << std::endl;
+	}
+	if (info.zoom_images)
+	{
+		ss << "Crop+zoom images: " << total.zooms << std::endl;
+	}
+	ss	<< "Outputs already in the image cache: " << total.cached << std::endl
+		<< "Annotations dropped (too small): " << total.dropped << std::endl
+		<< "Negative samples: " << total.negative << " of " << total_outputs << " (" << percentage(total.negative, total_outputs) << ")" << std::endl;
+	if (negative_after_limit != total.negative)
+	{
+		ss << "Negative samples after limit: " << negative_after_limit << " of " << final_outputs << " (" << percentage(negative_after_limit, final_outputs) << ")" << std::endl;
+	}
+	ss	<< "Training images: " << number_of_files_train << std::endl
+		<< "Validation images: " << number_of_files_valid << std::endl
+		<< std::endl
+		<< "New images to encode: " << total.jpg << " JPG (~" << format_bytes(jpg_bytes) << "), " << total.png << " PNG (~" << format_bytes(png_bytes) << ")" << std::endl
+		<< "Estimated disk space: " << format_bytes(jpg_bytes + png_bytes) << " (" << format_bytes(File(info.project_dir).getBytesFreeOnVolume()) << " free)" << std::endl;
+	if (info.pack_shards and total.jpg + total.png > 0)
+	{
+		const double average_bytes = (jpg_bytes + png_bytes) / (total.jpg + total.png);
+		ss << "Estimated size of the shards: " << format_bytes(average_bytes * final_outputs) << std::endl;
+	}
+	ss	<< "Estimated time: " << format_duration(estimated_seconds) << " using " << number_of_worker_threads() << " threads" << std::endl;
 
-	if (not error_detected.empty())
+	if (total.jpg + total.png > 0 and throughput.samples == 0)
+	{
+		ss << std::endl << "None of the sample images could be decoded, so the disk space and time are unknown." << std::endl;
+	}
+	if (number_of_uncached_images)
 	{
-		throw std::runtime_error(error_detected);
+		ss << std::endl << number_of_uncached_images << " images are not yet in the image cache, so the number of crop+zoom images and the JPG/PNG split are estimates." << std::endl;
+	}
+	if (number_of_unknown_sizes)
+	{
+		ss << std::endl << number_of_unknown_sizes << " images do not have their dimensions in the .json file, so they are assumed to match the network dimensions." << std::endl;
 	}
 
-	return;
+	Log(ss.str());
+	Log("export plan throughput from " + std::to_string(throughput.samples) + " samples:"
+		" decode=" + std::to_string(throughput.decode_seconds_per_megapixel) + "s/MP"
+		" resize=" + std::to_string(throughput.resize_seconds) + "s"
+		" jpg=" + std::to_string(throughput.jpg_seconds) + "s/" + std::to_string(static_cast<size_t>(throughput.jpg_bytes)) + " bytes"
+		" png=" + std::to_string(throughput.png_seconds) + "s/" + std::to_string(static_cast<size_t>(throughput.png_bytes)) + " bytes");
+
+	return ss.str();
 }
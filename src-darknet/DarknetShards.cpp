@@ -0,0 +1,206 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+
+
+namespace
+{
+	/// Once a shard reaches this size, the next image starts a new shard.
+	const uint64_t maximum_shard_size = 1024 * 1024 * 1024;
+
+
+	std::string load_file(const std::string & filename)
+	{
+		std::ifstream ifs(filename, std::ios::binary);
+		if (not ifs.good())
+		{
+			throw std::runtime_error("failed to open " + filename);
+		}
+
+		std::string content;
+		ifs.seekg(0, std::ios::end);
+		content.resize(ifs.tellg());
+		ifs.seekg(0, std::ios::beg);
+		ifs.read(content.data(), content.size());
+		if (ifs.fail())
+		{
+			throw std::runtime_error("failed to read " + filename);
+		}
+
+		return content;
+	}
+
+
+	/** Pack the images into shards named after @p name, such as @p train_00000.dmshard.  The shards are written in
+	 * parallel, and @p name.txt lists all of the shards.
+	 * @returns the filenames of the new shards.
+	 */
+	dm::VStr pack_shards(dm::Progress & progress, const File & dir, const std::string & name, const dm::VStr & images)
+	{
+		progress.set_progress(0.0);
+		progress.set_status(dm::getText(name == "train" ? "Packing training images into shards..." : "Packing validation images into shards..."));
+
+		/* Split the images into consecutive ranges of roughly the same size.  This only depends on the images, not on the
+		 * number of threads, so the same images always create the same shards.  Each shard is then written by one task.
+		 */
+		std::vector<std::pair<size_t, size_t>> ranges;
+		uint64_t current_size = 0;
+		for (size_t idx = 0; idx < images.size(); idx ++)
+		{
+			if (ranges.empty() or current_size >= maximum_shard_size)
+			{
+				ranges.push_back({idx, idx});
+				current_size = 0;
+			}
+			ranges.back().second = idx + 1;
+			current_size += File(images[idx]).getSize();
+		}
+
+		dm::VStr shard_filenames;
+		for (size_t idx = 0; idx < ranges.size(); idx ++)
+		{
+			char buffer[20];
+			std::snprintf(buffer, sizeof(buffer), "_%05zu.dmshard", idx);
+			shard_filenames.push_back(dir.getChildFile(name + buffer).getFullPathName().toStdString());
+		}
+
+		std::atomic<uint64_t> total_bytes = 0;
+		dm::WorkPool::Tasks tasks;
+		for (size_t idx = 0; idx < ranges.size(); idx ++)
+		{
+			tasks.push_back(
+				[&, idx](const size_t worker_idx)
+				{
+					dm::ShardWriter shard(shard_filenames[idx]);
+					for (size_t image_idx = ranges[idx].first; image_idx < ranges[idx].second; image_idx ++)
+					{
+						const std::string & image_filename = images[image_idx];
+						const std::string label_filename = File(image_filename).withFileExtension(".txt").getFullPathName().toStdString();
+						shard.add(image_filename, load_file(label_filename), load_file(image_filename));
+					}
+					shard.close();
+					total_bytes += shard.bytes_written;
+				});
+		}
+
+		dm::Log("archiving " + std::to_string(images.size()) + " " + name + " images into " + std::to_string(tasks.size()) + " shards in " + dir.getFullPathName().toStdString() + " (Darknet still trains from the individual files)");
+		const auto start_time = std::chrono::high_resolution_clock::now();
+
+		auto job = dm::work_pool().submit(name + " shards", tasks);
+		job->wait(
+			[&](const double fraction)
+			{
+				progress.set_progress(fraction);
+				if (progress.should_stop())
+				{
+					job->cancel();
+				}
+			});
+
+		if (job->is_cancelled())
+		{
+			throw std::runtime_error("creating " + name + " shards was cancelled");
+		}
+
+		// list all of the shards the same way train.txt and valid.txt list all of the images
+		std::ofstream ofs(dir.getChildFile(name + ".txt").getFullPathName().toStdString());
+		for (const auto & fn : shard_filenames)
+		{
+			ofs << fn << std::endl;
+		}
+
+		const auto end_time = std::chrono::high_resolution_clock::now();
+		const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+		dm::Log("created " + std::to_string(shard_filenames.size()) + " " + name + " shards (" + std::to_string(total_bytes / 1024 / 1024) + " MiB) in " + std::to_string(milliseconds) + " milliseconds");
+
+		return shard_filenames;
+	}
+
+
+	/** Instead of packing the images a second time, find each one in the shards which were already written, and list the
+	 * shard and offset of each record in @p name.idx.  @p name.txt lists the shards which contain at least one of the
+	 * images, in the same order as they were created.
+	 */
+	void index_shards(const File & dir, const std::string & name, const dm::VStr & images, const dm::VStr & shard_filenames)
+	{
+		std::map<std::string, std::pair<size_t, uint64_t>> records;
+		for (size_t idx = 0; idx < shard_filenames.size(); idx ++)
+		{
+			for (const auto & entry : dm::ShardReader::load_index(shard_filenames[idx]))
+			{
+				records[entry.name] = {idx, entry.offset};
+			}
+		}
+
+		std::vector<bool> shard_is_used(shard_filenames.size(), false);
+		std::ofstream idx_file(dir.getChildFile(name + ".idx").getFullPathName().toStdString());
+		for (const auto & fn : images)
+		{
+			const auto & [shard_idx, offset] = records.at(fn);
+			idx_file << shard_filenames[shard_idx] << "\t" << offset << "\t" << fn << "\n";
+			shard_is_used[shard_idx] = true;
+		}
+
+		std::ofstream ofs(dir.getChildFile(name + ".txt").getFullPathName().toStdString());
+		for (size_t idx = 0; idx < shard_filenames.size(); idx ++)
+		{
+			if (shard_is_used[idx])
+			{
+				ofs << shard_filenames[idx] << std::endl;
+			}
+		}
+
+		if (idx_file.fail() or ofs.fail())
+		{
+			throw std::runtime_error("failed to write the " + name + " shard index in " + dir.getFullPathName().toStdString());
+		}
+
+		dm::Log("indexed " + std::to_string(images.size()) + " " + name + " images which are already in the training shards");
+
+		return;
+	}
+}
+
+
+void dm::DarknetGen::create_shards(Progress & progress, const VStr & train_images, const VStr & valid_images)
+{
+	File dir = File(info.project_dir).getChildFile("darkmark_shards");
+	dir.createDirectory();
+	if (dir.isDirectory() == false)
+	{
+		throw std::runtime_error("Failed to create directory " + dir.getFullPathName().toStdString() + ".");
+	}
+
+	// get rid of the shards from the previous export, since there may be fewer shards this time
+	for (const char * pattern : {"*.dmshard", "*.idx"})
+	{
+		for (auto dir_entry : RangedDirectoryIterator(dir, false, pattern, File::findFiles))
+		{
+			dir_entry.getFile().deleteFile();
+		}
+	}
+
+	const VStr train_shards = pack_shards(progress, dir, "train", train_images);
+
+	/* When training with all images -- the default -- every validation image is also a training image.  Packing them
+	 * again would write the entire dataset a second time, so the validation images are listed as an index into the
+	 * training shards instead.
+	 */
+	const std::set<std::string> training_images(train_images.begin(), train_images.end());
+	const bool all_valid_images_in_train = std::all_of(valid_images.begin(), valid_images.end(),
+		[&](const std::string & fn)
+		{
+			return training_images.count(fn) > 0;
+		});
+
+	if (all_valid_images_in_train)
+	{
+		index_shards(dir, "valid", valid_images, train_shards);
+	}
+	else
+	{
+		pack_shards(progress, dir, "valid", valid_images);
+	}
+
+	return;
+}
@@ -0,0 +1,169 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+#include "yolo_anchors.hpp"
+
+
+std::string dm::DarknetGen::sweep_anchors(Progress & progress, std::vector<cv::Size> network_sizes, std::vector<size_t> cluster_counts)
+{
+	progress.set_progress(0.0);
+	progress.set_status(getText("Sweeping anchors..."));
+
+	const size_t number_of_classes = content.names.size() - 1;
+
+	if (network_sizes.empty())
+	{
+		/* Sizes around the current network dimensions, keeping the same aspect ratio.  Every size multiplies the number
+		 * of k-means runs, so only the extremes and the current size are compared unless more are requested.
+		 */
+		for (const double factor : {0.5, 1.0, 1.5})
+		{
+			const int width		= std::max(32, static_cast<int>(std::round(factor * info.image_width	/ 32.0)) * 32);
+			const int height	= std::max(32, static_cast<int>(std::round(factor * info.image_height	/ 32.0)) * 32);
+			const cv::Size size(width, height);
+			if (std::find(network_sizes.begin(), network_sizes.end(), size) == network_sizes.end())
+			{
+				network_sizes.push_back(size);
+			}
+		}
+	}
+
+	if (cluster_counts.empty())
+	{
+		// the .cfg template decides how many anchors are needed, but it is still useful to know if more or fewer would help
+		const size_t current_clusters = (info.anchor_clusters > 1 ? info.anchor_clusters : 9);
+		if (current_clusters > 4)
+		{
+			cluster_counts.push_back(current_clusters - 3);
+		}
+		cluster_counts.push_back(current_clusters);
+		cluster_counts.push_back(current_clusters + 3);
+	}
+
+	/* Tiles and crop+zoom images change the size of the annotations, so when the Darknet files have already been created
+	 * the sweep uses the images from the training file.  Otherwise the annotations from the project images are used.
+	 */
+	VStr images;
+	std::string source = info.train_filename;
+	if (File(info.train_filename).existsAsFile())
+	{
+		std::ifstream ifs(info.train_filename);
+		std::string line;
+		while (std::getline(ifs, line))
+		{
+			if (not line.empty())
+			{
+				images.push_back(line);
+			}
+		}
+	}
+	if (images.empty())
+	{
+		images = content.image_filenames;
+		source = info.project_dir;
+	}
+
+	std::vector<std::pair<size_t, size_t>> sizes;
+	for (const auto & size : network_sizes)
+	{
+		sizes.push_back({static_cast<size_t>(size.width), static_cast<size_t>(size.height)});
+	}
+
+	Log("anchor sweep: " + std::to_string(images.size()) + " images from " + source + ", " + std::to_string(sizes.size()) + " network sizes, " + std::to_string(cluster_counts.size()) + " cluster counts");
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	std::vector<size_t> counter_per_class;
+	const auto results = ::sweep_anchors(images, sizes, cluster_counts, number_of_classes, static_cast<uint64_t>(info.random_seed), number_of_anchor_restarts, std::max(0, info.anchor_sample_size), info.annotation_area_size, progress, counter_per_class);
+
+	const auto end_time = std::chrono::high_resolution_clock::now();
+	const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+	size_t number_of_annotations = 0;
+	for (const auto count : counter_per_class)
+	{
+		number_of_annotations += count;
+	}
+
+	const auto format_size = [](const size_t width, const size_t height)
+	{
+		return std::to_string(width) + "x" + std::to_string(height);
+	};
+
+	const auto percentage = [](const size_t count, const size_t total_count)
+	{
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1) << (total_count ? 100.0 * count / total_count : 0.0) << "%";
+		return ss.str();
+	};
+
+	std::stringstream ss;
+	ss	<< "Anchor sweep of " << number_of_annotations << " annotations in " << images.size() << " images"
+		<< " (" << results.size() << " configurations in " << milliseconds << " milliseconds):" << std::endl
+		<< std::endl
+		<< "Small annotations have an area of " << info.annotation_area_size << " pixels or less once the image is resized to the network dimensions." << std::endl
+		<< "The current configuration is marked with \"*\"." << std::endl
+		<< std::endl
+		<< std::left
+		<< std::setw(12) << "network"
+		<< std::setw(10) << "clusters"
+		<< std::setw(10) << "avg IoU"
+		<< "small annotations" << std::endl;
+
+	for (const auto & result : results)
+	{
+		size_t small = 0;
+		for (const auto count : result.small_per_class)
+		{
+			small += count;
+		}
+
+		const bool is_current =
+			result.width				== static_cast<size_t>(info.image_width)	and
+			result.height				== static_cast<size_t>(info.image_height)	and
+			result.number_of_clusters	== static_cast<size_t>(info.anchor_clusters);
+
+		std::stringstream iou;
+		iou << std::fixed << std::setprecision(2) << result.avg_iou << "%";
+
+		ss	<< std::setw(12) << (format_size(result.width, result.height) + (is_current ? " *" : ""))
+			<< std::setw(10) << result.number_of_clusters
+			<< std::setw(10) << iou.str()
+			<< small << " (" << percentage(small, number_of_annotations) << ")" << std::endl;
+	}
+
+	// the small annotations only depend on the network size, so show each size once
+	ss	<< std::endl
+		<< "Small annotations per class:" << std::endl
+		<< std::setw(24) << "class"
+		<< std::setw(12) << "annotations";
+	for (const auto & size : sizes)
+	{
+		ss << std::setw(12) << format_size(size.first, size.second);
+	}
+	ss << std::endl;
+
+	for (size_t class_idx = 0; class_idx < number_of_classes; class_idx ++)
+	{
+		ss	<< std::setw(24) << (std::to_string(class_idx) + " " + content.names.at(class_idx)).substr(0, 23)
+			<< std::setw(12) << counter_per_class[class_idx];
+		for (size_t result_idx = 0; result_idx < results.size(); result_idx += cluster_counts.size())
+		{
+			ss << std::setw(12) << results[result_idx].small_per_class[class_idx];
+		}
+		ss << std::endl;
+	}
+
+	// the anchors are too long to show in a window, so they're written to a file along with the rest of the summary
+	const std::string fn = File(info.project_dir).getChildFile("anchor_sweep.txt").getFullPathName().toStdString();
+	std::ofstream ofs(fn);
+	ofs << ss.str() << std::endl << "Anchors:" << std::endl;
+	for (const auto & result : results)
+	{
+		ofs << format_size(result.width, result.height) << " with " << result.number_of_clusters << " clusters: " << result.anchors << std::endl;
+	}
+
+	ss << std::endl << "The anchors for every configuration are in " << fn << "." << std::endl;
+	Log(ss.str());
+
+	return ss.str();
+}
@@ -1,22 +1,11 @@
 // DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
 
 #include "DarkMark.hpp"
-#include "yolo_anchors.hpp"
-#include <random>
-
-
-// Sponsored change:  simplified interface + Japanese translation.
-#if DARKNET_GEN_SIMPLIFIED
-constexpr bool simplified_interface = true;
-#else
-constexpr bool simplified_interface = false;
-#endif
-constexpr bool normal_interface = not simplified_interface;
 
 
 void setTooltip(PropertyComponent * component, const String & msg)
 {
-	if (component and normal_interface)
+	if (component and dm::normal_interface)
 	{
 		component->setTooltip(msg);
 	}
@@ -25,142 +14,60 @@ void setTooltip(PropertyComponent * component, const String & msg)
 }
 
 
-class SaveTask : public ThreadWithProgressWindow
+/// Show the progress of a @ref dm::DarknetGen task in a modal window.
+class ProgressTask : public ThreadWithProgressWindow, public dm::Progress
 {
 	public:
 
-		SaveTask(dm::DarknetWnd & w) :
-			ThreadWithProgressWindow(dm::getText("TITLE3"), true, false),
+		ProgressTask(const String & title, const bool has_cancel_button, dm::DarknetWnd & w) :
+			ThreadWithProgressWindow(title, true, has_cancel_button),
 			wnd(w)
 		{
 			return;
 		}
 
-		void run()
+		virtual void set_progress(const double progress)
 		{
-			try
-			{
-				wnd.info.rebuild();
-
-				size_t number_of_files_train			= 0;
-				size_t number_of_files_valid			= 0;
-				size_t number_of_annotated_images		= 0;
-				size_t number_of_skipped_files			= 0;
-				size_t number_of_marks					= 0;
-				size_t number_of_empty_images			= 0;
-				size_t number_of_dropped_empty_images	= 0;
-				size_t number_of_images_resized			= 0;
-				size_t number_of_images_not_resized		= 0;
-				size_t number_of_tiles_created			= 0;
-				size_t number_of_zooms_created			= 0;
-				size_t number_of_dropped_annotations	= 0;
-
-				setStatusMessage(dm::getText("Creating training and validation files..."));
-				wnd.create_Darknet_training_and_validation_files(
-					*this,
-					number_of_files_train,
-					number_of_files_valid,
-					number_of_annotated_images,
-					number_of_skipped_files,
-					number_of_marks,
-					number_of_empty_images,
-					number_of_dropped_empty_images,
-					number_of_images_resized,
-					number_of_images_not_resized,
-					number_of_tiles_created,
-					number_of_zooms_created,
-					number_of_dropped_annotations);
-
-				setStatusMessage(dm::getText("Creating configuration files and shell scripts..."));
-				setProgress(0.333);
-				wnd.create_Darknet_configuration_file(*this);
-				setProgress(1.0);
-				wnd.create_Darknet_shell_scripts();
-
-				setStatusMessage(dm::getText("Done!"));
-				setProgress(1.0);
-
-				const bool singular = (wnd.content.names.size() == 2); // two because the "empty" class is appended to the names, but it does not get output
+			setProgress(progress);
 
-				std::stringstream ss;
-				ss	<< "The necessary files to run darknet have been saved to " << wnd.info.project_dir << "." << std::endl
-					<< std::endl
-					<< "There " << (singular ? "is " : "are ") << (wnd.content.names.size() - 1) << " class" << (singular ? "" : "es") << " with a total of "
-					<< number_of_files_train << " training images and "
-					<< number_of_files_valid << " validation images. The average is "
-					<< std::fixed << std::setprecision(2) << double(number_of_marks) / double(number_of_annotated_images)
-					<< " marks per image across a total of " << number_of_annotated_images << " annotated images." << std::endl
-					<< std::endl;
-
-				if (number_of_empty_images)
-				{
-					ss	<< "The number of negative samples (empty images): " << number_of_empty_images << "." << std::endl;
-					if (number_of_dropped_empty_images)
-					{
-						ss << "Additional negative samples dropped/ignored: " << number_of_dropped_empty_images << "." << std::endl;
-					}
-					ss << std::endl;
-				}
+			return;
+		}
 
-				if (number_of_images_resized)
-				{
-					ss	<< "The number of images resized to " << wnd.info.image_width << "x" << wnd.info.image_height << ": " << number_of_images_resized << "." << std::endl;
-					if (number_of_images_not_resized)
-					{
-						ss << "The number of images already at " << wnd.info.image_width << "x" << wnd.info.image_height << ": " << number_of_images_not_resized << "." << std::endl;
-					}
-					ss << std::endl;
-				}
+		virtual void set_status(const String & msg)
+		{
+			setStatusMessage(msg);
 
-				if (number_of_tiles_created)
-				{
-					ss	<< "The number of new image tiles created: " << number_of_tiles_created << "." << std::endl
-						<< std::endl;
-				}
+			return;
+		}
 
-				if (number_of_zooms_created)
-				{
-					ss	<< "The number of random crop & zoom images created: " << number_of_zooms_created << "." << std::endl
-						<< std::endl;
-				}
+		virtual bool should_stop()
+		{
+			return threadShouldExit();
+		}
 
-				if (number_of_skipped_files)
-				{
-					ss	<< "IMPORTANT: " << number_of_skipped_files << " images were skipped because they have not yet been annotated." << std::endl
-						<< std::endl;
-				}
+		dm::DarknetWnd & wnd;
+};
 
-				const double percentage = double(number_of_empty_images) / double(number_of_annotated_images + number_of_empty_images);
-				if (percentage < 0.2)
-				{
-					ss	<< "WARNING: The number of negative samples (empty images) seems unusually low: " << (int)std::round(100.0 * percentage) << "%." << std::endl
-						<< std::endl;
-				}
-				if (percentage > 0.7)
-				{
-					ss	<< "NOTE: The number of negative samples (empty images) seems unusually high: " << (int)std::round(100.0 * percentage) << "%." << std::endl
-						<< std::endl;
-				}
 
-				if (wnd.info.remove_small_annotations)
-				{
-					if (number_of_dropped_annotations == 0)
-					{
-						ss << "No annotations were dropped." << std::endl << std::endl;
-					}
-					else
-					{
-						ss << "WARNING: The number of dropped lines (annotations are too small): " << number_of_dropped_annotations << "." << std::endl << std::endl;
-					}
-				}
+class SaveTask : public ProgressTask
+{
+	public:
 
-				ss << "Run " << wnd.info.command_filename << " to start the training.";
+		SaveTask(dm::DarknetWnd & w) :
+			ProgressTask(dm::getText("TITLE3"), false, w)
+		{
+			return;
+		}
 
-				dm::Log(ss.str());
+		void run()
+		{
+			try
+			{
+				const std::string summary = wnd.create_darknet_files(*this);
 
-				if (normal_interface and dm::dmapp().cli_options["darknet"] != "run")
+				if (dm::normal_interface and dm::dmapp().cli_options["darknet"] != "run")
 				{
-					AlertWindow::showMessageBox(AlertWindow::AlertIconType::InfoIcon, "DarkMark", ss.str());
+					AlertWindow::showMessageBox(AlertWindow::AlertIconType::InfoIcon, "DarkMark", summary);
 				}
 			}
 			catch (const std::exception & e)
@@ -173,8 +80,60 @@ class SaveTask : public ThreadWithProgressWindow
 				AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", ss.str());
 			}
 		}
+};
 
-		dm::DarknetWnd & wnd;
+
+class PlanTask : public ProgressTask
+{
+	public:
+
+		PlanTask(dm::DarknetWnd & w) :
+			ProgressTask(dm::getText("Planning the export..."), true, w)
+		{
+			return;
+		}
+
+		void run()
+		{
+			try
+			{
+				summary = wnd.plan_export(*this);
+			}
+			catch (const std::exception & e)
+			{
+				summary = "Failed to plan the export:\n\n" + std::string(e.what());
+				dm::Log(summary);
+			}
+		}
+
+		std::string summary;
+};
+
+
+class SweepTask : public ProgressTask
+{
+	public:
+
+		SweepTask(dm::DarknetWnd & w) :
+			ProgressTask(dm::getText("Sweeping anchors..."), true, w)
+		{
+			return;
+		}
+
+		void run()
+		{
+			try
+			{
+				summary = wnd.sweep_anchors(*this, {}, {});
+			}
+			catch (const std::exception & e)
+			{
+				summary = "Failed to sweep the anchors:\n\n" + std::string(e.what());
+				dm::Log(summary);
+			}
+		}
+
+		std::string summary;
 };
 
 
@@ -213,10 +172,11 @@ class CfgTemplateButton : public ButtonPropertyComponent
 
 dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	DocumentWindow(getText("TITLE"), Colours::darkgrey, TitleBarButtons::closeButton),
-	content(c),
-	info(c.project_info),
+	DarknetGen(c),
 	help_button(getText("Read Me!")),
 	youtube_button("YouTube", DrawableButton::ButtonStyle::ImageOnButtonBackground),
+	plan_button(getText("Estimate")),
+	sweep_button(getText("Anchors")),
 	ok_button(getText("OK")),
 	cancel_button(getText("Cancel"))
 {
@@ -237,11 +197,15 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	canvas.addAndMakeVisible(pp);
 	canvas.addAndMakeVisible(help_button);
 	canvas.addAndMakeVisible(youtube_button);
+	canvas.addAndMakeVisible(plan_button);
+	canvas.addAndMakeVisible(sweep_button);
 	canvas.addAndMakeVisible(ok_button);
 	canvas.addAndMakeVisible(cancel_button);
 
 	help_button		.addListener(this);
 	youtube_button	.addListener(this);
+	plan_button		.addListener(this);
+	sweep_button	.addListener(this);
 	ok_button		.addListener(this);
 	cancel_button	.addListener(this);
 
@@ -266,6 +230,8 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	youtube_button.setColour(TextButton::ColourIds::buttonColourId, Colours::red);
 
 	help_button.setTooltip("Read the documentation on the web site.");
+	plan_button.setTooltip("Estimate the number of images, the disk space, and the time needed to create the Darknet files, without creating any files.");
+	sweep_button.setTooltip("Compare the average IoU and the number of small annotations for several network sizes and numbers of anchors around the current configuration.");
 
 	if (info.batch_size <= 1)
 	{
@@ -277,6 +243,7 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	v_train_with_all_images			= info.train_with_all_images;
 	v_training_images_percentage	= std::round(100.0 * info.training_images_percentage);
 	v_limit_validation_images		= info.limit_validation_images;
+	v_pack_shards					= info.pack_shards;
 	v_image_width					= info.image_width;
 	v_image_height					= info.image_height;
 	v_batch_size					= info.batch_size;
@@ -287,6 +254,7 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	v_image_type					= info.image_type.c_str();
 	v_do_not_resize_images			= info.do_not_resize_images;
 	v_resize_images					= info.resize_images;
+	v_link_unmodified_images		= info.link_unmodified_images;
 	v_tile_images					= info.tile_images;
 	v_zoom_images					= info.zoom_images;
 	v_limit_negative_samples		= info.limit_negative_samples;
@@ -408,6 +376,10 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	setTooltip(b, "DarkMark will automatically resize all the images to match the network dimensions. This speeds up training since Darknet doesn't have to dynamically resize the images while training. This may be combined with the 'tile images' option.");
 	properties.add(b);
 
+	b = new BooleanPropertyComponent(v_link_unmodified_images, getText("link unmodified images"), getText("link images which match the network dimensions"));
+	setTooltip(b, "When an image already matches the network dimensions and is already in the right image format, DarkMark will create a hard link to the original image in the image cache instead of decoding and re-encoding it. If a hard link cannot be created, the original image is copied instead.");
+	properties.add(b);
+
 	b = new BooleanPropertyComponent(v_tile_images, getText("tile images"), getText("tile images to match the network dimensions"));
 	setTooltip(b, "DarkMark will create new image tiles using the network dimensions. Annotations will automatically be fixed up to match the tiles. This may be combined with the 'resize images' option.");
 	properties.add(b);
@@ -455,6 +427,10 @@ dm::DarknetWnd::DarknetWnd(dm::DMContent & c) :
 	highlight_conditions_and_messages.push_back(BubbleInfo(b, true, "It is highly recommended that this be kept \"off\". This is an advanced feature meant to be used when encountering a specific problem while training. It can negatively impact the training of a neural network if enabled needlessly."));
 	v_limit_validation_images.addListener(this);
 
+	b = new BooleanPropertyComponent(v_pack_shards, getText("pack images into shards"), getText("pack images into shards"));
+	setTooltip(b, "In addition to the usual train.txt and valid.txt files, pack all of the training and validation images and annotations into a small number of large shard files in the \"darkmark_shards\" subdirectory. The shards are an archive format which is faster to copy or back up than millions of small files. Darknet cannot read the shards and still trains from the individual files. Use DarkMark_verify_shards to check the shards.");
+	properties.add(b);
+
 	pp.addSection(getText("images"), properties, true);
 	properties.clear();
 
@@ -699,6 +675,10 @@ void dm::DarknetWnd::resized()
 	button_row.items.add(FlexItem().withWidth(margin_size));
 	button_row.items.add(FlexItem(youtube_button).withWidth(30.0));
 	button_row.items.add(FlexItem().withFlex(1.0));
+	button_row.items.add(FlexItem(sweep_button).withWidth(100.0));
+	button_row.items.add(FlexItem().withWidth(margin_size));
+	button_row.items.add(FlexItem(plan_button).withWidth(100.0));
+	button_row.items.add(FlexItem().withWidth(margin_size));
 	button_row.items.add(FlexItem(cancel_button).withWidth(100.0));
 	button_row.items.add(FlexItem().withWidth(margin_size));
 	button_row.items.add(FlexItem(ok_button).withWidth(100.0));
@@ -766,33 +746,46 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	const int batch_size		= v_batch_size	.getValue();
 	const int subdivisions		= v_subdivisions.getValue();
 
-	if (cfg_template.isEmpty() or File(cfg_template).exists() == false)
+	const std::string error_message = validate(cfg_template.toStdString(), image_width, image_height, batch_size, subdivisions);
+	if (not error_message.empty())
 	{
-		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", "The configuration template filename is not valid.");
+		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", error_message);
 		return;
 	}
 
-	if (image_width % 32)
+	if (button == &plan_button or button == &sweep_button)
 	{
-		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", "The image width must be a multiple of 32.");
-		return;
-	}
+		/* The estimate and the sweep use the values currently shown in the window.  But the project info is shared with
+		 * the rest of DarkMark, so it is restored once the task has finished.  Nothing changes in the project until "OK"
+		 * is pressed, even if the window is then cancelled.
+		 */
+		const ProjectInfo original_info = info;
+		update_project_info();
 
-	if (image_height % 32)
-	{
-		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", "The image height must be a multiple of 32.");
-		return;
-	}
+		std::string summary;
+		if (button == &plan_button)
+		{
+			PlanTask plan_task(*this);
+			if (plan_task.runThread())
+			{
+				summary = plan_task.summary;
+			}
+		}
+		else
+		{
+			SweepTask sweep_task(*this);
+			if (sweep_task.runThread())
+			{
+				summary = sweep_task.summary;
+			}
+		}
 
-	if (subdivisions > batch_size)
-	{
-		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", "The subdivision must be less than or equal to the batch size.");
-		return;
-	}
+		info = original_info;
 
-	if (batch_size % subdivisions)
-	{
-		AlertWindow::showMessageBox(AlertWindow::AlertIconType::WarningIcon, "DarkMark", "The batch size must be a multiple of subdivisions.");
+		if (not summary.empty())
+		{
+			AlertWindow::showMessageBox(AlertWindow::AlertIconType::InfoIcon, "DarkMark", summary);
+		}
 		return;
 	}
 
@@ -803,6 +796,7 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	cfg().setValue(content.cfg_prefix + "darknet_train_with_all_images"	, v_train_with_all_images		);
 	cfg().setValue(content.cfg_prefix + "darknet_training_percentage"	, v_training_images_percentage	);
 	cfg().setValue(content.cfg_prefix + "darknet_limit_validation_images",v_limit_validation_images		);
+	cfg().setValue(content.cfg_prefix + "darknet_pack_shards"			, v_pack_shards					);
 	cfg().setValue(content.cfg_prefix + "darknet_image_width"			, v_image_width					);
 	cfg().setValue(content.cfg_prefix + "darknet_image_height"			, v_image_height				);
 	cfg().setValue(content.cfg_prefix + "darknet_batch_size"			, v_batch_size					);
@@ -813,6 +807,7 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	cfg().setValue(content.cfg_prefix + "darknet_image_type"			, v_image_type					);
 	cfg().setValue(content.cfg_prefix + "darknet_do_not_resize_images"	, v_do_not_resize_images		);
 	cfg().setValue(content.cfg_prefix + "darknet_resize_images"			, v_resize_images				);
+	cfg().setValue(content.cfg_prefix + "darknet_link_unmodified_images", v_link_unmodified_images	);
 	cfg().setValue(content.cfg_prefix + "darknet_tile_images"			, v_tile_images					);
 	cfg().setValue(content.cfg_prefix + "darknet_zoom_images"			, v_zoom_images					);
 	cfg().setValue(content.cfg_prefix + "darknet_remove_small_annotations", v_remove_small_annotations	);
@@ -833,11 +828,25 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	cfg().setValue(content.cfg_prefix + "darknet_cutmix"				, v_cutmix						);
 	cfg().setValue(content.cfg_prefix + "darknet_mixup"					, v_mixup						);
 
+	update_project_info();
+
+	SaveTask save_task(*this);
+	save_task.runThread();
+
+	closeButtonPressed();
+
+	return;
+}
+
+
+void dm::DarknetWnd::update_project_info()
+{
 	info.cfg_template				= v_cfg_template			.toString().toStdString();
 	info.extra_flags				= v_extra_flags				.toString().toStdString();
 	info.train_with_all_images		= v_train_with_all_images	.getValue();
 	info.training_images_percentage	= static_cast<double>(v_training_images_percentage.getValue()) / 100.0;
 	info.limit_validation_images	= v_limit_validation_images	.getValue();
+	info.pack_shards				= v_pack_shards				.getValue();
 	info.image_width				= v_image_width				.getValue();
 	info.image_height				= v_image_height			.getValue();
 	info.batch_size					= v_batch_size				.getValue();
@@ -848,6 +857,7 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	info.image_type					= v_image_type				.toString().toStdString();
 	info.do_not_resize_images		= v_do_not_resize_images	.getValue();
 	info.resize_images				= v_resize_images			.getValue();
+	info.link_unmodified_images		= v_link_unmodified_images	.getValue();
 	info.tile_images				= v_tile_images				.getValue();
 	info.zoom_images				= v_zoom_images				.getValue();
 	info.limit_negative_samples		= v_limit_negative_samples	.getValue();
@@ -868,10 +878,9 @@ void dm::DarknetWnd::buttonClicked(Button * button)
 	info.enable_flip				= v_enable_flip				.getValue();
 	info.angle						= v_angle					.getValue();
 
-	SaveTask save_task(*this);
-	save_task.runThread();
-
-	closeButtonPressed();
+	verbose_output					= v_verbose_output			.getValue();
+	keep_augmented_images			= v_keep_augmented_images	.getValue();
+	show_receptive_field			= v_show_receptive_field	.getValue();
 
 	return;
 }
@@ -1014,533 +1023,3 @@ void dm::DarknetWnd::valueChanged(Value & value)
 
 	return;
 }
-
-
-void dm::DarknetWnd::create_Darknet_configuration_file(ThreadWithProgressWindow & progress_window)
-{
-	const size_t number_of_classes		= content.names.size() - 1;
-	const bool enable_mosaic			= info.enable_mosaic;
-	const bool enable_cutmix			= info.enable_cutmix;
-	const bool enable_mixup				= info.enable_mixup;
-	const bool enable_flip				= info.enable_flip;
-	const float learning_rate			= info.learning_rate;
-	const float max_chart_loss			= info.max_chart_loss;
-	const float saturation				= info.saturation;
-	const float exposure				= info.exposure;
-	const float hue						= info.hue;
-	const int angle						= info.angle;
-	const size_t number_of_iterations	= info.iterations;
-	const size_t batch					= info.batch_size;
-	const size_t subdivisions			= info.subdivisions;
-//	const size_t filters				= number_of_classes * 3 + 15;
-	const size_t width					= info.image_width;
-	const size_t height					= info.image_height;
-	const bool recalculate_anchors		= info.recalculate_anchors;
-	const size_t anchor_clusters		= info.anchor_clusters;
-	const bool class_imbalance			= info.class_imbalance;
-
-	MStr m =
-	{
-		{"use_cuda_graph"	, "0"													},
-		{"flip"				, enable_flip	? "1" : "0"								},
-		{"mosaic"			, enable_mosaic	? "1" : "0"								},
-		{"cutmix"			, enable_cutmix	? "1" : "0"								},
-		{"mixup"			, enable_mixup	? "1" : "0"								},
-		{"learning_rate"	, std::to_string(learning_rate)							},
-		{"max_chart_loss"	, std::to_string(max_chart_loss)						},
-		{"hue"				, std::to_string(hue)									},
-		{"saturation"		, std::to_string(saturation)							},
-		{"exposure"			, std::to_string(exposure)								},
-		{"max_batches"		, std::to_string(number_of_iterations)					},
-		{"scales"			, "0.2,0.1"												},
-		{"batch"			, std::to_string(batch)									},
-		{"subdivisions"		, std::to_string(subdivisions)							},
-		{"height"			, std::to_string(height)								},
-		{"width"			, std::to_string(width)									},
-		{"angle"			, std::to_string(angle)									}
-	};
-
-	if (v_show_receptive_field.getValue().operator bool())
-	{
-		m["show_receptive_field"] = "1";
-	}
-
-	std::set<size_t> steps =
-	{
-		static_cast<size_t>(std::round(0.8f * number_of_iterations)),
-		static_cast<size_t>(std::round(0.9f * number_of_iterations))
-	};
-
-	if (v_restart_training.getValue().operator bool())
-	{
-		steps.insert(std::round(0.5f * number_of_iterations));
-		steps.insert(std::round(0.6f * number_of_iterations));
-		steps.insert(std::round(0.7f * number_of_iterations));
-		m["scales"] = "0.5,0.4,0.3,0.2,0.1";
-		m["burn_in"] = "0";
-	}
-
-	std::string str;
-	for (const auto s : steps)
-	{
-		if (str.size())
-		{
-			str += ",";
-		}
-		str += std::to_string(s);
-	}
-	m["steps"] = str;
-
-	cfg_handler.modify_all_sections("[net]", m);
-
-	m.clear();
-	if (recalculate_anchors)
-	{
-		progress_window.setStatusMessage(dm::getText("Recalculating anchors..."));
-		progress_window.setProgress(0.0);
-
-		/* Make many attempts at figuring out the best anchors.  In tests, I've seen the best anchors found as high
-		 * as the 98th attempt!  Also keep track of the time in case it is taking too long and we want to abort.
-		 */
-		std::time_t now = std::time(nullptr);
-		const std::time_t end_time = now + 60;
-		const size_t max_attempts = 100;
-		float best_avg_iou = 0.0f;
-
-		for (size_t attempt = 0; attempt < max_attempts and std::time(nullptr) < end_time; attempt ++)
-		{
-			progress_window.setProgress(double(attempt) / double(max_attempts));
-
-			std::string counters_per_class;
-			std::string anchors;
-			float avg_iou = 0.0f;
-
-			calc_anchors(info.train_filename, anchor_clusters, info.image_width, info.image_height, number_of_classes, anchors, counters_per_class, avg_iou);
-			if (avg_iou > best_avg_iou)
-			{
-				dm::Log("attempt #" + std::to_string(attempt) + ": avg IoU ........ " + std::to_string(avg_iou));
-				dm::Log("attempt #" + std::to_string(attempt) + ": new anchors .... " + anchors);
-				dm::Log("attempt #" + std::to_string(attempt) + ": new counters ... " + counters_per_class);
-
-				best_avg_iou = avg_iou;
-				m["anchors"] = anchors;
-
-				if (class_imbalance)
-				{
-					m["counters_per_class"] = counters_per_class;
-				}
-			}
-		}
-
-		/* In YOLOv3-tiny and YOLOv4-tiny, there is a typo in the masks.  It
-		 * should be 0,1,2 but instead appears as 1,2,3.  Fix this when the
-		 * user has chosen to re-calculate the anchors.
-		 *
-		 * https://github.com/AlexeyAB/darknet/issues/7856#issuecomment-874147909
-		 */
-		for (auto section_idx : cfg_handler.find_section("yolo"))
-		{
-			const auto idx = cfg_handler.find_key_in_section(section_idx, "mask");
-
-			if (idx != std::string::npos)
-			{
-				std::string & line = cfg_handler.cfg.at(idx);
-				if (line == "mask = 1,2,3")
-				{
-					Log("fixing YOLO masks at index " + std::to_string(idx) + ": " + line);
-					line = "mask = 0,1,2";
-				}
-			}
-		}
-	}
-
-	m["classes"] = std::to_string(number_of_classes);
-
-	cfg_handler.modify_all_sections("[yolo]", m);
-	cfg_handler.fix_filters_before_yolo();
-	cfg_handler.output(info);
-
-	return;
-}
-
-
-void dm::DarknetWnd::create_Darknet_training_and_validation_files(
-		ThreadWithProgressWindow & progress_window,
-		size_t & number_of_files_train			,
-		size_t & number_of_files_valid			,
-		size_t & number_of_annotated_images		,
-		size_t & number_of_skipped_files		,
-		size_t & number_of_marks				,
-		size_t & number_of_empty_images			,
-		size_t & number_of_dropped_empty_images	,
-		size_t & number_of_resized_images		,
-		size_t & number_of_images_not_resized	,
-		size_t & number_of_tiles_created		,
-		size_t & number_of_zooms_created		,
-		size_t & number_of_dropped_annotations	)
-{
-	if (true)
-	{
-		std::ofstream fs(info.data_filename);
-		fs	<< "classes = "	<< content.names.size() - 1						<< std::endl
-			<< "train = "	<< info.train_filename							<< std::endl
-			<< "valid = "	<< info.valid_filename							<< std::endl
-			<< "names = "	<< cfg().get_str(content.cfg_prefix + "names")	<< std::endl
-			<< "backup = "	<< info.project_dir								<< std::endl;
-	}
-
-	number_of_files_train			= 0;
-	number_of_files_valid			= 0;
-	number_of_annotated_images		= 0;
-	number_of_skipped_files			= 0;
-	number_of_marks					= 0;
-	number_of_empty_images			= 0;
-	number_of_dropped_empty_images	= 0;
-	number_of_resized_images		= 0;
-	number_of_images_not_resized	= 0;
-	number_of_tiles_created			= 0;
-	number_of_zooms_created			= 0;
-	number_of_dropped_annotations	= 0;
-
-	File dir = File(info.project_dir).getChildFile("darkmark_image_cache");
-	if (dir.exists())
-	{
-		for (const auto & name : {"resize", "tiles", "zoom"})
-		{
-			File subdir = dir.getChildFile(name);
-			subdir.deleteRecursively();
-		}
-	}
-
-	// these vectors will have the full path of the images we need to use (or which have been skipped)
-	VStr negative_samples;
-	VStr annotated_images;
-	VStr skipped_images;
-	VStr all_output_images;
-	find_all_annotated_images(progress_window, annotated_images, skipped_images, number_of_marks, number_of_empty_images);
-	number_of_annotated_images = annotated_images.size();
-	number_of_skipped_files = skipped_images.size();
-
-	Log("total number of skipped input images ..... " + std::to_string(number_of_skipped_files		));
-	Log("original number of annotated images ...... " + std::to_string(number_of_annotated_images	));
-	Log("original number of marks ................. " + std::to_string(number_of_marks				));
-	Log("original number of empty images .......... " + std::to_string(number_of_empty_images		));
-
-	if (info.do_not_resize_images)
-	{
-		Log("not resizing any images");
-		all_output_images = annotated_images;
-	}
-	else
-	{
-		// reset these counters and let the resize/tile/zoom+crop functions set these values
-		number_of_marks = 0;
-		number_of_empty_images = 0;
-	}
-
-	if (info.resize_images)
-	{
-		Log("resizing all images");
-		resize_images(progress_window, annotated_images, all_output_images, number_of_resized_images, number_of_images_not_resized, number_of_marks, number_of_empty_images);
-		Log("number of images resized ................. " + std::to_string(number_of_resized_images		));
-		Log("number of images not resized ............. " + std::to_string(number_of_images_not_resized	));
-	}
-	if (info.tile_images)
-	{
-		Log("tiling all images");
-		tile_images(progress_window, annotated_images, all_output_images, number_of_marks, number_of_tiles_created, number_of_empty_images);
-		Log("number of tiles created .................. " + std::to_string(number_of_tiles_created));
-	}
-	if (info.zoom_images)
-	{
-		Log("crop+zoom all images");
-		random_zoom_images(progress_window, annotated_images, all_output_images, number_of_marks, number_of_zooms_created, number_of_empty_images);
-		Log("number of crop+zoom images created ....... " + std::to_string(number_of_zooms_created));
-	}
-
-	std::shuffle(all_output_images.begin(), all_output_images.end(), get_random_engine());
-
-	if (info.limit_negative_samples)
-	{
-		// see if we need to limit the negative samples (especially useful when using tiling with large images)
-		negative_samples.clear();
-		annotated_images.clear();
-		double work_done = 0.0;
-		double work_to_do = all_output_images.size() + 1.0;
-		progress_window.setProgress(0.0);
-		progress_window.setStatusMessage(dm::getText("Limit negative samples..."));
-		for (size_t idx = 0; idx < all_output_images.size(); idx ++)
-		{
-			work_done ++;
-			progress_window.setProgress(work_done / work_to_do);
-
-			const auto & fn = all_output_images[idx];
-			if (File(fn).withFileExtension(".txt").getSize() == 0)
-			{
-				negative_samples.push_back(fn);
-			}
-			else
-			{
-				annotated_images.push_back(fn);
-			}
-		}
-
-		Log("negative samples: " + std::to_string(negative_samples.size()));
-		Log("annotated images: " + std::to_string(annotated_images.size()));
-
-		if (negative_samples.size() > 1.2 * annotated_images.size())
-		{
-			number_of_dropped_empty_images = negative_samples.size() - annotated_images.size();
-			Log("number of dropped negative samples ....... " + std::to_string(number_of_dropped_empty_images));
-			negative_samples.resize(annotated_images.size());
-
-			number_of_empty_images = negative_samples.size();
-			all_output_images.swap(negative_samples);
-			all_output_images.insert(all_output_images.end(), annotated_images.begin(), annotated_images.end());
-			std::shuffle(all_output_images.begin(), all_output_images.end(), get_random_engine());
-		}
-	}
-
-	if (info.do_not_resize_images == false and info.remove_small_annotations)
-	{
-		// go through all of the annotations and see if anything needs to be dropped
-
-		Log("drop small annotations");
-		drop_small_annotations(progress_window, all_output_images, number_of_dropped_annotations);
-	}
-
-	// now that we know the exact set of images (including resized and tiled images)
-	// we can create the training and validation .txt files
-
-	double work_done = 0.0;
-	double work_to_do = all_output_images.size() + 1.0;
-	progress_window.setProgress(0.0);
-	progress_window.setStatusMessage(dm::getText("Writing training and validation files..."));
-	Log("total number of output images ............ " + std::to_string(all_output_images.size()));
-
-	const bool use_all_images = info.train_with_all_images;
-	number_of_files_train = std::round(info.training_images_percentage * all_output_images.size());
-	number_of_files_valid = all_output_images.size() - number_of_files_train;
-
-	if (use_all_images)
-	{
-		number_of_files_train = all_output_images.size();
-		number_of_files_valid = all_output_images.size();
-	}
-
-	const size_t maximum_number_of_validation_images = 10 * content.names.size();
-	if (info.limit_validation_images)
-	{
-		if (number_of_files_valid > maximum_number_of_validation_images)
-		{
-			number_of_files_valid = maximum_number_of_validation_images;
-
-			if (not use_all_images)
-			{
-				number_of_files_train = all_output_images.size() - number_of_files_valid;
-			}
-		}
-	}
-
-	number_of_annotated_images = all_output_images.size() - number_of_empty_images;
-	Log("total number of annotated images ............ " + std::to_string(number_of_annotated_images	));
-	Log("total number of marks ....................... " + std::to_string(number_of_marks - number_of_dropped_annotations));
-	Log("total number of dropped marks (too small) ... " + std::to_string(number_of_dropped_annotations));
-	Log("total number of empty images ................ " + std::to_string(number_of_empty_images		));
-	Log("total number of training images ............. " + std::to_string(number_of_files_train) + " (" + info.train_filename + ")");
-	Log("total number of validation images ........... " + std::to_string(number_of_files_valid) + " (" + info.valid_filename + ")");
-	Log("cap validation images ....................... " + std::string(info.limit_validation_images ? "true" : "false"));
-
-	std::ofstream fs_train(info.train_filename);
-	std::ofstream fs_valid(info.valid_filename);
-
-	size_t current_number_of_validation_images = 0;
-	for (size_t idx = 0; idx < all_output_images.size(); idx ++)
-	{
-		work_done ++;
-		progress_window.setProgress(work_done / work_to_do);
-
-		if (use_all_images or idx < number_of_files_train)
-		{
-			fs_train << all_output_images[idx] << std::endl;
-		}
-
-		if (use_all_images or idx >= number_of_files_train)
-		{
-			if (info.limit_validation_images and current_number_of_validation_images >= maximum_number_of_validation_images)
-			{
-				continue;
-			}
-			fs_valid << all_output_images[idx] << std::endl;
-			current_number_of_validation_images ++;
-		}
-	}
-
-	Log("training and validation files have been saved to disk");
-
-	return;
-}
-
-
-void dm::DarknetWnd::create_Darknet_shell_scripts()
-{
-	if (simplified_interface)
-	{
-		return;
-	}
-
-	std::string header;
-
-	if (true)
-	{
-		std::stringstream ss;
-		ss	<< "#!/bin/bash -e"				<< std::endl
-			<< ""							<< std::endl
-			<< "cd " << info.project_dir	<< std::endl
-			<< ""							<< std::endl
-			<< "# Warning: this file is automatically created/updated by DarkMark v" << DARKMARK_VERSION << "!" << std::endl
-			<< "# Created on " << Time::getCurrentTime().formatted("%a %Y-%m-%d %H:%M:%S %Z").toStdString()
-			<< " by " << SystemStats::getLogonName().toStdString()
-			<< "@" << SystemStats::getComputerName().toStdString() << "." << std::endl;
-		header = ss.str();
-	}
-
-	if (true)
-	{
-		std::string cmd =
-				cfg().get_str("darknet_executable") +
-				" detector train " +
-				(v_verbose_output		.getValue() ? "-verbose "	: "") +
-				(v_keep_augmented_images.getValue() ? "-show_imgs "	: "") +
-				v_extra_flags.toString().toStdString() + " " +
-				info.data_filename + " " + info.cfg_filename;
-
-		if (info.save_weights > 0)
-		{
-			cmd += " --save-weights " + std::to_string(info.save_weights);
-		}
-		if (info.restart_training)
-		{
-			cmd += " " + cfg().get_str(content.cfg_prefix + "weights");
-			cmd += " -clear";
-		}
-
-		std::stringstream ss;
-		ss	<< header
-			<< ""												<< std::endl
-			<< "rm -f output.log"								<< std::endl
-			<< "#rm -f chart.png"								<< std::endl
-			<< ""												<< std::endl
-			<< "echo \"creating new log file\" > output.log"	<< std::endl
-			<< "date >> output.log"								<< std::endl
-			<< ""												<< std::endl
-			<< "ts1=$(date)"									<< std::endl
-			<< "ts2=$(date +%s)"								<< std::endl
-			<< "echo \"initial ts1: ${ts1}\" >> output.log"		<< std::endl
-			<< "echo \"initial ts2: ${ts2}\" >> output.log"		<< std::endl
-			<< "echo \"cmd: " << cmd << "\" >> output.log"		<< std::endl
-			<< ""												<< std::endl
-			<< "/usr/bin/time --verbose " << cmd << " 2>&1 | tee --append output.log" << std::endl
-			<< ""												<< std::endl
-			<< "ts3=$(date)"									<< std::endl
-			<< "ts4=$(date +%s)"								<< std::endl
-			<< "echo \"ts1: ${ts1}\" >> output.log"				<< std::endl
-			<< "echo \"ts2: ${ts2}\" >> output.log"				<< std::endl
-			<< "echo \"ts3: ${ts3}\" >> output.log"				<< std::endl
-			<< "echo \"ts4: ${ts4}\" >> output.log"				<< std::endl
-			<< ""												<< std::endl;
-
-		if (info.delete_temp_weights)
-		{
-			ss	<< "find " << info.project_dir << " -maxdepth 1 -regex \".+_[0-9]+\\.weights\" -print -delete >> output.log" << std::endl
-				<< "" << std::endl;
-		}
-
-		const std::string data = ss.str();
-		File f(info.command_filename);
-		f.replaceWithData(data.c_str(), data.size());	// do not use replaceWithText() since it converts the file to CRLF endings which confuses bash
-		f.setExecutePermission(true);
-	}
-
-	if (true)
-	{
-		std::stringstream ss;
-		ss	<< header
-			<< "#"																								<< std::endl
-			<< "# This script assumes you have 2 computers:"													<< std::endl
-			<< "#"																								<< std::endl
-			<< "# - the first is the desktop where you run DarkMark and this script,"							<< std::endl
-			<< "# - the second has a decent GPU and is where you train the neural network."						<< std::endl
-			<< "#"																								<< std::endl
-			<< "# It also assumes the directory structure for where neural networks are saved"					<< std::endl
-			<< "# on disk is identical between both computers."													<< std::endl
-			<< "#"																								<< std::endl
-			<< "# Running this script *FROM THE DESKTOP COMPUTER* will retrieve the results"					<< std::endl
-			<< "# (the .weights files) from 'gpurig' where training took place."								<< std::endl
-			<< ""																								<< std::endl
-			<< "ping -c 1 -W 1 gpurig >/dev/null 2>&1"															<< std::endl
-			<< "if [ $? -ne 0 ]; then"																			<< std::endl
-			<< "	echo \"Make sure the hostname 'gpurig' can be resolved or exists in the /etc/hosts file!\""	<< std::endl
-			<< "else"																							<< std::endl
-			<< "#	rm -f " << info.project_name << "*.weights"													<< std::endl
-			<< "#	rm -f output.log"																			<< std::endl
-			<< "	rm -f chart.png"																			<< std::endl
-			<< ""																								<< std::endl
-			<< "	rsync --update --human-readable --info=progress2,stats2 --times --no-compress gpurig:" << info.project_dir << "/\\* ." << std::endl
-			<< ""																								<< std::endl;
-
-			if (info.delete_temp_weights)
-			{
-				ss	<< "	find " << info.project_dir << " -maxdepth 1 -regex \".+_[0-9]+\\.weights\" -print -delete" << std::endl
-					<< "" << std::endl;
-			}
-
-		ss	<< "	if [ -e chart.png ]; then"																	<< std::endl
-			<< "		eog chart.png"																			<< std::endl
-			<< "	fi"																							<< std::endl
-			<< "fi"																								<< std::endl
-			<< ""																								<< std::endl;
-
-		const std::string data = ss.str();
-		File f = File(info.project_dir).getChildFile("get_results_from_gpu_rig.sh");
-		f.replaceWithData(data.c_str(), data.size());
-		f.setExecutePermission(true);
-	}
-
-	if (true)
-	{
-		std::stringstream ss;
-		ss	<< header
-			<< "#"																								<< std::endl
-			<< "# This script assumes you have 2 computers:"													<< std::endl
-			<< "#"																								<< std::endl
-			<< "# - the first is the desktop where you run DarkMark and this script,"							<< std::endl
-			<< "# - the second has a decent GPU and is where you train the neural network."						<< std::endl
-			<< "#"																								<< std::endl
-			<< "# It also assumes the directory structure for where neural networks are saved"					<< std::endl
-			<< "# on disk is identical between both computers."													<< std::endl
-			<< "#"																								<< std::endl
-			<< "# Running this script *FROM THE DESKTOP COMPUTER* will copy all of the"							<< std::endl
-			<< "# necessary files (images, .txt, .names, .cfg, etc) from the desktop computer"					<< std::endl
-			<< "# to the rig with the decent GPU so you can then start the training process."					<< std::endl
-			<< "#"																								<< std::endl
-			<< "# After this script has finished running, ssh to the GPU rig and run this to train:"			<< std::endl
-			<< "#"																								<< std::endl
-			<< "#		" << info.command_filename																<< std::endl
-			<< "#"																								<< std::endl
-			<< ""																								<< std::endl
-			<< "ping -c 1 -W 1 gpurig >/dev/null 2>&1"															<< std::endl
-			<< "if [ $? -ne 0 ]; then"																			<< std::endl
-			<< "	echo \"Make sure the hostname 'gpurig' can be resolved or exists in the /etc/hosts file!\""	<< std::endl
-			<< "else"																							<< std::endl
-			<< "	rsync --update --human-readable --recursive --no-inc-recursive --info=progress2,stats2 --times --no-compress . gpurig:" << info.project_dir << std::endl
-			<< "fi"																								<< std::endl
-			<< ""																								<< std::endl;
-		const std::string data = ss.str();
-		File f = File(info.project_dir).getChildFile("send_files_to_gpu_rig.sh");
-		f.replaceWithData(data.c_str(), data.size());
-		f.setExecutePermission(true);
-	}
-
-	return;
-}
@@ -7,7 +7,7 @@
 
 namespace dm
 {
-	class DarknetWnd : public DocumentWindow, public Button::Listener, public Value::Listener
+	class DarknetWnd : public DocumentWindow, public Button::Listener, public Value::Listener, public DarknetGen
 	{
 		public:
 
@@ -26,41 +26,15 @@ namespace dm
 
 			virtual void valueChanged(Value & value);
 
-			void create_Darknet_training_and_validation_files(
-					ThreadWithProgressWindow & progress_window,
-					size_t & number_of_files_train			,
-					size_t & number_of_files_valid			,
-					size_t & number_of_annotated_images		,
-					size_t & number_of_skipped_files		,
-					size_t & number_of_marks				,
-					size_t & number_of_empty_images			,
-					size_t & number_of_dropped_empty_images	,
-					size_t & number_of_resized_images		,
-					size_t & number_of_images_not_resized	,
-					size_t & number_of_tiles_created		,
-					size_t & number_of_zooms_created		,
-					size_t & number_of_dropped_annotations	);
-
-			void find_all_annotated_images(ThreadWithProgressWindow & progress_window, VStr & annotated_images, VStr & skipped_images, size_t & number_of_marks, size_t & number_of_empty_images);
-
-			void resize_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_resized_images, size_t & number_of_images_not_resized, size_t & number_of_marks, size_t & number_of_empty_images);
-
-			void tile_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_marks, size_t & number_of_tiles_created, size_t & number_of_empty_images);
-
-			void random_zoom_images(ThreadWithProgressWindow & progress_window, const VStr & annotated_images, VStr & all_output_images, size_t & number_of_marks, size_t & number_of_zooms_created, size_t & number_of_empty_images);
-
-			void drop_small_annotations(ThreadWithProgressWindow & progress_window, const VStr & all_output_images, size_t & number_of_annotations_dropped);
-
-			void create_Darknet_configuration_file(ThreadWithProgressWindow & progress_window);
-			void create_Darknet_shell_scripts();
-
-			CfgHandler cfg_handler;
+			/// Copy the values shown in the window to the project info used by @ref DarknetGen.
+			void update_project_info();
 
 			Value v_cfg_template;
 			Value v_extra_flags;
 			Value v_train_with_all_images;
 			Value v_training_images_percentage;
 			Value v_limit_validation_images;
+			Value v_pack_shards;
 			Value v_image_width;
 			Value v_image_height;
 			Value v_batch_size;
@@ -71,6 +45,7 @@ namespace dm
 			Value v_image_type;
 			Value v_do_not_resize_images;
 			Value v_resize_images;
+			Value v_link_unmodified_images;
 			Value v_tile_images;
 			Value v_zoom_images;
 			Value v_limit_negative_samples;
@@ -94,12 +69,12 @@ namespace dm
 			Value v_keep_augmented_images;
 			Value v_show_receptive_field;
 
-			DMContent & content;
-			ProjectInfo & info;
 			Component canvas;
 			PropertyPanel pp;
 			TextButton help_button;
 			DrawableButton youtube_button;
+			TextButton plan_button;
+			TextButton sweep_button;
 			TextButton ok_button;
 			TextButton cancel_button;
 
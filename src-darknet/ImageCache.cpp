@@ -0,0 +1,268 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+#include "json.hpp"
+using json = nlohmann::json;
+
+
+namespace
+{
+	/// The text logs written by each stage are not outputs, so they must never be treated as orphans.
+	const dm::SStr stage_logs = {"resized.txt", "tiles.txt", "zoom.txt"};
+}
+
+
+dm::ImageCache::ImageCache(const std::string & project_dir) :
+	cache_dir(File(project_dir).getChildFile("darkmark_image_cache").getFullPathName().toStdString()),
+	manifest_filename(File(cache_dir).getChildFile("manifest.json").getFullPathName().toStdString()),
+	master_seed(0),
+	hits(0),
+	misses(0)
+{
+	File f(manifest_filename);
+	if (f.existsAsFile())
+	{
+		try
+		{
+			json root = json::parse(f.loadFileAsString().toStdString());
+
+			for (const auto & [filename, j] : root["sources"].items())
+			{
+				previous_sources[filename] = {j["size"].get<int64>(), j["timestamp"].get<int64>(), j["md5"].get<std::string>()};
+			}
+
+			for (const auto & [key, j] : root["entries"].items())
+			{
+				Entry & entry = previous_entries[key];
+				entry.stage		= j["stage"];
+				entry.resized	= j["resized"];
+				entry.seed		= j.value("seed", uint64_t(0));
+				for (const auto & o : j["outputs"])
+				{
+					Output output = {o["filename"].get<std::string>(), o["annotations"].get<size_t>(), {}};
+					if (o.contains("dropped"))
+					{
+						for (const auto & [class_idx, count] : o["dropped"].items())
+						{
+							output.dropped[std::stoi(class_idx)] = count.get<size_t>();
+						}
+					}
+					entry.outputs.push_back(output);
+				}
+			}
+		}
+		catch (const std::exception & e)
+		{
+			// if the manifest is corrupt then we'll regenerate everything
+			Log("ignoring invalid image cache manifest " + manifest_filename + ": " + e.what());
+			previous_sources.clear();
+			previous_entries.clear();
+		}
+	}
+
+	Log("image cache manifest has " + std::to_string(previous_entries.size()) + " entries for " + std::to_string(previous_sources.size()) + " source images");
+
+	return;
+}
+
+
+std::string dm::ImageCache::stage_directory(const std::string & stage) const
+{
+	File dir = File(cache_dir).getChildFile(stage);
+	const std::string dir_name = dir.getFullPathName().toStdString();
+	dir.createDirectory();
+	if (dir.isDirectory() == false)
+	{
+		throw std::runtime_error("Failed to create directory " + dir_name + ".");
+	}
+
+	return dir_name;
+}
+
+
+std::string dm::ImageCache::source_hash(const std::string & filename)
+{
+	File f(filename);
+	const int64 size		= f.getSize();
+	const int64 timestamp	= f.getLastModificationTime().toMilliseconds();
+
+	if (true)
+	{
+		std::lock_guard lock(mutex);
+		auto iter = previous_sources.find(filename);
+		if (iter != previous_sources.end() and iter->second.size == size and iter->second.timestamp == timestamp)
+		{
+			current_sources[filename] = iter->second;
+			return iter->second.md5;
+		}
+	}
+
+	// the file is new or has changed, so we need to read it (without holding the lock)
+	const std::string md5 = MD5(f).toHexString().toStdString();
+
+	std::lock_guard lock(mutex);
+	current_sources[filename] = {size, timestamp, md5};
+
+	return md5;
+}
+
+
+bool dm::ImageCache::known_source_hash(const std::string & filename, std::string & md5) const
+{
+	File f(filename);
+	const int64 size		= f.getSize();
+	const int64 timestamp	= f.getLastModificationTime().toMilliseconds();
+
+	std::lock_guard lock(mutex);
+	auto iter = previous_sources.find(filename);
+	if (iter != previous_sources.end() and iter->second.size == size and iter->second.timestamp == timestamp)
+	{
+		md5 = iter->second.md5;
+		return true;
+	}
+
+	return false;
+}
+
+
+std::string dm::ImageCache::key(const std::string & stage, const std::string & source_hash, const std::string & annotation_hash, const std::string & parameters)
+{
+	const std::string str = stage + "|" + source_hash + "|" + annotation_hash + "|" + parameters;
+
+	return MD5(str.c_str(), str.size()).toHexString().toStdString();
+}
+
+
+void dm::ImageCache::set_master_seed(const uint64_t seed)
+{
+	std::lock_guard lock(mutex);
+
+	master_seed = seed;
+
+	return;
+}
+
+
+bool dm::ImageCache::find(const std::string & key, Entry & entry)
+{
+	std::lock_guard lock(mutex);
+
+	auto iter = previous_entries.find(key);
+	if (iter == previous_entries.end())
+	{
+		misses ++;
+		return false;
+	}
+
+	for (const auto & output : iter->second.outputs)
+	{
+		File f(output.filename);
+		if (f.existsAsFile() == false or f.withFileExtension(".txt").existsAsFile() == false)
+		{
+			// something has deleted part of this entry, so it will need to be re-generated
+			misses ++;
+			return false;
+		}
+	}
+
+	hits ++;
+	entry = iter->second;
+	current_entries[key] = entry;
+
+	return true;
+}
+
+
+void dm::ImageCache::add(const std::string & key, const Entry & entry)
+{
+	std::lock_guard lock(mutex);
+
+	current_entries[key] = entry;
+
+	return;
+}
+
+
+size_t dm::ImageCache::save()
+{
+	std::lock_guard lock(mutex);
+
+	json root;
+	root["master_seed"] = master_seed;
+	root["sources"] = json::object();
+	root["entries"] = json::object();
+
+	for (const auto & [filename, source] : current_sources)
+	{
+		root["sources"][filename]["size"]		= source.size;
+		root["sources"][filename]["timestamp"]	= source.timestamp;
+		root["sources"][filename]["md5"]		= source.md5;
+	}
+
+	SStr referenced;
+	for (const auto & [key, entry] : current_entries)
+	{
+		json & j = root["entries"][key];
+		j["stage"]		= entry.stage;
+		j["resized"]	= entry.resized;
+		j["seed"]		= entry.seed;
+		j["outputs"]	= json::array();
+		for (const auto & output : entry.outputs)
+		{
+			json o = {{"filename", output.filename}, {"annotations", output.annotations}};
+			for (const auto & [class_idx, count] : output.dropped)
+			{
+				o["dropped"][std::to_string(class_idx)] = count;
+			}
+			j["outputs"].push_back(o);
+
+			referenced.insert(output.filename);
+			referenced.insert(File(output.filename).withFileExtension(".txt").getFullPathName().toStdString());
+		}
+	}
+
+	// anything in the stage directories which is not referenced by the manifest is an orphan from a previous export
+	size_t orphans = 0;
+	for (const auto & stage : {"resize", "tiles", "zoom"})
+	{
+		File dir = File(cache_dir).getChildFile(stage);
+		if (dir.isDirectory() == false)
+		{
+			continue;
+		}
+
+		for (auto dir_entry : RangedDirectoryIterator(dir, false, "*", File::findFiles))
+		{
+			File f = dir_entry.getFile();
+			const std::string filename = f.getFullPathName().toStdString();
+			if (referenced.count(filename) == 0 and stage_logs.count(f.getFileName().toStdString()) == 0)
+			{
+				f.deleteFile();
+				orphans ++;
+			}
+		}
+	}
+
+	std::ofstream ofs(manifest_filename);
+	ofs << root.dump(1, '\t') << std::endl;
+
+	Log("image cache: " + std::to_string(hits) + " re-used, " + std::to_string(misses) + " generated, " + std::to_string(orphans) + " orphaned files deleted, " + std::to_string(current_entries.size()) + " entries saved to " + manifest_filename);
+
+	return orphans;
+}
+
+
+size_t dm::ImageCache::number_of_hits() const
+{
+	std::lock_guard lock(mutex);
+
+	return hits;
+}
+
+
+size_t dm::ImageCache::number_of_misses() const
+{
+	std::lock_guard lock(mutex);
+
+	return misses;
+}
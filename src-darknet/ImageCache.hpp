@@ -0,0 +1,113 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+
+
+namespace dm
+{
+	/** Keeps track of the images created in @p darkmark_image_cache when the Darknet files are generated.  Every set of
+	 * outputs is keyed by a hash of the source image, its annotations, and the settings used to create the outputs.  When
+	 * none of these have changed since the previous export, the existing outputs are re-used instead of decoding and
+	 * re-encoding the image.  Outputs which are no longer referenced are deleted when the manifest is saved.
+	 *
+	 * The manifest is stored as @p darkmark_image_cache/manifest.json, along with the master seed used to create the
+	 * random number streams.  All methods are thread-safe.
+	 */
+	class ImageCache final
+	{
+		public:
+
+			/// The number of annotations dropped because they were too small, indexed by class.
+			using DroppedAnnotations = std::map<int, size_t>;
+
+			/// A single image created in the cache, and the number of annotations written to the corresponding .txt file.
+			struct Output
+			{
+				std::string filename;
+				size_t annotations;
+				DroppedAnnotations dropped;
+			};
+			using Outputs = std::vector<Output>;
+
+			/// All of the images created from one source image by one of the stages (@p "resize", @p "tiles", or @p "zoom").
+			struct Entry
+			{
+				std::string stage;
+				bool resized;		///< Only used by the resize stage to remember if the image had to be resized.
+				uint64_t seed;		///< The seed of the random number stream used to create the outputs.
+				Outputs outputs;
+			};
+
+			/// Load the existing manifest (if any) from @p darkmark_image_cache in the given project directory.
+			ImageCache(const std::string & project_dir);
+
+			/// The directory where the outputs for the given stage are stored.  The directory is created if necessary.
+			std::string stage_directory(const std::string & stage) const;
+
+			/** Get the MD5 hash of the source image.  The image file is only read if the size or timestamp of the file has
+			 * changed since the last time it was hashed.
+			 */
+			std::string source_hash(const std::string & filename);
+
+			/** Get the MD5 hash of the source image, but only if it is already known from the previous manifest and the file
+			 * has not changed.  Unlike @ref source_hash() this never reads the image file.
+			 */
+			bool known_source_hash(const std::string & filename, std::string & md5) const;
+
+			/// Combine all of the parts which determine the content of the outputs into a single key.
+			static std::string key(const std::string & stage, const std::string & source_hash, const std::string & annotation_hash, const std::string & parameters);
+
+			/** Look up the key in the manifest.  This only returns @p true if all of the output images and .txt files still
+			 * exist on disk, in which case @p entry is set to the previous outputs.
+			 */
+			bool find(const std::string & key, Entry & entry);
+
+			/// Remember the outputs which were created for this key.
+			void add(const std::string & key, const Entry & entry);
+
+			/// Remember the master seed so it is recorded in the manifest.
+			void set_master_seed(const uint64_t seed);
+
+			/** Save the manifest, keeping only the keys which were used or added since the cache was loaded.  Any files in
+			 * the stage directories which are no longer referenced are deleted.
+			 * @returns The number of orphaned files which were deleted.
+			 */
+			size_t save();
+
+			/// The number of keys which were found in the cache and re-used.
+			size_t number_of_hits() const;
+
+			/// The number of keys which had to be generated.
+			size_t number_of_misses() const;
+
+		private:
+
+			/// What we remember about each source image so it doesn't need to be hashed again.
+			struct Source
+			{
+				int64 size;
+				int64 timestamp;
+				std::string md5;
+			};
+
+			mutable std::mutex mutex;
+
+			const std::string cache_dir;
+			const std::string manifest_filename;
+
+			/// Sources and keys as loaded from the previous manifest.
+			std::map<std::string, Source> previous_sources;
+			std::map<std::string, Entry> previous_entries;
+
+			/// Sources and keys seen since the cache was loaded.  These are the only ones kept when the manifest is saved.
+			std::map<std::string, Source> current_sources;
+			std::map<std::string, Entry> current_entries;
+
+			uint64_t master_seed;
+
+			size_t hits;
+			size_t misses;
+	};
+}
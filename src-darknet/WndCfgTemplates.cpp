@@ -2,6 +2,9 @@
 
 #include "DarkMark.hpp"
 
+#include "json.hpp"
+using json = nlohmann::json;
+
 
 /** Any timestamp prior to this will be considered "old"
  * - yolov2 is 2018-03
@@ -265,27 +268,70 @@ std::string get_command_output(const std::string & cmd)
 }
 
 
-void dm::WndCfgTemplates::run()
+namespace
 {
-	File dir = File(cfg().getValue("darknet_templates"));
-	auto files = dir.findChildFiles(File::TypesOfFileToFind::findFiles, true, "*.cfg");
-	std::sort(files.begin(), files.end(),
-			[](const File & lhs, const File & rhs)
+	/// Fields which are read from the .cfg files or from git, and which are remembered between runs.
+	const auto cached_fields =
+	{
+		dm::WndCfgTemplates::Fields::kLines,
+		dm::WndCfgTemplates::Fields::kLayers,
+		dm::WndCfgTemplates::Fields::kYoloLayers,
+		dm::WndCfgTemplates::Fields::kNetworkSize,
+		dm::WndCfgTemplates::Fields::kLastModified,
+		dm::WndCfgTemplates::Fields::kLastCommitName
+	};
+
+
+	File template_cache_file()
+	{
+		return dm::cfg().getFile().getSiblingFile("DarkMark_cfg_templates.json");
+	}
+
+
+	json load_template_cache()
+	{
+		json cache = json::object();
+
+		File f = template_cache_file();
+		if (f.existsAsFile())
+		{
+			try
 			{
-				// perform a case-insensitive comparison on the filename only (ignore the path)
-				return lhs.getFileName().toUpperCase() < rhs.getFileName().toUpperCase();
-			});
+				cache = json::parse(f.loadFileAsString().toStdString());
+			}
+			catch (const std::exception & e)
+			{
+				dm::Log("ignoring invalid configuration template cache " + f.getFullPathName().toStdString() + ": " + e.what());
+				cache = json::object();
+			}
+		}
 
-	for (const auto & file : files)
+		if (cache.is_object() == false or cache.contains("files") == false or cache["files"].is_object() == false)
+		{
+			cache = json::object();
+			cache["files"] = json::object();
+		}
+
+		return cache;
+	}
+
+
+	void save_template_cache(const json & cache)
 	{
-		if (threadShouldExit())
+		File f = template_cache_file();
+		if (f.replaceWithText(cache.dump(1, '\t')) == false)
 		{
-			break;
+			dm::Log("failed to save the configuration template cache " + f.getFullPathName().toStdString());
 		}
 
-		Row row;
-		row.field[Fields::kName		] = file.getFileName()		.toStdString();
-		row.field[Fields::kFullPath	] = file.getFullPathName()	.toStdString();
+		return;
+	}
+
+
+	/// Count the lines, layers, and YOLO layers in a .cfg file, and find the network dimensions.
+	void parse_template(const File & file, dm::WndCfgTemplates::Row & row)
+	{
+		using Fields = dm::WndCfgTemplates::Fields;
 
 		StringArray lines;
 		file.readLines(lines);
@@ -297,15 +343,10 @@ void dm::WndCfgTemplates::run()
 		bool look_for_width_and_height	= true;
 		for (const auto & line : lines)
 		{
-			if (threadShouldExit())
-			{
-				break;
-			}
 			number_of_lines ++;
 
 			if (line.startsWith("["))
 			{
-//				Log(file.getFileName().toStdString() + " #" + std::to_string(number_of_lines) + ": " + line.toStdString());
 				number_of_layers ++;
 				if (line.startsWithIgnoreCase("[yolo"))
 				{
@@ -331,6 +372,8 @@ void dm::WndCfgTemplates::run()
 		}
 		row.field[Fields::kLines	] = std::to_string(number_of_lines);
 		row.field[Fields::kLayers	] = std::to_string(number_of_layers - 1);
+		row.field[Fields::kYoloLayers	] = "";
+		row.field[Fields::kNetworkSize	] = "";
 
 		if (number_of_yolo_layers)
 		{
@@ -342,42 +385,170 @@ void dm::WndCfgTemplates::run()
 			row.field[Fields::kNetworkSize] = std::to_string(network_width) + "x" + std::to_string(network_height);
 		}
 
-		table_content_all.push_back(row);
+		// these come from git, and are set once all the files have been parsed
+		row.field[Fields::kLastModified		] = "";
+		row.field[Fields::kLastCommitName	] = "";
+
+		return;
 	}
+}
 
-	size_t rows_without_git_information = 0;
 
-	// get more details on each row in the table
-	for (auto & row : table_content_all)
+void dm::WndCfgTemplates::run()
+{
+	File dir = File(cfg().getValue("darknet_templates"));
+	auto files = dir.findChildFiles(File::TypesOfFileToFind::findFiles, true, "*.cfg");
+	std::sort(files.begin(), files.end(),
+			[](const File & lhs, const File & rhs)
+			{
+				// perform a case-insensitive comparison on the filename only (ignore the path)
+				return lhs.getFileName().toUpperCase() < rhs.getFileName().toUpperCase();
+			});
+
+	json cache = load_template_cache();
+	json & cached_files = cache["files"];
+
+	// only the templates which are new or which have been modified since the last time need to be parsed
+	table_content_all.resize(static_cast<size_t>(files.size()));
+	std::vector<size_t> rows_to_parse;
+	for (size_t idx = 0; idx < table_content_all.size(); idx ++)
 	{
-		if (threadShouldExit())
+		const File & file = files[idx];
+		Row & row = table_content_all[idx];
+		row.field[Fields::kName		] = file.getFileName()		.toStdString();
+		row.field[Fields::kFullPath	] = file.getFullPathName()	.toStdString();
+
+		const auto iter = cached_files.find(row.field[Fields::kFullPath]);
+		if (iter != cached_files.end() and
+			iter->is_object() and
+			iter->value("modified"	, int64_t(0)) == file.getLastModificationTime().toMilliseconds() and
+			iter->value("size"		, int64_t(-1)) == file.getSize())
 		{
-			break;
+			for (const auto field : cached_fields)
+			{
+				row.field[field] = iter->value(std::to_string(field), "");
+			}
 		}
+		else
+		{
+			rows_to_parse.push_back(idx);
+		}
+	}
 
-		// now try to run the "git" command against each .cfg file to see if we can get some details on each one
-		//
-		// output should look similar to this:
+	WorkPool::Tasks tasks;
+	for (const size_t idx : rows_to_parse)
+	{
+		tasks.push_back(
+			[&, idx](const size_t worker_idx)
+			{
+				parse_template(files[idx], table_content_all[idx]);
+			});
+	}
+	auto job = work_pool().submit("cfg templates", tasks);
+	job->wait(
+		[&](const double fraction)
+		{
+			if (threadShouldExit())
+			{
+				job->cancel();
+			}
+		});
+	if (job->is_cancelled())
+	{
+		return;
+	}
+
+	/* Instead of running "git log -1" once for each .cfg file, the history of the whole directory is read once, and the
+	 * most recent commit for each file is the first one where it shows up.  This only needs to be done again when one of
+	 * the files has changed or when the git repo has new commits.
+	 */
+	std::string git_prefix;
+	std::string git_head;
+	const StringArray git_info = StringArray::fromLines(get_command_output("git -C \"" + dir.getFullPathName().toStdString() + "\" rev-parse --show-prefix HEAD"));
+	if (git_info.size() >= 2 and git_info[1].trim().length() >= 40)
+	{
+		git_prefix	= git_info[0].trim().toStdString();
+		git_head	= git_info[1].trim().toStdString();
+	}
+
+	if (git_head.empty() == false and (rows_to_parse.empty() == false or cache.value("git_head", "") != git_head))
+	{
+		// output should look similar to this, where the filenames are relative to the root of the git repo:
 		//
-		//		2020-12-15 07:09:58 +0300 / AlexeyAB
+		//		@@@ 2020-12-15 07:09:58 +0300 / AlexeyAB
+		//		cfg/yolov4.cfg
+		//		cfg/yolov4-tiny.cfg
 		//
-		const std::string str = get_command_output("git -C \"" + dir.getFullPathName().toStdString() + "\" log -1 --pretty=\"format:%ci / %cn\" \"" + row.field[Fields::kFullPath] + "\"");
-		if (str.size() >= 10)
+		std::map<std::string, std::string> last_commits;
+		std::string commit;
+		const StringArray lines = StringArray::fromLines(get_command_output("git -C \"" + dir.getFullPathName().toStdString() + "\" -c core.quotePath=false log --pretty=\"format:@@@ %ci / %cn\" --name-only -- ."));
+		for (const auto & line : lines)
 		{
-			row.field[Fields::kLastModified] = str.substr(0, 10);
+			if (line.startsWith("@@@ "))
+			{
+				commit = line.substring(4).toStdString();
+			}
+			else if (line.isNotEmpty() and last_commits.count(line.toStdString()) == 0)
+			{
+				last_commits[line.toStdString()] = commit;
+			}
 		}
-		else
+
+		for (size_t idx = 0; idx < table_content_all.size(); idx ++)
+		{
+			Row & row = table_content_all[idx];
+			const std::string relative_name = git_prefix + files[idx].getRelativePathFrom(dir).replaceCharacter('\\', '/').toStdString();
+			const std::string str = (last_commits.count(relative_name) ? last_commits.at(relative_name) : "");
+			row.field[Fields::kLastModified		] = "";
+			row.field[Fields::kLastCommitName	] = "";
+			if (str.size() >= 10)
+			{
+				row.field[Fields::kLastModified] = str.substr(0, 10);
+			}
+
+			const auto pos = str.find(" / ");
+			if (pos != std::string::npos)
+			{
+				row.field[Fields::kLastCommitName] = str.substr(pos + 3);
+			}
+		}
+	}
+
+	size_t rows_without_git_information = 0;
+	for (size_t idx = 0; idx < table_content_all.size(); idx ++)
+	{
+		Row & row = table_content_all[idx];
+		if (git_head.empty() or row.field[Fields::kLastModified].empty() or row.field[Fields::kLastCommitName] == "unknown")
 		{
 			rows_without_git_information ++;
-			File f(row.field[Fields::kFullPath]);
-			row.field[Fields::kLastModified] = f.getLastModificationTime().formatted("%Y-%m-%d").toStdString();
-			row.field[Fields::kLastCommitName] = "unknown";
+			row.field[Fields::kLastModified		] = files[idx].getLastModificationTime().formatted("%Y-%m-%d").toStdString();
+			row.field[Fields::kLastCommitName	] = "unknown";
+		}
+	}
+
+	// remember everything which was read from the files and from git so the window opens quickly next time
+	cache = json::object();
+	cache["git_head"] = git_head;
+	cache["files"] = json::object();
+	for (size_t idx = 0; idx < table_content_all.size(); idx ++)
+	{
+		const Row & row = table_content_all[idx];
+		json & j = cache["files"][row.field[Fields::kFullPath]];
+		j["modified"]	= files[idx].getLastModificationTime().toMilliseconds();
+		j["size"]		= files[idx].getSize();
+		for (const auto field : cached_fields)
+		{
+			j[std::to_string(field)] = row.field[field];
 		}
+	}
+	save_template_cache(cache);
 
-		const auto pos = str.find(" / ");
-		if (pos != std::string::npos)
+	// get more details on each row in the table
+	for (auto & row : table_content_all)
+	{
+		if (threadShouldExit())
 		{
-			row.field[Fields::kLastCommitName] = str.substr(pos + 3);
+			break;
 		}
 
 		const std::string & short_name = row.field[Fields::kName];
@@ -1,126 +1,131 @@
 // DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <limits>
 #include <random>
 #include <string>
 #include <vector>
 #include <map>
-#include "yolo_anchors.hpp"
 #include "Tools.hpp"
+#include "yolo_anchors.hpp"
 
 
 typedef std::vector<int>	VInt;
 typedef std::vector<float>	VFloat;
 
 
-struct box_label
-{
-	int class_idx;
-	float x;
-	float y;
-	float w;
-	float h;
-};
-
-typedef std::vector<box_label> Boxes;
-
-
-struct matrix
+/** Widths and heights stored as two contiguous arrays instead of one array of structures.  The loops which compare every
+ * box against one of the clusters then walk through plain float arrays, which the compiler turns into SIMD instructions.
+ */
+struct WidthHeight
 {
-	size_t rows;
-	size_t cols;
-	VFloat vals;
+	VFloat w;
+	VFloat h;
 
-	matrix(const size_t r, const size_t c)
+	size_t size() const
 	{
-		rows = r;
-		cols = c;
-		vals = VFloat(std::max<size_t>(1lu, r * c), 0.0f);
-		return;
+		return w.size();
 	}
 
-	matrix() : matrix(0, 0)
+	void push_back(const float width, const float height)
 	{
+		w.push_back(width);
+		h.push_back(height);
 		return;
 	}
-
-	float & row_and_col(const size_t r, const size_t c)
-	{
-		if (rows == 0 or cols == 0)
-		{
-			throw std::invalid_argument("cannot get cell r=" + std::to_string(r) + " c=" + std::to_string(c) + " when rows=" + std::to_string(rows) + " and cols=" + std::to_string(cols));
-		}
-		if (r >= rows or c >= cols)
-		{
-			throw std::invalid_argument("invalid cell r=" + std::to_string(r) + " c=" + std::to_string(c) + " when rows=" + std::to_string(rows) + " and cols=" + std::to_string(cols));
-		}
-
-		return vals.at(r * cols + c);
-	}
-
-	float * row(const size_t r)
-	{
-		return & row_and_col(r, 0);
-	}
 };
 
 
-struct model
+/// The result of a single k-means run.
+struct KMeansResult
 {
-	VInt assignments;
-	matrix centers;
+	WidthHeight centers;
+	float avg_iou;
+	size_t iterations;
 };
 
 
-float dist(float *x, float *y, int n)
+/// IoU between a box and an anchor, where both are centered on the same point.
+inline float box_iou(const float box_w, const float box_h, const float anchor_w, const float anchor_h)
 {
-	float mw = (x[0] < y[0]) ? x[0] : y[0];
-	float mh = (x[1] < y[1]) ? x[1] : y[1];
-	float inter = mw * mh;
-	float sum = x[0] * x[1] + y[0] * y[1];
-	float un = sum - inter;
-	float iou = inter / un;
-
-	return 1.0f - iou;
+	const float min_w			= (box_w < anchor_w) ? box_w : anchor_w;
+	const float min_h			= (box_h < anchor_h) ? box_h : anchor_h;
+	const float box_intersect	= min_w * min_h;
+	const float box_union		= box_w * box_h + anchor_w * anchor_h - box_intersect;
+
+	return box_intersect / box_union;
 }
 
 
-VInt random_samples(const size_t maximum_number_of_samples)
+/** Update @p best_iou and @p assignments for one cluster.  There is no branch in the loop, so it is vectorized.  The
+ * distance used by k-means is @p 1-IoU, so the cluster with the best IoU is the closest cluster.
+ */
+void compare_with_cluster(const WidthHeight & boxes, const float anchor_w, const float anchor_h, const int cluster, VFloat & best_iou, VInt & assignments)
 {
-	VInt v;
-	v.reserve(maximum_number_of_samples);
-	while (v.size() < maximum_number_of_samples)
+	const size_t number_of_boxes	= boxes.size();
+	const float * const box_w		= boxes.w.data();
+	const float * const box_h		= boxes.h.data();
+	float * const best				= best_iou.data();
+	int * const assigned			= assignments.data();
+
+	for (size_t i = 0; i < number_of_boxes; i ++)
 	{
-		v.push_back(v.size());
+		const float iou		= box_iou(box_w[i], box_h[i], anchor_w, anchor_h);
+		const bool better	= iou > best[i];
+		best[i]				= better ? iou		: best[i];
+		assigned[i]			= better ? cluster	: assigned[i];
 	}
 
-	#if 0
-	//
-	// If using a stand-alone version of yolo anchors, you'll have to use this
-	// (or something similar) as your random number generator.
-	//
-	std::random_device rd;
-	std::mt19937 rng(rd());
-	#else
-	auto & rng = dm::get_random_engine();
-	#endif
+	return;
+}
 
-	std::shuffle(v.begin(), v.end(), rng);
 
-	return v;
+/** Assign every box to the closest cluster.
+ * @returns the number of boxes which are assigned to a different cluster than in @p previous_assignments.
+ */
+size_t kmeans_expectation(const WidthHeight & boxes, const WidthHeight & centers, VFloat & best_iou, VInt & assignments, const VInt & previous_assignments)
+{
+	std::fill(best_iou.begin(), best_iou.end(), -1.0f);
+	for (size_t j = 0; j < centers.size(); j ++)
+	{
+		compare_with_cluster(boxes, centers.w[j], centers.h[j], j, best_iou, assignments);
+	}
+
+	size_t changes = 0;
+	for (size_t i = 0; i < assignments.size(); i ++)
+	{
+		changes += (assignments[i] != previous_assignments[i] ? 1 : 0);
+	}
+
+	return changes;
 }
 
 
-void random_centers(matrix & data, matrix & centers)
+/// Move every cluster to the average size of the boxes assigned to it.  Clusters without any boxes are left as-is.
+void kmeans_maximization(const WidthHeight & boxes, const VInt & assignments, WidthHeight & centers)
 {
-	const VInt s = random_samples(data.rows);
-	for (size_t row = 0; row < centers.rows; row ++)
+	std::vector<double> sum_w(centers.size(), 0.0);
+	std::vector<double> sum_h(centers.size(), 0.0);
+	std::vector<size_t> counts(centers.size(), 0);
+
+	for (size_t i = 0; i < boxes.size(); i ++)
+	{
+		const int cluster = assignments[i];
+		sum_w[cluster] += boxes.w[i];
+		sum_h[cluster] += boxes.h[i];
+		counts[cluster] ++;
+	}
+
+	for (size_t j = 0; j < centers.size(); j ++)
 	{
-		for (size_t col = 0; col < data.cols; col ++)
+		if (counts[j])
 		{
-			centers.row_and_col(row, col) = data.row_and_col(s[row], col);
+			centers.w[j] = sum_w[j] / counts[j];
+			centers.h[j] = sum_h[j] / counts[j];
 		}
 	}
 
@@ -128,137 +133,432 @@ void random_centers(matrix & data, matrix & centers)
 }
 
 
-int closest_center(float *datum, matrix & centers)
+/** Choose the initial clusters with k-means++:  the first is a random box, and each of the following clusters is a box
+ * chosen with a probability proportional to the square of its distance to the closest cluster already chosen.  This
+ * spreads the clusters out from the start, which needs fewer iterations and fewer restarts than purely random clusters.
+ */
+WidthHeight kmeans_plus_plus(const WidthHeight & boxes, const size_t number_of_clusters, dm::SplitMix64 & rng, VFloat & best_iou, VInt & assignments)
 {
-	int best = 0;
-	float best_dist = dist(datum, centers.row(best), centers.cols);
-	for (size_t j = 0; j < centers.rows; ++j)
+	const size_t number_of_boxes = boxes.size();
+
+	WidthHeight centers;
+	std::uniform_int_distribution<size_t> uni(0, number_of_boxes - 1);
+	size_t idx = uni(rng);
+	centers.push_back(boxes.w[idx], boxes.h[idx]);
+
+	std::fill(best_iou.begin(), best_iou.end(), -1.0f);
+	while (centers.size() < number_of_clusters)
 	{
-		float new_dist = dist(datum, centers.row(j), centers.cols);
-		if (new_dist < best_dist)
+		const size_t cluster = centers.size() - 1;
+		compare_with_cluster(boxes, centers.w[cluster], centers.h[cluster], cluster, best_iou, assignments);
+
+		double total = 0.0;
+		for (size_t i = 0; i < number_of_boxes; i ++)
 		{
-			best_dist = new_dist;
-			best = j;
+			const double distance = 1.0 - best_iou[i];
+			total += distance * distance;
 		}
+
+		if (total <= 0.0)
+		{
+			// every box is identical to one of the clusters, so it doesn't matter which one we pick
+			idx = uni(rng);
+		}
+		else
+		{
+			std::uniform_real_distribution<double> uni_d(0.0, total);
+			const double target = uni_d(rng);
+			double cumulative = 0.0;
+			for (idx = 0; idx < number_of_boxes - 1; idx ++)
+			{
+				const double distance = 1.0 - best_iou[idx];
+				cumulative += distance * distance;
+				if (cumulative >= target)
+				{
+					break;
+				}
+			}
+		}
+
+		centers.push_back(boxes.w[idx], boxes.h[idx]);
 	}
 
-	return best;
+	return centers;
 }
 
 
-int kmeans_expectation(matrix & data, VInt & assignments, matrix & centers)
+/** Run k-means once, starting with k-means++ clusters chosen with the given seed.  The same boxes and seed always give
+ * the same result.
+ */
+KMeansResult do_kmeans(const WidthHeight & boxes, const size_t number_of_clusters, const uint64_t seed)
 {
-	int converged = 1;
-	for (size_t i = 0; i < data.rows; ++i)
+	const size_t max_iterations = 1000;
+
+	dm::SplitMix64 rng(seed);
+	VFloat best_iou(boxes.size(), -1.0f);
+	VInt assignments(boxes.size(), 0);
+	VInt previous_assignments(boxes.size(), -1);
+
+	KMeansResult result;
+	result.centers		= kmeans_plus_plus(boxes, number_of_clusters, rng, best_iou, assignments);
+	result.iterations	= 0;
+
+	while (true)
 	{
-		int closest = closest_center(data.row(i), centers);
-		if (closest != assignments[i])
+		const size_t changes = kmeans_expectation(boxes, result.centers, best_iou, assignments, previous_assignments);
+		if (changes == 0 or result.iterations >= max_iterations)
 		{
-			converged = 0;
+			break;
 		}
-		assignments[i] = closest;
+
+		kmeans_maximization(boxes, assignments, result.centers);
+		previous_assignments.swap(assignments);
+		result.iterations ++;
 	}
 
-	return converged;
+	// best_iou was calculated against the final clusters
+	double total_iou = 0.0;
+	for (const float iou : best_iou)
+	{
+		if (iou > 0.0f and iou < 1.0f)
+		{
+			total_iou += iou;
+		}
+	}
+	result.avg_iou = 100.0 * total_iou / static_cast<double>(boxes.size());
+
+	return result;
 }
 
 
-void kmeans_maximization(matrix & data, VInt & assignments, matrix & centers)
+/// The boxes read from some of the label files.
+struct LoadedBoxes
 {
-	matrix old_centers(centers.rows, centers.cols);
+	WidthHeight boxes;
+	VInt classes;	///< class of each box, or @p -1 if the class is unknown
+	VInt counter_per_class;
+};
 
-	VInt counts(centers.rows, 0);
 
-	for (size_t i = 0; i < centers.rows; ++i)
+/** Read the normalized width and height of every annotation in the label file.  Lines which cannot be parsed are
+ * skipped, as are boxes without a size since they would make the IoU undefined.
+ */
+void read_boxes(const std::string & filename, LoadedBoxes & loaded)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	if (not ifs.good())
 	{
-		for (size_t j = 0; j < centers.cols; ++j)
+		return;
+	}
+	const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	const char * p			= content.data();
+	const char * const end	= p + content.size();
+	while (p < end)
+	{
+		const char * eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+		if (eol == nullptr)
 		{
-			old_centers.row_and_col(i, j) = centers.row_and_col(i, j);
-			centers.row_and_col(i, j) = 0;
+			eol = end;
 		}
+
+		int class_idx	= -1;
+		float values[4]	= {0.0f, 0.0f, 0.0f, 0.0f};	// x, y, w, h
+		const bool valid = dm::parse_annotation(p, eol, class_idx, values);
+
+		if (valid and values[2] > 0.0f and values[3] > 0.0f)
+		{
+			if (class_idx >= 0 and static_cast<size_t>(class_idx) < loaded.counter_per_class.size())
+			{
+				loaded.counter_per_class[class_idx] ++;
+			}
+			else
+			{
+				class_idx = -1;
+			}
+			loaded.boxes.push_back(values[2], values[3]);
+			loaded.classes.push_back(class_idx);
+		}
+
+		p = eol + 1;
 	}
 
-	for (size_t i = 0; i < data.rows; ++i)
+	return;
+}
+
+
+/// Read the list of images, such as @p train.txt, skipping blank lines.
+dm::VStr read_image_list(const std::string & train_images_filename)
+{
+	dm::VStr image_filenames;
+	std::string path;
+	std::ifstream ifs(train_images_filename);
+	while (std::getline(ifs, path))
 	{
-		++counts[assignments[i]];
-		for (size_t j = 0; j < data.cols; ++j)
+		if (not path.empty())
 		{
-			centers.row_and_col(assignments[i], j) += data.row_and_col(i, j);
+			image_filenames.push_back(path);
 		}
 	}
 
-	for (size_t i = 0; i < centers.rows; ++i)
+	return image_filenames;
+}
+
+
+/** Read all of the label files for the images in @p image_filenames.  The files are read in parallel, and the boxes are
+ * then combined in the same order as the images so the result does not depend on the number of threads.  The boxes
+ * are normalized, and @p classes has the class of each box.
+ */
+void load_boxes(const dm::VStr & image_filenames, const size_t number_of_classes, dm::Progress & progress, WidthHeight & boxes, VInt & classes, VInt & counter_per_class)
+{
+	dm::VStr label_filenames;
+	label_filenames.reserve(image_filenames.size());
+	for (const auto & path : image_filenames)
 	{
-		if (counts[i])
+		// find the .txt label file that goes with this image file
+		std::string labelpath = path;
+		size_t pos = labelpath.rfind(".");
+		if (pos != std::string::npos)
 		{
-			for (size_t j = 0; j < centers.cols; ++j)
-			{
-				centers.row_and_col(i, j) /= counts[i];
-			}
+			labelpath.erase(pos);
 		}
+		labelpath += ".txt";
+		label_filenames.push_back(labelpath);
 	}
 
-	for (size_t i = 0; i < centers.rows; ++i)
+	const size_t files_per_task = 256;
+	std::vector<LoadedBoxes> loaded((label_filenames.size() + files_per_task - 1) / files_per_task);
+	dm::WorkPool::Tasks tasks;
+	for (size_t task_idx = 0; task_idx < loaded.size(); task_idx ++)
 	{
-		for (size_t j = 0; j < centers.cols; ++j)
+		tasks.push_back(
+			[&, task_idx](const size_t worker_idx)
+			{
+				LoadedBoxes & result = loaded[task_idx];
+				result.counter_per_class.resize(number_of_classes, 0);
+
+				const size_t last = std::min(label_filenames.size(), (task_idx + 1) * files_per_task);
+				for (size_t idx = task_idx * files_per_task; idx < last; idx ++)
+				{
+					read_boxes(label_filenames[idx], result);
+				}
+			});
+	}
+
+	auto job = dm::work_pool().submit("anchor boxes", tasks);
+	job->wait(
+		[&](const double fraction)
 		{
-			if(centers.row_and_col(i, j) == 0)
+			progress.set_progress(fraction);
+			if (progress.should_stop())
 			{
-				centers.row_and_col(i, j) = old_centers.row_and_col(i, j);
+				job->cancel();
 			}
+		});
+
+	if (job->is_cancelled())
+	{
+		throw std::runtime_error("reading the annotations was cancelled");
+	}
+
+	size_t number_of_boxes = 0;
+	for (const auto & result : loaded)
+	{
+		number_of_boxes += result.boxes.size();
+	}
+
+	boxes.w.clear();
+	boxes.h.clear();
+	classes.clear();
+	boxes.w.reserve(number_of_boxes);
+	boxes.h.reserve(number_of_boxes);
+	classes.reserve(number_of_boxes);
+	counter_per_class.assign(number_of_classes, 0);
+	for (auto & result : loaded)
+	{
+		boxes.w.insert(boxes.w.end(), result.boxes.w.begin(), result.boxes.w.end());
+		boxes.h.insert(boxes.h.end(), result.boxes.h.begin(), result.boxes.h.end());
+		classes.insert(classes.end(), result.classes.begin(), result.classes.end());
+		for (size_t i = 0; i < number_of_classes; i ++)
+		{
+			counter_per_class[i] += result.counter_per_class[i];
 		}
+
+		// release the memory as soon as possible, since there may be many millions of boxes
+		result = LoadedBoxes();
 	}
 
 	return;
 }
 
 
-model do_kmeans(matrix & data, const size_t number_of_clusters)
+/** Choose @p sample_size boxes using reservoir sampling.  Every box has the same chance of being chosen, and the same
+ * seed always chooses the same boxes.
+ */
+WidthHeight reservoir_sample(const WidthHeight & boxes, const size_t sample_size, const uint64_t seed)
 {
-	matrix centers(number_of_clusters, data.cols);
+	WidthHeight sample;
+	sample.w.assign(boxes.w.begin(), boxes.w.begin() + sample_size);
+	sample.h.assign(boxes.h.begin(), boxes.h.begin() + sample_size);
+
+	dm::SplitMix64 rng(seed);
+	for (size_t i = sample_size; i < boxes.size(); i ++)
+	{
+		std::uniform_int_distribution<size_t> uni(0, i);
+		const size_t j = uni(rng);
+		if (j < sample_size)
+		{
+			sample.w[j] = boxes.w[i];
+			sample.h[j] = boxes.h[i];
+		}
+	}
+
+	return sample;
+}
 
-	VInt assignments(data.rows, 0);
 
-	random_centers(data, centers);
+/** Calculate the average IoU of every box against the closest anchor, along with the standard deviation of the IoU.  The
+ * boxes are split into chunks which are processed in parallel, and the sums are combined in order.
+ */
+void iou_statistics(const WidthHeight & boxes, const WidthHeight & centers, double & average, double & standard_deviation)
+{
+	const size_t boxes_per_task = 1 << 20;
+	const size_t number_of_tasks = (boxes.size() + boxes_per_task - 1) / boxes_per_task;
+	std::vector<double> sums(number_of_tasks, 0.0);
+	std::vector<double> sums_of_squares(number_of_tasks, 0.0);
 
-	for (int i = 0; i < 1000 and not kmeans_expectation(data, assignments, centers); ++i)
+	dm::WorkPool::Tasks tasks;
+	for (size_t task_idx = 0; task_idx < number_of_tasks; task_idx ++)
 	{
-		kmeans_maximization(data, assignments, centers);
+		tasks.push_back(
+			[&, task_idx](const size_t worker_idx)
+			{
+				const size_t first	= task_idx * boxes_per_task;
+				const size_t last	= std::min(boxes.size(), first + boxes_per_task);
+
+				WidthHeight chunk;
+				chunk.w.assign(boxes.w.begin() + first, boxes.w.begin() + last);
+				chunk.h.assign(boxes.h.begin() + first, boxes.h.begin() + last);
+				VFloat best_iou(chunk.size(), -1.0f);
+				VInt assignments(chunk.size(), 0);
+				for (size_t j = 0; j < centers.size(); j ++)
+				{
+					compare_with_cluster(chunk, centers.w[j], centers.h[j], j, best_iou, assignments);
+				}
+
+				for (const float iou : best_iou)
+				{
+					// same as when the anchors are calculated:  ignore a perfect IoU
+					const double value = (iou > 0.0f and iou < 1.0f) ? iou : 0.0;
+					sums[task_idx]				+= value;
+					sums_of_squares[task_idx]	+= value * value;
+				}
+			});
 	}
 
-	model m;
-	m.assignments = assignments;
-	m.centers = centers;
+	dm::work_pool().submit("anchor IoU", tasks)->wait();
 
-	return m;
+	double sum				= 0.0;
+	double sum_of_squares	= 0.0;
+	for (size_t task_idx = 0; task_idx < number_of_tasks; task_idx ++)
+	{
+		sum				+= sums[task_idx];
+		sum_of_squares	+= sums_of_squares[task_idx];
+	}
+
+	const double count	= std::max(size_t(1), boxes.size());
+	average				= sum / count;
+	standard_deviation	= std::sqrt(std::max(0.0, sum_of_squares / count - average * average));
+
+	return;
 }
 
 
-Boxes read_boxes(const std::string & filename)
+/// Scale the normalized boxes to the network dimensions.
+WidthHeight scale_boxes(const WidthHeight & boxes, const size_t width, const size_t height)
 {
-	Boxes boxes;
-	boxes.reserve(20);
+	WidthHeight scaled;
+	scaled.w.resize(boxes.size());
+	scaled.h.resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i ++)
+	{
+		scaled.w[i] = boxes.w[i] * static_cast<float>(width);
+		scaled.h[i] = boxes.h[i] * static_cast<float>(height);
+	}
+
+	return scaled;
+}
 
-	std::ifstream ifs(filename);
-	ifs.imbue(std::locale("C"));
 
-	while (ifs.good())
+/** Run all of the k-means restarts for one set of boxes.  Every restart gets its own random number stream derived from
+ * the seed, so the results don't depend on the number of threads or on the order in which the restarts finish.
+ */
+void add_restarts(dm::WorkPool::Tasks & tasks, const WidthHeight & boxes, const size_t number_of_clusters, const uint64_t seed, std::vector<KMeansResult> & results)
+{
+	for (size_t restart = 0; restart < results.size(); restart ++)
 	{
-		box_label box;
-		ifs >> box.class_idx >> box.x >> box.y >> box.w >> box.h;
-		if (ifs.eof())
+		tasks.push_back(
+			[&boxes, &results, number_of_clusters, seed, restart](const size_t worker_idx)
+			{
+				results[restart] = do_kmeans(boxes, number_of_clusters, dm::SplitMix64::split(seed, restart));
+			});
+	}
+
+	return;
+}
+
+
+/// The restart with the best average IoU.  If two restarts have the same IoU then the first one wins.
+size_t best_restart(const std::vector<KMeansResult> & results)
+{
+	size_t best = 0;
+	for (size_t restart = 1; restart < results.size(); restart ++)
+	{
+		if (results[restart].avg_iou > results[best].avg_iou)
 		{
-			// ran into EOF, meaning we didn't read all 5 entries we need, don't use this entry!
-			break;
+			best = restart;
 		}
-		boxes.push_back(box);
 	}
 
-	return boxes;
+	return best;
 }
 
 
-void calc_anchors(const std::string & train_images_filename, const size_t number_of_clusters, const size_t width, const size_t height, const size_t number_of_classes, std::string & new_anchors, std::string & new_counters_per_class, float & new_avg_iou)
+/// Format the anchors the way they are written to the .cfg file, sorted from smallest to largest.
+std::string format_anchors(const WidthHeight & centers)
+{
+	// Store all the sizes in a multimap.  The key is the total area, and the value is the width+height stored as strings.
+	// This way the multimap will automatically sort all the values for us from smallest to largest, and all that we need
+	// to do is create the final string from all the values.
+	std::multimap<float, std::string> mm;
+	for (size_t row = 0; row < centers.size(); row ++)
+	{
+		const float w				= centers.w[row];
+		const float h				= centers.h[row];
+		const float area			= w * h;
+		const size_t round_width	= std::round(w);
+		const size_t round_height	= std::round(h);
+		const std::string text	= std::to_string(round_width) + ", " + std::to_string(round_height);
+		mm.insert(std::make_pair(area, text));
+	}
+
+	std::string anchors;
+	for (auto [key, val] : mm)
+	{
+		(void)key; // silence "unused variable" warning on older compilers (Ubuntu 18.04 and g++ 7.5.0)
+
+		if (not anchors.empty())
+		{
+			anchors += ", ";
+		}
+		anchors += val;
+	}
+
+	return anchors;
+}
+
+
+void calc_anchors(const std::string & train_images_filename, const size_t number_of_clusters, const size_t width, const size_t height, const size_t number_of_classes, const uint64_t seed, const size_t number_of_restarts, const size_t sample_size, dm::Progress & progress, std::string & new_anchors, std::string & new_counters_per_class, float & new_avg_iou)
 {
 	new_anchors				= "";
 	new_counters_per_class	= "";
@@ -274,115 +574,220 @@ void calc_anchors(const std::string & train_images_filename, const size_t number
 		throw std::invalid_argument("width and height must both be multiples of 32, and number_of_clusters must be greater than 1");
 	}
 
-	VFloat rel_width_height_array;
-	VInt counter_per_class(number_of_classes, 0);
-	size_t number_of_boxes = 0;
-	std::string path;
-	std::ifstream ifs(train_images_filename);
-	while (std::getline(ifs, path))
+	WidthHeight normalized_boxes;
+	VInt classes;
+	VInt counter_per_class;
+	load_boxes(read_image_list(train_images_filename), number_of_classes, progress, normalized_boxes, classes, counter_per_class);
+
+	// the boxes are normalized, so scale them to the network dimensions
+	const WidthHeight all_boxes = scale_boxes(normalized_boxes, width, height);
+	normalized_boxes = WidthHeight();
+
+	/* With many millions of boxes, k-means is run on a random sample.  The sample is more than enough to find the anchors,
+	 * and the average IoU reported is then calculated using all of the boxes.
+	 */
+	const bool use_sample = (sample_size > 0 and all_boxes.size() > sample_size);
+	const WidthHeight sampled_boxes = use_sample ? reservoir_sample(all_boxes, sample_size, dm::SplitMix64::split(seed, all_boxes.size())) : WidthHeight();
+	const WidthHeight & boxes = use_sample ? sampled_boxes : all_boxes;
+
+	const size_t number_of_boxes = boxes.size();
+	if (number_of_boxes == 0)
 	{
-		if (path.empty())
+		throw std::runtime_error("cannot calculate the anchors since there are no annotations in " + train_images_filename);
+	}
+
+	progress.set_progress(0.0);
+
+	// the restart with the best average IoU is kept
+	std::vector<KMeansResult> results(std::max(size_t(1), number_of_restarts));
+	dm::WorkPool::Tasks tasks;
+	add_restarts(tasks, boxes, number_of_clusters, seed, results);
+
+	auto job = dm::work_pool().submit("anchors", tasks);
+	job->wait(
+		[&](const double fraction)
 		{
-			continue;
-		}
+			progress.set_progress(fraction);
+			if (progress.should_stop())
+			{
+				job->cancel();
+			}
+		});
 
-		// find the .txt label file that goes with this image file
-		std::string labelpath = path;
-		size_t pos = labelpath.rfind(".");
-		if (pos != std::string::npos)
+	if (job->is_cancelled())
+	{
+		throw std::runtime_error("recalculating the anchors was cancelled");
+	}
+
+	const size_t best = best_restart(results);
+	const KMeansResult & anchors_data = results[best];
+	dm::Log("anchors: " + std::to_string(number_of_boxes) + " boxes, best of " + std::to_string(results.size()) + " restarts is #" + std::to_string(best) + " after " + std::to_string(anchors_data.iterations) + " iterations");
+
+	new_avg_iou = anchors_data.avg_iou;
+	if (use_sample)
+	{
+		// 95% confidence interval for the average IoU of all the boxes, as estimated from the sample
+		double sample_average		= 0.0;
+		double standard_deviation	= 0.0;
+		iou_statistics(boxes, anchors_data.centers, sample_average, standard_deviation);
+		const double confidence = 100.0 * 1.96 * standard_deviation / std::sqrt(static_cast<double>(number_of_boxes));
+
+		double average = 0.0;
+		iou_statistics(all_boxes, anchors_data.centers, average, standard_deviation);
+		new_avg_iou = 100.0 * average;
+
+		std::stringstream ss;
+		ss	<< std::fixed << std::setprecision(2)
+			<< "anchors: sampled " << number_of_boxes << " of " << all_boxes.size() << " boxes,"
+			<< " avg IoU of the sample is " << (100.0 * sample_average) << "% +/- " << confidence << "% (95% confidence),"
+			<< " avg IoU of all boxes is " << new_avg_iou << "%";
+		dm::Log(ss.str());
+	}
+
+	new_anchors = format_anchors(anchors_data.centers);
+
+	// now we figure out the values for counters_per_class
+
+	for (size_t i = 0; i < number_of_classes; i++)
+	{
+		if (i > 0)
 		{
-			labelpath.erase(pos);
+			new_counters_per_class += ", ";
 		}
-		labelpath += ".txt";
+		new_counters_per_class += std::to_string(counter_per_class[i]);
+	}
+
+	return;
+}
+
 
-		for (const auto & box : read_boxes(labelpath))
+std::vector<AnchorSweepResult> sweep_anchors(const dm::VStr & image_filenames, const std::vector<std::pair<size_t, size_t>> & network_sizes, const std::vector<size_t> & cluster_counts, const size_t number_of_classes, const uint64_t seed, const size_t number_of_restarts, const size_t sample_size, const int minimum_area, dm::Progress & progress, std::vector<size_t> & counter_per_class)
+{
+	for (const auto & [width, height] : network_sizes)
+	{
+		if (width < 32 or width % 32 or height < 32 or height % 32)
 		{
-			number_of_boxes ++;
-			counter_per_class[box.class_idx] ++;
-			rel_width_height_array.push_back(box.w * static_cast<float>(width));
-			rel_width_height_array.push_back(box.h * static_cast<float>(height));
+			throw std::invalid_argument("network sizes must be multiples of 32, but " + std::to_string(width) + "x" + std::to_string(height) + " was requested");
+		}
+	}
+	for (const auto number_of_clusters : cluster_counts)
+	{
+		if (number_of_clusters <= 1)
+		{
+			throw std::invalid_argument("the number of clusters must be greater than 1");
 		}
 	}
 
-	matrix boxes_data(number_of_boxes, 2);
-	for (size_t i = 0; i < number_of_boxes; ++i)
+	// the boxes are only read once, and then every configuration uses the same normalized boxes
+	WidthHeight normalized_boxes;
+	VInt classes;
+	VInt counters;
+	load_boxes(image_filenames, number_of_classes, progress, normalized_boxes, classes, counters);
+	if (normalized_boxes.size() == 0)
 	{
-		boxes_data.row_and_col(i, 0) = rel_width_height_array[i * 2 + 0];
-		boxes_data.row_and_col(i, 1) = rel_width_height_array[i * 2 + 1];
+		throw std::runtime_error("cannot calculate the anchors since none of the images have annotations");
 	}
+	counter_per_class.assign(counters.begin(), counters.end());
 
-	// K-means
-	model anchors_data = do_kmeans(boxes_data, number_of_clusters);
+	// same sample as calc_anchors(), so the current configuration gives the same anchors as when the .cfg file is created
+	const bool use_sample = (sample_size > 0 and normalized_boxes.size() > sample_size);
+	const WidthHeight sampled_boxes = use_sample ? reservoir_sample(normalized_boxes, sample_size, dm::SplitMix64::split(seed, normalized_boxes.size())) : WidthHeight();
+	const WidthHeight & normalized_sample = use_sample ? sampled_boxes : normalized_boxes;
 
-	// Store all the sizes in a multimap.  The key is the total area, and the value is the width+height stored as strings.
-	// This way the multimap will automatically sort all the values for us from smallest to largest, and all that we need
-	// to do is create the final string from all the values.
-	std::multimap<float, std::string> mm;
-	for (size_t row = 0; row < number_of_clusters; row ++)
+	// scale the boxes once for each network size; all of the cluster counts for that size then share the same boxes
+	std::vector<WidthHeight> scaled_boxes;
+	for (const auto & [width, height] : network_sizes)
 	{
-		const float w				= anchors_data.centers.row_and_col(row, 0);
-		const float h				= anchors_data.centers.row_and_col(row, 1);
-		const float area			= w * h;
-		const size_t round_width	= std::round(w);
-		const size_t round_height	= std::round(h);
-		const std::string text	= std::to_string(round_width) + ", " + std::to_string(round_height);
-		mm.insert(std::make_pair(area, text));
+		scaled_boxes.push_back(scale_boxes(normalized_sample, width, height));
 	}
-	for (auto [key, val] : mm)
-	{
-		(void)key; // silence "unused variable" warning on older compilers (Ubuntu 18.04 and g++ 7.5.0)
 
-		if (not new_anchors.empty())
+	const size_t restarts = std::max(size_t(1), number_of_restarts);
+	std::vector<AnchorSweepResult> sweep;
+	std::vector<std::vector<KMeansResult>> results(network_sizes.size() * cluster_counts.size(), std::vector<KMeansResult>(restarts));
+	dm::WorkPool::Tasks tasks;
+	for (size_t size_idx = 0; size_idx < network_sizes.size(); size_idx ++)
+	{
+		for (const auto number_of_clusters : cluster_counts)
 		{
-			new_anchors += ", ";
+			AnchorSweepResult result;
+			result.width				= network_sizes[size_idx].first;
+			result.height				= network_sizes[size_idx].second;
+			result.number_of_clusters	= number_of_clusters;
+			result.avg_iou				= 0.0f;
+			add_restarts(tasks, scaled_boxes[size_idx], number_of_clusters, seed, results[sweep.size()]);
+			sweep.push_back(result);
 		}
-		new_anchors += val;
 	}
 
-	// now we figure out the values for counters_per_class
-
-	float avg_iou = 0.0f;
-	for (size_t i = 0; i < number_of_boxes; ++i)
+	// the small annotations only depend on the network size, and are counted using all of the boxes
+	std::vector<std::vector<size_t>> small_per_class(network_sizes.size(), std::vector<size_t>(number_of_classes, 0));
+	for (size_t size_idx = 0; size_idx < network_sizes.size(); size_idx ++)
 	{
-		float box_w		= rel_width_height_array[i * 2 + 0];
-		float box_h		= rel_width_height_array[i * 2 + 1];
-		float min_dist	= std::numeric_limits<float>::max();
-		float best_iou	= 0.0f;
-		for (size_t j = 0; j < number_of_clusters; ++j)
+		tasks.push_back(
+			[&, size_idx](const size_t worker_idx)
+			{
+				const float width	= network_sizes[size_idx].first;
+				const float height	= network_sizes[size_idx].second;
+				auto & small		= small_per_class[size_idx];
+				for (size_t i = 0; i < normalized_boxes.size(); i ++)
+				{
+					// same rounding as when small annotations are dropped from the images
+					const int annotation_width	= std::round(width	* normalized_boxes.w[i]);
+					const int annotation_height	= std::round(height	* normalized_boxes.h[i]);
+					if (classes[i] >= 0 and annotation_width * annotation_height <= minimum_area)
+					{
+						small[classes[i]] ++;
+					}
+				}
+			});
+	}
+
+	progress.set_progress(0.0);
+	auto job = dm::work_pool().submit("anchor sweep", tasks);
+	job->wait(
+		[&](const double fraction)
 		{
-			const float anchor_w		= anchors_data.centers.row_and_col(j, 0);
-			const float anchor_h		= anchors_data.centers.row_and_col(j, 1);
-			const float min_w			= (box_w < anchor_w) ? box_w : anchor_w;
-			const float min_h			= (box_h < anchor_h) ? box_h : anchor_h;
-			const float box_intersect	= min_w * min_h;
-			const float box_union		= box_w * box_h + anchor_w * anchor_h - box_intersect;
-			const float iou				= box_intersect / box_union;
-			const float distance		= 1 - iou;
-			if (distance < min_dist)
+			progress.set_progress(fraction);
+			if (progress.should_stop())
 			{
-				min_dist = distance;
-				best_iou = iou;
+				job->cancel();
 			}
-		}
+		});
 
-		if (best_iou > 0.0f and best_iou < 1.0f)
-		{
-			avg_iou += best_iou;
-		}
+	if (job->is_cancelled())
+	{
+		throw std::runtime_error("the anchor sweep was cancelled");
 	}
 
-	for (size_t i = 0; i < number_of_classes; i++)
+	size_t result_idx = 0;
+	for (size_t size_idx = 0; size_idx < network_sizes.size(); size_idx ++)
 	{
-		if (i > 0)
+		// when k-means used a sample, the average IoU of each configuration is calculated again using all of the boxes
+		const WidthHeight all_boxes = use_sample ? scale_boxes(normalized_boxes, network_sizes[size_idx].first, network_sizes[size_idx].second) : WidthHeight();
+
+		for (size_t cluster_idx = 0; cluster_idx < cluster_counts.size(); cluster_idx ++)
 		{
-			new_counters_per_class += ", ";
+			AnchorSweepResult & result = sweep[result_idx];
+			const KMeansResult & best = results[result_idx][best_restart(results[result_idx])];
+			result.avg_iou			= best.avg_iou;
+			result.anchors			= format_anchors(best.centers);
+			result.small_per_class	= small_per_class[size_idx];
+
+			if (use_sample)
+			{
+				double average				= 0.0;
+				double standard_deviation	= 0.0;
+				iou_statistics(all_boxes, best.centers, average, standard_deviation);
+				result.avg_iou = 100.0 * average;
+			}
+
+			result_idx ++;
 		}
-		new_counters_per_class += std::to_string(counter_per_class[i]);
 	}
 
-	new_avg_iou = 100.0f * avg_iou / static_cast<float>(number_of_boxes);
+	dm::Log("anchor sweep: " + std::to_string(normalized_boxes.size()) + " boxes, " + std::to_string(sweep.size()) + " configurations, " + std::to_string(restarts) + " restarts each" + (use_sample ? ", k-means used a sample of " + std::to_string(normalized_sample.size()) + " boxes" : ""));
 
-	return;
+	return sweep;
 }
 
 
@@ -5,5 +5,36 @@
 /** The original @p calc_anchors() code from Darknet was taken from src/detector.c.  The code was then heavily modified
  * to bring it up to C++, remove memory leaks, cut out unneeded functionality, and remove all console output.  This new
  * function returns 3 values:  @p new_anchors, @p new_counters_per_class, and @p new_avg_iou.
+ *
+ * The label files are read in parallel, and then k-means is restarted @p number_of_restarts times in parallel, each
+ * time starting with k-means++ clusters.  The restart with the best average IoU is kept.  The result only depends on the
+ * annotations, the parameters, and the @p seed.
+ *
+ * When there are more than @p sample_size boxes, k-means only uses a random sample of that many boxes, which keeps the
+ * time needed more or less constant regardless of the size of the dataset.  The average IoU is still calculated using
+ * all of the boxes.  Set @p sample_size to zero to always use all of the boxes.
  */
-void calc_anchors(const std::string & train_images_filename, const size_t number_of_clusters, const size_t width, const size_t height, const size_t number_of_classes, std::string & new_anchors, std::string & new_counters_per_class, float & new_avg_iou);
+void calc_anchors(const std::string & train_images_filename, const size_t number_of_clusters, const size_t width, const size_t height, const size_t number_of_classes, const uint64_t seed, const size_t number_of_restarts, const size_t sample_size, dm::Progress & progress, std::string & new_anchors, std::string & new_counters_per_class, float & new_avg_iou);
+
+
+/// The anchors found by @ref sweep_anchors() for one combination of network size and number of clusters.
+struct AnchorSweepResult
+{
+	size_t width;
+	size_t height;
+	size_t number_of_clusters;
+	float avg_iou;						///< average IoU of all the boxes against the closest anchor, between 0 and 100
+	std::string anchors;				///< the anchors, formatted the same way as in the .cfg file
+	std::vector<size_t> small_per_class;	///< number of annotations in each class with an area of @p minimum_area pixels or less at this network size
+};
+
+/** Evaluate every combination of network size and number of clusters.  The label files are read only once, and then
+ * all of the k-means restarts for all of the configurations run in parallel from the same boxes.  Each configuration
+ * uses the same restarts, seed, and sample as @ref calc_anchors(), so the anchors are identical to those that would
+ * be written to the .cfg file for that configuration.
+ *
+ * @p counter_per_class is set to the number of annotations in each class.
+ *
+ * @returns one result for each configuration, ordered by network size and then by number of clusters.
+ */
+std::vector<AnchorSweepResult> sweep_anchors(const dm::VStr & image_filenames, const std::vector<std::pair<size_t, size_t>> & network_sizes, const std::vector<size_t> & cluster_counts, const size_t number_of_classes, const uint64_t seed, const size_t number_of_restarts, const size_t sample_size, const int minimum_area, dm::Progress & progress, std::vector<size_t> & counter_per_class);
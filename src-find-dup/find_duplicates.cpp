@@ -1,48 +1,1283 @@
 #include "DarkMark.hpp"
+#include <bitset>
+#include <numeric>
+#include <unordered_map>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+
+std::string find_oldest_file(const dm::SStr & filenames)
+{
+	Time t = Time::getCurrentTime();
+	std::string oldest_filename;
+
+	for (const auto & fn : filenames)
+	{
+		File f(fn);
+		if (f.getCreationTime() < t)
+		{
+			// this file is older, remember the time and name
+			t = f.getCreationTime();
+			oldest_filename = fn;
+		}
+	}
+
+	return oldest_filename;
+}
+
+
+/** How much of the start and of the end of a file is read to quickly rule out files which cannot be duplicates.  Files
+ * which are not larger than twice this size are read completely, so their partial checksum is also their full checksum.
+ */
+const int64 partial_checksum_size = 64 * 1024;
+
+
+/** Maximum number of bits out of 64 which may be different for 2 images to be considered similar.  Re-encoded and
+ * resized copies are usually within a few bits, while unrelated images are typically 32 bits apart.
+ */
+const int default_max_distance = 10;
+
+
+/// Total number of bytes read from disk while calculating the checksums.
+std::atomic<uint64_t> bytes_read = 0;
+
+
+/// The checksums which can be used to find exact duplicates.
+enum class EHash
+{
+	kXXH64,	///< 64-bit xxHash, which is much faster than MD5 (this is the default)
+	kMD5,	///< MD5, which is slower but can be compared with the output of other tools such as @p md5sum
+};
+
+
+/// Which checksum is used for the partial and full checksums.
+EHash hash_algorithm = EHash::kXXH64;
+
+
+/// The name of the checksum, which is also used to tell apart the checksums in the cache.
+std::string hash_algorithm_name()
+{
+	return (hash_algorithm == EHash::kMD5 ? "md5" : "xxh64");
+}
+
+
+/** Streaming implementation of the 64-bit xxHash algorithm.  This is not a cryptographic hash, but it is many times
+ * faster than MD5 and more than good enough to tell apart files, so the disks instead of the CPU become the limit.
+ */
+class XXH64
+{
+	public:
+
+		XXH64() :
+			acc{prime1 + prime2, prime2, 0, 0 - prime1},
+			total_length(0),
+			buffered(0)
+		{
+			return;
+		}
+
+		/// Add more data to the hash.  This can be called many times.
+		void update(const uint8_t * data, size_t length)
+		{
+			total_length += length;
+
+			if (buffered + length < 32)
+			{
+				std::memcpy(buffer + buffered, data, length);
+				buffered += length;
+				return;
+			}
+
+			if (buffered)
+			{
+				// complete the stripe which was started by the previous call
+				const size_t missing = 32 - buffered;
+				std::memcpy(buffer + buffered, data, missing);
+				process_stripe(buffer);
+				data += missing;
+				length -= missing;
+				buffered = 0;
+			}
+
+			while (length >= 32)
+			{
+				process_stripe(data);
+				data += 32;
+				length -= 32;
+			}
+
+			std::memcpy(buffer, data, length);
+			buffered = length;
+
+			return;
+		}
+
+		/// Get the hash of all the data as a 16-character hex string.
+		std::string digest() const
+		{
+			uint64_t h = prime5 + total_length;
+			if (total_length >= 32)
+			{
+				h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+				for (const auto v : acc)
+				{
+					h ^= round(0, v);
+					h = h * prime1 + prime4;
+				}
+				h += total_length;
+			}
+
+			const uint8_t * ptr = buffer;
+			size_t length = buffered;
+			while (length >= 8)
+			{
+				h ^= round(0, read64(ptr));
+				h = rotl(h, 27) * prime1 + prime4;
+				ptr += 8;
+				length -= 8;
+			}
+			if (length >= 4)
+			{
+				h ^= read32(ptr) * prime1;
+				h = rotl(h, 23) * prime2 + prime3;
+				ptr += 4;
+				length -= 4;
+			}
+			while (length > 0)
+			{
+				h ^= *ptr * prime5;
+				h = rotl(h, 11) * prime1;
+				ptr ++;
+				length --;
+			}
+
+			h ^= h >> 33;
+			h *= prime2;
+			h ^= h >> 29;
+			h *= prime3;
+			h ^= h >> 32;
+
+			std::stringstream ss;
+			ss << std::hex << std::setw(16) << std::setfill('0') << h;
+
+			return ss.str();
+		}
+
+	private:
+
+		static constexpr uint64_t prime1 = 11400714785074694791ULL;
+		static constexpr uint64_t prime2 = 14029467366897019727ULL;
+		static constexpr uint64_t prime3 =  1609587929392839161ULL;
+		static constexpr uint64_t prime4 =  9650029242287828579ULL;
+		static constexpr uint64_t prime5 =  2870177450012600261ULL;
+
+		static uint64_t rotl(const uint64_t value, const int bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
+
+		static uint64_t round(uint64_t value, const uint64_t input)
+		{
+			value += input * prime2;
+			value = rotl(value, 31);
+			value *= prime1;
+
+			return value;
+		}
+
+		// xxHash is defined using little-endian values, which is what all the platforms supported by DarkMark use
+		static uint64_t read64(const uint8_t * ptr)
+		{
+			uint64_t value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		static uint64_t read32(const uint8_t * ptr)
+		{
+			uint32_t value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		void process_stripe(const uint8_t * ptr)
+		{
+			for (size_t idx = 0; idx < 4; idx ++)
+			{
+				acc[idx] = round(acc[idx], read64(ptr + 8 * idx));
+			}
+
+			return;
+		}
+
+		uint64_t acc[4];
+		uint64_t total_length;
+		uint8_t buffer[32];
+		size_t buffered;
+};
+
+
+/** Calculate the checksum of a file.  The file is memory-mapped instead of being read through a stream, so the data is
+ * not copied and the OS can read ahead in large blocks.  When @p partial is set, only the first and last few KiB of
+ * the file are used, which is enough to quickly rule out most of the files which cannot be duplicates.
+ */
+std::string checksum_file(const std::string & fn, const bool partial)
+{
+	const File file(fn);
+	MemoryMappedFile mmf(file, MemoryMappedFile::readOnly);
+	const uint8_t * data = reinterpret_cast<const uint8_t *>(mmf.getData());
+	const int64 file_size = mmf.getSize();
+	if (data == nullptr and file.getSize() > 0)
+	{
+		throw std::runtime_error("failed to map " + fn);
+	}
+
+	// both ranges are used as-is for the hash; when the entire file is used, the 2nd range is empty
+	const bool entire_file = (not partial or file_size <= 2 * partial_checksum_size);
+	const int64 first_length = (entire_file ? file_size : partial_checksum_size);
+	const int64 second_start = file_size - partial_checksum_size;
+	const int64 second_length = (entire_file ? 0 : partial_checksum_size);
+
+#if JUCE_LINUX
+	if (data)
+	{
+		madvise(const_cast<uint8_t *>(data), file_size, entire_file ? MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+#endif
+
+	std::string checksum;
+	if (hash_algorithm == EHash::kMD5)
+	{
+		if (entire_file)
+		{
+			checksum = MD5(data, first_length).toHexString().toStdString();
+		}
+		else
+		{
+			MemoryBlock mb(data, first_length);
+			mb.append(data + second_start, second_length);
+			checksum = MD5(mb).toHexString().toStdString();
+		}
+	}
+	else
+	{
+		XXH64 xxh;
+		if (first_length)
+		{
+			xxh.update(data, first_length);
+		}
+		if (second_length)
+		{
+			xxh.update(data + second_start, second_length);
+		}
+		checksum = xxh.digest();
+	}
+	bytes_read += first_length + second_length;
+
+	return checksum;
+}
+
+
+/// Calculate the checksum of the first and last few KiB of a file.
+std::string partial_checksum(const std::string & fn, const int64 file_size)
+{
+	return checksum_file(fn, true);
+}
+
+
+/// Calculate the checksum of the entire file.
+std::string full_checksum(const std::string & fn, const int64 file_size)
+{
+	return checksum_file(fn, false);
+}
+
+
+/** Compare the content of 2 files byte-for-byte.  Matching checksums only mean the files are almost certainly the same,
+ * and the checksum may have come from the cache, so this is done right before a file is deleted or replaced.
+ */
+bool files_are_identical(const std::string & lhs, const std::string & rhs)
+{
+	const File lhs_file(lhs);
+	const File rhs_file(rhs);
+	const int64 file_size = lhs_file.getSize();
+	if (file_size != rhs_file.getSize())
+	{
+		return false;
+	}
+	if (file_size == 0)
+	{
+		return true;
+	}
+
+	MemoryMappedFile lhs_mmf(lhs_file, MemoryMappedFile::readOnly);
+	MemoryMappedFile rhs_mmf(rhs_file, MemoryMappedFile::readOnly);
+	if (lhs_mmf.getData() == nullptr or rhs_mmf.getData() == nullptr)
+	{
+		throw std::runtime_error("failed to map " + lhs + " and " + rhs);
+	}
+	if (static_cast<int64>(lhs_mmf.getSize()) != file_size or static_cast<int64>(rhs_mmf.getSize()) != file_size)
+	{
+		return false;
+	}
+
+	return std::memcmp(lhs_mmf.getData(), rhs_mmf.getData(), file_size) == 0;
+}
+
+
+/** Identifies the content of a file without reading it.  If the file is modified or replaced, then at least one of
+ * these values will change and the file needs to be read again.
+ */
+struct FileKey
+{
+	uint64_t	device;
+	uint64_t	inode;
+	int64		size;
+	int64		mtime_ns;
+
+	bool operator<(const FileKey & rhs) const
+	{
+		return std::tie(device, inode, size, mtime_ns) < std::tie(rhs.device, rhs.inode, rhs.size, rhs.mtime_ns);
+	}
+};
+
+
+/// The checksums remembered for a file.  Any of these may be empty if that checksum was never needed.
+struct CachedChecksums
+{
+	std::string algorithm;	///< see @ref hash_algorithm_name(), which applies to the partial and full checksums
+	std::string partial;
+	std::string full;
+	std::string perceptual;
+};
+
+
+/// All of the checksums remembered for the files in one of the directories.
+typedef std::map<FileKey, CachedChecksums> HashCache;
+
+
+/// Name of the file in each directory where the checksums are remembered between runs.
+const std::string hash_cache_filename = ".darkmark_hashes";
+
+
+/// Line written at the top of the cache file.  If the format or the checksums change, this must also change.
+const std::string hash_cache_header = "# DarkMark find_duplicates hash cache v2";
+
+
+/// The previous format did not have the name of the algorithm, since the checksums were always MD5.
+const std::string hash_cache_header_v1 = "# DarkMark find_duplicates hash cache v1";
+
+
+/// Get the device, inode, size, and modification time of a file.  @returns @p false if the file cannot be found.
+bool get_file_key(const std::string & fn, FileKey & key)
+{
+#ifdef WIN32
+	/* There are no inodes on Windows, and the modification time only has a resolution of 1 second.  Two different files
+	 * with the same size and time would have the same key, so the inode is left at zero which disables the cache.
+	 */
+	struct _stat64 st;
+	if (_stat64(fn.c_str(), &st) != 0)
+	{
+		return false;
+	}
+	key.device		= st.st_dev;
+	key.inode		= 0;
+	key.size		= st.st_size;
+	key.mtime_ns	= static_cast<int64>(st.st_mtime) * 1000000000;
+#else
+	struct stat st;
+	if (stat(fn.c_str(), &st) != 0)
+	{
+		return false;
+	}
+	key.device		= st.st_dev;
+	key.inode		= st.st_ino;
+	key.size		= st.st_size;
+	#if JUCE_MAC
+	key.mtime_ns	= static_cast<int64>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+	#else
+	key.mtime_ns	= static_cast<int64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	#endif
+#endif
+
+	return true;
+}
+
+
+/// Load the checksums remembered from the last time this directory was scanned.
+HashCache load_hash_cache(const std::string & dir_name)
+{
+	HashCache cache;
+
+	std::ifstream ifs(File(dir_name).getChildFile(hash_cache_filename).getFullPathName().toStdString());
+	std::string line;
+	if (not std::getline(ifs, line) or (line != hash_cache_header and line != hash_cache_header_v1))
+	{
+		// either the cache doesn't exist, or it was written by a different version
+		return cache;
+	}
+	const bool is_v1 = (line == hash_cache_header_v1);
+
+	while (std::getline(ifs, line))
+	{
+		// device, inode, size, mtime, algorithm (not in v1), partial checksum, full checksum, and the optional perceptual hash (checksums may be "-")
+		std::stringstream ss(line);
+		FileKey key;
+		CachedChecksums checksums;
+		checksums.algorithm = "md5";
+		if (ss >> key.device >> key.inode >> key.size >> key.mtime_ns and (is_v1 or ss >> checksums.algorithm) and ss >> checksums.partial >> checksums.full)
+		{
+			if (not (ss >> checksums.perceptual) or checksums.perceptual == "-")
+			{
+				checksums.perceptual = "";
+			}
+			if (checksums.algorithm != hash_algorithm_name())
+			{
+				// these checksums cannot be compared with the ones calculated this time, but the perceptual hash is still valid
+				checksums.partial	= "";
+				checksums.full		= "";
+			}
+			if (checksums.partial == "-")
+			{
+				checksums.partial = "";
+			}
+			if (checksums.full == "-")
+			{
+				checksums.full = "";
+			}
+			if (key.inode != 0)
+			{
+				cache[key] = checksums;
+			}
+		}
+	}
+
+	return cache;
+}
+
+
+/// Save the checksums so the next scan of this directory doesn't need to read the same files again.
+void save_hash_cache(const std::string & dir_name, const HashCache & cache)
+{
+	File f = File(dir_name).getChildFile(hash_cache_filename);
+	File tmp = f.getSiblingFile(hash_cache_filename + ".tmp");
+
+	if (true)
+	{
+		std::ofstream ofs(tmp.getFullPathName().toStdString(), std::ofstream::trunc);
+		ofs << hash_cache_header << std::endl;
+		for (const auto & [key, checksums] : cache)
+		{
+			ofs	<< key.device
+				<< "\t" << key.inode
+				<< "\t" << key.size
+				<< "\t" << key.mtime_ns
+				<< "\t" << hash_algorithm_name()
+				<< "\t" << (checksums.partial.empty()	? "-" : checksums.partial)
+				<< "\t" << (checksums.full.empty()		? "-" : checksums.full)
+				<< "\t" << (checksums.perceptual.empty()	? "-" : checksums.perceptual)
+				<< std::endl;
+		}
+
+		if (ofs.fail())
+		{
+			std::cout << "ERROR: failed to write the checksums to " << tmp.getFullPathName() << std::endl;
+			tmp.deleteFile();
+			return;
+		}
+	}
+
+	// replace the old cache only once the new one has been completely written
+	if (not tmp.moveFileTo(f))
+	{
+		std::cout << "ERROR: failed to replace " << f.getFullPathName() << std::endl;
+		tmp.deleteFile();
+	}
+
+	return;
+}
+
+
+/** Calculate a checksum for each of the files.  Several threads are started, and each one takes the next file from the
+ * shared queue.  The largest files are started first so a few large videos don't keep one thread busy long after all
+ * the others have finished.  Files which cannot be read are not added to @p checksums.
+ */
+void calculate_checksums(const std::string & description, const std::vector<std::pair<std::string, int64>> & files, std::function<std::string(const std::string &, const int64)> checksum, dm::MStr & checksums)
+{
+	std::vector<size_t> queue(files.size());
+	std::iota(queue.begin(), queue.end(), 0);
+	std::stable_sort(queue.begin(), queue.end(),
+		[&](const size_t lhs, const size_t rhs)
+		{
+			return files[lhs].second > files[rhs].second;
+		});
+
+	std::vector<std::string> results(files.size());
+	std::atomic<size_t> next_file = 0;
+	std::atomic<size_t> file_counter = 0;
+	std::mutex mutex;
+	std::condition_variable finished;
+
+	const auto worker = [&]()
+	{
+		// many copies of this are started, each on a new thread
+		while (true)
+		{
+			const size_t queue_idx = next_file ++;
+			if (queue_idx >= queue.size())
+			{
+				break;
+			}
+			const size_t idx = queue[queue_idx];
+
+			const auto & [fn, file_size] = files[idx];
+			try
+			{
+				results[idx] = checksum(fn, file_size);
+			}
+			catch (const std::exception & e)
+			{
+				std::cout << "ERROR while processing " << fn << ": " << e.what() << std::endl;
+			}
+			if (++ file_counter == files.size())
+			{
+				std::lock_guard lock(mutex);
+				finished.notify_all();
+			}
+		}
+
+		return;
+	};
+
+	const size_t nproc = std::max(1U, std::thread::hardware_concurrency());
+	dm::VThreads threads;
+	for (size_t i = 0; i < std::min(nproc, files.size()); i ++)
+	{
+		threads.emplace_back(std::thread(worker));
+	}
+	if (true)
+	{
+		// wake up as soon as the last file is done, otherwise update the progress a few times per second
+		std::unique_lock lock(mutex);
+		while (not finished.wait_for(lock, std::chrono::milliseconds(250), [&]() { return file_counter == files.size(); }))
+		{
+			std::cout << "\r" << description << " " << (int)std::round(100.0f * file_counter / files.size()) << "% " << std::flush;
+		}
+	}
+	std::cout << "\r" << description << " 100%" << std::endl;
+	for (auto & t : threads)
+	{
+		t.join();
+	}
+
+	for (size_t idx = 0; idx < files.size(); idx ++)
+	{
+		if (not results[idx].empty())
+		{
+			checksums[files[idx].first] = results[idx];
+		}
+	}
+
+	return;
+}
+
+
+/** Print the number of annotations for this image.
+ * @returns the number of annotations, zero for a negative sample, or @p -1 if the image has no .txt file.
+ */
+int print_annotations(const std::string & fn)
+{
+	File f = File(fn).withFileExtension(".txt");
+	if (not f.existsAsFile())
+	{
+		return -1;
+	}
+
+	StringArray a;
+	f.readLines(a);
+	if (a.size() == 0)
+	{
+		std::cout << "\x1b[1;37m [negative sample]\x1b[0m";
+	}
+	else if (a.size() == 1)
+	{
+		std::cout << "\x1b[1;37m [1 annotation]\x1b[0m";
+	}
+	else
+	{
+		std::cout << "\x1b[1;37m [" << a.size() << " annotations]\x1b[0m";
+	}
+
+	return a.size();
+}
+
+
+/** Show all of the files which have the same checksum, and decide which of the copies are redundant.
+ * @returns each redundant file together with the copy of the same file which is kept.
+ */
+dm::MStr list_duplicates(const dm::MStr & all_files_and_md5s)
+{
+	// group the files by checksum in a single pass instead of looking through all the files for each duplicate checksum
+	std::map<std::string, dm::VStr> files_by_checksum;
+	for (const auto & [fn, md5] : all_files_and_md5s)
+	{
+		files_by_checksum[md5].push_back(fn);
+	}
+
+	size_t count_duplicate_checksums	= 0;
+	size_t count_duplicate_files		= 0;
+	for (const auto & [md5, filenames] : files_by_checksum)
+	{
+		if (filenames.size() > 1)
+		{
+			count_duplicate_checksums ++;
+			count_duplicate_files += filenames.size();
+		}
+	}
+	std::cout	<< "Number of duplicate checksums ............... " << count_duplicate_checksums << std::endl
+				<< "Number of duplicate files ................... " << count_duplicate_files << std::endl;
+
+	// list all duplicates
+	dm::MStr redundant_files;
+	for (const auto & [md5, filenames] : files_by_checksum)
+	{
+		if (filenames.size() < 2)
+		{
+			continue;
+		}
+
+		dm::SStr similar_files_without_annotations;
+		dm::SStr similar_files_with_annotations;
+		dm::SStr similar_files_negative_samples;
+
+		std::cout << std::endl << md5 << ":" << std::endl;
+		for (const auto & fn : filenames)
+		{
+			std::cout << "-> " << fn;
+
+			const int annotations = print_annotations(fn);
+			if (annotations < 0)
+			{
+				similar_files_without_annotations.insert(fn);
+			}
+			else if (annotations == 0)
+			{
+				similar_files_negative_samples.insert(fn);
+			}
+			else
+			{
+				similar_files_with_annotations.insert(fn);
+			}
+
+			std::cout << std::endl;
+		}
+
+		// see if we can tell the user which file needs to be deleted
+		dm::SStr files_to_delete;
+
+		if (similar_files_without_annotations.size() > 0 and (similar_files_with_annotations.size() > 0 or similar_files_negative_samples.size() > 0))
+		{
+			// first case -- if we have annotations, then all of the ones without annotations can be deleted
+			files_to_delete = similar_files_without_annotations;
+		}
+		else if (similar_files_negative_samples.size() > 0 and similar_files_with_annotations.size() == 0 and similar_files_without_annotations.size() == 0)
+		{
+			// next case -- we ONLY have negative samples, so keep the oldest file
+			files_to_delete = similar_files_negative_samples;
+			files_to_delete.erase(find_oldest_file(similar_files_negative_samples));
+		}
+		else if (similar_files_without_annotations.size() > 0 and similar_files_with_annotations.size() == 0 and similar_files_negative_samples.size() == 0)
+		{
+			// next case -- we ONLY have non-annotated versions of this file, in which case we'll keep the oldest file
+			files_to_delete = similar_files_without_annotations;
+			files_to_delete.erase(find_oldest_file(similar_files_without_annotations));
+		}
+
+		// remember which of the remaining copies is kept, since that is the file used when replacing copies with hardlinks
+		std::string file_to_keep;
+		for (const auto & fn : filenames)
+		{
+			if (files_to_delete.count(fn) == 0)
+			{
+				file_to_keep = fn;
+				break;
+			}
+		}
+		if (not file_to_keep.empty())
+		{
+			for (const auto & fn : files_to_delete)
+			{
+				redundant_files[fn] = file_to_keep;
+			}
+		}
+	}
+
+	std::cout << std::endl;
+
+	return redundant_files;
+}
+
+
+/// Show the commands which can be used to delete the redundant files and their annotations.
+void print_delete_commands(const dm::MStr & redundant_files)
+{
+	if (redundant_files.empty())
+	{
+		return;
+	}
+
+	std::cout << "\x1b[1;31mWARNING:  running the following commands will DELETE files from disk!\x1b[0m" << std::endl;
+
+	for (const auto & [fn, original] : redundant_files)
+	{
+		std::cout << "\x1b[1;33mrm \"" << fn << "\"\x1b[0m" << std::endl;
+
+		// see if we have annotation files to delete as well
+		for (const auto & ext : {".txt", ".json"})
+		{
+			File f = File(fn).withFileExtension(ext);
+			if (f.existsAsFile())
+			{
+				std::cout << "\x1b[1;33mrm \"" << f.getFullPathName() << "\"\x1b[0m" << std::endl;
+			}
+		}
+	}
+
+	std::cout
+		<< std::endl
+		<< "Number of simple source files to delete ..... " << redundant_files.size() << std::endl
+		<< "Use --apply to delete these files, or --hardlink to replace them with hardlinks to the copy which is kept." << std::endl
+		<< std::endl;
+
+	return;
+}
+
+
+/** Replace a file with a hardlink to @p original.  The link is created with a temporary name and then renamed over the
+ * file, so if anything fails the file is left as it was.
+ */
+void replace_with_hardlink(const std::filesystem::path & original, const std::filesystem::path & fn)
+{
+	const std::filesystem::path tmp = fn.string() + ".darkmark_tmp";
+
+	std::error_code ec;
+	std::filesystem::remove(tmp, ec);
+	std::filesystem::create_hard_link(original, tmp, ec);
+	if (ec)
+	{
+		throw std::filesystem::filesystem_error("failed to create a hardlink", original, tmp, ec);
+	}
+
+	std::filesystem::rename(tmp, fn, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmp);
+		throw std::filesystem::filesystem_error("failed to replace the file with a hardlink", tmp, fn, ec);
+	}
+
+	return;
+}
+
+
+/** Delete the redundant files, or replace them with hardlinks to the copy which is kept.  The undo manifest is written
+ * before anything is modified, and then updated once all the files have been processed.  Since the annotations are
+ * stored in the manifest, everything can be restored with @p --undo=... even when the files are deleted.  Each file is
+ * compared byte-for-byte with the copy which is kept before it is deleted or replaced.
+ */
+void apply_duplicate_actions(const dm::MStr & redundant_files, const std::map<std::string, FileKey> & file_keys, const bool hardlink)
+{
+	if (redundant_files.empty())
+	{
+		std::cout << "There are no redundant files." << std::endl;
+		return;
+	}
+
+	const std::string manifest_filename = File::getCurrentWorkingDirectory().getChildFile(Time::getCurrentTime().formatted("find_duplicates_undo_%Y-%m-%d_%H-%M-%S.json")).getFullPathName().toStdString();
+
+	json manifest;
+	manifest["timestamp"]	= Time::getCurrentTime().formatted("%Y-%m-%d %H:%M:%S %Z").toStdString();
+	manifest["action"]		= (hardlink ? "hardlink" : "delete");
+	manifest["checksum"]	= hash_algorithm_name();
+	manifest["files"]		= json::array();
+	for (const auto & [fn, original] : redundant_files)
+	{
+		json entry;
+		entry["file"]		= fn;
+		entry["original"]	= original;
+		entry["done"]		= false;
+		if (not hardlink)
+		{
+			// remember the annotations, since unlike the images there is no other copy of these files
+			for (const auto & ext : {".txt", ".json"})
+			{
+				File f = File(fn).withFileExtension(ext);
+				if (f.existsAsFile())
+				{
+					entry["annotations"][ext] = f.loadFileAsString().toStdString();
+				}
+			}
+		}
+		manifest["files"].push_back(entry);
+	}
+
+	const auto save_manifest = [&]()
+	{
+		std::ofstream ofs(manifest_filename);
+		ofs << manifest.dump(1, '\t') << std::endl;
+		if (ofs.fail())
+		{
+			throw std::runtime_error("failed to write the undo manifest " + manifest_filename);
+		}
+	};
+	save_manifest();
+	std::cout << "Undo manifest ............................... " << manifest_filename << std::endl;
+
+	// the files must not have been modified since the checksums were calculated
+	const auto get_unchanged_key = [&](const std::string & filename, FileKey & key)
+	{
+		if (not get_file_key(filename, key) or file_keys.count(filename) == 0)
+		{
+			return false;
+		}
+		const FileKey & old_key = file_keys.at(filename);
+		return not (key < old_key or old_key < key);
+	};
+
+	size_t files_done		= 0;
+	size_t files_skipped	= 0;
+	int64 bytes_reclaimed	= 0;
+	for (auto & entry : manifest["files"])
+	{
+		const std::string fn		= entry["file"];
+		const std::string original	= entry["original"];
+		try
+		{
+			FileKey key;
+			FileKey original_key;
+			if (not get_unchanged_key(fn, key) or not get_unchanged_key(original, original_key))
+			{
+				throw std::runtime_error("file was modified after the checksum was calculated");
+			}
+
+			if (hardlink)
+			{
+				if (key.device == original_key.device and key.inode == original_key.inode and key.inode != 0)
+				{
+					throw std::runtime_error("file is already a hardlink to " + original);
+				}
+				if (key.device != original_key.device)
+				{
+					throw std::runtime_error("file is not on the same filesystem as " + original);
+				}
+			}
+
+			if (not files_are_identical(fn, original))
+			{
+				throw std::runtime_error("file is not identical to " + original);
+			}
+
+			if (hardlink)
+			{
+				replace_with_hardlink(original, fn);
+			}
+			else
+			{
+				File(fn).deleteFile();
+				for (const auto & ext : {".txt", ".json"})
+				{
+					File(fn).withFileExtension(ext).deleteFile();
+				}
+			}
+
+			entry["done"] = true;
+			files_done ++;
+			bytes_reclaimed += key.size;
+		}
+		catch (const std::exception & e)
+		{
+			std::cout << "ERROR: skipped " << fn << ": " << e.what() << std::endl;
+			entry["error"] = e.what();
+			files_skipped ++;
+		}
+	}
+
+	save_manifest();
+
+	std::cout
+		<< (hardlink ? "Files replaced with hardlinks ............... " : "Files deleted ............................... ") << files_done << std::endl
+		<< "Files skipped ............................... " << files_skipped << std::endl
+		<< "Bytes reclaimed ............................. " << bytes_reclaimed << std::endl
+		<< "Undo with ................................... --undo=\"" << manifest_filename << "\"" << std::endl;
+
+	return;
+}
+
+
+/** Restore the files listed in an undo manifest.  Deleted files are copied back from the copy which was kept, along with
+ * their annotations.  Hardlinks are replaced with copies so the files are independent again.  This also works when the
+ * manifest is from a run which was interrupted.
+ */
+void undo_duplicate_actions(const std::string & manifest_filename)
+{
+	json manifest;
+	if (true)
+	{
+		std::ifstream ifs(manifest_filename);
+		if (not ifs.good())
+		{
+			throw std::invalid_argument("failed to open " + manifest_filename);
+		}
+		manifest = json::parse(ifs);
+	}
+
+	const bool hardlink = (manifest.value("action", "") == "hardlink");
+
+	size_t files_restored	= 0;
+	size_t files_skipped	= 0;
+	for (const auto & entry : manifest["files"])
+	{
+		const std::filesystem::path fn			= entry["file"].get<std::string>();
+		const std::filesystem::path original	= entry["original"].get<std::string>();
+
+		if (not entry.value("done", false))
+		{
+			/* The manifest is only updated once all the files have been processed, so if --apply or --hardlink was
+			 * interrupted, the files which were already deleted or linked are still marked as not done.  Look at the
+			 * files themselves to know which ones were modified.
+			 */
+			std::error_code ec;
+			const bool modified = (hardlink ? std::filesystem::equivalent(fn, original, ec) : not std::filesystem::exists(fn, ec));
+			if (not modified)
+			{
+				continue;
+			}
+		}
+
+		try
+		{
+			if (hardlink)
+			{
+				if (not std::filesystem::equivalent(fn, original))
+				{
+					throw std::runtime_error("file is no longer a hardlink to " + original.string());
+				}
+
+				// make a new copy of the file and rename it over the hardlink
+				const std::filesystem::path tmp = fn.string() + ".darkmark_tmp";
+				std::filesystem::copy_file(original, tmp, std::filesystem::copy_options::overwrite_existing);
+				std::filesystem::rename(tmp, fn);
+			}
+			else
+			{
+				if (std::filesystem::exists(fn))
+				{
+					throw std::runtime_error("file already exists");
+				}
+				std::filesystem::copy_file(original, fn);
 
+				if (entry.contains("annotations"))
+				{
+					for (const auto & [ext, content] : entry["annotations"].items())
+					{
+						const File f = File(fn.string()).withFileExtension(ext);
+						if (not f.existsAsFile())
+						{
+							f.replaceWithText(content.get<std::string>(), false, false, nullptr);
+						}
+					}
+				}
+			}
+			files_restored ++;
+		}
+		catch (const std::exception & e)
+		{
+			std::cout << "ERROR: skipped " << fn.string() << ": " << e.what() << std::endl;
+			files_skipped ++;
+		}
+	}
 
-std::string find_oldest_file(const dm::SStr & filenames)
+	std::cout
+		<< "Files restored .............................. " << files_restored << std::endl
+		<< "Files skipped ............................... " << files_skipped << std::endl;
+
+	return;
+}
+
+
+/** Calculate the 64-bit perceptual hash (pHash) of an image:  the image is scaled down to 32x32, and each bit says if
+ * one of the 8x8 lowest frequencies of the DCT is above or below the median.  Re-encoded, resized, and lightly cropped
+ * copies of an image only change a few of the bits.  JPEG images are decoded at a reduced size, which is much faster.
+ */
+std::string perceptual_hash(const std::string & fn, const int64 file_size)
 {
-	Time t = Time::getCurrentTime();
-	std::string oldest_filename;
+	cv::Mat mat = cv::imread(fn, cv::IMREAD_REDUCED_GRAYSCALE_4);
+	if (mat.empty() or mat.cols < 32 or mat.rows < 32)
+	{
+		mat = cv::imread(fn, cv::IMREAD_GRAYSCALE);
+	}
+	if (mat.empty())
+	{
+		throw std::runtime_error("failed to decode the image");
+	}
+	bytes_read += file_size;
 
-	for (const auto & fn : filenames)
+	cv::Mat small;
+	cv::resize(mat, small, cv::Size(32, 32), 0.0, 0.0, cv::INTER_AREA);
+	small.convertTo(small, CV_32F);
+	cv::Mat dct;
+	cv::dct(small, dct);
+
+	std::vector<float> values;
+	for (int y = 0; y < 8; y ++)
 	{
-		File f(fn);
-		if (f.getCreationTime() < t)
+		for (int x = 0; x < 8; x ++)
 		{
-			// this file is older, remember the time and name
-			t = f.getCreationTime();
-			oldest_filename = fn;
+			values.push_back(dct.at<float>(y, x));
 		}
 	}
 
-	return oldest_filename;
+	// the first value is the average brightness (DC) which is much larger than the rest, so it is ignored for the median
+	std::vector<float> sorted(values.begin() + 1, values.end());
+	std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+	const float median = sorted[sorted.size() / 2];
+
+	uint64_t hash = 0;
+	for (size_t idx = 0; idx < values.size(); idx ++)
+	{
+		if (values[idx] > median)
+		{
+			hash |= (uint64_t(1) << idx);
+		}
+	}
+
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+	return ss.str();
 }
 
 
-void find_md5(dm::MStr & filenames, std::atomic<size_t> & file_counter)
+/// The number of bits which are different between two hashes.
+int hamming_distance(const uint64_t lhs, const uint64_t rhs)
 {
-	// many copies of this are started, each on a new thread
+	return std::bitset<64>(lhs ^ rhs).count();
+}
 
-	std::string most_recent_filename = "?";
 
-	try
+/** Find the groups of similar hashes, where each hash in a group is at most @p max_distance bits away from at least one
+ * other hash in the group.  This uses multi-index hashing:  the 64-bit hashes are split into 4 chunks of 16 bits, and if
+ * 2 hashes are within @p max_distance bits then at least one of the chunks must be within @p max_distance/4 bits.  So
+ * only the hashes which share a nearby chunk are compared, instead of comparing every hash against every other hash.
+ */
+std::vector<std::vector<size_t>> find_similar_hashes(const std::vector<uint64_t> & hashes, const int max_distance)
+{
+	const size_t number_of_chunks	= 4;
+	const int chunk_distance		= max_distance / number_of_chunks;
+
+	const auto chunk = [](const uint64_t hash, const size_t idx) -> uint16_t
+	{
+		return (hash >> (16 * idx)) & 0xffff;
+	};
+
+	std::vector<std::unordered_map<uint16_t, std::vector<uint32_t>>> tables(number_of_chunks);
+	for (size_t idx = 0; idx < hashes.size(); idx ++)
 	{
-		for (auto & [fn, checksum] : filenames)
+		for (size_t chunk_idx = 0; chunk_idx < number_of_chunks; chunk_idx ++)
 		{
-			most_recent_filename = fn;
-			File f(fn);
-			MD5 md5(f);
-			filenames[fn] = md5.toHexString().toStdString();
-			file_counter ++;
+			tables[chunk_idx][chunk(hashes[idx], chunk_idx)].push_back(idx);
 		}
 	}
-	catch (const std::exception & e)
+
+	// every 16-bit value with at most "chunk_distance" bits set is a nearby chunk which needs to be looked up
+	std::vector<uint16_t> masks;
+	for (uint32_t mask = 0; mask <= 0xffff; mask ++)
+	{
+		if (static_cast<int>(std::bitset<16>(mask).count()) <= chunk_distance)
+		{
+			masks.push_back(mask);
+		}
+	}
+
+	// each thread looks for the neighbours of the next block of hashes
+	const size_t hashes_per_block = 1024;
+	std::atomic<size_t> next_block = 0;
+	std::mutex mutex;
+	std::vector<std::pair<size_t, size_t>> similar_pairs;
+	const auto worker = [&]()
+	{
+		std::vector<std::pair<size_t, size_t>> pairs;
+		std::vector<uint32_t> candidates;
+		while (true)
+		{
+			const size_t first = hashes_per_block * next_block ++;
+			if (first >= hashes.size())
+			{
+				break;
+			}
+
+			const size_t last = std::min(hashes.size(), first + hashes_per_block);
+			for (size_t idx = first; idx < last; idx ++)
+			{
+				candidates.clear();
+				for (size_t chunk_idx = 0; chunk_idx < number_of_chunks; chunk_idx ++)
+				{
+					const uint16_t value = chunk(hashes[idx], chunk_idx);
+					for (const auto mask : masks)
+					{
+						const auto iter = tables[chunk_idx].find(value ^ mask);
+						if (iter == tables[chunk_idx].end())
+						{
+							continue;
+						}
+						for (const auto other : iter->second)
+						{
+							// only look forward so each pair is only found once
+							if (other > idx)
+							{
+								candidates.push_back(other);
+							}
+						}
+					}
+				}
+
+				std::sort(candidates.begin(), candidates.end());
+				candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+				for (const auto other : candidates)
+				{
+					if (hamming_distance(hashes[idx], hashes[other]) <= max_distance)
+					{
+						pairs.push_back({idx, other});
+					}
+				}
+			}
+		}
+
+		std::lock_guard lock(mutex);
+		similar_pairs.insert(similar_pairs.end(), pairs.begin(), pairs.end());
+
+		return;
+	};
+
+	const size_t nproc = std::max(1U, std::thread::hardware_concurrency());
+	dm::VThreads threads;
+	for (size_t i = 0; i < nproc; i ++)
+	{
+		threads.emplace_back(std::thread(worker));
+	}
+	for (auto & t : threads)
+	{
+		t.join();
+	}
+
+	// union-find to combine the pairs into groups
+	std::vector<size_t> parent(hashes.size());
+	std::iota(parent.begin(), parent.end(), 0);
+	const std::function<size_t(size_t)> find_root = [&](size_t idx)
+	{
+		while (parent[idx] != idx)
+		{
+			parent[idx] = parent[parent[idx]];
+			idx = parent[idx];
+		}
+		return idx;
+	};
+	for (const auto & [lhs, rhs] : similar_pairs)
+	{
+		const size_t lhs_root = find_root(lhs);
+		const size_t rhs_root = find_root(rhs);
+		if (lhs_root != rhs_root)
+		{
+			parent[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+		}
+	}
+
+	std::map<size_t, std::vector<size_t>> groups;
+	for (const auto & [lhs, rhs] : similar_pairs)
+	{
+		groups[find_root(lhs)];
+	}
+	for (size_t idx = 0; idx < hashes.size(); idx ++)
+	{
+		const size_t root = find_root(idx);
+		if (groups.count(root))
+		{
+			groups[root].push_back(idx);
+		}
+	}
+
+	std::vector<std::vector<size_t>> results;
+	for (auto & [root, members] : groups)
+	{
+		results.push_back(members);
+	}
+
+	return results;
+}
+
+
+/** Show the groups of images which look the same even if they are not byte-for-byte identical.  The similarity of each
+ * image is compared to the first image in the group.  Nothing is deleted, since these are not exact copies.
+ */
+void list_near_duplicates(const dm::MStr & all_files, const dm::MStr & perceptual_hashes, const dm::MStr & file_directories, const int max_distance)
+{
+	dm::VStr filenames;
+	std::vector<uint64_t> hashes;
+	for (const auto & [fn, hash] : perceptual_hashes)
+	{
+		filenames.push_back(fn);
+		hashes.push_back(std::stoull(hash, nullptr, 16));
+	}
+
+	std::cout << "Looking for similar images .................. " << hashes.size() << " images with up to " << max_distance << " different bits" << std::endl;
+	const auto groups = find_similar_hashes(hashes, max_distance);
+
+	size_t count_similar_files		= 0;
+	size_t count_groups_with_dirs	= 0;
+	for (const auto & group : groups)
 	{
-		std::cout << "ERROR while processing " << most_recent_filename << ": " << e.what() << std::endl;
+		count_similar_files += group.size();
+
+		// similar images found in different directories may end up in both the training and validation images
+		dm::SStr directories;
+		for (const auto idx : group)
+		{
+			if (file_directories.count(filenames[idx]))
+			{
+				directories.insert(file_directories.at(filenames[idx]));
+			}
+		}
+		if (directories.size() > 1)
+		{
+			count_groups_with_dirs ++;
+		}
+
+		std::cout << std::endl << "similar images (" << group.size() << " files";
+		if (directories.size() > 1)
+		{
+			std::cout << "\x1b[1;31m, found in " << directories.size() << " different directories\x1b[0m";
+		}
+		std::cout << "):" << std::endl;
+
+		for (const auto idx : group)
+		{
+			const int distance = hamming_distance(hashes[group[0]], hashes[idx]);
+			std::cout << "-> " << filenames[idx] << " \x1b[1;36m[" << std::fixed << std::setprecision(1) << (100.0 * (64 - distance) / 64.0) << "% similar]\x1b[0m";
+			print_annotations(filenames[idx]);
+			std::cout << std::endl;
+		}
 	}
 
+	std::cout
+		<< std::endl
+		<< "Number of images checked .................... " << hashes.size() << " of " << all_files.size() << std::endl
+		<< "Number of groups of similar images .......... " << groups.size() << std::endl
+		<< "Number of similar images .................... " << count_similar_files << std::endl
+		<< "Groups which span several directories ....... " << count_groups_with_dirs << std::endl;
+
 	return;
 }
 
@@ -57,15 +1292,99 @@ int main(int argc, char * argv[])
 		{
 			std::cout
 				<< "Recursively check images in a dataset to find duplicates." << std::endl
-				<< "This uses the MD5 checksum of the image files, so only exact duplicates will be found." << std::endl
+				<< "By default this uses a checksum of the image files, so only exact duplicates will be found." << std::endl
+				<< "Use --perceptual to also find images which look the same but are stored differently." << std::endl
+				<< "The checksums are remembered in \"" << hash_cache_filename << "\" in each directory, so unmodified files are not read again." << std::endl
+				<< "" << std::endl
+				<< "Options:" << std::endl
+				<< "  --perceptual    Find images which look the same, such as re-encoded or resized copies, instead of exact duplicates." << std::endl
+				<< "  --distance=N    Number of bits out of 64 which may differ for images to be similar (default " << default_max_distance << ")." << std::endl
+				<< "  --hash=md5      Use MD5 checksums instead of the much faster 64-bit xxHash." << std::endl
+				<< "  --apply         Delete the redundant copies and their annotations instead of only listing the commands." << std::endl
+				<< "  --hardlink      Replace the redundant copies with hardlinks to the copy which is kept." << std::endl
+				<< "  --undo=FILE     Restore the files using the undo manifest written by --apply or --hardlink." << std::endl
 				<< "" << std::endl
 				<< "Example 1:  " << argv[0] << " ~/nn/cars/set_03/ ~/nn/cars/set_05/" << std::endl
-				<< "Example 2:  " << argv[0] << " ." << std::endl;
+				<< "Example 2:  " << argv[0] << " ." << std::endl
+				<< "Example 3:  " << argv[0] << " --perceptual ~/nn/cars/train/ ~/nn/cars/valid/" << std::endl;
 
 			throw std::invalid_argument("no subdirectory specified");
 		}
 
-		const dm::SStr extensions_of_interest =
+		bool perceptual		= false;
+		bool apply			= false;
+		bool hardlink		= false;
+		int max_distance	= default_max_distance;
+		std::string undo_manifest;
+		dm::VStr paths;
+		for (int i = 1; i < argc; i ++)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--perceptual")
+			{
+				perceptual = true;
+			}
+			else if (arg.find("--distance=") == 0)
+			{
+				max_distance = std::atoi(arg.substr(11).c_str());
+				if (max_distance < 0 or max_distance > 32)
+				{
+					throw std::invalid_argument("the distance must be between 0 and 32");
+				}
+			}
+			else if (arg == "--apply")
+			{
+				apply = true;
+			}
+			else if (arg == "--hardlink")
+			{
+				apply		= true;
+				hardlink	= true;
+			}
+			else if (arg.find("--undo=") == 0)
+			{
+				undo_manifest = arg.substr(7);
+			}
+			else if (arg == "--hash=md5")
+			{
+				hash_algorithm = EHash::kMD5;
+			}
+			else if (arg == "--hash=xxh64")
+			{
+				hash_algorithm = EHash::kXXH64;
+			}
+			else if (arg.find("--hash=") == 0)
+			{
+				throw std::invalid_argument("unknown checksum \"" + arg.substr(7) + "\" (must be \"xxh64\" or \"md5\")");
+			}
+			else
+			{
+				paths.push_back(arg);
+			}
+		}
+
+		if (not undo_manifest.empty())
+		{
+			undo_duplicate_actions(undo_manifest);
+			return 0;
+		}
+
+		if (apply and perceptual)
+		{
+			throw std::invalid_argument("similar images are never deleted automatically, so --apply cannot be combined with --perceptual");
+		}
+
+		// videos cannot be compared perceptually
+		const dm::SStr image_extensions =
+		{
+			".jpg",
+			".jpeg",
+			".gif",
+			".png",
+			".tiff",
+			".webp"
+		};
+		dm::SStr extensions_of_interest =
 		{
 			".jpg",
 			".jpeg",
@@ -81,6 +1400,10 @@ int main(int argc, char * argv[])
 			".mjpeg",
 			".mov"
 		};
+		if (perceptual)
+		{
+			extensions_of_interest = image_extensions;
+		}
 		std::cout << "File extensions to check ....................";
 		for (const auto & ext : extensions_of_interest)
 		{
@@ -90,11 +1413,12 @@ int main(int argc, char * argv[])
 
 		dm::SStr all_directories;
 		dm::MStr all_files_and_md5s;
+		dm::MStr file_directories;	// the directory in which each file was found, which is where the checksums are cached
 		size_t files_skipped = 0;
 
-		for (int i = 1; i < argc; i ++)
+		for (const auto & path : paths)
 		{
-			File f(argv[i]);
+			File f(path);
 			if (not f.exists())
 			{
 				throw std::invalid_argument("\"" + f.getFullPathName().toStdString() + "\" does not exist");
@@ -121,7 +1445,12 @@ int main(int argc, char * argv[])
 			{
 				if (extensions_of_interest.count(file.getFileExtension().toLowerCase().toStdString()) == 1)
 				{
-					all_files_and_md5s[file.getFullPathName().toStdString()] = "";
+					const std::string fn = file.getFullPathName().toStdString();
+					all_files_and_md5s[fn] = "";
+					if (file_directories.count(fn) == 0)
+					{
+						file_directories[fn] = dir_name;
+					}
 				}
 				else
 				{
@@ -130,195 +1459,224 @@ int main(int argc, char * argv[])
 			}
 		}
 
-		std::cout
-			<< "Files skipped (unknown extension) ........... " << files_skipped << std::endl
-			<< "Number of image and video files to verify ... " << all_files_and_md5s.size() << std::endl;
-
-		// split the set of files into multiple sets so we can get multiple threads working on this at the same time
-		size_t nproc = std::max(1U, std::thread::hardware_concurrency());
-		std::vector<dm::MStr> files_and_md5s(nproc);
-		int counter = 0;
-		for (const auto & [fn, md5] : all_files_and_md5s)
-		{
-			files_and_md5s[counter % nproc][fn] = "";
-			counter ++;
-		}
-		std::cout << "Number of threads to create ................. " << files_and_md5s.size() << " with " << files_and_md5s[0].size() << " files each" << std::endl;
-
-		// this is where we start the threads that will inspect each of the images
-
-		dm::VThreads threads;
-		std::atomic<size_t> file_counter = 0;
-		for (auto & s : files_and_md5s)
-		{
-			threads.emplace_back(std::thread(find_md5, std::ref(s), std::ref(file_counter)));
-		}
-		while (file_counter < all_files_and_md5s.size())
-		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(750));
-			std::cout << "\rCalculating the MD5 checksum of all files ... " << (int)std::round(100.0f * file_counter / all_files_and_md5s.size()) << "% " << std::flush;
-		}
-		std::cout << std::endl;
-		for (auto & t : threads)
+		/* Files can only be duplicates if they have exactly the same size.  Of the files which have the same size, only the
+		 * first and last few KiB are read, and only the files which still look the same are then read completely.  In a
+		 * large archive of videos most files have a unique size, so most of the files don't need to be read at all.
+		 */
+		std::map<std::string, HashCache> old_caches;
+		for (const auto & dir_name : all_directories)
 		{
-			t.join();
+			old_caches[dir_name] = load_hash_cache(dir_name);
 		}
 
-		// put the individual thread results back into a single map
-		for (auto & m : files_and_md5s)
+		/* Files which are already hardlinks to the same inode share their content and take no extra space, so they are
+		 * not duplicates.  Only the first name of each inode is compared with the other files, which also means the same
+		 * content is never read twice.
+		 */
+		std::map<std::string, FileKey> file_keys;
+		std::map<int64, dm::VStr> files_by_size;
+		std::set<std::pair<uint64_t, uint64_t>> inodes_seen;
+		size_t hardlinks_skipped = 0;
+		for (auto iter = all_files_and_md5s.begin(); iter != all_files_and_md5s.end(); )
 		{
-			for (const auto & [fn, md5] : m)
+			const std::string & fn = iter->first;
+			FileKey key;
+			if (not get_file_key(fn, key))
 			{
-				all_files_and_md5s[fn] = md5;
+				std::cout << "ERROR: failed to get the details of " << fn << std::endl;
+				iter ++;
+				continue;
+			}
+			if (key.inode != 0 and inodes_seen.insert({key.device, key.inode}).second == false)
+			{
+				hardlinks_skipped ++;
+				iter = all_files_and_md5s.erase(iter);
+				continue;
 			}
+			file_keys[fn] = key;
+			files_by_size[key.size].push_back(fn);
+			iter ++;
 		}
-		files_and_md5s.clear();
+		std::cout << "Hardlinks to files already seen (skipped) ... " << hardlinks_skipped << std::endl;
 
-		// now we look for duplicates
-		dm::SStr all_md5s;
-		dm::SStr duplicate_md5s;
-		size_t count_duplicate_files = 0;
-		for (auto & [fn, md5] : all_files_and_md5s)
+		// find the checksums which were calculated the last time this file was seen
+		const auto find_cached_checksums = [&](const std::string & fn) -> const CachedChecksums *
 		{
-			if ((all_md5s.size() == all_files_and_md5s.size() - 1) or
-				(all_md5s.size() % 100 == 0))
+			if (file_directories.count(fn) == 0 or file_keys.count(fn) == 0 or file_keys.at(fn).inode == 0)
 			{
-				std::cout << "\rLooking for duplicate MD5 checksums ......... " << (int)std::round(100.0f * all_md5s.size() / all_files_and_md5s.size()) << "% " << std::flush;
+				// without an inode the key does not uniquely identify the file, so the cache cannot be trusted
+				return nullptr;
 			}
-			if (all_md5s.count(md5) == 0)
+			const auto & cache = old_caches.at(file_directories.at(fn));
+			const auto iter = cache.find(file_keys.at(fn));
+			if (iter == cache.end())
 			{
-				all_md5s.insert(md5);
-				continue;
+				return nullptr;
 			}
+			return &iter->second;
+		};
 
-			// if we get here, then we have a duplicate!
-			count_duplicate_files ++;
-
-			if (duplicate_md5s.count(md5) == 0)
+		// use the cached checksums when possible, and return the list of files where the checksum still needs to be calculated
+		size_t cache_lookups	= 0;
+		size_t cache_hits		= 0;
+		const auto use_cached_checksums = [&](const std::vector<std::pair<std::string, int64>> & files, std::string CachedChecksums::* field, dm::MStr & checksums)
+		{
+			std::vector<std::pair<std::string, int64>> files_to_read;
+			for (const auto & file : files)
 			{
-				// this is a new duplicate (so count the origin as a duplicate as well)
-				count_duplicate_files ++;
-				duplicate_md5s.insert(md5);
+				cache_lookups ++;
+				const CachedChecksums * cached = find_cached_checksums(file.first);
+				const std::string checksum = (cached == nullptr ? "" : cached->*field);
+				if (checksum.empty())
+				{
+					files_to_read.push_back(file);
+				}
+				else
+				{
+					cache_hits ++;
+					checksums[file.first] = checksum;
+				}
 			}
-		}
-		std::cout << std::endl	<< "Number of duplicate MD5 checksums ........... " << duplicate_md5s.size() << std::endl
-								<< "Number of duplicate files ................... " << count_duplicate_files << std::endl;
 
-		// list all duplicates
-		dm::SStr simple_delete_solution;
-		for (const auto & duplicate_md5 : duplicate_md5s)
+			return files_to_read;
+		};
+
+		dm::MStr partial_md5s;
+		dm::MStr full_md5s;
+		dm::MStr perceptual_hashes;
+		if (perceptual)
 		{
-			dm::SStr similar_files_without_annotations;
-			dm::SStr similar_files_with_annotations;
-			dm::SStr similar_files_negative_samples;
+			// every image needs to be decoded, but the hashes of the images which have not changed are in the cache
+			std::vector<std::pair<std::string, int64>> images;
+			for (const auto & [fn, key] : file_keys)
+			{
+				images.push_back({fn, key.size});
+			}
 
-			std::cout << std::endl << duplicate_md5 << ":" << std::endl;
-			for (const auto & [fn, md5] : all_files_and_md5s)
+			std::cout
+				<< "Files skipped (unknown extension) ........... " << files_skipped << std::endl
+				<< "Number of images to compare ................. " << images.size() << std::endl;
+
+			calculate_checksums("Calculating perceptual hashes ...............", use_cached_checksums(images, &CachedChecksums::perceptual, perceptual_hashes), perceptual_hash, perceptual_hashes);
+		}
+		else
+		{
+			std::vector<std::pair<std::string, int64>> files_with_same_size;
+			for (const auto & [file_size, filenames] : files_by_size)
 			{
-				if (duplicate_md5 == md5)
+				if (filenames.size() > 1)
 				{
-					std::cout << "-> " << fn;
-
-					File f = File(fn).withFileExtension(".txt");
-					if (f.existsAsFile())
-					{
-						StringArray a;
-						f.readLines(a);
-						if (a.size() == 0)
-						{
-							std::cout << "\x1b[1;37m [negative sample]\x1b[0m";
-							similar_files_negative_samples.insert(fn);
-						}
-						else if (a.size() == 1)
-						{
-							std::cout << "\x1b[1;37m [1 annotation]\x1b[0m";
-							similar_files_with_annotations.insert(fn);
-						}
-						else
-						{
-							std::cout << "\x1b[1;37m [" << a.size() << " annotations]\x1b[0m";
-							similar_files_with_annotations.insert(fn);
-						}
-					}
-					else
+					for (const auto & fn : filenames)
 					{
-						similar_files_without_annotations.insert(fn);
+						files_with_same_size.push_back({fn, file_size});
 					}
-
-					std::cout << std::endl;
 				}
 			}
 
-#if 0
-			for (const auto & f : similar_files_negative_samples)		std::cout << "NEGATIVE SAMPLES: " << f << std::endl;
-			for (const auto & f : similar_files_with_annotations)		std::cout << "WITH ANNOTATIONS: " << f << std::endl;
-			for (const auto & f : similar_files_without_annotations)	std::cout << "ZERO ANNOTATIONS: " << f << std::endl;
-#endif
+			std::cout
+				<< "Files skipped (unknown extension) ........... " << files_skipped << std::endl
+				<< "Number of image and video files to verify ... " << all_files_and_md5s.size() << std::endl
+				<< "Files with a unique size (not read) ......... " << (all_files_and_md5s.size() - files_with_same_size.size()) << std::endl
+				<< "Files with the same size as another file .... " << files_with_same_size.size() << std::endl;
 
-			// see if we can tell the user which file needs to be deleted
+			calculate_checksums("Calculating partial " + hash_algorithm_name() + " checksums " + std::string(14 - hash_algorithm_name().size(), '.'), use_cached_checksums(files_with_same_size, &CachedChecksums::partial, partial_md5s), partial_checksum, partial_md5s);
 
-			if (similar_files_without_annotations.size() > 0 and (similar_files_with_annotations.size() > 0 or similar_files_negative_samples.size() > 0))
+			std::map<std::pair<int64, std::string>, dm::VStr> files_by_partial_md5;
+			for (const auto & [fn, file_size] : files_with_same_size)
 			{
-				// first case -- if we have annotations, then all of the ones without annotations can be deleted
-				for (const auto & fn : similar_files_without_annotations)
+				if (partial_md5s.count(fn))
 				{
-					simple_delete_solution.insert(fn);
+					files_by_partial_md5[{file_size, partial_md5s.at(fn)}].push_back(fn);
 				}
 			}
-			else if (similar_files_negative_samples.size() > 0 and similar_files_with_annotations.size() == 0 and similar_files_without_annotations.size() == 0)
-			{
-				// next case -- we ONLY have negative samples, so keep the oldest file
 
-				const std::string oldest_file_in_set = find_oldest_file(similar_files_negative_samples);
-				for (const auto & fn : similar_files_negative_samples)
+			// only the files which are still potential duplicates are kept
+			all_files_and_md5s.clear();
+			std::vector<std::pair<std::string, int64>> files_to_read_completely;
+			for (const auto & [key, filenames] : files_by_partial_md5)
+			{
+				const auto & [file_size, md5] = key;
+				if (filenames.size() < 2)
 				{
-					if (fn != oldest_file_in_set)
-					{
-						simple_delete_solution.insert(fn);
-					}
+					continue;
 				}
-			}
-			else if (similar_files_without_annotations.size() > 0 and similar_files_with_annotations.size() == 0 and similar_files_negative_samples.size() == 0)
-			{
-				// next case -- we ONLY have non-annotated versions of this file, in which case we'll keep the oldest file
-
-				const std::string oldest_file_in_set = find_oldest_file(similar_files_without_annotations);
 
-				for (const auto & fn : similar_files_without_annotations)
+				for (const auto & fn : filenames)
 				{
-					if (fn != oldest_file_in_set)
+					if (file_size <= 2 * partial_checksum_size)
 					{
-						simple_delete_solution.insert(fn);
+						// the entire file was read, so the partial checksum is the full checksum
+						all_files_and_md5s[fn] = md5;
+					}
+					else
+					{
+						files_to_read_completely.push_back({fn, file_size});
 					}
 				}
 			}
+
+			std::cout << "Files which must be read completely ......... " << files_to_read_completely.size() << std::endl;
+			calculate_checksums("Calculating the " + hash_algorithm_name() + " checksum of files " + std::string(10 - hash_algorithm_name().size(), '.'), use_cached_checksums(files_to_read_completely, &CachedChecksums::full, full_md5s), full_checksum, full_md5s);
+			for (const auto & [fn, md5] : full_md5s)
+			{
+				all_files_and_md5s[fn] = md5;
+			}
 		}
 
-		if (simple_delete_solution.size() > 0)
-		{
-			std::cout << std::endl << "\x1b[1;31mWARNING:  running the following commands will DELETE files from disk!\x1b[0m" << std::endl;
+		std::cout
+			<< "Checksums found in the cache ................ " << cache_hits << " of " << cache_lookups << " (" << (int)std::round(cache_lookups ? 100.0f * cache_hits / cache_lookups : 0.0f) << "%)" << std::endl
+			<< "Total number of bytes read .................. " << bytes_read << std::endl;
 
-			for (const auto & fn : simple_delete_solution)
+		/* Remember the checksums for the next time.  Only the files which still exist are saved, and checksums which were
+		 * not needed this time (such as files which no longer share their size with another file) are kept as well.
+		 */
+		for (const auto & dir_name : all_directories)
+		{
+			HashCache cache;
+			for (const auto & [fn, key] : file_keys)
 			{
-				std::cout << "\x1b[1;33mrm \"" << fn << "\"\x1b[0m" << std::endl;
+				if (file_directories.count(fn) == 0 or file_directories.at(fn) != dir_name or key.inode == 0)
+				{
+					continue;
+				}
 
-				// see if we have annotation files to delete as well
-				for (const auto & ext : {".txt", ".json"})
+				const CachedChecksums * old = find_cached_checksums(fn);
+				CachedChecksums checksums = (old ? *old : CachedChecksums());
+				if (partial_md5s.count(fn))
 				{
-					File f = File(fn).withFileExtension(ext);
-					if (f.existsAsFile())
-					{
-						std::cout << "\x1b[1;33mrm \"" << f.getFullPathName() << "\"\x1b[0m" << std::endl;
-					}
+					checksums.partial = partial_md5s.at(fn);
+				}
+				if (full_md5s.count(fn))
+				{
+					checksums.full = full_md5s.at(fn);
+				}
+				if (perceptual_hashes.count(fn))
+				{
+					checksums.perceptual = perceptual_hashes.at(fn);
+				}
+				if (not checksums.partial.empty() or not checksums.full.empty() or not checksums.perceptual.empty())
+				{
+					cache[key] = checksums;
 				}
 			}
+			save_hash_cache(dir_name, cache);
+		}
 
-			std::cout
-					<< std::endl
-					<< "Number of duplicate MD5 checksums ........... " << duplicate_md5s.size() << std::endl
-					<< "Number of duplicate files ................... " << count_duplicate_files << std::endl
-					<< "Number of simple source files to delete ..... " << simple_delete_solution.size() << std::endl
-					<< std::endl;
+		if (perceptual)
+		{
+			list_near_duplicates(all_files_and_md5s, perceptual_hashes, file_directories, max_distance);
+		}
+		else
+		{
+			const dm::MStr redundant_files = list_duplicates(all_files_and_md5s);
+			if (apply)
+			{
+				apply_duplicate_actions(redundant_files, file_keys, hardlink);
+			}
+			else
+			{
+				print_delete_commands(redundant_files);
+			}
 		}
 
 		rc = 0;
@@ -0,0 +1,443 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+
+namespace
+{
+	const std::string dm_image_cache = "darkmark_image_cache";
+
+	/// Number of directories given to each task when a level of the project is read.
+	const size_t directories_per_task = 8;
+
+
+	/// Combine the name, size, and timestamp of a file.  The order in which the files are seen does not matter.
+	uint64_t file_signature(const std::filesystem::directory_entry & entry)
+	{
+		std::error_code ec;
+		const auto size		= entry.file_size(ec);
+		const auto mtime	= entry.last_write_time(ec).time_since_epoch().count();
+
+		return std::hash<std::string>()(entry.path().filename().string() + "/" + std::to_string(size) + "/" + std::to_string(mtime));
+	}
+}
+
+
+dm::ProjectInventory::ProjectInventory(const std::string & key, const std::string & dir) :
+	cfg_key(key),
+	project_directory(dir)
+{
+	return;
+}
+
+
+File dm::ProjectInventory::cache_file(const std::string & key)
+{
+	return cfg().getFile().getSiblingFile("DarkMark_inventory_" + key + ".json");
+}
+
+
+bool dm::ProjectInventory::load()
+{
+	directories.clear();
+	weights.clear();
+
+	const File f = cache_file(cfg_key);
+	if (not f.existsAsFile())
+	{
+		return false;
+	}
+
+	try
+	{
+		const json root = json::parse(f.loadFileAsString().toStdString());
+		if (root.value("project_directory", "") != project_directory)
+		{
+			// the project has been moved, so none of the results can be used
+			return false;
+		}
+
+		for (const auto & j : root["directories"])
+		{
+			Directory & d = directories[j["name"].get<std::string>()];
+			d.mtime						= j["mtime"				];
+			d.file_signature			= j.value("file_signature", uint64_t(0));
+			d.bytes						= j["bytes"				];
+			d.is_image_cache			= j["image_cache"		];
+			d.number_of_images			= j["images"			];
+			d.number_of_json			= j["json"				];
+			d.number_of_empty_images	= j["empty"				];
+			d.number_of_marks			= j["marks"				];
+			d.number_of_errors			= j["errors"			];
+			d.oldest					= j["oldest"			];
+			d.newest					= j["newest"			];
+			d.sample_image				= j["sample_image"		];
+			d.subdirectories			= j["subdirectories"	].get<VStr>();
+		}
+
+		for (const auto & j : root["weights"])
+		{
+			WeightsChecksum & w = weights[j["name"].get<std::string>()];
+			w.size	= j["size"	];
+			w.mtime	= j["mtime"	];
+			w.md5	= j["md5"	];
+		}
+	}
+	catch (const std::exception & e)
+	{
+		Log(f.getFullPathName().toStdString() + ": ignoring the cached inventory: " + e.what());
+		directories.clear();
+		weights.clear();
+	}
+
+	return directories.empty() == false;
+}
+
+
+void dm::ProjectInventory::save() const
+{
+	json root;
+	root["project_directory"]	= project_directory;
+	root["timestamp"]			= std::time(nullptr);
+	root["directories"]			= json::array();
+	root["weights"]				= json::array();
+
+	for (const auto & [name, d] : directories)
+	{
+		json j;
+		j["name"			] = name;
+		j["mtime"			] = d.mtime;
+		j["file_signature"	] = d.file_signature;
+		j["bytes"			] = d.bytes;
+		j["image_cache"		] = d.is_image_cache;
+		j["images"			] = d.number_of_images;
+		j["json"			] = d.number_of_json;
+		j["empty"			] = d.number_of_empty_images;
+		j["marks"			] = d.number_of_marks;
+		j["errors"			] = d.number_of_errors;
+		j["oldest"			] = d.oldest;
+		j["newest"			] = d.newest;
+		j["sample_image"	] = d.sample_image;
+		j["subdirectories"	] = d.subdirectories;
+		root["directories"].push_back(j);
+	}
+
+	for (const auto & [name, w] : weights)
+	{
+		if (not File(name).existsAsFile())
+		{
+			continue;
+		}
+
+		json j;
+		j["name"	] = name;
+		j["size"	] = w.size;
+		j["mtime"	] = w.mtime;
+		j["md5"		] = w.md5;
+		root["weights"].push_back(j);
+	}
+
+	// write to a temporary file first so an interrupted save cannot leave behind a truncated inventory
+	const File f = cache_file(cfg_key);
+	const File tmp = f.getSiblingFile(f.getFileName() + ".tmp");
+	if (tmp.replaceWithText(root.dump(1, '\t')))
+	{
+		tmp.moveFileTo(f);
+	}
+
+	return;
+}
+
+
+dm::ProjectInventory::Directory dm::ProjectInventory::scan_directory(const std::string & dirname, const bool in_image_cache, const bool full_rescan, const std::regex & image_regex, const std::map<std::string, Directory> & previous) const
+{
+	Directory d;
+	d.mtime						= 0;
+	d.file_signature			= 0;
+	d.bytes						= 0;
+	d.is_image_cache			= in_image_cache;
+	d.number_of_images			= 0;
+	d.number_of_json			= 0;
+	d.number_of_empty_images	= 0;
+	d.number_of_marks			= 0;
+	d.number_of_errors			= 0;
+	d.oldest					= 0;
+	d.newest					= 0;
+
+	std::error_code ec;
+	d.mtime = std::filesystem::last_write_time(dirname, ec).time_since_epoch().count();
+	if (ec)
+	{
+		return d;
+	}
+
+	const auto iter = previous.find(dirname);
+	if (not full_rescan and iter != previous.end() and iter->second.mtime == d.mtime)
+	{
+		/* No files were added, removed, or renamed.  But DarkMark modifies some files in place, such as the .json and .txt
+		 * annotations when they are saved, and the images when they are rotated or flipped.  So the size and timestamp of
+		 * every file is still checked, which is much faster than parsing all of the .json files again.
+		 */
+		const Directory & cached = iter->second;
+
+		uint64_t signature = 0;
+		for (const auto & entry : std::filesystem::directory_iterator(dirname, std::filesystem::directory_options::skip_permission_denied, ec))
+		{
+			std::error_code entry_ec;
+			if (entry.is_regular_file(entry_ec))
+			{
+				signature += file_signature(entry);
+			}
+		}
+		if (not ec and signature == cached.file_signature)
+		{
+			return cached;
+		}
+		ec.clear();
+	}
+
+	// if we get here then we need to read everything in this directory
+
+	VStr images;
+	SStr json_filenames;
+	for (const auto & entry : std::filesystem::directory_iterator(dirname, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		std::error_code entry_ec;
+		const std::string name = entry.path().filename().string();
+
+		if (entry.is_directory(entry_ec))
+		{
+			// don't follow symlinks since they could point back to a parent directory
+			if (not entry.is_symlink(entry_ec))
+			{
+				d.subdirectories.push_back(name);
+			}
+			continue;
+		}
+
+		if (not entry.is_regular_file(entry_ec))
+		{
+			continue;
+		}
+
+		const auto size = entry.file_size(entry_ec);
+		if (not entry_ec)
+		{
+			d.bytes += size;
+		}
+		d.file_signature += file_signature(entry);
+
+		if (entry.path().extension() == ".json")
+		{
+			json_filenames.insert(name);
+			continue;
+		}
+
+		// same rules as dm::find_files():  ignore the chart*.png files created by darknet, and the image cache
+		const std::string filename = entry.path().string();
+		if (d.is_image_cache or not std::regex_match(filename, image_regex))
+		{
+			continue;
+		}
+		if (filename.find(".png") != std::string::npos and (name.find("chart.png") == 0 or name.find("chart_") == 0))
+		{
+			continue;
+		}
+		images.push_back(filename);
+	}
+
+	std::sort(images.begin(), images.end());
+	d.number_of_images = images.size();
+	if (images.empty() == false)
+	{
+		d.sample_image = images[images.size() / 2];
+	}
+
+	for (const auto & image : images)
+	{
+		const std::filesystem::path json_filename = std::filesystem::path(image).replace_extension(".json");
+		if (json_filenames.count(json_filename.filename().string()) == 0)
+		{
+			continue;
+		}
+
+		d.number_of_json ++;
+		try
+		{
+			std::ifstream ifs(json_filename);
+			const json j = json::parse(ifs);
+			d.number_of_marks += j["mark"].size();
+			if (j.value("completely_empty", false))
+			{
+				// count empty images as well...but not the same way as marks
+				d.number_of_empty_images ++;
+			}
+			const std::time_t timestamp = j["timestamp"].get<std::time_t>();
+			if (d.oldest == 0 or timestamp < d.oldest)
+			{
+				d.oldest = timestamp;
+			}
+			if (d.newest == 0 or timestamp > d.newest)
+			{
+				d.newest = timestamp;
+			}
+		}
+		catch (...)
+		{
+			d.number_of_errors ++;
+		}
+	}
+
+	return d;
+}
+
+
+void dm::ProjectInventory::refresh(std::atomic<bool> & done, const bool full_rescan)
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	const std::regex image_regex(cfg().get_str("image_regex"), std::regex::icase | std::regex::nosubs | std::regex::optimize | std::regex::ECMAScript);
+
+	std::map<std::string, Directory> previous;
+	previous.swap(directories);
+
+	/* Each level of subdirectories is read in parallel.  Project directories are usually wide and shallow -- many images
+	 * split into a handful of subdirectories -- so the number of levels is small.
+	 */
+	std::vector<std::pair<std::string, bool>> level;
+	level.push_back({project_directory, false});
+	size_t directories_read = 0;
+
+	while (level.empty() == false and not done)
+	{
+		std::vector<Directory> results(level.size());
+
+		WorkPool::Tasks tasks;
+		for (size_t first = 0; first < level.size(); first += directories_per_task)
+		{
+			const size_t last = std::min(first + directories_per_task, level.size());
+			tasks.push_back(
+				[&, first, last](const size_t worker_idx)
+				{
+					for (size_t idx = first; idx < last and not done; idx ++)
+					{
+						results[idx] = scan_directory(level[idx].first, level[idx].second, full_rescan, image_regex, previous);
+					}
+				});
+		}
+
+		auto job = work_pool().submit("project inventory", tasks);
+		job->wait(
+			[&](const double fraction)
+			{
+				if (done)
+				{
+					job->cancel();
+				}
+			});
+
+		if (done)
+		{
+			break;
+		}
+
+		std::vector<std::pair<std::string, bool>> next_level;
+		for (size_t idx = 0; idx < level.size(); idx ++)
+		{
+			const File dir(level[idx].first);
+			for (const auto & name : results[idx].subdirectories)
+			{
+				next_level.push_back({dir.getChildFile(name).getFullPathName().toStdString(), results[idx].is_image_cache or name == dm_image_cache});
+			}
+			directories[level[idx].first] = std::move(results[idx]);
+			directories_read ++;
+		}
+		level.swap(next_level);
+	}
+
+	if (done)
+	{
+		// keep the old results rather than a partial inventory
+		directories.swap(previous);
+		return;
+	}
+
+	const auto end_time = std::chrono::high_resolution_clock::now();
+	Log(project_directory + ": inventory of " + std::to_string(directories_read) + " directories " + (full_rescan ? "rescanned" : "refreshed") + " in " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()) + " milliseconds");
+
+	return;
+}
+
+
+dm::ProjectInventory::Totals dm::ProjectInventory::totals() const
+{
+	Totals t;
+	t.number_of_images			= 0;
+	t.number_of_json			= 0;
+	t.number_of_empty_images	= 0;
+	t.number_of_marks			= 0;
+	t.number_of_errors			= 0;
+	t.oldest					= 0;
+	t.newest					= 0;
+	t.total_bytes				= 0;
+	t.image_cache_bytes			= 0;
+
+	VStr sample_images;
+	for (const auto & iter : directories)
+	{
+		const Directory & d = iter.second;
+		t.number_of_images			+= d.number_of_images;
+		t.number_of_json			+= d.number_of_json;
+		t.number_of_empty_images	+= d.number_of_empty_images;
+		t.number_of_marks			+= d.number_of_marks;
+		t.number_of_errors			+= d.number_of_errors;
+		t.total_bytes				+= d.bytes;
+
+		if (d.is_image_cache)
+		{
+			t.image_cache_bytes += d.bytes;
+		}
+		if (d.oldest > 0 and (t.oldest == 0 or d.oldest < t.oldest))
+		{
+			t.oldest = d.oldest;
+		}
+		if (d.newest > t.newest)
+		{
+			t.newest = d.newest;
+		}
+		if (d.sample_image.empty() == false)
+		{
+			sample_images.push_back(d.sample_image);
+		}
+	}
+
+	if (sample_images.empty() == false)
+	{
+		t.sample_image = sample_images[std::rand() % sample_images.size()];
+	}
+
+	return t;
+}
+
+
+std::string dm::ProjectInventory::weights_md5(const std::string & filename)
+{
+	const File f(filename);
+	const int64_t size	= f.getSize();
+	const int64_t mtime	= f.getLastModificationTime().toMilliseconds();
+
+	auto iter = weights.find(filename);
+	if (iter != weights.end() and iter->second.size == size and iter->second.mtime == mtime)
+	{
+		return iter->second.md5;
+	}
+
+	Log("calculating MD5 checksum for " + filename);
+	const std::string md5 = MD5(f).toHexString().toStdString();
+	weights[filename] = {size, mtime, md5};
+
+	return md5;
+}
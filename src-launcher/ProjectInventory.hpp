@@ -0,0 +1,104 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+
+
+namespace dm
+{
+	/** The information shown in the launcher for each project:  number of images and markup files, size of the project
+	 * directory, and the timestamps of the markup.  Large projects can have hundreds of thousands of files, so the results
+	 * are cached per directory in @p DarkMark_inventory_<key>.json next to the configuration file.
+	 *
+	 * When the inventory is refreshed, a directory with the same modification time as the last time it was scanned keeps
+	 * the cached results, as long as the size and timestamp of every file is also the same.  This is needed since DarkMark
+	 * re-writes annotations and images in place.  Everything else is read again.  The directories are read in parallel,
+	 * one level at a time.
+	 */
+	class ProjectInventory final
+	{
+		public:
+
+			/// Results for the entire project.
+			struct Totals
+			{
+				size_t		number_of_images;
+				size_t		number_of_json;			///< number of images which have a .json file
+				size_t		number_of_empty_images;	///< negative samples
+				size_t		number_of_marks;
+				size_t		number_of_errors;		///< .json files which could not be parsed
+				std::time_t	oldest;
+				std::time_t	newest;
+				int64_t		total_bytes;
+				int64_t		image_cache_bytes;		///< bytes in @p darkmark_image_cache
+				std::string	sample_image;			///< one of the images, used as a thumbnail
+			};
+
+			/// Constructor.
+			ProjectInventory(const std::string & key, const std::string & dir);
+
+			/// Where the inventory for the given project key is stored.
+			static File cache_file(const std::string & key);
+
+			/** Load the results from the last time this project was scanned.
+			 * @returns @p false if nothing has been cached for this project.
+			 */
+			bool load();
+
+			/// Save the inventory to @ref cache_file().
+			void save() const;
+
+			/** Bring the inventory up-to-date.  Directories which have not changed are not read again unless @p full_rescan
+			 * is set.  If @p done is set while this is running, the previous results are kept.
+			 */
+			void refresh(std::atomic<bool> & done, const bool full_rescan);
+
+			/// Add up the results from all of the directories.
+			Totals totals() const;
+
+			/** Get the MD5 checksum of a .weights file.  These files can be hundreds of MiB, so the checksums are kept in the
+			 * inventory until the size or timestamp of the file changes.
+			 */
+			std::string weights_md5(const std::string & filename);
+
+		private:
+
+			/// Results for a single directory, not including the subdirectories.
+			struct Directory
+			{
+				int64_t		mtime;
+				uint64_t	file_signature;		///< combination of the name, size, and timestamp of every file
+				int64_t		bytes;
+				bool		is_image_cache;
+				size_t		number_of_images;
+				size_t		number_of_json;
+				size_t		number_of_empty_images;
+				size_t		number_of_marks;
+				size_t		number_of_errors;
+				std::time_t	oldest;
+				std::time_t	newest;
+				std::string	sample_image;
+				VStr		subdirectories;		///< only the name, not the full path
+			};
+
+			struct WeightsChecksum
+			{
+				int64_t		size;
+				int64_t		mtime;
+				std::string	md5;
+			};
+
+			/// Read a single directory, or return the cached results if it has not changed.
+			Directory scan_directory(const std::string & dirname, const bool in_image_cache, const bool full_rescan, const std::regex & image_regex, const std::map<std::string, Directory> & previous) const;
+
+			const std::string cfg_key;
+			const std::string project_directory;
+
+			/// The key is the full path to each directory.
+			std::map<std::string, Directory> directories;
+
+			/// The key is the full path to each .weights file.
+			std::map<std::string, WeightsChecksum> weights;
+	};
+}
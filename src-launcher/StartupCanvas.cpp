@@ -2,9 +2,6 @@
 
 #include "DarkMark.hpp"
 
-#include "json.hpp"
-using json = nlohmann::json;
-
 
 std::string format_bytes(double bytes)
 {
@@ -86,7 +83,10 @@ dm::StartupCanvas::StartupCanvas(const std::string & key, const std::string & di
 	cfg_key(key),
 	hide_some_weight_files("hide extra .weights files"),
 	applying_filter(true),
-	done(false)
+	done(false),
+	inventory(key, dir),
+	refreshed(false),
+	full_rescan(false)
 {
 	addAndMakeVisible(pp);
 	addAndMakeVisible(table);
@@ -152,7 +152,8 @@ dm::StartupCanvas::StartupCanvas(const std::string & key, const std::string & di
 	hide_some_weight_files.setToggleState(true, NotificationType::sendNotification);
 	hide_some_weight_files.addListener(this);
 
-	refresh();
+	// the rest is only read once this tab is shown, see visibilityChanged()
+	load_project_settings();
 
 	return;
 }
@@ -161,7 +162,21 @@ dm::StartupCanvas::StartupCanvas(const std::string & key, const std::string & di
 dm::StartupCanvas::~StartupCanvas()
 {
 	done = true;
-	t.join();
+	if (t.joinable())
+	{
+		t.join();
+	}
+
+	return;
+}
+
+
+void dm::StartupCanvas::visibilityChanged()
+{
+	if (isVisible() and not refreshed)
+	{
+		refresh();
+	}
 
 	return;
 }
@@ -216,107 +231,93 @@ void dm::StartupCanvas::initialize_on_thread()
 	// give the main window a chance to start up completely before we start pounding the drive looking for files
 	std::this_thread::sleep_for(std::chrono::milliseconds(100 + std::rand() % 250));
 
-	File dir(project_directory.toString());
+	if (initialize_everything and not done)
+	{
+		// show what we found the last time this project was opened while the directories are checked for changes
+		if (inventory.load())
+		{
+			show_inventory();
+		}
+	}
 
-	VStr image_filenames;
-	VStr json_filenames;
-	VStr images_without_json;
+	find_all_darknet_files();
 
-	if (initialize_everything)
+	if (initialize_everything and not done)
 	{
-		find_files(dir, image_filenames, json_filenames, images_without_json, done);
+		inventory.refresh(done, full_rescan);
+		if (not done)
+		{
+			show_inventory();
+			inventory.save();
+		}
 	}
 
-	if (not done)
+	return;
+}
+
+
+void dm::StartupCanvas::show_inventory()
+{
+	const auto totals = inventory.totals();
+
+	const size_t image_counter	= totals.number_of_images;
+	const size_t json_counter	= totals.number_of_json;
+	const size_t empty_images	= totals.number_of_empty_images;
+	const size_t count			= totals.number_of_marks;
+
+	String str = String(json_counter) + " (" + String(std::round(100.0 * json_counter / (image_counter == 0 ? 1 : image_counter))) + "%)";
+	if (empty_images)
 	{
-		const size_t image_counter	= image_filenames.size();
-		const size_t json_counter	= json_filenames.size();
+		// since we have some empty images, update the text counter to include those stats as well
+		const int percentage = std::round(100.0 * empty_images / json_counter);
+		str += " of which " + String(empty_images) + " (" + String(percentage) + "%) are negative samples";
+	}
+	number_of_images	= String(image_counter);
+	number_of_json		= str;
 
-		number_of_images	= String(image_counter);
-		number_of_json		= String(json_counter) + " (" + String(std::round(100.0 * json_counter / (image_counter == 0 ? 1 : image_counter))) + "%)";
+	str = format_bytes(totals.total_bytes);
+	if (totals.image_cache_bytes > 0)
+	{
+		str += " (" + String(format_bytes(totals.image_cache_bytes)) + " of which is in the cache)";
 	}
+	size_of_directory = str;
 
-	if (not done and initialize_everything and image_filenames.empty() == false)
+	if (totals.sample_image.empty() == false and thumbnail.getImage().isNull())
 	{
-		auto image = ImageCache::getFromFile(File(image_filenames[std::rand() % image_filenames.size()]));
+		auto image = juce::ImageCache::getFromFile(File(totals.sample_image));
 		thumbnail.setImage(image, RectanglePlacement::xLeft);
 	}
 
-	find_all_darknet_files();
-
-	if (not done and initialize_everything)
+	if (totals.number_of_errors)
 	{
-		calculate_size_of_directory();
-
-		try
-		{
-			// look for newest and oldest timestamp
-			std::size_t empty_images = 0;
-			std::time_t oldest = 0;
-			std::time_t newest = 0;
-			std::size_t count = 0;
-
-			for (const auto & filename : json_filenames)
-			{
-				if (done)
-				{
-					break;
-				}
-
-				json j = json::parse(File(filename).loadFileAsString().toStdString());
-				count += j["mark"].size();
-				if (j.value("completely_empty", false) == true)
-				{
-					// count empty images as well...but not the same way as marks
-					empty_images ++;
-				}
-				std::time_t timestamp = j["timestamp"].get<std::time_t>();
-				if (oldest == 0 || timestamp < oldest)
-				{
-					oldest = timestamp;
-				}
-				if (newest == 0 || timestamp > newest)
-				{
-					newest = timestamp;
-				}
-			}
-
-			if (not done and empty_images)
-			{
-				// since we have some empty images, update the text counter to include those stats as well
-				const int percentage = std::round(100.0 * empty_images / json_filenames.size());
-				auto str = number_of_json.toString();
-				str += " of which " + String(empty_images) + " (" + String(percentage) + "%) are negative samples";
-				number_of_json = str;
-			}
+		Log(project_directory.toString().toStdString() + ": error while reading " + std::to_string(totals.number_of_errors) + " markup .json file" + (totals.number_of_errors == 1 ? "" : "s"));
+	}
+	if (totals.number_of_errors and totals.number_of_errors == json_counter)
+	{
+		oldest_markup	= "(error reading markup .json file)";
+		newest_markup	= oldest_markup.toString();
+		number_of_marks	= oldest_markup.toString();
+		return;
+	}
 
-			oldest_markup = format_timestamp(oldest).c_str();
-			newest_markup = format_timestamp(newest).c_str();
+	oldest_markup = format_timestamp(totals.oldest).c_str();
+	newest_markup = format_timestamp(totals.newest).c_str();
 
-			const int classes = number_of_classes.getValue();
-			std::stringstream ss;
-			ss << std::fixed << std::setprecision(1);
-			ss << count;
-			if (not done and classes > 0 and count > 0 and json_filenames.size() > empty_images)
-			{
-				const double average_marks_per_class = static_cast<double>(count) / static_cast<double>(classes);
-				const double average_marks_per_image = static_cast<double>(count) / static_cast<double>(json_filenames.size() - empty_images);
+	const int classes = number_of_classes.getValue();
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << count;
+	if (classes > 0 and count > 0 and json_counter > empty_images)
+	{
+		const double average_marks_per_class = static_cast<double>(count) / static_cast<double>(classes);
+		const double average_marks_per_image = static_cast<double>(count) / static_cast<double>(json_counter - empty_images);
 
-				ss	<< " ("
-					<< average_marks_per_class << " mark" << (average_marks_per_class == 1.0 ? "" : "s") << " per class, "
-					<< average_marks_per_image << " mark" << (average_marks_per_image == 1.0 ? "" : "s") << " per image, "
-					<< empty_images << " negative sample" << (empty_images == 1.0 ? "" : "s") << ")";
-			}
-			number_of_marks = ss.str().c_str();
-		}
-		catch (const std::exception & e)
-		{
-			Log(dir.getFullPathName().toStdString() + ": error while reading JSON: " + e.what());
-			oldest_markup	= "(error reading markup .json file)";
-			newest_markup	= oldest_markup.toString();
-			number_of_marks	= oldest_markup.toString();
-		}
+		ss	<< " ("
+			<< average_marks_per_class << " mark" << (average_marks_per_class == 1.0 ? "" : "s") << " per class, "
+			<< average_marks_per_image << " mark" << (average_marks_per_image == 1.0 ? "" : "s") << " per image, "
+			<< empty_images << " negative sample" << (empty_images == 1.0 ? "" : "s") << ")";
 	}
+	number_of_marks = ss.str().c_str();
 
 	return;
 }
@@ -472,7 +473,7 @@ void dm::StartupCanvas::find_all_darknet_files()
 }
 
 
-void dm::StartupCanvas::refresh()
+void dm::StartupCanvas::refresh(const bool rescan)
 {
 	done = true;
 	if (t.joinable())
@@ -480,6 +481,9 @@ void dm::StartupCanvas::refresh()
 		t.join();
 	}
 
+	refreshed	= true;
+	full_rescan	= rescan;
+
 	size_of_directory	= "...";
 	number_of_images	= "...";
 	number_of_json		= "...";
@@ -488,6 +492,17 @@ void dm::StartupCanvas::refresh()
 	newest_markup		= "...";
 	oldest_markup		= "...";
 
+	load_project_settings();
+
+	done = false;
+	t = std::thread(&StartupCanvas::initialize_on_thread, this);
+
+	return;
+}
+
+
+void dm::StartupCanvas::load_project_settings()
+{
 	last_used = format_timestamp(cfg().getIntValue("project_" + cfg_key + "_timestamp")).c_str();
 
 	String dims =
@@ -506,9 +521,6 @@ void dm::StartupCanvas::refresh()
 	darknet_weights_filename		= cfg().getValue("project_" + cfg_key + "_weights"				);
 	darknet_names_filename			= cfg().getValue("project_" + cfg_key + "_names"				);
 
-	done = false;
-	t = std::thread(&StartupCanvas::initialize_on_thread, this);
-
 	return;
 }
 
@@ -675,8 +687,6 @@ void dm::StartupCanvas::delete_extra_weights_files()
 		File(filename).deleteFile();
 	}
 
-	calculate_size_of_directory();
-
 	if (extra_weights_files.empty() == false)
 	{
 		const size_t count = extra_weights_files.size();
@@ -684,6 +694,9 @@ void dm::StartupCanvas::delete_extra_weights_files()
 		extra_weights_files.clear();
 	}
 
+	// the list of files and the size of the project directory have changed
+	refresh();
+
 	return;
 }
 
@@ -720,7 +733,10 @@ void dm::StartupCanvas::buttonClicked(Button * button)
 		// this can take a while, so start it on a thread
 		// (and in the case where this toggle is set to FALSE, we have no way to get back the entries we deleted)
 		done = false;
-		t.join();
+		if (t.joinable())
+		{
+			t.join();
+		}
 		t = std::thread(&StartupCanvas::find_all_darknet_files, this);
 	}
 
@@ -769,8 +785,7 @@ void dm::StartupCanvas::filter_out_extra_weight_files()
 			info.short_name.find("_last.weights")	!= std::string::npos	or
 			info.short_name.find("_final.weights")	!= std::string::npos	)
 		{
-			Log("calculating MD5 checksum for " + info.full_name);
-			const std::string md5 = MD5(File(info.full_name)).toHexString().toStdString();
+			const std::string md5 = inventory.weights_md5(info.full_name);
 			if (md5s.count(md5) == 0)
 			{
 				Log("keeping the file " + info.full_name + " (md5=" + md5 + ")");
@@ -799,46 +814,3 @@ void dm::StartupCanvas::filter_out_extra_weight_files()
 
 	return;
 }
-
-
-void dm::StartupCanvas::calculate_size_of_directory()
-{
-	int64_t total_bytes = 0;
-	int64_t image_cache_bytes = 0;
-
-#ifdef WIN32
-	const String dm_image_cache = "\\darkmark_image_cache\\";
-#else
-	const String dm_image_cache = "/darkmark_image_cache/";
-#endif
-
-	File dir(project_directory.toString());
-	for (auto dir_entry : RangedDirectoryIterator(dir, true))
-	{
-		if (done)
-		{
-			break;
-		}
-
-		total_bytes += dir_entry.getFileSize();
-
-
-		if (dir_entry.getFile().getFullPathName().contains(dm_image_cache))
-		{
-			image_cache_bytes += dir_entry.getFileSize();
-		}
-	}
-
-	if (not done)
-	{
-		String str = format_bytes(total_bytes);
-		if (image_cache_bytes > 0)
-		{
-			str += " (" + String(format_bytes(image_cache_bytes)) + " of which is in the cache)";
-		}
-
-		size_of_directory = str;
-	}
-
-	return;
-}
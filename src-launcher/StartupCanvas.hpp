@@ -39,7 +39,16 @@ namespace dm
 		/// Sets the @ref need_to_rebuild_cache_image flag, which eventually results in a call to @ref rebuild_cache_image().
 		virtual void resized();
 
-		void refresh();
+		/// Starts a refresh as soon as the tab is shown for the first time.  Tabs which are never shown are never read.
+		virtual void visibilityChanged();
+
+		/** Reload the project settings and start a thread to update the inventory.  Unless @p full_rescan is set, the
+		 * directories which have not changed since the inventory was last saved are not read again.
+		 */
+		void refresh(const bool full_rescan = false);
+
+		/// Read the settings for this project from the configuration file.
+		void load_project_settings();
 
 		virtual int getNumRows();
 		virtual void paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected);
@@ -58,7 +67,8 @@ namespace dm
 		void find_all_darknet_files();
 		void filter_out_extra_weight_files();
 
-		void calculate_size_of_directory();
+		/// Show the results from @ref inventory.
+		void show_inventory();
 
 		std::string cfg_key;
 
@@ -93,5 +103,13 @@ namespace dm
 		std::thread t;
 
 		VDarknetFileInfo v;
+
+		ProjectInventory inventory;
+
+		/// Set once the first refresh has been started.
+		bool refreshed;
+
+		/// Whether the refresh running on @ref t needs to read every directory again.
+		bool full_rescan;
 	};
 }
@@ -276,7 +276,8 @@ void dm::StartupWnd::buttonClicked(Button * button)
 		StartupCanvas * notebook_canvas = dynamic_cast<StartupCanvas*>(notebook.getTabContentComponent(notebook.getCurrentTabIndex()));
 		if (notebook_canvas)
 		{
-			notebook_canvas->refresh();
+			// the user asked for this, so don't trust any of the cached results
+			notebook_canvas->refresh(true);
 		}
 	}
 	else if (button == &import_pdf_button)
@@ -539,9 +540,11 @@ void dm::StartupWnd::buttonClicked(Button * button)
 				// need to remove the project from DarkMark, which means we must go through all of the keys
 				// and delete all the ones that match the name "project_0123_..."
 
-				const String name = "project_" + notebook_canvas->cfg_key + "_";
+				const std::string key = notebook_canvas->cfg_key;
+				const String name = "project_" + key + "_";
 				notebook.removeTab(tab_index);
 				notebook_canvas = nullptr;
+				ProjectInventory::cache_file(key).deleteFile();
 
 				SStr keys_to_delete;
 				for (const String & k : cfg().getAllProperties().getAllKeys())
@@ -639,6 +642,12 @@ void dm::StartupWnd::buttonClicked(Button * button)
 				}
 			}
 
+			if (load_project)
+			{
+				// a class remap which was interrupted must be finished or rolled back before the annotations are loaded
+				load_project = recover_interrupted_class_remap(File(notebook_canvas->project_directory.toString()), true);
+			}
+
 			if (load_project)
 			{
 				setVisible(false);
@@ -52,6 +52,7 @@ namespace dm
 	class DMStatsWnd;
 	class AboutWnd;
 	class CfgHandler;
+	class ImageCache;
 	class DarknetWnd;
 	class ClassIdWnd;
 	class WndCfgTemplates;
@@ -62,6 +63,12 @@ namespace dm
 	class SettingsWnd;
 	class FilterWnd;
 	class ProjectInfo;
+	class WorkPool;
+	class SplitMix64;
+	class ShardWriter;
+	class ShardReader;
+	class Progress;
+	class DarknetGen;
 	class DMContentReview;
 	class DMContentReviewIoU;
 	class DMReviewIoUWnd;
@@ -96,6 +103,11 @@ namespace dm
 #include "Bitmaps.hpp"
 #include "Mark.hpp"
 #include "Tools.hpp"
+#include "WorkPool.hpp"
+#include "BoundedQueue.hpp"
+#include "SplitMix64.hpp"
+#include "Shard.hpp"
+#include "Progress.hpp"
 #include "CrosshairComponent.hpp"
 #include "ProjectInfo.hpp"
 #include "Notebook.hpp"
@@ -109,6 +121,8 @@ namespace dm
 #include "DMReviewCanvas.hpp"
 #include "DMReviewIoUWnd.hpp"
 #include "CfgHandler.hpp"
+#include "ImageCache.hpp"
+#include "DarknetGen.hpp"
 #include "DarknetWnd.hpp"
 #include "WndCfgTemplates.hpp"
 #include "PdfImportWindow.hpp"
@@ -117,6 +131,7 @@ namespace dm
 #include "ClassIdWnd.hpp"
 #include "SettingsWnd.hpp"
 #include "FilterWnd.hpp"
+#include "ProjectInventory.hpp"
 #include "StartupCanvas.hpp"
 #include "DMContentImportTxt.hpp"
 #include "DMContentReloadResave.hpp"
@@ -14,7 +14,8 @@
 
 void DarkMark_Juce_Crash_Handler(void *ptr)
 {
-	dm::Log("crash handler invoked -- exiting");
+	dm::Log(dm::ELogLevel::kError, "crash handler invoked -- exiting");
+	dm::flush_log();
 
 	exit(1);
 }
@@ -22,7 +23,8 @@ void DarkMark_Juce_Crash_Handler(void *ptr)
 
 void DarkMark_CPlusPlus_Terminate_Handler(void)
 {
-	dm::Log("terminate handler invoked");
+	dm::Log(dm::ELogLevel::kError, "terminate handler invoked");
+	dm::flush_log();
 
 	exit(2);
 }
@@ -146,6 +148,8 @@ void dm::DarkMarkApplication::signal_handler(int signal_number)
 		// ignore it, we're about to abort anyway
 	}
 
+	dm::flush_log();
+
 	std::signal(SIGABRT, SIG_DFL);
 	std::abort();
 
@@ -207,6 +211,23 @@ bool validPositiveFloat(const std::string & str)
 }
 
 
+bool isTrue(const std::string & str)
+{
+	if (str == "true"	||
+		str == "TRUE"	||
+		str == "yes"	||
+		str == "YES"	||
+		str == "on"		||
+		str == "ON"		||
+		str == "1"		)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+
 bool validBool(const std::string & str)
 {
 	if (str == "true"	||
@@ -254,59 +275,55 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 
 	std::srand(std::time(nullptr));
 
-	// See if we have access to some sort of windowing system.  If the user does a "ssh" without "ssh -X" then JUCE will
-	// crash when we try to create a window.  So get ahead of this and attempt to detect if we have a desktop, otherwise
-	// log a message.
+	/* See if we have access to some sort of windowing system.  If the user does a "ssh" without "ssh -X" then JUCE will
+	 * crash when we try to create a window.  So get ahead of this and attempt to detect if we have a desktop.  Without a
+	 * desktop, the only thing DarkMark can do is "gen-darknet", which is handled once the CLI parameters have been parsed.
+	 */
 	Desktop & desktop = Desktop::getInstance();
-	if (desktop.isHeadless())
+	const bool headless_system = desktop.isHeadless();
+	if (not headless_system)
 	{
-		dm::Log("This seems to be a headless system.  Do you have a GUI desktop?");
-		dm::Log("Did you perhaps run \"ssh\" instead of \"ssh -X\"?");
-		dm::Log("Are you running a server distro instead of a desktop edition?");
-		dm::Log("DarkMark is a GUI application, and it requires a GUI desktop to run!");
-		dm::Log("Please fix this error and try again.");
-		throw std::runtime_error("Cannot run DarkMark on a headless system.");
-	}
+		const Displays & displays = desktop.getDisplays();
+		const Displays::Display * primary_display = displays.getPrimaryDisplay();
+		if (primary_display == nullptr)
+		{
+			dm::Log("This seems suspicious:  no primary display has been configured!?");
+		}
 
-	const Displays & displays = desktop.getDisplays();
-	const Displays::Display * primary_display = displays.getPrimaryDisplay();
-	if (primary_display == nullptr)
-	{
-		dm::Log("This seems suspicious:  no primary display has been configured!?");
-	}
+		for (int idx = 0; idx < displays.displays.size(); idx ++)
+		{
+			const auto & display = displays.displays.getReference(idx);
+			dm::Log(
+				"display #"	+ std::to_string(idx) +
+				" dpi="		+ std::to_string(display.dpi) +
+				" main="	+ std::to_string(display.isMain) +
+				" scale="	+ std::to_string(display.scale) +
+				" total=\""	+ display.totalArea	.toString().toStdString() + "\""
+				" user=\""	+ display.userArea	.toString().toStdString() + "\""
+				);
+		}
 
-	for (int idx = 0; idx < displays.displays.size(); idx ++)
-	{
-		const auto & display = displays.displays.getReference(idx);
-		dm::Log(
-			"display #"	+ std::to_string(idx) +
-			" dpi="		+ std::to_string(display.dpi) +
-			" main="	+ std::to_string(display.isMain) +
-			" scale="	+ std::to_string(display.scale) +
-			" total=\""	+ display.totalArea	.toString().toStdString() + "\""
-			" user=\""	+ display.userArea	.toString().toStdString() + "\""
-			);
+		#if DARKNET_GEN_SIMPLIFIED
+			// different default font is needed for Japanese characters; this requires: "sudo apt-get install fonts-ipafont-gothic"
+			Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("IPAPGothic");
+		#else
+			/* Until 2022-04, JUCE would default to "Liberation Sans" on Ubuntu.  But at some point in April 2022, JUCE seems to
+			 * have changed the default to an italic version of "DejaVu Sans".  Unfortunately, I don't like how it makes things
+			 * look since it is a heavy font and -- in my opinion! -- italics is a poor choice for the default font in a GUI.
+			 * So I'm now hard-coding the font back to "Liberation Sans".  But I worry this will cause font issues for people
+			 * who want to run DarkMark on systems without that font.  This may need to be revisited.
+			 */
+			Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Liberation Sans");
+//			Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("DejaVu Sans");
+//			Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Ubuntu Condensed");
+//			Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Ubuntu");
+		#endif
 	}
 
-	#if DARKNET_GEN_SIMPLIFIED
-		// different default font is needed for Japanese characters; this requires: "sudo apt-get install fonts-ipafont-gothic"
-		Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("IPAPGothic");
-	#else
-		/* Until 2022-04, JUCE would default to "Liberation Sans" on Ubuntu.  But at some point in April 2022, JUCE seems to
-		 * have changed the default to an italic version of "DejaVu Sans".  Unfortunately, I don't like how it makes things
-		 * look since it is a heavy font and -- in my opinion! -- italics is a poor choice for the default font in a GUI.
-		 * So I'm now hard-coding the font back to "Liberation Sans".  But I worry this will cause font issues for people
-		 * who want to run DarkMark on systems without that font.  This may need to be revisited.
-		 */
-		Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Liberation Sans");
-//		Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("DejaVu Sans");
-//		Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Ubuntu Condensed");
-//		Desktop::getInstance().getDefaultLookAndFeel().setDefaultSansSerifTypefaceName("Ubuntu");
-	#endif
-
 	try
 	{
 		cfg.reset(new Cfg);
+		dm::set_log_level(dm::log_level_from_string(cfg->get_str("log_level")));
 	}
 	catch (const std::exception & e)
 	{
@@ -314,7 +331,17 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 		throw;
 	}
 
-	for (auto parm : StringArray::fromTokens(commandLine, true))
+	const StringArray parms = StringArray::fromTokens(commandLine, true);
+	for (const auto & parm : parms)
+	{
+		if (parm.unquoted() == "progress=json")
+		{
+			// STDOUT is reserved for the JSON progress lines, so the log must go elsewhere before anything else is logged
+			dm::set_log_to_stderr(true);
+		}
+	}
+
+	for (auto parm : parms)
 	{
 		parm = parm.unquoted();
 		auto key = parm.toStdString();
@@ -357,6 +384,10 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 		else if (key == "darknet" and val == "run")
 		{
 		}
+		else if (key == "progress" and (val == "text" or val == "json"))
+		{
+			// only used when running without a display
+		}
 		else if (key == "add")
 		{
 			File f(val);
@@ -474,6 +505,10 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 				throw std::runtime_error("cannot find project \"" + val + "\"");
 			}
 		}
+		else if (key == "sweep_sizes" or key == "sweep_clusters")
+		{
+			// the lists are validated when the sweep runs
+		}
 		else if (key == "template")
 		{
 			File f(val);
@@ -490,7 +525,10 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 				key == "max_batches"			or
 				key == "batch_size"				or
 				key == "subdivisions"			or
-				key == "annotation_area_size"	))
+				key == "random_seed"			or
+				key == "annotation_area_size"	or
+				key == "anchor_sample_size"		or
+				key == "jobs"					))
 		{
 			// no further validation performed here
 		}
@@ -498,10 +536,14 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 			validBool(val) and (
 				key == "do_not_resize_images"		or
 				key == "resize_images"				or
+				key == "link_unmodified_images"		or
 				key == "tile_images"				or
 				key == "zoom_images"				or
 				key == "limit_neg_samples"			or
 				key == "limit_validation_images"	or
+				key == "pack_shards"				or
+				key == "plan"						or
+				key == "sweep"						or
 				key == "yolo_anchors"				or
 				key == "class_imbalance"			or
 				key == "mosaic"						or
@@ -509,7 +551,8 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 				key == "mixup"						or
 				key == "flip"						or
 				key == "restart_training"			or
-				key == "remove_small_annotations"	))
+				key == "remove_small_annotations"	or
+				key == "headless"					))
 		{
 			// no further validation performed here
 		}
@@ -530,6 +573,42 @@ void dm::DarkMarkApplication::initialise(const String & commandLine)
 		cli_options["project_key"] = project_key.toStdString();
 	}
 
+	const bool gen_darknet = cli_options.count("editor") and cli_options.at("editor") == "gen-darknet";
+	const bool headless_requested = cli_options.count("headless") and isTrue(cli_options.at("headless"));
+	if (headless_requested and not gen_darknet)
+	{
+		dm::Log("Error: \"headless=true\" can only be used with \"editor=gen-darknet\"");
+		throw std::runtime_error("CLI parameter \"headless\" requires \"editor=gen-darknet\"");
+	}
+	if (headless_system or headless_requested)
+	{
+		if (not gen_darknet)
+		{
+			dm::Log("This seems to be a headless system.  Do you have a GUI desktop?");
+			dm::Log("Did you perhaps run \"ssh\" instead of \"ssh -X\"?");
+			dm::Log("Are you running a server distro instead of a desktop edition?");
+			dm::Log("DarkMark is a GUI application, and it requires a GUI desktop to run!");
+			dm::Log("Without a desktop, the only thing DarkMark can do is \"editor=gen-darknet\".");
+			dm::Log("Please fix this error and try again.");
+			throw std::runtime_error("Cannot run DarkMark on a headless system.");
+		}
+
+		// create the darknet files right now without creating any windows, and then exit
+		EHeadless task = EHeadless::kCreate;
+		if (cli_options.count("plan") and isTrue(cli_options.at("plan")))
+		{
+			task = EHeadless::kPlan;
+		}
+		else if (cli_options.count("sweep") and isTrue(cli_options.at("sweep")))
+		{
+			task = EHeadless::kSweep;
+		}
+		setApplicationReturnValue(gen_darknet_headless(task));
+		quit();
+
+		return;
+	}
+
 
 #if JUCE_MAC
 	app_menu_model = std::make_unique<DMAppMenuModel>();
@@ -587,6 +666,7 @@ void dm::DarkMarkApplication::shutdown()
 {
 	// shutdown the application
 	dm::Log("shutting down DarkMark v" DARKMARK_VERSION);
+	dm::flush_log();
 
 #if JUCE_MAC
 	MenuBarModel::setMacMainMenu(nullptr);
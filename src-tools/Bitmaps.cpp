@@ -6,7 +6,7 @@
 
 Image dm::DarkMarkLogo()
 {
-	return ImageCache::getFromMemory(swirl_300x300_green_jpg, sizeof(swirl_300x300_green_jpg));
+	return juce::ImageCache::getFromMemory(swirl_300x300_green_jpg, sizeof(swirl_300x300_green_jpg));
 }
 
 
@@ -89,17 +89,17 @@ Image dm::convert_opencv_mat_to_juce_image(const cv::Mat & mat)
 
 Image dm::AboutLogoWhiteBackground()
 {
-	return ImageCache::getFromMemory(ccr_darkmark_logo_white_background_png, sizeof(ccr_darkmark_logo_white_background_png));
+	return juce::ImageCache::getFromMemory(ccr_darkmark_logo_white_background_png, sizeof(ccr_darkmark_logo_white_background_png));
 }
 
 
 Image dm::AboutLogoRedSwirl()
 {
-	return ImageCache::getFromMemory(ccr_darkmark_logo_red_swirl_png, sizeof(ccr_darkmark_logo_red_swirl_png));
+	return juce::ImageCache::getFromMemory(ccr_darkmark_logo_red_swirl_png, sizeof(ccr_darkmark_logo_red_swirl_png));
 }
 
 
 Image dm::AboutLogoDarknet()
 {
-	return ImageCache::getFromMemory(ccr_darkmark_logo_darknet_png, sizeof(ccr_darkmark_logo_darknet_png));
+	return juce::ImageCache::getFromMemory(ccr_darkmark_logo_darknet_png, sizeof(ccr_darkmark_logo_darknet_png));
 }
@@ -0,0 +1,89 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+namespace dm
+{
+	/** A thread-safe FIFO queue with a maximum size, used to connect the stages of a pipeline.  Producers block when the
+	 * queue is full, and consumers block when the queue is empty.  This way a fast stage cannot run too far ahead of a slow
+	 * stage and fill up the memory with decoded images.
+	 *
+	 * Once the producers are done, call @ref close().  The consumers will then empty the queue, after which @ref pop()
+	 * returns @p false.
+	 */
+	template <typename T>
+	class BoundedQueue final
+	{
+		public:
+
+			BoundedQueue(const size_t max_size) :
+				capacity(std::max(size_t(1), max_size)),
+				closed(false)
+			{
+				return;
+			}
+
+			/** Add an item to the end of the queue, blocking while the queue is full.
+			 * @returns @p false if the queue has been closed, in which case the item was not added.
+			 */
+			bool push(T item)
+			{
+				std::unique_lock lock(mutex);
+				not_full.wait(lock, [&]{ return closed or queue.size() < capacity; });
+				if (closed)
+				{
+					return false;
+				}
+
+				queue.push_back(std::move(item));
+				not_empty.notify_one();
+
+				return true;
+			}
+
+			/** Remove an item from the front of the queue, blocking while the queue is empty.
+			 * @returns @p false once the queue has been closed and there are no items left.
+			 */
+			bool pop(T & item)
+			{
+				std::unique_lock lock(mutex);
+				not_empty.wait(lock, [&]{ return closed or queue.empty() == false; });
+				if (queue.empty())
+				{
+					return false;
+				}
+
+				item = std::move(queue.front());
+				queue.pop_front();
+				not_full.notify_one();
+
+				return true;
+			}
+
+			/// No more items can be added.  Wakes up all the threads waiting on the queue.
+			void close()
+			{
+				std::lock_guard lock(mutex);
+				closed = true;
+				not_full.notify_all();
+				not_empty.notify_all();
+
+				return;
+			}
+
+		private:
+
+			const size_t capacity;
+			bool closed;
+			std::deque<T> queue;
+			std::mutex mutex;
+			std::condition_variable not_full;
+			std::condition_variable not_empty;
+	};
+}
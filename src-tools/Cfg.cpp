@@ -88,6 +88,7 @@ dm::Cfg & dm::Cfg::first_time_initialization(void)
 	insert_if_not_exist("heatmap_threshold"				, 0.1												);
 	insert_if_not_exist("heatmap_visualize"				, 2													);
 	insert_if_not_exist("show_dots"						, false												);
+	insert_if_not_exist("log_level"						, "info"											); // debug, info, warning, or error
 
 	// see at the bottom of this method where these two are initialized
 	insert_if_not_exist("darknet_executable"			, ""												);
@@ -3,22 +3,369 @@
 #include "DarkMark.hpp"
 
 
-void dm::Log(const std::string & str)
+namespace
 {
-	if (not str.empty())
+	std::atomic<int> minimum_log_level = static_cast<int>(dm::ELogLevel::kInfo);
+
+	/// When set, messages go to @p STDERR instead of @p STDOUT.  See @ref dm::set_log_to_stderr().
+	std::atomic<bool> log_to_stderr = false;
+
+	/// Set once the logger has been destroyed at exit.  Anything logged after that is written immediately.
+	std::atomic<bool> logger_destroyed = false;
+
+
+	/// Small sequential number for each thread, which is easier to read in the log than @p std::thread::id.
+	size_t get_thread_number()
 	{
-		char buffer[50];
-		std::time_t tt = std::time(nullptr);
-		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S ", std::localtime(&tt));
+		static std::atomic<size_t> next_thread_number = 1;
+		thread_local const size_t thread_number = next_thread_number ++;
+
+		return thread_number;
+	}
 
-		std::cout << buffer << str << std::endl;
 
-		static std::ofstream ofs(File::getSpecialLocation(File::SpecialLocationType::tempDirectory).getChildFile("darkmark.log").getFullPathName().toStdString(), std::ofstream::trunc);
-		if (ofs.is_open())
+	const char * get_level_prefix(const dm::ELogLevel level)
+	{
+		switch (level)
 		{
-			ofs << buffer << str << std::endl << std::flush;
+			case dm::ELogLevel::kDebug:		return "DEBUG: ";
+			case dm::ELogLevel::kWarning:	return "WARNING: ";
+			case dm::ELogLevel::kError:		return "ERROR: ";
+			default:						return "";
 		}
 	}
 
+
+	std::ostream & console()
+	{
+		return log_to_stderr ? std::cerr : std::cout;
+	}
+
+
+	/** Format the complete line before writing it, so each message is written to the console with a single call and
+	 * cannot be split by output from other threads.
+	 */
+	std::string format_line(const char * timestamp, const size_t thread_number, const dm::ELogLevel level, const std::string & message)
+	{
+		std::string line;
+		line.reserve(message.size() + 50);
+		line += timestamp;
+		line += " [" + std::to_string(thread_number) + "] ";
+		line += get_level_prefix(level);
+		line += message;
+		line += "\n";
+
+		return line;
+	}
+
+
+	struct LogEntry
+	{
+		std::time_t		timestamp;
+		size_t			thread_number;
+		dm::ELogLevel	level;
+		std::string		message;
+	};
+
+
+	/** Bounded multiple-producer single-consumer queue.  Each cell has a sequence number which tells the producers and the
+	 * consumer whose turn it is to use that cell, so no locks are needed to add or remove messages.  Only the writer
+	 * thread (or a call to @ref dm::flush_log()) removes messages, and it does so while holding @ref writer_mutex.
+	 */
+	class Logger final
+	{
+		public:
+
+			Logger() :
+				cells(new Cell[capacity]),
+				enqueue_pos(0),
+				dequeue_pos(0),
+				stop_requested(false),
+				ofs(File::getSpecialLocation(File::SpecialLocationType::tempDirectory).getChildFile("darkmark.log").getFullPathName().toStdString(), std::ofstream::trunc),
+				last_timestamp(0)
+			{
+				for (size_t idx = 0; idx < capacity; idx ++)
+				{
+					cells[idx].sequence = idx;
+				}
+
+				writer = std::thread(&Logger::writer_loop, this);
+
+				return;
+			}
+
+			~Logger()
+			{
+				// anything logged from now on is written directly, and the writer thread empties the queue before exiting
+				logger_destroyed = true;
+				stop_requested = true;
+				cv.notify_one();
+				writer.join();
+
+				return;
+			}
+
+			void enqueue(LogEntry && entry)
+			{
+				const bool wake_writer = (entry.level >= dm::ELogLevel::kWarning);
+
+				size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Cell & cell = cells[pos % capacity];
+					const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+					const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+					if (difference == 0)
+					{
+						if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						{
+							cell.entry = std::move(entry);
+							cell.sequence.store(pos + 1, std::memory_order_release);
+							break;
+						}
+					}
+					else if (difference < 0)
+					{
+						// the queue is full, so wait for the writer to catch up rather than lose messages
+						if (logger_destroyed)
+						{
+							// ...unless DarkMark is exiting and the writer is gone
+							return;
+						}
+						cv.notify_one();
+						std::this_thread::yield();
+						pos = enqueue_pos.load(std::memory_order_relaxed);
+					}
+					else
+					{
+						pos = enqueue_pos.load(std::memory_order_relaxed);
+					}
+				}
+
+				if (wake_writer)
+				{
+					cv.notify_one();
+				}
+
+				return;
+			}
+
+			/** Write everything in the queue.  Returns @p false if another thread is already writing and didn't finish
+			 * within the given time, which can happen if a crash handler is called from within the writer thread.
+			 */
+			bool drain(const std::chrono::milliseconds timeout = std::chrono::milliseconds::max())
+			{
+				std::unique_lock lock(writer_mutex, std::defer_lock);
+				if (timeout == std::chrono::milliseconds::max())
+				{
+					lock.lock();
+				}
+				else if (not lock.try_lock_for(timeout))
+				{
+					return false;
+				}
+
+				bool wrote_something = false;
+				LogEntry entry;
+				while (dequeue(entry))
+				{
+					write(entry);
+					wrote_something = true;
+				}
+
+				if (wrote_something)
+				{
+					console() << std::flush;
+					if (ofs.is_open())
+					{
+						ofs << std::flush;
+					}
+				}
+
+				return true;
+			}
+
+		private:
+
+			struct Cell
+			{
+				std::atomic<size_t> sequence;
+				LogEntry entry;
+			};
+
+			/// Number of messages which can be queued before the threads calling @ref dm::Log() have to wait for the writer.
+			static constexpr size_t capacity = 8192;
+
+			/// The writer mutex must be locked prior to calling this.
+			bool dequeue(LogEntry & entry)
+			{
+				Cell & cell = cells[dequeue_pos % capacity];
+				const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				if (sequence != dequeue_pos + 1)
+				{
+					// the next cell is either empty or a producer is still copying the message into it
+					return false;
+				}
+
+				entry = std::move(cell.entry);
+				cell.sequence.store(dequeue_pos + capacity, std::memory_order_release);
+				dequeue_pos ++;
+
+				return true;
+			}
+
+			/// The writer mutex must be locked prior to calling this.
+			void write(const LogEntry & entry)
+			{
+				if (entry.timestamp != last_timestamp)
+				{
+					// many messages are logged within the same second, so only format the time when it changes
+					last_timestamp = entry.timestamp;
+					std::strftime(timestamp_text, sizeof(timestamp_text), "%Y-%m-%d %H:%M:%S", std::localtime(&entry.timestamp));
+				}
+
+				const std::string line = format_line(timestamp_text, entry.thread_number, entry.level, entry.message);
+
+				console().write(line.data(), line.size());
+				if (ofs.is_open())
+				{
+					ofs.write(line.data(), line.size());
+				}
+
+				return;
+			}
+
+			void writer_loop()
+			{
+				while (not stop_requested)
+				{
+					drain();
+
+					std::unique_lock lock(cv_mutex);
+					cv.wait_for(lock, std::chrono::milliseconds(50));
+				}
+
+				drain();
+
+				return;
+			}
+
+			std::unique_ptr<Cell[]> cells;
+
+			alignas(64) std::atomic<size_t> enqueue_pos;
+			alignas(64) size_t dequeue_pos;
+
+			std::atomic<bool> stop_requested;
+			std::mutex cv_mutex;
+			std::condition_variable cv;
+			std::timed_mutex writer_mutex;
+			std::thread writer;
+
+			std::ofstream ofs;
+
+			std::time_t last_timestamp;
+			char timestamp_text[50];
+	};
+
+
+	Logger & logger()
+	{
+		static Logger l;
+
+		return l;
+	}
+}
+
+
+void dm::Log(const ELogLevel level, const std::string & str)
+{
+	if (str.empty() or not log_enabled(level))
+	{
+		return;
+	}
+
+	LogEntry entry = {std::time(nullptr), get_thread_number(), level, str};
+
+	if (logger_destroyed)
+	{
+		// static objects are being destroyed as DarkMark exits, so there is no writer thread anymore
+		char buffer[50];
+		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&entry.timestamp));
+		const std::string line = format_line(buffer, entry.thread_number, level, str);
+		console().write(line.data(), line.size()).flush();
+		return;
+	}
+
+	logger().enqueue(std::move(entry));
+
+	return;
+}
+
+
+void dm::Log(const std::string & str)
+{
+	Log(ELogLevel::kInfo, str);
+
+	return;
+}
+
+
+bool dm::log_enabled(const ELogLevel level)
+{
+	return static_cast<int>(level) >= minimum_log_level.load(std::memory_order_relaxed);
+}
+
+
+void dm::set_log_level(const ELogLevel level)
+{
+	minimum_log_level = static_cast<int>(level);
+
+	return;
+}
+
+
+void dm::set_log_to_stderr(const bool flag)
+{
+	if (flag != log_to_stderr)
+	{
+		// anything already queued goes to the previous stream
+		flush_log();
+		log_to_stderr = flag;
+	}
+
+	return;
+}
+
+
+dm::ELogLevel dm::log_level_from_string(const std::string & str)
+{
+	const String level = String(str).trim().toLowerCase();
+
+	if (level == "debug")
+	{
+		return ELogLevel::kDebug;
+	}
+	if (level == "warning")
+	{
+		return ELogLevel::kWarning;
+	}
+	if (level == "error")
+	{
+		return ELogLevel::kError;
+	}
+
+	return ELogLevel::kInfo;
+}
+
+
+void dm::flush_log()
+{
+	if (not logger_destroyed)
+	{
+		// don't wait forever in case this is called from a crash handler while the writer thread is busy
+		logger().drain(std::chrono::milliseconds(500));
+	}
+
 	return;
 }
@@ -6,5 +6,57 @@
 
 namespace dm
 {
+	enum class ELogLevel
+	{
+		kDebug		= 0,
+		kInfo		= 1,
+		kWarning	= 2,
+		kError		= 3,
+	};
+
+	/// Returns @p true if messages at this level are written to the log.
+	bool log_enabled(const ELogLevel level);
+
+	/** Queue a message to be written to @p STDOUT (or @p STDERR, see @ref set_log_to_stderr()) and to @p darkmark.log in
+	 * the temporary directory.  The messages are written by a background thread, so the caller only pays for adding the
+	 * message to a lock-free ring buffer.  Messages below the level set with @ref set_log_level() are discarded immediately.
+	 */
+	void Log(const ELogLevel level, const std::string & str);
+
+	/// Same as calling @ref Log() with @ref ELogLevel::kInfo.
 	void Log(const std::string & str);
+
+	/** Only call @p format to create the message if @p level is enabled.  This is meant for messages in loops which are
+	 * normally disabled, such as:
+	 *
+	 * ~~~~
+	 * Log(ELogLevel::kDebug, [&]{ return "loading " + filename; });
+	 * ~~~~
+	 */
+	template <typename F, typename = std::enable_if_t<std::is_invocable_r_v<std::string, F>>>
+	void Log(const ELogLevel level, F && format)
+	{
+		if (log_enabled(level))
+		{
+			Log(level, std::string(format()));
+		}
+
+		return;
+	}
+
+	/// Set the minimum level of messages written to the log.  The default is @ref ELogLevel::kInfo.
+	void set_log_level(const ELogLevel level);
+
+	/** Write the log messages to @p STDERR instead of @p STDOUT.  This is used when @p STDOUT is reserved for output which
+	 * must be parsed, such as the JSON progress lines when running without a display.  The log file is not affected.
+	 */
+	void set_log_to_stderr(const bool flag);
+
+	/// Convert "debug", "info", "warning", or "error" to a log level.  Anything else is @ref ELogLevel::kInfo.
+	ELogLevel log_level_from_string(const std::string & str);
+
+	/** Write all queued messages before returning.  This is called when DarkMark exits or crashes so the last messages are
+	 * not lost.
+	 */
+	void flush_log();
 }
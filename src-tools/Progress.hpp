@@ -0,0 +1,31 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+
+
+namespace dm
+{
+	/** Report the progress of a long-running task.  In the GUI this is a @p ThreadWithProgressWindow, while the headless
+	 * "gen-darknet" mode prints the progress to the console.  This way the same code can run with or without a display.
+	 */
+	class Progress
+	{
+		public:
+
+			virtual ~Progress()
+			{
+				return;
+			}
+
+			/// Set the progress of the current step, between 0.0 and 1.0.
+			virtual void set_progress(const double progress) = 0;
+
+			/// Describe the current step.  This is normally called before the progress is reset back to zero.
+			virtual void set_status(const String & msg) = 0;
+
+			/// Returns @p true if the user has asked for the task to be cancelled.
+			virtual bool should_stop() = 0;
+	};
+}
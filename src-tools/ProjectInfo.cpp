@@ -62,6 +62,7 @@ dm::ProjectInfo::ProjectInfo(const std::string & prefix)
 	train_with_all_images		= cfg().get_bool	(cfg_prefix + "darknet_train_with_all_images"	, true	);
 	training_images_percentage	= cfg().get_int		(cfg_prefix + "darknet_training_percentage"		, 80	) / 100.0;
 	limit_validation_images		= cfg().get_bool	(cfg_prefix + "darknet_limit_validation_images"	, false	);
+	pack_shards					= cfg().get_bool	(cfg_prefix + "darknet_pack_shards"				, false	);
 	image_width					= cfg().get_int		(cfg_prefix + "darknet_image_width"				, 352	);
 	image_height				= cfg().get_int		(cfg_prefix + "darknet_image_height"			, 256	);
 	batch_size					= cfg().get_int		(cfg_prefix + "darknet_batch_size"				, 64	);
@@ -72,13 +73,16 @@ dm::ProjectInfo::ProjectInfo(const std::string & prefix)
 	image_type					= cfg().get_str		(cfg_prefix + "darknet_image_type"				, "both");
 	do_not_resize_images		= cfg().get_bool	(cfg_prefix + "darknet_do_not_resize_images"	, false	);
 	resize_images				= cfg().get_bool	(cfg_prefix + "darknet_resize_images"			, true	);
+	link_unmodified_images		= cfg().get_bool	(cfg_prefix + "darknet_link_unmodified_images", true	);
 	tile_images					= cfg().get_bool	(cfg_prefix + "darknet_tile_images"				, false	);
 	zoom_images					= cfg().get_bool	(cfg_prefix + "darknet_zoom_images"				, true	);
 	remove_small_annotations	= cfg().get_bool	(cfg_prefix + "darknet_remove_small_annotations", true	);
 	annotation_area_size		= cfg().get_int		(cfg_prefix + "darknet_annotation_area_size"	, 64	);
+	random_seed					= cfg().get_int		(cfg_prefix + "darknet_random_seed"				, 0		);
 	limit_negative_samples		= cfg().get_bool	(cfg_prefix + "darknet_limit_negative_samples"	, true	);
 	recalculate_anchors			= cfg().get_bool	(cfg_prefix + "darknet_recalculate_anchors"		, true	);
 	anchor_clusters				= cfg().get_int		(cfg_prefix + "darknet_anchor_clusters"			, 9		);
+	anchor_sample_size			= cfg().get_int		(cfg_prefix + "darknet_anchor_sample_size"		, 100000);
 	class_imbalance				= cfg().get_bool	(cfg_prefix + "darknet_class_imbalance"			, false	);
 	restart_training			= cfg().get_bool	(cfg_prefix + "darknet_restart_training"		, false	);
 	delete_temp_weights			= cfg().get_bool	(cfg_prefix + "darknet_delete_temp_weights"		, false	);
@@ -101,10 +105,12 @@ dm::ProjectInfo::ProjectInfo(const std::string & prefix)
 	if (options.count("subdivisions"			))	subdivisions			= toInt(options.at("subdivisions"				));
 	if (options.count("do_not_resize_images"	))	do_not_resize_images	= toBool(options.at("do_not_resize_images"		));
 	if (options.count("resize_images"			))	resize_images			= toBool(options.at("resize_images"				));
+	if (options.count("link_unmodified_images"	))	link_unmodified_images	= toBool(options.at("link_unmodified_images"	));
 	if (options.count("tile_images"				))	tile_images				= toBool(options.at("tile_images"				));
 	if (options.count("zoom_images"				))	zoom_images				= toBool(options.at("zoom_images"				));
 	if (options.count("limit_neg_samples"		))	limit_negative_samples	= toBool(options.at("limit_neg_samples"			));
 	if (options.count("limit_validation_images"	))	limit_validation_images	= toBool(options.at("limit_validation_images"	));
+	if (options.count("pack_shards"				))	pack_shards				= toBool(options.at("pack_shards"				));
 	if (options.count("yolo_anchors"			))	recalculate_anchors		= toBool(options.at("yolo_anchors"				));
 	if (options.count("learning_rate"			))	learning_rate			= toFloat(options.at("learning_rate"			));
 	if (options.count("class_imbalance"			))	class_imbalance			= toBool(options.at("class_imbalance"			));
@@ -115,6 +121,8 @@ dm::ProjectInfo::ProjectInfo(const std::string & prefix)
 	if (options.count("restart_training"		))	restart_training		= toBool(options.at("restart_training"			));
 	if (options.count("remove_small_annotations"))	remove_small_annotations= toBool(options.at("remove_small_annotations"	));
 	if (options.count("annotation_area_size"	))	annotation_area_size	= toInt(options.at("annotation_area_size"		));
+	if (options.count("random_seed"				))	random_seed				= toInt(options.at("random_seed"				));
+	if (options.count("anchor_sample_size"		))	anchor_sample_size		= toInt(options.at("anchor_sample_size"			));
 
 	if (image_type != "JPG" and
 		image_type != "PNG")
@@ -29,6 +29,7 @@ namespace dm
 			bool		train_with_all_images;		///< should we train with *all* images, or should we use @ref training_images_percentage?
 			double		training_images_percentage;	///< between 0.0 and 1.0
 			bool		limit_validation_images;	///< truncate valid.txt to limit validation images
+			bool		pack_shards;				///< also pack the training and validation images into a few large shard files
 			int			image_width;				///< must be a multiple of 32 (416, 608, 832, ...)
 			int			image_height;				///< must be a multiple of 32 (416, 608, 832, ...)
 			int			batch_size;					///< e.g., @p 64
@@ -44,11 +45,14 @@ namespace dm
 			bool		zoom_images;				///< Zoom images.
 			/// @}
 
+			bool		link_unmodified_images;		///< images which already match the network dimensions are hard-linked (or copied) into the image cache instead of being re-encoded
 			bool		remove_small_annotations;	///< whether extremely tiny annotations should be removed
 			int			annotation_area_size;		///< annotations of this size and less will be removed
+			int			random_seed;				///< master seed for the random choices made when creating the resized/tiled/zoomed images; also part of the image cache key and used to recalculate the anchors
 			bool		limit_negative_samples;		///< whether negative samples will be limited to 50% of the training images
 			bool		recalculate_anchors;		///< whether darknet will be called to recalculate anchors
 			int			anchor_clusters;			///< number of anchor clusters to use (default is 9)
+			int			anchor_sample_size;			///< maximum number of annotations used to calculate the anchors, or zero to use all of them
 			bool		class_imbalance;			///< whether counters_per_class will be added to each yolo section
 			bool		restart_training;			///< whether training should use the previous *_best.weights file or start new
 			bool		delete_temp_weights;		///< whether the temporary .weights files should be deleted once training has finished
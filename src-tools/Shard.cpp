@@ -0,0 +1,332 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include <array>
+#include <cstring>
+#include "DarkMark.hpp"
+
+
+namespace
+{
+	const char shard_signature[]	= "DMSHARD1";
+	const char record_signature[]	= "DMRC";
+	const size_t signature_size		= 8;
+	const size_t header_size		= 24;
+
+	/// Shards are read and written in large blocks to avoid many small system calls.
+	const size_t stream_buffer_size	= 8 * 1024 * 1024;
+
+
+	void put_u32(char * ptr, const uint32_t value)
+	{
+		for (size_t idx = 0; idx < 4; idx ++)
+		{
+			ptr[idx] = static_cast<char>((value >> (8 * idx)) & 0xff);
+		}
+
+		return;
+	}
+
+
+	void put_u64(char * ptr, const uint64_t value)
+	{
+		for (size_t idx = 0; idx < 8; idx ++)
+		{
+			ptr[idx] = static_cast<char>((value >> (8 * idx)) & 0xff);
+		}
+
+		return;
+	}
+
+
+	uint32_t get_u32(const char * ptr)
+	{
+		uint32_t value = 0;
+		for (size_t idx = 0; idx < 4; idx ++)
+		{
+			value |= static_cast<uint32_t>(static_cast<uint8_t>(ptr[idx])) << (8 * idx);
+		}
+
+		return value;
+	}
+
+
+	uint64_t get_u64(const char * ptr)
+	{
+		uint64_t value = 0;
+		for (size_t idx = 0; idx < 8; idx ++)
+		{
+			value |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[idx])) << (8 * idx);
+		}
+
+		return value;
+	}
+
+
+	/// Tables for the "slicing-by-8" CRC-32, which processes 8 bytes at a time.
+	const std::array<std::array<uint32_t, 256>, 8> & crc_tables()
+	{
+		static const auto tables = []()
+		{
+			std::array<std::array<uint32_t, 256>, 8> t;
+			for (uint32_t idx = 0; idx < 256; idx ++)
+			{
+				uint32_t crc = idx;
+				for (int bit = 0; bit < 8; bit ++)
+				{
+					crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+				}
+				t[0][idx] = crc;
+			}
+			for (uint32_t idx = 0; idx < 256; idx ++)
+			{
+				for (size_t slice = 1; slice < 8; slice ++)
+				{
+					t[slice][idx] = (t[slice - 1][idx] >> 8) ^ t[0][t[slice - 1][idx] & 0xff];
+				}
+			}
+			return t;
+		}();
+
+		return tables;
+	}
+}
+
+
+uint32_t dm::shard_crc32(const void * ptr, const size_t len, const uint32_t previous_crc)
+{
+	const auto & t = crc_tables();
+	const uint8_t * p = static_cast<const uint8_t *>(ptr);
+	size_t remaining = len;
+	uint32_t crc = ~previous_crc;
+
+	while (remaining >= 8)
+	{
+		const uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24));
+		crc =	t[7][lo & 0xff]			^ t[6][(lo >> 8) & 0xff]	^ t[5][(lo >> 16) & 0xff]	^ t[4][lo >> 24]	^
+				t[3][p[4]]				^ t[2][p[5]]				^ t[1][p[6]]				^ t[0][p[7]];
+		p += 8;
+		remaining -= 8;
+	}
+
+	while (remaining > 0)
+	{
+		crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+		p ++;
+		remaining --;
+	}
+
+	return ~crc;
+}
+
+
+dm::ShardWriter::ShardWriter(const std::string & shard_filename) :
+	filename(shard_filename),
+	index_filename(File(shard_filename).withFileExtension(".idx").getFullPathName().toStdString()),
+	number_of_records(0),
+	bytes_written(0),
+	buffer(stream_buffer_size)
+{
+	shard.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	shard.open(filename, std::ios::binary | std::ios::trunc);
+	index.open(index_filename, std::ios::trunc);
+	if (not shard.good() or not index.good())
+	{
+		throw std::runtime_error("failed to create shard " + filename);
+	}
+
+	shard.write(shard_signature, signature_size);
+	bytes_written = signature_size;
+
+	return;
+}
+
+
+dm::ShardWriter::~ShardWriter()
+{
+	try
+	{
+		close();
+	}
+	catch (...)
+	{
+		// destructors must not throw; call close() directly to know if the shard was written correctly
+	}
+
+	return;
+}
+
+
+dm::ShardWriter & dm::ShardWriter::add(const std::string & name, const std::string & label, const std::string & image)
+{
+	uint32_t crc = shard_crc32(name.data(), name.size());
+	crc = shard_crc32(label.data(), label.size(), crc);
+	crc = shard_crc32(image.data(), image.size(), crc);
+
+	char header[header_size];
+	std::memcpy(header, record_signature, 4);
+	put_u32(header +  4, static_cast<uint32_t>(name.size()));
+	put_u32(header +  8, static_cast<uint32_t>(label.size()));
+	put_u32(header + 12, crc);
+	put_u64(header + 16, image.size());
+
+	const uint64_t offset = bytes_written;
+	shard.write(header, header_size);
+	shard.write(name.data(), name.size());
+	shard.write(label.data(), label.size());
+	shard.write(image.data(), image.size());
+	if (not shard.good())
+	{
+		throw std::runtime_error("failed to write " + name + " to shard " + filename);
+	}
+
+	index << offset << "\t" << image.size() << "\t" << label.size() << "\t" << name << "\n";
+
+	bytes_written += header_size + name.size() + label.size() + image.size();
+	number_of_records ++;
+
+	return *this;
+}
+
+
+void dm::ShardWriter::close()
+{
+	if (shard.is_open())
+	{
+		shard.close();
+		index.close();
+		if (shard.fail() or index.fail())
+		{
+			throw std::runtime_error("failed to close shard " + filename);
+		}
+	}
+
+	return;
+}
+
+
+dm::ShardReader::ShardReader(const std::string & shard_filename) :
+	filename(shard_filename),
+	number_of_records(0),
+	bytes_read(0),
+	file_size(0),
+	buffer(stream_buffer_size)
+{
+	shard.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	shard.open(filename, std::ios::binary | std::ios::ate);
+	if (not shard.good())
+	{
+		throw std::runtime_error("failed to open shard " + filename);
+	}
+
+	// remember the size of the file so the record headers can be validated before anything is allocated
+	file_size = static_cast<uint64_t>(shard.tellg());
+	shard.seekg(0, std::ios::beg);
+
+	char signature[signature_size];
+	shard.read(signature, signature_size);
+	if (not shard.good() or std::memcmp(signature, shard_signature, signature_size) != 0)
+	{
+		throw std::runtime_error(filename + " is not a DarkMark shard");
+	}
+	bytes_read = signature_size;
+
+	return;
+}
+
+
+bool dm::ShardReader::next(ShardRecord & record)
+{
+	char header[header_size];
+	shard.read(header, header_size);
+	if (shard.gcount() == 0 and shard.eof())
+	{
+		return false;
+	}
+	if (static_cast<size_t>(shard.gcount()) != header_size)
+	{
+		throw std::runtime_error(filename + ": truncated record header at offset " + std::to_string(bytes_read));
+	}
+	if (std::memcmp(header, record_signature, 4) != 0)
+	{
+		throw std::runtime_error(filename + ": invalid record signature at offset " + std::to_string(bytes_read));
+	}
+
+	const uint32_t name_size	= get_u32(header +  4);
+	const uint32_t label_size	= get_u32(header +  8);
+	const uint32_t crc			= get_u32(header + 12);
+	const uint64_t image_size	= get_u64(header + 16);
+
+	record.offset = bytes_read;
+
+	/* The sizes come from the file, so a corrupt header could ask for many gigabytes.  Make sure the whole record fits
+	 * in what remains of the file before resizing any of the strings.
+	 */
+	uint64_t remaining = file_size - std::min(file_size, record.offset + header_size);
+	for (const uint64_t size : {static_cast<uint64_t>(name_size), static_cast<uint64_t>(label_size), image_size})
+	{
+		if (size > remaining)
+		{
+			throw std::runtime_error(filename + ": truncated record at offset " + std::to_string(record.offset));
+		}
+		remaining -= size;
+	}
+
+	read_exactly(record.name	, name_size		, record.offset);
+	read_exactly(record.label	, label_size	, record.offset);
+	read_exactly(record.image	, image_size	, record.offset);
+
+	uint32_t actual_crc = shard_crc32(record.name.data(), record.name.size());
+	actual_crc = shard_crc32(record.label.data(), record.label.size(), actual_crc);
+	actual_crc = shard_crc32(record.image.data(), record.image.size(), actual_crc);
+	if (actual_crc != crc)
+	{
+		throw std::runtime_error(filename + ": CRC mismatch for \"" + record.name + "\" at offset " + std::to_string(record.offset));
+	}
+
+	bytes_read += header_size + name_size + label_size + image_size;
+	number_of_records ++;
+
+	return true;
+}
+
+
+void dm::ShardReader::read_exactly(std::string & str, const uint64_t size, const uint64_t offset)
+{
+	str.resize(size);
+	shard.read(str.data(), size);
+	if (static_cast<uint64_t>(shard.gcount()) != size)
+	{
+		throw std::runtime_error(filename + ": truncated record at offset " + std::to_string(offset));
+	}
+
+	return;
+}
+
+
+dm::ShardIndex dm::ShardReader::load_index(const std::string & shard_filename)
+{
+	const std::string index_filename = File(shard_filename).withFileExtension(".idx").getFullPathName().toStdString();
+	std::ifstream ifs(index_filename);
+	if (not ifs.good())
+	{
+		throw std::runtime_error("failed to open shard index " + index_filename);
+	}
+
+	ShardIndex index;
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		std::istringstream iss(line);
+		ShardIndexEntry entry;
+		iss >> entry.offset >> entry.image_size >> entry.label_size;
+		iss.ignore(1, '\t');
+		std::getline(iss, entry.name);
+		if (iss.fail() and entry.name.empty())
+		{
+			throw std::runtime_error("invalid line in shard index " + index_filename + ": " + line);
+		}
+		index.push_back(entry);
+	}
+
+	return index;
+}
@@ -0,0 +1,117 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+#include <cstdint>
+
+
+namespace dm
+{
+	/// A single image and its annotations read from a shard.
+	struct ShardRecord
+	{
+		uint64_t offset;	///< Offset of the record within the shard file.
+		std::string name;
+		std::string label;
+		std::string image;
+	};
+
+	/// One line from a shard index file.
+	struct ShardIndexEntry
+	{
+		uint64_t offset;
+		uint64_t image_size;
+		uint32_t label_size;
+		std::string name;
+	};
+	using ShardIndex = std::vector<ShardIndexEntry>;
+
+	/// Calculate (or continue calculating) the CRC-32 of a block of memory.  This is the same CRC-32 used by zlib.
+	uint32_t shard_crc32(const void * ptr, const size_t len, const uint32_t previous_crc = 0);
+
+	/** Append records to a new shard file and the corresponding index.  Each instance must only be used by one thread.
+	 *
+	 * A shard packs many training images and their annotations into a single append-only file, so a dataset with
+	 * millions of images can be archived or copied as a small number of large files.  Darknet cannot read shards, so they
+	 * do not replace the individual image and annotation files used for training.  All integers are little-endian.
+	 *
+	 * The file starts with the 8-byte signature @p "DMSHARD1", followed by one record per image:
+	 *
+	 * Size			| Description
+	 * -------------|------------
+	 * 4 bytes		| record signature @p "DMRC"
+	 * 4 bytes		| length of the image name
+	 * 4 bytes		| length of the annotations
+	 * 4 bytes		| CRC-32 of the name, annotations, and image
+	 * 8 bytes		| length of the image
+	 * (variable)	| image name, typically the original filename
+	 * (variable)	| annotations in Darknet .txt format
+	 * (variable)	| image, still encoded as JPG or PNG
+	 *
+	 * Each shard has a text index with the same name and the extension @p .idx.  There is one line per record with the
+	 * offset of the record, the length of the image, the length of the annotations, and the image name, all separated by
+	 * tabs.  The index is not needed to read the shard sequentially, but allows random access to any record.
+	 */
+	class ShardWriter final
+	{
+		public:
+
+			/// Create the shard and the index file.  Any previous file with the same name is overwritten.
+			ShardWriter(const std::string & shard_filename);
+
+			~ShardWriter();
+
+			/// Append a record to the shard, and the corresponding line to the index.
+			ShardWriter & add(const std::string & name, const std::string & label, const std::string & image);
+
+			/// Flush and close both files.  This throws if anything could not be written.
+			void close();
+
+			const std::string filename;
+			const std::string index_filename;
+
+			size_t number_of_records;
+			uint64_t bytes_written;
+
+		private:
+
+			std::vector<char> buffer;
+			std::ofstream shard;
+			std::ofstream index;
+	};
+
+	/** Read the records from a shard file, from the first to the last.  The file is read with a large buffer and the
+	 * strings in the record are re-used, so iterating through a shard is mostly limited by the speed of the disk.
+	 */
+	class ShardReader final
+	{
+		public:
+
+			ShardReader(const std::string & shard_filename);
+
+			/** Read the next record.
+			 * @returns @p false once the end of the shard has been reached.
+			 * @throws std::runtime_error if the record is truncated, if a size in the header goes beyond the end of the
+			 * file, or if the signature or CRC-32 is invalid.
+			 */
+			bool next(ShardRecord & record);
+
+			/// Load the text index which accompanies the shard.
+			static ShardIndex load_index(const std::string & shard_filename);
+
+			const std::string filename;
+
+			size_t number_of_records;
+			uint64_t bytes_read;
+			uint64_t file_size;
+
+		private:
+
+			/// Read exactly @p size bytes into @p str, or throw if the shard ends first.
+			void read_exactly(std::string & str, const uint64_t size, const uint64_t offset);
+
+			std::vector<char> buffer;
+			std::ifstream shard;
+	};
+}
@@ -0,0 +1,62 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+#include <cstdint>
+
+
+namespace dm
+{
+	/** A tiny random number generator which is cheap to create and to split into independent streams.  Unlike
+	 * @ref get_random_engine() which is shared by the whole application, each thread (or each image) is expected to
+	 * create its own instance, so there is no locking and no contention.  Given the same seed, the same sequence of
+	 * numbers is always produced.
+	 *
+	 * This meets the requirements of a C++ "uniform random bit generator", so it can be used with the usual
+	 * @p std::uniform_int_distribution and @p std::uniform_real_distribution.
+	 *
+	 * See https://prng.di.unimi.it/splitmix64.c for the original algorithm.
+	 */
+	class SplitMix64 final
+	{
+		public:
+
+			using result_type = uint64_t;
+
+			SplitMix64(const uint64_t seed = 0) :
+				state(seed)
+			{
+				return;
+			}
+
+			/// Scramble the bits of a 64-bit value.  Also used to combine seeds when splitting a stream.
+			static uint64_t mix(uint64_t z)
+			{
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+				return z ^ (z >> 31);
+			}
+
+			/// Create a new independent stream from this seed and the given value, such as the hash of a filename.
+			static uint64_t split(const uint64_t seed, const uint64_t value)
+			{
+				return mix(mix(seed + 0x9e3779b97f4a7c15ULL) ^ value);
+			}
+
+			result_type operator()()
+			{
+				state += 0x9e3779b97f4a7c15ULL;
+
+				return mix(state);
+			}
+
+			static constexpr result_type min() { return 0; }
+			static constexpr result_type max() { return UINT64_MAX; }
+
+		private:
+
+			uint64_t state;
+	};
+}
@@ -88,3 +88,146 @@ std::default_random_engine & dm::get_random_engine()
 
 	return engine;
 }
+
+
+const char * dm::parse_int(const char * p, const char * const end, int & value)
+{
+	bool negative = false;
+	if (p < end and (*p == '-' or *p == '+'))
+	{
+		negative = (*p == '-');
+		p ++;
+	}
+
+	// accumulate in 64 bits so a number which does not fit in an int is rejected instead of silently wrapping around
+	const int64_t limit = static_cast<int64_t>(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+	const char * const start = p;
+	int64_t i = 0;
+	while (p < end and *p >= '0' and *p <= '9')
+	{
+		i = i * 10 + (*p - '0');
+		if (i > limit)
+		{
+			return nullptr;
+		}
+		p ++;
+	}
+
+	if (p == start)
+	{
+		return nullptr;
+	}
+
+	value = static_cast<int>(negative ? -i : i);
+
+	return p;
+}
+
+
+const char * dm::parse_float(const char * p, const char * const end, float & value)
+{
+	bool negative = false;
+	if (p < end and (*p == '-' or *p == '+'))
+	{
+		negative = (*p == '-');
+		p ++;
+	}
+
+	double mantissa		= 0.0;
+	int exponent		= 0;
+	bool found_digits	= false;
+	while (p < end and *p >= '0' and *p <= '9')
+	{
+		mantissa = mantissa * 10.0 + (*p - '0');
+		found_digits = true;
+		p ++;
+	}
+	if (p < end and *p == '.')
+	{
+		p ++;
+		while (p < end and *p >= '0' and *p <= '9')
+		{
+			mantissa = mantissa * 10.0 + (*p - '0');
+			exponent --;
+			found_digits = true;
+			p ++;
+		}
+	}
+
+	if (not found_digits)
+	{
+		return nullptr;
+	}
+
+	if (p < end and (*p == 'e' or *p == 'E'))
+	{
+		int e = 0;
+		const char * const next = parse_int(p + 1, end, e);
+		if (next)
+		{
+			exponent += e;
+			p = next;
+		}
+	}
+
+	const double d = (exponent == 0 ? mantissa : mantissa * std::pow(10.0, exponent));
+	value = static_cast<float>(negative ? -d : d);
+
+	return p;
+}
+
+
+bool dm::parse_annotation(const char * p, const char * const end, int & class_idx, float values[4])
+{
+	const auto skip_spaces = [&]()
+	{
+		while (p and p < end and (*p == ' ' or *p == '\t' or *p == '\r' or *p == '\n'))
+		{
+			p ++;
+		}
+	};
+
+	skip_spaces();
+	p = parse_int(p, end, class_idx);
+	for (size_t idx = 0; p and idx < 4; idx ++)
+	{
+		if (p < end and *p != ' ' and *p != '\t')
+		{
+			// the values must be separated by whitespace, otherwise something like "1.5" would be read as 2 numbers
+			return false;
+		}
+		skip_spaces();
+		p = parse_float(p, end, values[idx]);
+	}
+
+	// only whitespace (including the end of the line) may follow the last value
+	skip_spaces();
+
+	return (p == end);
+}
+
+
+cv::Mat dm::create_thumbnail(const cv::Mat & mat, const int height)
+{
+	if (mat.empty() or height < 1)
+	{
+		return cv::Mat();
+	}
+
+	const float size_factor = static_cast<float>(mat.rows) / mat.cols;
+	const cv::Size desired_size(std::max(1, static_cast<int>(std::round(size_factor * height))), height);
+
+	return DarkHelp::fast_resize_ignore_aspect_ratio(mat, desired_size);
+}
+
+
+cv::Mat dm::load_thumbnail(const std::string & filename, const int height)
+{
+	cv::Mat mat = cv::imread(filename, cv::IMREAD_REDUCED_COLOR_4);
+	if (mat.empty() or mat.rows < height)
+	{
+		mat = cv::imread(filename);
+	}
+
+	return create_thumbnail(mat, height);
+}
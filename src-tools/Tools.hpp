@@ -12,4 +12,30 @@ namespace dm
 
 	/// Used to generate random numbers.
 	std::default_random_engine & get_random_engine();
+
+	/** Parse an integer in the style of @p std::from_chars(), but without depending on the locale or on a recent compiler.
+	 * @returns a pointer to the first character after the number, or @p nullptr if there is no number or if the number
+	 * does not fit in an @p int.
+	 */
+	const char * parse_int(const char * p, const char * const end, int & value);
+
+	/** Parse a float such as @p 0.1234567890 the same way as @ref parse_int().  This is all that is needed for the values
+	 * DarkMark writes to the .txt files, and is many times faster than reading them with @p std::ifstream.
+	 */
+	const char * parse_float(const char * p, const char * const end, float & value);
+
+	/** Parse one line of a YOLO .txt annotation file:  the class and the normalized @p x, @p y, @p w, and @p h values.
+	 * The values are separated by spaces or tabs, and only whitespace may follow the 5th value.
+	 * @returns @p false if the line is not exactly 5 numbers.
+	 */
+	bool parse_annotation(const char * p, const char * const end, int & class_idx, float values[4]);
+
+	/// Resize an image which has already been decoded to a thumbnail which is @p height pixels high.
+	cv::Mat create_thumbnail(const cv::Mat & mat, const int height);
+
+	/** Load an image as a thumbnail which is @p height pixels high.  Only a few pixels are needed, so the image is decoded
+	 * at 1/4 of the size unless that would be smaller than the thumbnail.
+	 * @returns an empty @p cv::Mat if the image cannot be read.
+	 */
+	cv::Mat load_thumbnail(const std::string & filename, const int height);
 }
@@ -0,0 +1,273 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+
+
+dm::WorkPool::Job::Job(const std::string & n, const size_t count) :
+	name(n),
+	number_of_tasks(count),
+	tasks_finished(0),
+	cancelled(false)
+{
+	return;
+}
+
+
+void dm::WorkPool::Job::cancel()
+{
+	cancelled = true;
+
+	return;
+}
+
+
+bool dm::WorkPool::Job::is_cancelled() const
+{
+	return cancelled;
+}
+
+
+bool dm::WorkPool::Job::is_done() const
+{
+	std::lock_guard lock(mutex);
+
+	return tasks_finished >= number_of_tasks;
+}
+
+
+double dm::WorkPool::Job::progress() const
+{
+	std::lock_guard lock(mutex);
+
+	if (number_of_tasks == 0)
+	{
+		return 1.0;
+	}
+
+	return static_cast<double>(tasks_finished) / static_cast<double>(number_of_tasks);
+}
+
+
+void dm::WorkPool::Job::wait(const std::function<void(const double)> & progress_callback, const std::chrono::milliseconds interval)
+{
+	std::unique_lock lock(mutex);
+
+	while (tasks_finished < number_of_tasks)
+	{
+		cv.wait_for(lock, interval, [&]{ return tasks_finished >= number_of_tasks; });
+
+		if (progress_callback)
+		{
+			const double fraction = static_cast<double>(tasks_finished) / static_cast<double>(number_of_tasks);
+
+			// do not hold the lock while calling back into the GUI, otherwise the workers would be blocked
+			lock.unlock();
+			progress_callback(fraction);
+			lock.lock();
+		}
+	}
+
+	if (not first_error.empty())
+	{
+		throw std::runtime_error(first_error);
+	}
+
+	return;
+}
+
+
+void dm::WorkPool::Job::task_finished(const std::string & error)
+{
+	std::lock_guard lock(mutex);
+
+	if (not error.empty())
+	{
+		Log(name + ": " + error);
+		if (first_error.empty())
+		{
+			first_error = error;
+		}
+
+		// once a task has failed there is no point in continuing with the rest of the tasks in this job
+		cancelled = true;
+	}
+
+	tasks_finished ++;
+	cv.notify_all();
+
+	return;
+}
+
+
+dm::WorkPool::WorkPool(size_t number_of_workers) :
+	tasks_pending(0),
+	next_worker(0),
+	stopping(false)
+{
+	if (number_of_workers == 0)
+	{
+		number_of_workers = number_of_worker_threads();
+	}
+
+	Log("starting work pool with " + std::to_string(number_of_workers) + " threads");
+
+	for (size_t idx = 0; idx < number_of_workers; idx ++)
+	{
+		workers.emplace_back(new Worker);
+	}
+
+	for (size_t idx = 0; idx < number_of_workers; idx ++)
+	{
+		threads.emplace_back(&WorkPool::worker_loop, this, idx);
+	}
+
+	return;
+}
+
+
+dm::WorkPool::~WorkPool()
+{
+	if (true)
+	{
+		std::lock_guard lock(sleep_mutex);
+		stopping = true;
+	}
+	sleep_cv.notify_all();
+
+	for (auto & t : threads)
+	{
+		t.join();
+	}
+
+	return;
+}
+
+
+dm::WorkPool::SJob dm::WorkPool::submit(const std::string & name, Tasks tasks)
+{
+	SJob job = std::make_shared<Job>(name, tasks.size());
+
+	if (tasks.empty())
+	{
+		return job;
+	}
+
+	std::lock_guard lock(sleep_mutex);
+
+	// deal the tasks out to the workers; anything that ends up on a busy worker will be stolen by the idle workers
+	for (auto & task : tasks)
+	{
+		auto & worker = *workers[next_worker];
+		next_worker = (next_worker + 1) % workers.size();
+
+		std::lock_guard worker_lock(worker.mutex);
+		worker.queue.push_back({job, std::move(task)});
+	}
+
+	tasks_pending += tasks.size();
+	sleep_cv.notify_all();
+
+	return job;
+}
+
+
+bool dm::WorkPool::next_task(const size_t worker_idx, Item & item)
+{
+	// first we look at our own queue
+	if (true)
+	{
+		auto & worker = *workers[worker_idx];
+		std::lock_guard lock(worker.mutex);
+		if (not worker.queue.empty())
+		{
+			item = std::move(worker.queue.front());
+			worker.queue.pop_front();
+			return true;
+		}
+	}
+
+	// if we get here then our queue is empty, so steal from the back of the other queues
+	for (size_t offset = 1; offset < workers.size(); offset ++)
+	{
+		auto & worker = *workers[(worker_idx + offset) % workers.size()];
+		std::lock_guard lock(worker.mutex);
+		if (not worker.queue.empty())
+		{
+			item = std::move(worker.queue.back());
+			worker.queue.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void dm::WorkPool::worker_loop(const size_t worker_idx)
+{
+	while (true)
+	{
+		Item item;
+		if (next_task(worker_idx, item))
+		{
+			if (true)
+			{
+				std::lock_guard lock(sleep_mutex);
+				tasks_pending --;
+			}
+
+			std::string error;
+			if (not item.job->is_cancelled())
+			{
+				try
+				{
+					item.task(worker_idx);
+				}
+				catch (const std::exception & e)
+				{
+					error = e.what();
+				}
+				catch (...)
+				{
+					error = "unknown exception";
+				}
+			}
+
+			item.job->task_finished(error);
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex);
+		sleep_cv.wait(lock, [&]{ return stopping or tasks_pending > 0; });
+		if (stopping and tasks_pending == 0)
+		{
+			break;
+		}
+	}
+
+	return;
+}
+
+
+dm::WorkPool & dm::work_pool()
+{
+	static WorkPool pool;
+
+	return pool;
+}
+
+
+size_t dm::number_of_worker_threads()
+{
+	const auto & options = dmapp().cli_options;
+	if (options.count("jobs"))
+	{
+		const int jobs = std::atoi(options.at("jobs").c_str());
+		if (jobs > 0)
+		{
+			return jobs;
+		}
+	}
+
+	return std::max(2U, std::thread::hardware_concurrency());
+}
@@ -0,0 +1,118 @@
+// DarkMark (C) 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+
+#pragma once
+
+#include "DarkMark.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+namespace dm
+{
+	/** Pool of worker threads shared by the long-running parts of DarkMark, such as exporting the Darknet files.  Each
+	 * worker has a queue of tasks.  When a worker runs out of tasks, it "steals" tasks from the end of the other queues.
+	 * This way a few very slow tasks (for example, huge images) don't leave the other cores idle.
+	 *
+	 * Normally the pool is accessed with @ref dm::work_pool().
+	 */
+	class WorkPool final
+	{
+		public:
+
+			/// Tasks are given the index of the worker thread on which they are running.
+			using Task	= std::function<void(const size_t worker_idx)>;
+			using Tasks	= std::vector<Task>;
+
+			/** A group of related tasks submitted together.  The tasks can be cancelled as a group, and the caller waits on
+			 * a condition variable for the tasks to finish instead of polling.
+			 */
+			class Job final
+			{
+				public:
+
+					Job(const std::string & n, const size_t count);
+
+					/// Tasks in this job which have not yet started will be skipped.  Tasks already running are not interrupted.
+					void cancel();
+
+					bool is_cancelled() const;
+
+					bool is_done() const;
+
+					/// Fraction of the tasks which have finished, between 0.0 and 1.0.
+					double progress() const;
+
+					/** Block until all the tasks have finished.  The @p progress_callback is called every @p interval while
+					 * waiting.  If one of the tasks threw an exception, then the first error is re-thrown once all the tasks
+					 * have finished or been skipped.
+					 */
+					void wait(const std::function<void(const double)> & progress_callback = nullptr, const std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+
+					const std::string name;
+					const size_t number_of_tasks;
+
+				private:
+
+					friend class WorkPool;
+
+					void task_finished(const std::string & error);
+
+					mutable std::mutex mutex;
+					std::condition_variable cv;
+					size_t tasks_finished;
+					std::atomic<bool> cancelled;
+					std::string first_error;
+			};
+			using SJob = std::shared_ptr<Job>;
+
+			/// When @p number_of_workers is zero, @ref number_of_worker_threads() is used.
+			WorkPool(size_t number_of_workers = 0);
+
+			~WorkPool();
+
+			/// The number of worker threads.
+			size_t size() const { return workers.size(); }
+
+			/// Queue up all the tasks.  This returns immediately; call @ref Job::wait() to wait for the tasks to finish.
+			SJob submit(const std::string & name, Tasks tasks);
+
+		private:
+
+			struct Item
+			{
+				SJob job;
+				Task task;
+			};
+
+			struct Worker
+			{
+				std::mutex mutex;
+				std::deque<Item> queue;
+			};
+
+			void worker_loop(const size_t worker_idx);
+
+			/// Get the next task for this worker, either from the front of its own queue or from the back of another queue.
+			bool next_task(const size_t worker_idx, Item & item);
+
+			std::vector<std::unique_ptr<Worker>> workers;
+			VThreads threads;
+
+			std::mutex sleep_mutex;
+			std::condition_variable sleep_cv;
+			size_t tasks_pending;
+			size_t next_worker;
+			bool stopping;
+	};
+
+	/// The work pool shared across all of DarkMark.  It is created the first time it is needed.
+	WorkPool & work_pool();
+
+	/** The number of threads to use for CPU-bound work.  This is the number of hardware threads, unless a different value
+	 * was given on the command line with @p jobs=...
+	 */
+	size_t number_of_worker_threads();
+}
@@ -0,0 +1,202 @@
+// DarkMark (C) 2019-2026 Stephane Charette <stephanecharette@gmail.com>
+
+#include "DarkMark.hpp"
+
+
+/// The results of checking a single shard.
+struct ShardResult
+{
+	std::string filename;
+	size_t records;
+	uint64_t bytes;
+	size_t undecodable_images;
+	std::string error;
+};
+using ShardResults = std::vector<ShardResult>;
+
+
+void verify_shard(ShardResult & result, const bool decode_images)
+{
+	// many copies of this are started, each on a new thread
+
+	try
+	{
+		dm::ShardReader reader(result.filename);
+		const dm::ShardIndex index = dm::ShardReader::load_index(result.filename);
+
+		dm::ShardRecord record;
+		while (reader.next(record))
+		{
+			const size_t idx = reader.number_of_records - 1;
+			if (idx >= index.size())
+			{
+				throw std::runtime_error("record #" + std::to_string(idx) + " \"" + record.name + "\" is missing from the index");
+			}
+
+			const auto & entry = index[idx];
+			if (entry.offset != record.offset or entry.image_size != record.image.size() or entry.label_size != record.label.size() or entry.name != record.name)
+			{
+				throw std::runtime_error("record #" + std::to_string(idx) + " \"" + record.name + "\" does not match the index");
+			}
+
+			if (decode_images)
+			{
+				const cv::Mat encoded(1, static_cast<int>(record.image.size()), CV_8UC1, record.image.data());
+				if (cv::imdecode(encoded, cv::IMREAD_UNCHANGED).empty())
+				{
+					std::cout << std::endl << "cannot decode " << record.name << " in " << result.filename << std::endl;
+					result.undecodable_images ++;
+				}
+			}
+
+			result.records	= reader.number_of_records;
+			result.bytes	= reader.bytes_read;
+		}
+
+		if (reader.number_of_records != index.size())
+		{
+			throw std::runtime_error("the index has " + std::to_string(index.size()) + " records but the shard has " + std::to_string(reader.number_of_records));
+		}
+	}
+	catch (const std::exception & e)
+	{
+		result.error = e.what();
+	}
+
+	return;
+}
+
+
+int main(int argc, char * argv[])
+{
+	int rc = 1;
+
+	try
+	{
+		if (argc < 2)
+		{
+			std::cout
+				<< "Verify the shards created by DarkMark when \"pack images into shards\" is enabled." << std::endl
+				<< "Every record is read and the CRC-32 is checked.  Use \"--decode\" to also decode every image." << std::endl
+				<< "Shards can be specified individually, or as a directory which contains shards." << std::endl
+				<< "" << std::endl
+				<< "Example 1:  " << argv[0] << " ~/nn/cars/darkmark_shards/" << std::endl
+				<< "Example 2:  " << argv[0] << " --decode ~/nn/cars/darkmark_shards/train_00000.dmshard" << std::endl;
+
+			throw std::invalid_argument("no shard specified");
+		}
+
+		bool decode_images = false;
+		dm::SStr all_shards;
+		for (int i = 1; i < argc; i ++)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--decode")
+			{
+				decode_images = true;
+				continue;
+			}
+
+			File f(arg);
+			if (not f.exists())
+			{
+				throw std::invalid_argument("\"" + f.getFullPathName().toStdString() + "\" does not exist");
+			}
+
+			if (f.isDirectory())
+			{
+				for (const auto & file : f.findChildFiles(File::TypesOfFileToFind::findFiles, false, "*.dmshard"))
+				{
+					all_shards.insert(file.getFullPathName().toStdString());
+				}
+			}
+			else
+			{
+				all_shards.insert(f.getFullPathName().toStdString());
+			}
+		}
+
+		ShardResults results;
+		for (const auto & fn : all_shards)
+		{
+			results.push_back({fn, 0, 0, 0, ""});
+		}
+
+		std::cout
+			<< "Number of shards to verify .................. " << results.size() << std::endl
+			<< "Decode images ............................... " << (decode_images ? "yes" : "no") << std::endl;
+
+		// each thread takes the next shard which has not yet been verified
+		const size_t nproc = std::min(results.size(), static_cast<size_t>(std::max(1U, std::thread::hardware_concurrency())));
+		std::atomic<size_t> next_shard = 0;
+		std::atomic<size_t> shards_done = 0;
+		const auto start_time = std::chrono::high_resolution_clock::now();
+
+		dm::VThreads threads;
+		for (size_t idx = 0; idx < nproc; idx ++)
+		{
+			threads.emplace_back(
+				[&]()
+				{
+					for (size_t shard_idx = next_shard ++; shard_idx < results.size(); shard_idx = next_shard ++)
+					{
+						verify_shard(results[shard_idx], decode_images);
+						shards_done ++;
+					}
+				});
+		}
+		while (shards_done < results.size())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(750));
+			std::cout << "\rVerifying shards ............................ " << shards_done << "/" << results.size() << " " << std::flush;
+		}
+		std::cout << std::endl;
+		for (auto & t : threads)
+		{
+			t.join();
+		}
+
+		const auto end_time = std::chrono::high_resolution_clock::now();
+		const double seconds = std::max(0.001, std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time).count());
+
+		size_t total_records		= 0;
+		uint64_t total_bytes		= 0;
+		size_t total_errors			= 0;
+		size_t total_undecodable	= 0;
+		for (const auto & result : results)
+		{
+			total_records		+= result.records;
+			total_bytes			+= result.bytes;
+			total_undecodable	+= result.undecodable_images;
+
+			if (result.error.empty())
+			{
+				std::cout << "-> " << result.filename << ": " << result.records << " records" << std::endl;
+			}
+			else
+			{
+				std::cout << "-> " << result.filename << ": \x1b[1;31mERROR: " << result.error << "\x1b[0m" << std::endl;
+				total_errors ++;
+			}
+		}
+
+		std::cout
+			<< "Number of records ........................... " << total_records << std::endl
+			<< "Number of bytes read ........................ " << total_bytes << std::endl
+			<< "Throughput .................................. " << std::fixed << std::setprecision(1) << (total_bytes / 1024.0 / 1024.0 / seconds) << " MiB/s" << std::endl
+			<< "Number of shards with errors ................ " << total_errors << std::endl;
+		if (decode_images)
+		{
+			std::cout << "Number of images which cannot be decoded .... " << total_undecodable << std::endl;
+		}
+
+		rc = (total_errors == 0 and total_undecodable == 0) ? 0 : 1;
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << std::endl << "ERROR: " << e.what() << std::endl;
+		rc = 2;
+	}
+
+	return rc;
+}